@@ -2,6 +2,8 @@
 
 #include <stdint.h>
 
+#include <parameter_dictionary/parameter_dictionary.h>
+
 namespace thrust_mapping {
 
 class CollectiveThrustMapping {
@@ -20,6 +22,8 @@ class CollectiveThrustMapping {
                                 const double battery_voltage) const;
 
   bool loadParameters();
+  bool loadParameters(
+      const parameter_dictionary::ParameterDictionary& parameters);
 
  private:
   double thrust_map_a_;
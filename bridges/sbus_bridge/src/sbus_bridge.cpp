@@ -1,8 +1,8 @@
 #include "sbus_bridge/sbus_bridge.h"
 
+#include <parameter_dictionary/parameter_dictionary.h>
 #include <quadrotor_common/geometry_eigen_conversions.h>
 #include <quadrotor_common/math_common.h>
-#include <quadrotor_common/parameter_helper.h>
 #include <quadrotor_msgs/LowLevelFeedback.h>
 #include <Eigen/Dense>
 
@@ -525,8 +525,15 @@ void SBusBridge::publishLowLevelFeedback(const ros::TimerEvent& time) const {
 }
 
 bool SBusBridge::loadParameters() {
+  // Fetch the whole namespace at once instead of requesting every parameter
+  // from the parameter server individually
+  parameter_dictionary::ParameterDictionary parameters;
+  if (!parameters.fetch(pnh_)) {
+    return false;
+  }
+
 #define GET_PARAM(name) \
-  if (!quadrotor_common::getParam(#name, name##_, pnh_)) return false
+  if (!parameters.getParam(#name, name##_)) return false
 
   GET_PARAM(port_name);
   GET_PARAM(enable_receiving_sbus_messages);
@@ -554,7 +561,7 @@ bool SBusBridge::loadParameters() {
   GET_PARAM(perform_thrust_voltage_compensation);
   GET_PARAM(n_lipo_cells);
 
-  if (!thrust_mapping_.loadParameters()) {
+  if (!thrust_mapping_.loadParameters(parameters)) {
     return false;
   }
 
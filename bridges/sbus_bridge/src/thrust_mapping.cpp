@@ -1,6 +1,5 @@
 #include "sbus_bridge/thrust_mapping.h"
 
-#include <quadrotor_common/parameter_helper.h>
 #include <ros/ros.h>
 
 namespace thrust_mapping {
@@ -55,10 +54,18 @@ uint16_t CollectiveThrustMapping::inverseThrustMapping(
 }
 
 bool CollectiveThrustMapping::loadParameters() {
-  ros::NodeHandle pnh("~");
+  parameter_dictionary::ParameterDictionary parameters;
+  if (!parameters.fetch(ros::NodeHandle("~"))) {
+    return false;
+  }
+
+  return loadParameters(parameters);
+}
 
+bool CollectiveThrustMapping::loadParameters(
+    const parameter_dictionary::ParameterDictionary& parameters) {
 #define GET_PARAM(name) \
-  if (!quadrotor_common::getParam(#name, name##_, pnh)) return false
+  if (!parameters.getParam(#name, name##_)) return false
 
   GET_PARAM(thrust_map_a);
   GET_PARAM(thrust_map_b);
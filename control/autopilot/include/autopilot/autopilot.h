@@ -1,7 +1,10 @@
 #pragma once
 
 #include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <thread>
 
@@ -18,11 +21,14 @@
 #include <quadrotor_msgs/LowLevelFeedback.h>
 #include <quadrotor_msgs/Trajectory.h>
 #include <quadrotor_msgs/TrajectoryPoint.h>
+#include <ros/callback_queue.h>
 #include <ros/ros.h>
 #include <state_predictor/state_predictor.h>
 #include <std_msgs/Empty.h>
+#include <trajectory_generation_helper/trajectory_cache.h>
 
 #include "autopilot/autopilot_states.h"
+#include "autopilot/clock.h"
 
 namespace autopilot {
 
@@ -31,7 +37,11 @@ class AutoPilot {
  public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
-  AutoPilot(const ros::NodeHandle& nh, const ros::NodeHandle& pnh);
+  AutoPilot(const ros::NodeHandle& nh, const ros::NodeHandle& pnh,
+            const std::shared_ptr<const Clock>& clock);
+
+  AutoPilot(const ros::NodeHandle& nh, const ros::NodeHandle& pnh)
+      : AutoPilot(nh, pnh, std::make_shared<RosClock>()) {}
 
   AutoPilot() : AutoPilot(ros::NodeHandle(), ros::NodeHandle("~")) {}
 
@@ -40,6 +50,7 @@ class AutoPilot {
  private:
   void watchdogThread();
   void goToPoseThread();
+  void shadowControllerThread();
 
   void stateEstimateCallback(const nav_msgs::Odometry::ConstPtr& msg);
   void lowLevelFeedbackCallback(
@@ -51,6 +62,8 @@ class AutoPilot {
   void referenceStateCallback(
       const quadrotor_msgs::TrajectoryPoint::ConstPtr& msg);
   void trajectoryCallback(const quadrotor_msgs::Trajectory::ConstPtr& msg);
+  void replannedTrajectoryCallback(
+      const quadrotor_msgs::Trajectory::ConstPtr& msg);
   void controlCommandInputCallback(
       const quadrotor_msgs::ControlCommand::ConstPtr& msg);
   void startCallback(const std_msgs::Empty::ConstPtr& msg);
@@ -59,31 +72,42 @@ class AutoPilot {
   void offCallback(const std_msgs::Empty::ConstPtr& msg);
 
   quadrotor_common::ControlCommand start(
-      const quadrotor_common::QuadStateEstimate& state_estimate);
+      const quadrotor_common::QuadStateEstimate& state_estimate,
+      const ros::Time& time_now);
   quadrotor_common::ControlCommand hover(
       const quadrotor_common::QuadStateEstimate& state_estimate);
   quadrotor_common::ControlCommand land(
-      const quadrotor_common::QuadStateEstimate& state_estimate);
+      const quadrotor_common::QuadStateEstimate& state_estimate,
+      const ros::Time& time_now);
   quadrotor_common::ControlCommand breakVelocity(
-      const quadrotor_common::QuadStateEstimate& state_estimate);
+      const quadrotor_common::QuadStateEstimate& state_estimate,
+      const ros::Time& time_now);
   quadrotor_common::ControlCommand waitForGoToPoseAction(
       const quadrotor_common::QuadStateEstimate& state_estimate);
   quadrotor_common::ControlCommand velocityControl(
-      const quadrotor_common::QuadStateEstimate& state_estimate);
+      const quadrotor_common::QuadStateEstimate& state_estimate,
+      const ros::Time& time_now);
   quadrotor_common::ControlCommand followReference(
-      const quadrotor_common::QuadStateEstimate& state_estimate);
+      const quadrotor_common::QuadStateEstimate& state_estimate,
+      const ros::Time& time_now);
   quadrotor_common::ControlCommand executeTrajectory(
       const quadrotor_common::QuadStateEstimate& state_estimate,
+      const ros::Time& time_now,
       ros::Duration* trajectory_execution_left_duration,
       int* trajectories_left_in_queue);
 
-  void setAutoPilotState(const States& new_state);
-  void setAutoPilotStateForced(const States& new_state);
-  double timeInCurrentState() const;
+  void setAutoPilotState(const States& new_state, const ros::Time& time_now);
+  void setAutoPilotStateForced(const States& new_state,
+                               const ros::Time& time_now);
+  double timeInCurrentState(const ros::Time& time_now) const;
   quadrotor_common::QuadStateEstimate getPredictedStateEstimate(
       const ros::Time& time) const;
 
   void publishControlCommand(const quadrotor_common::ControlCommand& command);
+  void feedShadowController(
+      const quadrotor_common::QuadStateEstimate& state_estimate,
+      const quadrotor_common::ControlCommand& base_command,
+      const ros::Duration& base_computation_time);
   void publishAutopilotFeedback(
       const States& autopilot_state, const ros::Duration& control_command_delay,
       const ros::Duration& control_computation_time,
@@ -91,19 +115,30 @@ class AutoPilot {
       const int trajectories_left_in_queue,
       const quadrotor_msgs::LowLevelFeedback& low_level_feedback,
       const quadrotor_common::TrajectoryPoint& reference_state,
-      const quadrotor_common::QuadStateEstimate& state_estimate);
+      const quadrotor_common::QuadStateEstimate& state_estimate,
+      const ros::Time& time_now);
 
   bool loadParameters();
 
   ros::NodeHandle nh_;
   ros::NodeHandle pnh_;
 
+  std::shared_ptr<const Clock> clock_;
+
+  // Control command inputs are handled in their own callback queue and
+  // spinner thread so they are not queued behind the other callbacks
+  ros::NodeHandle command_feedthrough_nh_;
+  ros::CallbackQueue command_feedthrough_queue_;
+  ros::AsyncSpinner command_feedthrough_spinner_;
+
   // Main mutex:
   // This mutex is locked in the watchdogThread and all the Callback functions
   // All other functions should only be called from one of those and therefore
   // do not need to lock the mutex themselves
   // The functions that lock the mutex do so at their start of execution and
   // keep it locked until they are finished
+  // The only exception is the controlCommandInputCallback which only locks it
+  // to switch to COMMAND_FEEDTHROUGH and forwards commands without it
   mutable std::mutex main_mutex_;
 
   // Go to pose mutex:
@@ -115,8 +150,25 @@ class AutoPilot {
   // - received_go_to_pose_command_
   mutable std::mutex go_to_pose_mutex_;
 
+  // Shadow controller mutex:
+  // This mutex is locked in the shadowControllerThread and in
+  // feedShadowController. The control loop only ever tries to lock it and
+  // skips handing over its inputs if it is not available, so the shadow
+  // controller can never delay the base controller
+  // It specifically protects
+  // - shadow_controller_input_available_
+  // - shadow_controller_state_estimate_
+  // - shadow_controller_reference_trajectory_
+  // - shadow_controller_base_command_
+  // - shadow_controller_base_computation_time_
+  // - shadow_controller_input_handover_time_
+  mutable std::mutex shadow_controller_mutex_;
+  std::condition_variable shadow_controller_cv_;
+
   ros::Publisher control_command_pub_;
   ros::Publisher autopilot_feedback_pub_;
+  ros::Publisher shadow_controller_feedback_pub_;
+  ros::Publisher command_feedthrough_latency_pub_;
 
   ros::Subscriber state_estimate_sub_;
   ros::Subscriber low_level_feedback_sub_;
@@ -124,6 +176,7 @@ class AutoPilot {
   ros::Subscriber velocity_command_sub_;
   ros::Subscriber reference_state_sub_;
   ros::Subscriber trajectory_sub_;
+  ros::Subscriber replanned_trajectory_sub_;
   ros::Subscriber control_command_input_sub_;
   ros::Subscriber start_sub_;
   ros::Subscriber force_hover_sub_;
@@ -135,7 +188,15 @@ class AutoPilot {
   Tcontroller base_controller_;
   Tparams base_controller_params_;
 
+  // Shadow controller that runs on the same inputs as the base controller
+  // but whose commands are only published for comparison and never sent to
+  // the vehicle
+  Tcontroller shadow_controller_;
+  Tparams shadow_controller_params_;
+
   quadrotor_common::TrajectoryPoint reference_state_;
+  // Only valid within a control cycle, it is handed over to the shadow
+  // controller by swapping it out in feedShadowController
   quadrotor_common::Trajectory reference_trajectory_;
 
   // Values received from callbacks
@@ -167,14 +228,36 @@ class AutoPilot {
   geometry_msgs::PoseStamped requested_go_to_pose_;
   bool received_go_to_pose_command_;
   std::atomic_bool stop_go_to_pose_thread_;
+  // Repeated requests to the same pose reuse the previous trajectory
+  trajectory_generation_helper::polynomials::TrajectoryCache
+      go_to_pose_trajectory_cache_;
 
   // Trajectory execution variables
   std::list<quadrotor_common::Trajectory> trajectory_queue_;
   ros::Time time_start_trajectory_execution_;
+  // Replaces the trajectory queue once its start time is reached
+  quadrotor_common::Trajectory replanned_trajectory_;
+  ros::Time time_start_replanned_trajectory_;
+  bool received_replanned_trajectory_;
 
   // Control command input variables
-  ros::Time time_last_control_command_input_received_;
-  bool last_control_command_input_thrust_high_;
+  // These are atomic since they are accessed without locking the main mutex
+  std::atomic_bool command_feedthrough_active_;
+  // Held while forwarding a control command input and while changing
+  // command_feedthrough_active_
+  std::mutex command_feedthrough_mutex_;
+  std::atomic<uint64_t> time_last_control_command_input_received_nsec_;
+  std::atomic_bool last_control_command_input_thrust_high_;
+
+  // Shadow controller variables
+  std::thread shadow_controller_thread_;
+  std::atomic_bool stop_shadow_controller_thread_;
+  bool shadow_controller_input_available_;
+  quadrotor_common::QuadStateEstimate shadow_controller_state_estimate_;
+  quadrotor_common::Trajectory shadow_controller_reference_trajectory_;
+  quadrotor_common::ControlCommand shadow_controller_base_command_;
+  ros::Duration shadow_controller_base_computation_time_;
+  ros::WallTime shadow_controller_input_handover_time_;
 
   // Watchdog
   std::thread watchdog_thread_;
@@ -211,6 +294,8 @@ class AutoPilot {
   double control_command_input_timeout_;
   bool enable_command_feedthrough_;
   double predictive_control_lookahead_;
+  bool enable_shadow_controller_;
+  int shadow_controller_cpu_core_;
 
   // Constants
   static constexpr double kVelocityCommandZeroThreshold_ = 0.03;
@@ -222,7 +307,9 @@ class AutoPilot {
   static constexpr double kGoToPoseTrajectorySamplingFrequency_ = 50.0;
   static constexpr int kGoToPosePolynomialOrderOfContinuity_ = 5;
   static constexpr double kGoToPoseNeglectThreshold_ = 0.05;
+  static constexpr int kGoToPoseTrajectoryCacheSize_ = 20;
   static constexpr double kThrustHighThreshold_ = 0.5;
+  static constexpr double kShadowControllerIdleFrequency_ = 50.0;
 };
 
 }  // namespace autopilot
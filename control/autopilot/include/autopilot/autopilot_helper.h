@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string>
+
 #include <quadrotor_common/control_command.h>
 #include <quadrotor_common/quad_state_estimate.h>
 #include <quadrotor_common/trajectory.h>
@@ -67,6 +69,13 @@ class AutoPilotHelper {
   void sendReferenceState(
       const quadrotor_common::TrajectoryPoint& trajectory_point) const;
   void sendTrajectory(const quadrotor_common::Trajectory& trajectory) const;
+  // Replaces the trajectories queued in the autopilot at start_time by a
+  // replanned trajectory that continues from the reference state at that time
+  void sendReplannedTrajectory(const quadrotor_common::Trajectory& trajectory,
+                               const ros::Time& start_time) const;
+  // Sends a trajectory stored with polynomial_trajectories::saveTrajectoryFile.
+  // Polynomial trajectories are sampled before they are sent.
+  bool sendTrajectoryFile(const std::string& file_name) const;
   void sendControlCommandInput(
       const quadrotor_common::ControlCommand& control_command) const;
 
@@ -86,6 +95,7 @@ class AutoPilotHelper {
   ros::Publisher velocity_pub_;
   ros::Publisher reference_state_pub_;
   ros::Publisher trajectory_pub_;
+  ros::Publisher replanned_trajectory_pub_;
   ros::Publisher control_command_input_pub_;
 
   ros::Publisher start_pub_;
@@ -102,6 +112,7 @@ class AutoPilotHelper {
 
   // Constants
   static constexpr double kFeedbackValidTimeout_ = 2.0;
+  static constexpr double kTrajectoryFileSamplingFrequency_ = 50.0;
 };
 
 }  // namespace autopilot_helper
@@ -1,8 +1,12 @@
 #pragma once
 
+#include <pthread.h>
+
+#include <autopilot/CommandFeedthroughLatency.h>
+#include <autopilot/ShadowControllerFeedback.h>
+#include <parameter_dictionary/parameter_dictionary.h>
 #include <quadrotor_common/geometry_eigen_conversions.h>
 #include <quadrotor_common/math_common.h>
-#include <quadrotor_common/parameter_helper.h>
 #include <quadrotor_msgs/AutopilotFeedback.h>
 #include <trajectory_generation_helper/heading_trajectory_helper.h>
 #include <trajectory_generation_helper/polynomial_trajectory_helper.h>
@@ -10,10 +14,15 @@
 namespace autopilot {
 
 template <typename Tcontroller, typename Tparams>
-AutoPilot<Tcontroller, Tparams>::AutoPilot(const ros::NodeHandle& nh,
-                                           const ros::NodeHandle& pnh)
+AutoPilot<Tcontroller, Tparams>::AutoPilot(
+    const ros::NodeHandle& nh, const ros::NodeHandle& pnh,
+    const std::shared_ptr<const Clock>& clock)
     : nh_(nh),
       pnh_(pnh),
+      clock_(clock),
+      command_feedthrough_nh_(nh),
+      command_feedthrough_queue_(),
+      command_feedthrough_spinner_(1, &command_feedthrough_queue_),
       state_predictor_(nh_, pnh_),
       reference_state_(),
       received_state_est_(),
@@ -38,10 +47,22 @@ AutoPilot<Tcontroller, Tparams>::AutoPilot(const ros::NodeHandle& nh,
       requested_go_to_pose_(),
       received_go_to_pose_command_(false),
       stop_go_to_pose_thread_(false),
+      go_to_pose_trajectory_cache_(kGoToPoseTrajectoryCacheSize_),
       trajectory_queue_(),
       time_start_trajectory_execution_(),
-      time_last_control_command_input_received_(),
+      replanned_trajectory_(),
+      time_start_replanned_trajectory_(),
+      received_replanned_trajectory_(false),
+      command_feedthrough_active_(false),
+      time_last_control_command_input_received_nsec_(0),
       last_control_command_input_thrust_high_(false),
+      stop_shadow_controller_thread_(false),
+      shadow_controller_input_available_(false),
+      shadow_controller_state_estimate_(),
+      shadow_controller_reference_trajectory_(),
+      shadow_controller_base_command_(),
+      shadow_controller_base_computation_time_(),
+      shadow_controller_input_handover_time_(),
       stop_watchdog_thread_(false),
       time_last_state_estimate_received_(),
       time_started_emergency_landing_(),
@@ -60,6 +81,14 @@ AutoPilot<Tcontroller, Tparams>::AutoPilot(const ros::NodeHandle& nh,
       nh_.advertise<quadrotor_msgs::ControlCommand>("control_command", 1);
   autopilot_feedback_pub_ =
       nh_.advertise<quadrotor_msgs::AutopilotFeedback>("autopilot/feedback", 1);
+  command_feedthrough_latency_pub_ =
+      nh_.advertise<autopilot::CommandFeedthroughLatency>(
+          "autopilot/command_feedthrough/latency", 1);
+  if (enable_shadow_controller_) {
+    shadow_controller_feedback_pub_ =
+        nh_.advertise<autopilot::ShadowControllerFeedback>(
+            "autopilot/shadow_controller/feedback", 1);
+  }
 
   // Subscribers
   state_estimate_sub_ =
@@ -82,9 +111,14 @@ AutoPilot<Tcontroller, Tparams>::AutoPilot(const ros::NodeHandle& nh,
   trajectory_sub_ =
       nh_.subscribe("autopilot/trajectory", 1,
                     &AutoPilot<Tcontroller, Tparams>::trajectoryCallback, this);
-  control_command_input_sub_ = nh_.subscribe(
+  replanned_trajectory_sub_ = nh_.subscribe(
+      "autopilot/replanned_trajectory", 1,
+      &AutoPilot<Tcontroller, Tparams>::replannedTrajectoryCallback, this);
+  command_feedthrough_nh_.setCallbackQueue(&command_feedthrough_queue_);
+  control_command_input_sub_ = command_feedthrough_nh_.subscribe(
       "autopilot/control_command_input", 1,
-      &AutoPilot<Tcontroller, Tparams>::controlCommandInputCallback, this);
+      &AutoPilot<Tcontroller, Tparams>::controlCommandInputCallback, this,
+      ros::TransportHints().tcpNoDelay());
 
   start_sub_ =
       nh_.subscribe("autopilot/start", 1,
@@ -98,6 +132,9 @@ AutoPilot<Tcontroller, Tparams>::AutoPilot(const ros::NodeHandle& nh,
   off_sub_ = nh_.subscribe("autopilot/off", 1,
                            &AutoPilot<Tcontroller, Tparams>::offCallback, this);
 
+  // Start handling control command inputs
+  command_feedthrough_spinner_.start();
+
   // Start watchdog thread
   try {
     watchdog_thread_ =
@@ -119,17 +156,41 @@ AutoPilot<Tcontroller, Tparams>::AutoPilot(const ros::NodeHandle& nh,
     ros::shutdown();
     return;
   }
+
+  // Start shadow controller thread
+  if (enable_shadow_controller_) {
+    try {
+      shadow_controller_thread_ = std::thread(
+          &AutoPilot<Tcontroller, Tparams>::shadowControllerThread, this);
+    } catch (...) {
+      ROS_ERROR("[%s] Could not successfully start shadow controller thread.",
+                pnh_.getNamespace().c_str());
+      ros::shutdown();
+      return;
+    }
+  }
 }
 
 template <typename Tcontroller, typename Tparams>
 AutoPilot<Tcontroller, Tparams>::~AutoPilot() {
   destructor_invoked_ = true;
 
+  // Stop handling control command inputs
+  command_feedthrough_spinner_.stop();
+
   // Stop go to pose thread
   stop_go_to_pose_thread_ = true;
   // Wait for go to pose thread to finish
   go_to_pose_thread_.join();
 
+  // Stop shadow controller thread
+  stop_shadow_controller_thread_ = true;
+  shadow_controller_cv_.notify_all();
+  // Wait for shadow controller thread to finish
+  if (shadow_controller_thread_.joinable()) {
+    shadow_controller_thread_.join();
+  }
+
   // Stop watchdog thread
   stop_watchdog_thread_ = true;
   // Wait for watchdog thread to finish
@@ -152,7 +213,7 @@ void AutoPilot<Tcontroller, Tparams>::watchdogThread() {
 
     std::lock_guard<std::mutex> main_lock(main_mutex_);
 
-    const ros::Time time_now = ros::Time::now();
+    const ros::Time time_now = clock_->now();
 
     if (state_estimate_available_ &&
         time_now - time_last_state_estimate_received_ >
@@ -165,14 +226,14 @@ void AutoPilot<Tcontroller, Tparams>::watchdogThread() {
         autopilot_state_ != States::EMERGENCY_LAND &&
         autopilot_state_ != States::COMMAND_FEEDTHROUGH &&
         autopilot_state_ != States::RC_MANUAL) {
-      setAutoPilotStateForced(States::EMERGENCY_LAND);
+      setAutoPilotStateForced(States::EMERGENCY_LAND, time_now);
     }
 
     if (autopilot_state_ == States::EMERGENCY_LAND) {
       // Check timeout to switch to OFF
       if (time_now - time_started_emergency_landing_ >
           ros::Duration(emergency_land_duration_)) {
-        setAutoPilotStateForced(States::OFF);
+        setAutoPilotStateForced(States::OFF, time_now);
       }
 
       // Send emergency landing control command
@@ -186,34 +247,37 @@ void AutoPilot<Tcontroller, Tparams>::watchdogThread() {
       publishControlCommand(control_cmd);
     }
 
+    ros::Time time_last_control_command_input_received;
+    time_last_control_command_input_received.fromNSec(
+        time_last_control_command_input_received_nsec_);
     if (autopilot_state_ == States::COMMAND_FEEDTHROUGH &&
-        (time_now - time_last_control_command_input_received_) >
+        (time_now - time_last_control_command_input_received) >
             ros::Duration(control_command_input_timeout_)) {
       if (last_control_command_input_thrust_high_) {
         ROS_WARN(
             "[%s] Did not receive control command inputs anymore but last "
             "thrust command was high, will switch to hover",
             pnh_.getNamespace().c_str());
-        setAutoPilotState(States::HOVER);
+        setAutoPilotState(States::HOVER, time_now);
       } else {
         ROS_WARN(
             "[%s] Did not receive control command inputs anymore but last "
             "thrust command was low, will switch to off",
             pnh_.getNamespace().c_str());
-        setAutoPilotState(States::OFF);
+        setAutoPilotState(States::OFF, time_now);
       }
     }
 
     if (!state_estimate_available_) {
       // Publish autopilot feedback throttled down to a maximum frequency
       // If there is no state estimate no feedback would be published otherwise
-      if ((ros::Time::now() - time_last_autopilot_feedback_published_) >=
+      if ((time_now - time_last_autopilot_feedback_published_) >=
           ros::Duration(1.0 / kMaxAutopilotFeedbackPublishFrequency_)) {
-        publishAutopilotFeedback(autopilot_state_,
-                                 ros::Duration(control_command_delay_),
-                                 ros::Duration(0.0), ros::Duration(0.0), 0,
-                                 received_low_level_feedback_, reference_state_,
-                                 quadrotor_common::QuadStateEstimate());
+        publishAutopilotFeedback(
+            autopilot_state_, ros::Duration(control_command_delay_),
+            ros::Duration(0.0), ros::Duration(0.0), 0,
+            received_low_level_feedback_, reference_state_,
+            quadrotor_common::QuadStateEstimate(), time_now);
       }
     }
 
@@ -264,7 +328,7 @@ void AutoPilot<Tcontroller, Tparams>::goToPoseThread() {
         reference_state_.position = end_state.position;
         reference_state_.heading = end_state.heading;
         // TODO: Do something smarter if we want to rotate without translation
-        setAutoPilotState(States::HOVER);
+        setAutoPilotState(States::HOVER, clock_->now());
 
         // Main mutex is unlocked because it goes out of scope here
       } else {
@@ -275,7 +339,8 @@ void AutoPilot<Tcontroller, Tparams>::goToPoseThread() {
                     kGoToPosePolynomialOrderOfContinuity_,
                     go_to_pose_max_velocity_, go_to_pose_max_normalized_thrust_,
                     go_to_pose_max_roll_pitch_rate_,
-                    kGoToPoseTrajectorySamplingFrequency_);
+                    kGoToPoseTrajectorySamplingFrequency_,
+                    &go_to_pose_trajectory_cache_);
 
         trajectory_generation_helper::heading::addConstantHeadingRate(
             start_state.heading, end_state.heading, &go_to_pose_traj);
@@ -289,7 +354,7 @@ void AutoPilot<Tcontroller, Tparams>::goToPoseThread() {
           if (autopilot_state_ == States::GO_TO_POSE) {
             trajectory_queue_.clear();
             trajectory_queue_.push_back(go_to_pose_traj);
-            setAutoPilotState(States::TRAJECTORY_CONTROL);
+            setAutoPilotState(States::TRAJECTORY_CONTROL, clock_->now());
           } else {
             ROS_WARN(
                 "[%s] Autopilot state switched to another state from "
@@ -314,6 +379,80 @@ void AutoPilot<Tcontroller, Tparams>::goToPoseThread() {
   }
 }
 
+// Thread running the shadow controller on the inputs handed over from the
+// control loop in feedShadowController
+// -> publish shadow and base controller outputs side by side
+template <typename Tcontroller, typename Tparams>
+void AutoPilot<Tcontroller, Tparams>::shadowControllerThread() {
+  if (shadow_controller_cpu_core_ >= 0) {
+    // Keep the shadow controller off the core the control loop is running on
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(shadow_controller_cpu_core_, &cpu_set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set) !=
+        0) {
+      ROS_WARN("[%s] Could not pin shadow controller thread to CPU core %d",
+               pnh_.getNamespace().c_str(), shadow_controller_cpu_core_);
+    }
+  }
+
+  quadrotor_common::QuadStateEstimate state_estimate;
+  quadrotor_common::Trajectory reference_trajectory;
+  quadrotor_common::ControlCommand base_command;
+  ros::Duration base_computation_time;
+  ros::WallTime input_handover_time;
+
+  while (ros::ok() && !stop_shadow_controller_thread_) {
+    {
+      std::unique_lock<std::mutex> shadow_controller_lock(
+          shadow_controller_mutex_);
+      // Wake up regularly to check whether we should stop
+      shadow_controller_cv_.wait_for(
+          shadow_controller_lock,
+          std::chrono::duration<double>(1.0 / kShadowControllerIdleFrequency_),
+          [this] {
+            return shadow_controller_input_available_ ||
+                   stop_shadow_controller_thread_;
+          });
+      if (!shadow_controller_input_available_) {
+        continue;
+      }
+
+      // Swap instead of copy to keep the mutex locked as short as possible
+      std::swap(state_estimate, shadow_controller_state_estimate_);
+      std::swap(reference_trajectory, shadow_controller_reference_trajectory_);
+      base_command = shadow_controller_base_command_;
+      base_computation_time = shadow_controller_base_computation_time_;
+      input_handover_time = shadow_controller_input_handover_time_;
+      shadow_controller_input_available_ = false;
+
+      // Shadow controller mutex is unlocked because it goes out of scope here
+    }
+
+    const ros::WallTime start_shadow_command_computation = ros::WallTime::now();
+    quadrotor_common::ControlCommand shadow_command = shadow_controller_.run(
+        state_estimate, reference_trajectory, shadow_controller_params_);
+    const ros::WallTime end_shadow_command_computation = ros::WallTime::now();
+    shadow_command.timestamp = base_command.timestamp;
+    shadow_command.expected_execution_time =
+        base_command.expected_execution_time;
+
+    autopilot::ShadowControllerFeedback fb_msg;
+    fb_msg.header.stamp = base_command.timestamp;
+    fb_msg.base_control_command = base_command.toRosMessage();
+    fb_msg.base_control_computation_time = base_computation_time;
+    fb_msg.shadow_control_command = shadow_command.toRosMessage();
+    fb_msg.shadow_control_computation_time =
+        ros::Duration((end_shadow_command_computation -
+                       start_shadow_command_computation)
+                          .toSec());
+    fb_msg.shadow_control_latency = ros::Duration(
+        (end_shadow_command_computation - input_handover_time).toSec());
+
+    shadow_controller_feedback_pub_.publish(fb_msg);
+  }
+}
+
 template <typename Tcontroller, typename Tparams>
 void AutoPilot<Tcontroller, Tparams>::stateEstimateCallback(
     const nav_msgs::Odometry::ConstPtr& msg) {
@@ -323,6 +462,10 @@ void AutoPilot<Tcontroller, Tparams>::stateEstimateCallback(
 
   std::lock_guard<std::mutex> main_lock(main_mutex_);
 
+  // The time is sampled only once per control cycle and passed on to all
+  // functions that need it so they all see the same time
+  const ros::Time time_now = clock_->now();
+
   received_state_est_ = quadrotor_common::QuadStateEstimate(*msg);
   if (!received_state_est_.isValid()) {
     state_estimate_available_ = false;
@@ -333,7 +476,7 @@ void AutoPilot<Tcontroller, Tparams>::stateEstimateCallback(
     }
   } else {
     state_estimate_available_ = true;
-    time_last_state_estimate_received_ = ros::Time::now();
+    time_last_state_estimate_received_ = time_now;
   }
 
   if (!velocity_estimate_in_world_frame_) {
@@ -345,9 +488,8 @@ void AutoPilot<Tcontroller, Tparams>::stateEstimateCallback(
 
   quadrotor_common::ControlCommand control_cmd;
 
-  ros::Time wall_time_now = ros::Time::now();
-  ros::Time command_execution_time =
-      wall_time_now + ros::Duration(control_command_delay_);
+  const ros::Time command_execution_time =
+      time_now + ros::Duration(control_command_delay_);
 
   quadrotor_common::QuadStateEstimate predicted_state = received_state_est_;
   if (autopilot_state_ != States::OFF) {
@@ -355,9 +497,22 @@ void AutoPilot<Tcontroller, Tparams>::stateEstimateCallback(
     predicted_state = getPredictedStateEstimate(command_execution_time);
   }
 
+  // The shadow controller is only fed in states in which the base controller
+  // is always run on reference_trajectory_
+  const bool feed_shadow_controller =
+      enable_shadow_controller_ &&
+      (autopilot_state_ == States::HOVER || autopilot_state_ == States::LAND ||
+       autopilot_state_ == States::BREAKING ||
+       autopilot_state_ == States::GO_TO_POSE ||
+       autopilot_state_ == States::VELOCITY_CONTROL ||
+       autopilot_state_ == States::REFERENCE_CONTROL ||
+       autopilot_state_ == States::TRAJECTORY_CONTROL);
+
   ros::Duration trajectory_execution_left_duration(0.0);
   int trajectories_left_in_queue = 0;
-  const ros::Time start_control_command_computation = ros::Time::now();
+  // The computation time is measured with the wall clock since it is not
+  // related to the time the autopilot is running on
+  const ros::WallTime start_control_command_computation = ros::WallTime::now();
   // Compute control command depending on autopilot state
   switch (autopilot_state_) {
     case States::OFF:
@@ -367,13 +522,13 @@ void AutoPilot<Tcontroller, Tparams>::stateEstimateCallback(
       reference_state_ = quadrotor_common::TrajectoryPoint();
       break;
     case States::START:
-      control_cmd = start(predicted_state);
+      control_cmd = start(predicted_state, time_now);
       break;
     case States::HOVER:
       control_cmd = hover(predicted_state);
       break;
     case States::LAND:
-      control_cmd = land(predicted_state);
+      control_cmd = land(predicted_state, time_now);
       break;
     case States::EMERGENCY_LAND:
       if (state_estimate_available_) {
@@ -382,27 +537,27 @@ void AutoPilot<Tcontroller, Tparams>::stateEstimateCallback(
         // to land before the emergency landing happened
         ROS_INFO("[%s] Regained state estimate", pnh_.getNamespace().c_str());
         if (state_before_emergency_landing_ == States::LAND) {
-          setAutoPilotState(States::LAND);
+          setAutoPilotState(States::LAND, time_now);
         } else {
-          setAutoPilotState(States::HOVER);
+          setAutoPilotState(States::HOVER, time_now);
         }
         control_cmd = hover(predicted_state);
       }
       break;
     case States::BREAKING:
-      control_cmd = breakVelocity(predicted_state);
+      control_cmd = breakVelocity(predicted_state, time_now);
       break;
     case States::GO_TO_POSE:
       control_cmd = waitForGoToPoseAction(predicted_state);
       break;
     case States::VELOCITY_CONTROL:
-      control_cmd = velocityControl(predicted_state);
+      control_cmd = velocityControl(predicted_state, time_now);
       break;
     case States::REFERENCE_CONTROL:
-      control_cmd = followReference(predicted_state);
+      control_cmd = followReference(predicted_state, time_now);
       break;
     case States::TRAJECTORY_CONTROL:
-      control_cmd = executeTrajectory(predicted_state,
+      control_cmd = executeTrajectory(predicted_state, time_now,
                                       &trajectory_execution_left_duration,
                                       &trajectories_left_in_queue);
       break;
@@ -419,23 +574,28 @@ void AutoPilot<Tcontroller, Tparams>::stateEstimateCallback(
       control_cmd.collective_thrust = kGravityAcc_;
       break;
   }
-  const ros::Duration control_computation_time =
-      ros::Time::now() - start_control_command_computation;
+  const ros::Duration control_computation_time = ros::Duration(
+      (ros::WallTime::now() - start_control_command_computation).toSec());
 
   if (autopilot_state_ != States::COMMAND_FEEDTHROUGH) {
-    control_cmd.timestamp = wall_time_now;
+    control_cmd.timestamp = time_now;
     control_cmd.expected_execution_time = command_execution_time;
     publishControlCommand(control_cmd);
   }
 
+  if (feed_shadow_controller) {
+    feedShadowController(predicted_state, control_cmd,
+                         control_computation_time);
+  }
+
   // Publish autopilot feedback throttled down to a maximum frequency
-  if ((ros::Time::now() - time_last_autopilot_feedback_published_) >=
+  if ((time_now - time_last_autopilot_feedback_published_) >=
       ros::Duration(1.0 / kMaxAutopilotFeedbackPublishFrequency_)) {
     publishAutopilotFeedback(
         autopilot_state_, ros::Duration(control_command_delay_),
         control_computation_time, trajectory_execution_left_duration,
         trajectories_left_in_queue, received_low_level_feedback_,
-        reference_state_, predicted_state);
+        reference_state_, predicted_state, time_now);
   }
 
   // Mutex is unlocked because it goes out of scope here
@@ -450,19 +610,21 @@ void AutoPilot<Tcontroller, Tparams>::lowLevelFeedbackCallback(
 
   std::lock_guard<std::mutex> main_lock(main_mutex_);
 
+  const ros::Time time_now = clock_->now();
+
   received_low_level_feedback_ = *msg;
 
   if (msg->control_mode == msg->RC_MANUAL &&
       autopilot_state_ != States::RC_MANUAL) {
-    setAutoPilotState(States::RC_MANUAL);
+    setAutoPilotState(States::RC_MANUAL, time_now);
   }
   if (msg->control_mode != msg->RC_MANUAL &&
       autopilot_state_ == States::RC_MANUAL) {
     if (state_before_rc_manual_flight_ == States::OFF) {
-      setAutoPilotState(States::OFF);
+      setAutoPilotState(States::OFF, time_now);
     } else {
       force_breaking_ = true;  // Ensure reference state is reset
-      setAutoPilotState(States::HOVER);
+      setAutoPilotState(States::HOVER, time_now);
     }
   }
 
@@ -482,11 +644,13 @@ void AutoPilot<Tcontroller, Tparams>::poseCommandCallback(
   std::lock_guard<std::mutex> go_to_pose_lock(go_to_pose_mutex_);
   std::lock_guard<std::mutex> main_lock(main_mutex_);
 
+  const ros::Time time_now = clock_->now();
+
   // Idea: A trajectory is planned to the desired pose in a separate
   // thread. Once the thread is done it pushes the computed trajectory into the
   // trajectory queue and switches to TRAJECTORY_CONTROL mode
   if (autopilot_state_ == States::HOVER) {
-    setAutoPilotState(States::GO_TO_POSE);
+    setAutoPilotState(States::GO_TO_POSE, time_now);
     requested_go_to_pose_ = *msg;
     received_go_to_pose_command_ = true;
   } else {
@@ -508,6 +672,8 @@ void AutoPilot<Tcontroller, Tparams>::velocityCommandCallback(
 
   std::lock_guard<std::mutex> main_lock(main_mutex_);
 
+  const ros::Time time_now = clock_->now();
+
   if (quadrotor_common::geometryToEigen(msg->twist.linear).norm() <=
           kVelocityCommandZeroThreshold_ &&
       fabs(msg->twist.angular.z) <= kVelocityCommandZeroThreshold_) {
@@ -519,11 +685,11 @@ void AutoPilot<Tcontroller, Tparams>::velocityCommandCallback(
     return;
   }
   if (autopilot_state_ != States::VELOCITY_CONTROL) {
-    setAutoPilotState(States::VELOCITY_CONTROL);
+    setAutoPilotState(States::VELOCITY_CONTROL, time_now);
   }
 
   desired_velocity_command_ = *msg;
-  desired_velocity_command_.header.stamp = ros::Time::now();
+  desired_velocity_command_.header.stamp = time_now;
 
   // Mutex is unlocked because it goes out of scope here
 }
@@ -537,6 +703,8 @@ void AutoPilot<Tcontroller, Tparams>::referenceStateCallback(
 
   std::lock_guard<std::mutex> main_lock(main_mutex_);
 
+  const ros::Time time_now = clock_->now();
+
   if (autopilot_state_ != States::HOVER &&
       autopilot_state_ != States::REFERENCE_CONTROL) {
     return;
@@ -545,7 +713,7 @@ void AutoPilot<Tcontroller, Tparams>::referenceStateCallback(
     if ((reference_state_.position -
          quadrotor_common::geometryToEigen(msg->pose.position))
             .norm() < kPositionJumpTolerance_) {
-      setAutoPilotState(States::REFERENCE_CONTROL);
+      setAutoPilotState(States::REFERENCE_CONTROL, time_now);
     } else {
       ROS_WARN(
           "[%s] Received first reference state that is more than %fm away "
@@ -563,7 +731,7 @@ void AutoPilot<Tcontroller, Tparams>::referenceStateCallback(
     return;
   }
 
-  time_last_reference_state_input_received_ = ros::Time::now();
+  time_last_reference_state_input_received_ = time_now;
   reference_state_input_ = *msg;
 
   // Mutex is unlocked because it goes out of scope here
@@ -578,6 +746,8 @@ void AutoPilot<Tcontroller, Tparams>::trajectoryCallback(
 
   std::lock_guard<std::mutex> main_lock(main_mutex_);
 
+  const ros::Time time_now = clock_->now();
+
   // Idea: trajectories are being pushed into a queue and consecutively
   // executed if there are no jumps in the beginning and between them
 
@@ -627,46 +797,113 @@ void AutoPilot<Tcontroller, Tparams>::trajectoryCallback(
   trajectory_queue_.push_back(quadrotor_common::Trajectory(*msg));
 
   if (autopilot_state_ != States::TRAJECTORY_CONTROL) {
-    setAutoPilotState(States::TRAJECTORY_CONTROL);
+    setAutoPilotState(States::TRAJECTORY_CONTROL, time_now);
   }
 
   // Mutex is unlocked because it goes out of scope here
 }
 
 template <typename Tcontroller, typename Tparams>
-void AutoPilot<Tcontroller, Tparams>::controlCommandInputCallback(
-    const quadrotor_msgs::ControlCommand::ConstPtr& msg) {
+void AutoPilot<Tcontroller, Tparams>::replannedTrajectoryCallback(
+    const quadrotor_msgs::Trajectory::ConstPtr& msg) {
   if (destructor_invoked_) {
     return;
   }
 
-  if (!enable_command_feedthrough_ || !msg->armed) {
+  std::lock_guard<std::mutex> main_lock(main_mutex_);
+
+  // Idea: a trajectory that is replanned while it is being executed, e.g. by
+  // receding horizon replanning, replaces all trajectories in the queue at
+  // the time stamp of its header. It has to start at the reference state the
+  // queue reaches at that time.
+
+  if (autopilot_state_ != States::TRAJECTORY_CONTROL) {
+    ROS_WARN(
+        "[%s] Received replanned trajectory but autopilot is not in "
+        "TRAJECTORY_CONTROL, will ignore trajectory",
+        pnh_.getNamespace().c_str());
+    return;
+  }
+  if (msg->type == msg->UNDEFINED || msg->points.size() == 0) {
+    ROS_WARN("[%s] Received invalid trajectory, will ignore trajectory",
+             pnh_.getNamespace().c_str());
     return;
   }
 
-  std::lock_guard<std::mutex> main_lock(main_mutex_);
+  replanned_trajectory_ = quadrotor_common::Trajectory(*msg);
+  if (msg->header.stamp.isZero()) {
+    time_start_replanned_trajectory_ = clock_->now();
+  } else {
+    time_start_replanned_trajectory_ = msg->header.stamp;
+  }
+  received_replanned_trajectory_ = true;
 
-  if (autopilot_state_ != States::OFF && autopilot_state_ != States::HOVER &&
-      autopilot_state_ != States::COMMAND_FEEDTHROUGH) {
-    // Only allow this if the current state is OFF or HOVER
-    // or already in COMMAND_FEEDTHROUGH
+  // Mutex is unlocked because it goes out of scope here
+}
+
+template <typename Tcontroller, typename Tparams>
+void AutoPilot<Tcontroller, Tparams>::controlCommandInputCallback(
+    const quadrotor_msgs::ControlCommand::ConstPtr& msg) {
+  if (destructor_invoked_) {
     return;
   }
 
-  if (autopilot_state_ != States::COMMAND_FEEDTHROUGH) {
-    setAutoPilotState(States::COMMAND_FEEDTHROUGH);
+  if (!enable_command_feedthrough_ || !msg->armed) {
+    return;
   }
 
-  control_command_pub_.publish(*msg);
+  const ros::WallTime time_received = ros::WallTime::now();
+  const ros::Time time_now = clock_->now();
+  const bool thrust_high = msg->collective_thrust > kThrustHighThreshold_;
+
+  if (!command_feedthrough_active_) {
+    // The main mutex is only needed to switch to COMMAND_FEEDTHROUGH
+    std::lock_guard<std::mutex> main_lock(main_mutex_);
+
+    if (autopilot_state_ != States::OFF && autopilot_state_ != States::HOVER &&
+        autopilot_state_ != States::COMMAND_FEEDTHROUGH) {
+      // Only allow this if the current state is OFF or HOVER
+      // or already in COMMAND_FEEDTHROUGH
+      return;
+    }
 
-  time_last_control_command_input_received_ = ros::Time::now();
-  if (msg->collective_thrust > kThrustHighThreshold_) {
-    last_control_command_input_thrust_high_ = true;
+    // Store the input before switching, otherwise the watchdog could see
+    // COMMAND_FEEDTHROUGH together with the time and thrust of an earlier
+    // input and leave the state right away
+    time_last_control_command_input_received_nsec_ = time_now.toNSec();
+    last_control_command_input_thrust_high_ = thrust_high;
+
+    if (autopilot_state_ != States::COMMAND_FEEDTHROUGH) {
+      setAutoPilotState(States::COMMAND_FEEDTHROUGH, time_now);
+    }
+
+    // Mutex is unlocked because it goes out of scope here
   } else {
-    last_control_command_input_thrust_high_ = false;
+    time_last_control_command_input_received_nsec_ = time_now.toNSec();
+    last_control_command_input_thrust_high_ = thrust_high;
+  }
+
+  {
+    // Commands are forwarded without locking the main mutex so they are never
+    // delayed by the control loop or trajectory uploads
+    // Leaving COMMAND_FEEDTHROUGH waits for this mutex, so a command is never
+    // forwarded after the autopilot switched to another state
+    std::lock_guard<std::mutex> command_feedthrough_lock(
+        command_feedthrough_mutex_);
+    if (!command_feedthrough_active_) {
+      return;
+    }
+    control_command_pub_.publish(*msg);
   }
 
-  // Mutex is unlocked because it goes out of scope here
+  if (command_feedthrough_latency_pub_.getNumSubscribers() > 0) {
+    autopilot::CommandFeedthroughLatency latency_msg;
+    latency_msg.header.stamp = msg->header.stamp;
+    latency_msg.reception_latency = time_now - msg->header.stamp;
+    latency_msg.forwarding_duration =
+        ros::Duration((ros::WallTime::now() - time_received).toSec());
+    command_feedthrough_latency_pub_.publish(latency_msg);
+  }
 }
 
 template <typename Tcontroller, typename Tparams>
@@ -678,6 +915,8 @@ void AutoPilot<Tcontroller, Tparams>::startCallback(
 
   std::lock_guard<std::mutex> main_lock(main_mutex_);
 
+  const ros::Time time_now = clock_->now();
+
   ROS_INFO_THROTTLE(0.5, "[%s] START command received",
                     pnh_.getNamespace().c_str());
   if (autopilot_state_ == States::OFF) {
@@ -689,7 +928,7 @@ void AutoPilot<Tcontroller, Tparams>::startCallback(
         ROS_INFO(
             "[%s] Absolute state estimate available, taking off based on it",
             pnh_.getNamespace().c_str());
-        setAutoPilotState(States::START);
+        setAutoPilotState(States::START, time_now);
       } else if (
           received_state_est_.coordinate_frame ==
               quadrotor_common::QuadStateEstimate::CoordinateFrame::VISION ||
@@ -698,7 +937,7 @@ void AutoPilot<Tcontroller, Tparams>::startCallback(
         ROS_INFO("[%s] Relative state estimate available, switch to hover",
                  pnh_.getNamespace().c_str());
         force_breaking_ = true;  // Ensure reference state is reset
-        setAutoPilotState(States::HOVER);
+        setAutoPilotState(States::HOVER, time_now);
       }
     } else {
       ROS_ERROR("[%s] No state estimate available, will not start",
@@ -722,6 +961,8 @@ void AutoPilot<Tcontroller, Tparams>::forceHoverCallback(
 
   std::lock_guard<std::mutex> main_lock(main_mutex_);
 
+  const ros::Time time_now = clock_->now();
+
   ROS_INFO_THROTTLE(0.5, "[%s] FORCE HOVER command received",
                     pnh_.getNamespace().c_str());
 
@@ -732,7 +973,7 @@ void AutoPilot<Tcontroller, Tparams>::forceHoverCallback(
   }
 
   force_breaking_ = true;
-  setAutoPilotState(States::HOVER);
+  setAutoPilotState(States::HOVER, time_now);
 
   // Mutex is unlocked because it goes out of scope here
 }
@@ -746,6 +987,8 @@ void AutoPilot<Tcontroller, Tparams>::landCallback(
 
   std::lock_guard<std::mutex> main_lock(main_mutex_);
 
+  const ros::Time time_now = clock_->now();
+
   ROS_INFO_THROTTLE(0.5, "[%s] LAND command received",
                     pnh_.getNamespace().c_str());
   if (autopilot_state_ == States::OFF || autopilot_state_ == States::LAND ||
@@ -754,7 +997,7 @@ void AutoPilot<Tcontroller, Tparams>::landCallback(
     return;
   }
 
-  setAutoPilotState(States::LAND);
+  setAutoPilotState(States::LAND, time_now);
 
   // Mutex is unlocked because it goes out of scope here
 }
@@ -768,9 +1011,11 @@ void AutoPilot<Tcontroller, Tparams>::offCallback(
 
   std::lock_guard<std::mutex> main_lock(main_mutex_);
 
+  const ros::Time time_now = clock_->now();
+
   if (autopilot_state_ != States::OFF) {
     ROS_INFO("[%s] OFF command received", pnh_.getNamespace().c_str());
-    setAutoPilotStateForced(States::OFF);
+    setAutoPilotStateForced(States::OFF, time_now);
     // Allow user to take over manually and land the vehicle, then off the
     // controller and disable the RC without the vehicle going back to hover
     state_before_rc_manual_flight_ = States::OFF;
@@ -781,7 +1026,8 @@ void AutoPilot<Tcontroller, Tparams>::offCallback(
 
 template <typename Tcontroller, typename Tparams>
 quadrotor_common::ControlCommand AutoPilot<Tcontroller, Tparams>::start(
-    const quadrotor_common::QuadStateEstimate& state_estimate) {
+    const quadrotor_common::QuadStateEstimate& state_estimate,
+    const ros::Time& time_now) {
   quadrotor_common::ControlCommand command;
 
   if (first_time_in_new_state_) {
@@ -793,15 +1039,15 @@ quadrotor_common::ControlCommand AutoPilot<Tcontroller, Tparams>::start(
         quadrotor_common::quaternionToEulerAnglesZYX(state_estimate.orientation)
             .z();
     if (state_estimate.position.z() >= optitrack_land_drop_height_) {
-      setAutoPilotState(States::HOVER);
+      setAutoPilotState(States::HOVER, time_now);
     }
   }
 
-  if (timeInCurrentState() > optitrack_start_land_timeout_ ||
+  if (timeInCurrentState(time_now) > optitrack_start_land_timeout_ ||
       reference_state_.position.z() >= optitrack_start_height_) {
-    setAutoPilotState(States::HOVER);
+    setAutoPilotState(States::HOVER, time_now);
   } else {
-    if (timeInCurrentState() < start_idle_duration_) {
+    if (timeInCurrentState(time_now) < start_idle_duration_) {
       command.control_mode = quadrotor_common::ControlMode::BODY_RATES;
       command.armed = true;
       command.bodyrates = Eigen::Vector3d::Zero();
@@ -810,15 +1056,16 @@ quadrotor_common::ControlCommand AutoPilot<Tcontroller, Tparams>::start(
     } else {
       reference_state_.position.z() =
           initial_start_position_.z() +
-          start_land_velocity_ * (timeInCurrentState() - start_idle_duration_);
+          start_land_velocity_ *
+              (timeInCurrentState(time_now) - start_idle_duration_);
       reference_state_.velocity.z() = start_land_velocity_;
-      if (timeInCurrentState() <
+      if (timeInCurrentState(time_now) <
           start_idle_duration_ +
               start_land_velocity_ / start_land_acceleration_) {
         reference_state_.acceleration.z() = start_land_acceleration_;
         reference_state_.velocity.z() =
             start_land_acceleration_ *
-            (timeInCurrentState() - start_idle_duration_);
+            (timeInCurrentState(time_now) - start_idle_duration_);
       } else {
         reference_state_.acceleration.setZero();
       }
@@ -857,7 +1104,8 @@ quadrotor_common::ControlCommand AutoPilot<Tcontroller, Tparams>::hover(
 
 template <typename Tcontroller, typename Tparams>
 quadrotor_common::ControlCommand AutoPilot<Tcontroller, Tparams>::land(
-    const quadrotor_common::QuadStateEstimate& state_estimate) {
+    const quadrotor_common::QuadStateEstimate& state_estimate,
+    const ros::Time& time_now) {
   quadrotor_common::ControlCommand command;
 
   if (first_time_in_new_state_) {
@@ -873,7 +1121,8 @@ quadrotor_common::ControlCommand AutoPilot<Tcontroller, Tparams>::land(
   }
 
   reference_state_.position.z() =
-      initial_land_position_.z() - start_land_velocity_ * timeInCurrentState();
+      initial_land_position_.z() -
+      start_land_velocity_ * timeInCurrentState(time_now);
   reference_state_.velocity.z() = -start_land_velocity_;
 
   reference_trajectory_ = quadrotor_common::Trajectory(reference_state_);
@@ -888,9 +1137,9 @@ quadrotor_common::ControlCommand AutoPilot<Tcontroller, Tparams>::land(
     // estimate available, otherwise we just keep going down "forever"
     if (!time_to_ramp_down_ &&
         (state_estimate.position.z() < optitrack_land_drop_height_ ||
-         timeInCurrentState() > optitrack_start_land_timeout_)) {
+         timeInCurrentState(time_now) > optitrack_start_land_timeout_)) {
       time_to_ramp_down_ = true;
-      time_started_ramping_down_ = ros::Time::now();
+      time_started_ramping_down_ = time_now;
     }
   }
 
@@ -902,11 +1151,11 @@ quadrotor_common::ControlCommand AutoPilot<Tcontroller, Tparams>::land(
     command.collective_thrust =
         initial_drop_thrust_ -
         initial_drop_thrust_ / propeller_ramp_down_timeout_ *
-            (ros::Time::now() - time_started_ramping_down_).toSec();
+            (time_now - time_started_ramping_down_).toSec();
   }
 
   if (command.collective_thrust <= 0.2) {
-    setAutoPilotState(States::OFF);
+    setAutoPilotState(States::OFF, time_now);
     command.zero();
   }
 
@@ -915,7 +1164,8 @@ quadrotor_common::ControlCommand AutoPilot<Tcontroller, Tparams>::land(
 
 template <typename Tcontroller, typename Tparams>
 quadrotor_common::ControlCommand AutoPilot<Tcontroller, Tparams>::breakVelocity(
-    const quadrotor_common::QuadStateEstimate& state_estimate) {
+    const quadrotor_common::QuadStateEstimate& state_estimate,
+    const ros::Time& time_now) {
   if (first_time_in_new_state_) {
     first_time_in_new_state_ = false;
     if (force_breaking_ ||
@@ -935,7 +1185,7 @@ quadrotor_common::ControlCommand AutoPilot<Tcontroller, Tparams>::breakVelocity(
       reference_state_ = quadrotor_common::TrajectoryPoint();
       reference_state_.position = current_position;
       reference_state_.heading = current_heading;
-      setAutoPilotStateForced(desired_state_after_breaking_);
+      setAutoPilotStateForced(desired_state_after_breaking_, time_now);
 
       reference_trajectory_ = quadrotor_common::Trajectory(reference_state_);
       return base_controller_.run(state_estimate, reference_trajectory_,
@@ -944,12 +1194,12 @@ quadrotor_common::ControlCommand AutoPilot<Tcontroller, Tparams>::breakVelocity(
   }
 
   if (state_estimate.velocity.norm() < breaking_velocity_threshold_ ||
-      timeInCurrentState() > breaking_timeout_) {
+      timeInCurrentState(time_now) > breaking_timeout_) {
     const double current_heading = reference_state_.heading;
     reference_state_ = quadrotor_common::TrajectoryPoint();
     reference_state_.position = state_estimate.position;
     reference_state_.heading = current_heading;
-    setAutoPilotStateForced(desired_state_after_breaking_);
+    setAutoPilotStateForced(desired_state_after_breaking_, time_now);
   }
 
   reference_trajectory_ = quadrotor_common::Trajectory(reference_state_);
@@ -986,13 +1236,14 @@ AutoPilot<Tcontroller, Tparams>::waitForGoToPoseAction(
 template <typename Tcontroller, typename Tparams>
 quadrotor_common::ControlCommand
 AutoPilot<Tcontroller, Tparams>::velocityControl(
-    const quadrotor_common::QuadStateEstimate& state_estimate) {
+    const quadrotor_common::QuadStateEstimate& state_estimate,
+    const ros::Time& time_now) {
   if (first_time_in_new_state_) {
     first_time_in_new_state_ = false;
-    time_last_velocity_command_handled_ = ros::Time::now();
+    time_last_velocity_command_handled_ = time_now;
   }
 
-  if ((ros::Time::now() - desired_velocity_command_.header.stamp) >
+  if ((time_now - desired_velocity_command_.header.stamp) >
       ros::Duration(velocity_command_input_timeout_)) {
     desired_velocity_command_.twist.linear.x = 0.0;
     desired_velocity_command_.twist.linear.y = 0.0;
@@ -1000,8 +1251,7 @@ AutoPilot<Tcontroller, Tparams>::velocityControl(
     desired_velocity_command_.twist.angular.z = 0.0;
   }
 
-  const double dt =
-      (ros::Time::now() - time_last_velocity_command_handled_).toSec();
+  const double dt = (time_now - time_last_velocity_command_handled_).toSec();
   const double alpha_velocity = 1 - exp(-dt / tau_velocity_command_);
 
   const Eigen::Vector3d commanded_velocity =
@@ -1016,7 +1266,7 @@ AutoPilot<Tcontroller, Tparams>::velocityControl(
     if (fabs(desired_velocity_command_.twist.angular.z) <
         kVelocityCommandZeroThreshold_) {
       reference_state_.heading_rate = 0.0;
-      setAutoPilotState(States::HOVER);
+      setAutoPilotState(States::HOVER, time_now);
     }
   }
   reference_state_.position += reference_state_.velocity * dt;
@@ -1026,7 +1276,7 @@ AutoPilot<Tcontroller, Tparams>::velocityControl(
       quadrotor_common::wrapMinusPiToPi(reference_state_.heading);
   reference_state_.heading_rate = desired_velocity_command_.twist.angular.z;
 
-  time_last_velocity_command_handled_ = ros::Time::now();
+  time_last_velocity_command_handled_ = time_now;
 
   reference_trajectory_ = quadrotor_common::Trajectory(reference_state_);
   const quadrotor_common::ControlCommand command = base_controller_.run(
@@ -1038,14 +1288,15 @@ AutoPilot<Tcontroller, Tparams>::velocityControl(
 template <typename Tcontroller, typename Tparams>
 quadrotor_common::ControlCommand
 AutoPilot<Tcontroller, Tparams>::followReference(
-    const quadrotor_common::QuadStateEstimate& state_estimate) {
+    const quadrotor_common::QuadStateEstimate& state_estimate,
+    const ros::Time& time_now) {
   if (first_time_in_new_state_) {
     first_time_in_new_state_ = false;
   }
 
-  if ((ros::Time::now() - time_last_reference_state_input_received_) >
+  if ((time_now - time_last_reference_state_input_received_) >
       ros::Duration(reference_state_input_timeout_)) {
-    setAutoPilotState(States::HOVER);
+    setAutoPilotState(States::HOVER, time_now);
   }
 
   reference_state_ = quadrotor_common::TrajectoryPoint(reference_state_input_);
@@ -1061,9 +1312,9 @@ template <typename Tcontroller, typename Tparams>
 quadrotor_common::ControlCommand
 AutoPilot<Tcontroller, Tparams>::executeTrajectory(
     const quadrotor_common::QuadStateEstimate& state_estimate,
+    const ros::Time& time_now,
     ros::Duration* trajectory_execution_left_duration,
     int* trajectories_left_in_queue) {
-  const ros::Time time_now = ros::Time::now();
   if (first_time_in_new_state_) {
     first_time_in_new_state_ = false;
     time_start_trajectory_execution_ = time_now;
@@ -1075,13 +1326,34 @@ AutoPilot<Tcontroller, Tparams>::executeTrajectory(
         pnh_.getNamespace().c_str());
     *trajectory_execution_left_duration = ros::Duration(0.0);
     *trajectories_left_in_queue = 0;
-    setAutoPilotState(States::HOVER);
+    setAutoPilotState(States::HOVER, time_now);
 
     reference_trajectory_ = quadrotor_common::Trajectory(reference_state_);
     return base_controller_.run(state_estimate, reference_trajectory_,
                                 base_controller_params_);
   }
 
+  if (received_replanned_trajectory_ &&
+      time_now >= time_start_replanned_trajectory_) {
+    received_replanned_trajectory_ = false;
+    // Check that there is no jump from the current reference state to the
+    // replanned trajectory
+    if ((replanned_trajectory_
+             .getStateAtTime(time_now - time_start_replanned_trajectory_)
+             .position -
+         reference_state_.position)
+            .norm() > kPositionJumpTolerance_) {
+      ROS_WARN(
+          "[%s] Replanned trajectory does not continue from the current "
+          "reference state, will ignore trajectory",
+          pnh_.getNamespace().c_str());
+    } else {
+      trajectory_queue_.clear();
+      trajectory_queue_.push_back(replanned_trajectory_);
+      time_start_trajectory_execution_ = time_start_replanned_trajectory_;
+    }
+  }
+
   if ((time_now - time_start_trajectory_execution_) >
       trajectory_queue_.front().points.back().time_from_start) {
     if (trajectory_queue_.size() == 1) {
@@ -1090,7 +1362,7 @@ AutoPilot<Tcontroller, Tparams>::executeTrajectory(
       *trajectory_execution_left_duration = ros::Duration(0.0);
       *trajectories_left_in_queue = 0;
       trajectory_queue_.pop_front();
-      setAutoPilotStateForced(States::HOVER);
+      setAutoPilotStateForced(States::HOVER, time_now);
 
       reference_trajectory_ = quadrotor_common::Trajectory(reference_state_);
       return base_controller_.run(state_estimate, reference_trajectory_,
@@ -1161,18 +1433,18 @@ AutoPilot<Tcontroller, Tparams>::executeTrajectory(
 
 template <typename Tcontroller, typename Tparams>
 void AutoPilot<Tcontroller, Tparams>::setAutoPilotState(
-    const States& new_state) {
+    const States& new_state, const ros::Time& time_now) {
   if (!state_estimate_available_ && new_state != States::OFF &&
       new_state != States::EMERGENCY_LAND &&
       new_state != States::COMMAND_FEEDTHROUGH &&
       new_state != States::RC_MANUAL) {
-    setAutoPilotStateForced(States::EMERGENCY_LAND);
+    setAutoPilotStateForced(States::EMERGENCY_LAND, time_now);
     return;
   }
 
   if (new_state == States::HOVER || new_state == States::LAND) {
     desired_state_after_breaking_ = new_state;
-    setAutoPilotStateForced(States::BREAKING);
+    setAutoPilotStateForced(States::BREAKING, time_now);
     return;
   }
   if (new_state == States::RC_MANUAL) {
@@ -1183,16 +1455,15 @@ void AutoPilot<Tcontroller, Tparams>::setAutoPilotState(
     }
   }
   if (new_state == States::EMERGENCY_LAND) {
-    time_started_emergency_landing_ = ros::Time::now();
+    time_started_emergency_landing_ = time_now;
   }
 
-  setAutoPilotStateForced(new_state);
+  setAutoPilotStateForced(new_state, time_now);
 }
 
 template <typename Tcontroller, typename Tparams>
 void AutoPilot<Tcontroller, Tparams>::setAutoPilotStateForced(
-    const States& new_state) {
-  const ros::Time time_now = ros::Time::now();
+    const States& new_state, const ros::Time& time_now) {
   if (new_state == States::EMERGENCY_LAND) {
     time_started_emergency_landing_ = time_now;
     if (autopilot_state_ == States::BREAKING) {
@@ -1204,9 +1475,17 @@ void AutoPilot<Tcontroller, Tparams>::setAutoPilotStateForced(
   if (new_state != States::TRAJECTORY_CONTROL && !trajectory_queue_.empty()) {
     trajectory_queue_.clear();
   }
+  if (new_state != States::TRAJECTORY_CONTROL) {
+    received_replanned_trajectory_ = false;
+  }
   time_of_switch_to_current_state_ = time_now;
   first_time_in_new_state_ = true;
   autopilot_state_ = new_state;
+  {
+    std::lock_guard<std::mutex> command_feedthrough_lock(
+        command_feedthrough_mutex_);
+    command_feedthrough_active_ = new_state == States::COMMAND_FEEDTHROUGH;
+  }
 
   std::string state_name;
   switch (autopilot_state_) {
@@ -1252,8 +1531,9 @@ void AutoPilot<Tcontroller, Tparams>::setAutoPilotStateForced(
 }
 
 template <typename Tcontroller, typename Tparams>
-double AutoPilot<Tcontroller, Tparams>::timeInCurrentState() const {
-  return (ros::Time::now() - time_of_switch_to_current_state_).toSec();
+double AutoPilot<Tcontroller, Tparams>::timeInCurrentState(
+    const ros::Time& time_now) const {
+  return (time_now - time_of_switch_to_current_state_).toSec();
 }
 
 template <typename Tcontroller, typename Tparams>
@@ -1281,6 +1561,35 @@ void AutoPilot<Tcontroller, Tparams>::publishControlCommand(
   }
 }
 
+template <typename Tcontroller, typename Tparams>
+void AutoPilot<Tcontroller, Tparams>::feedShadowController(
+    const quadrotor_common::QuadStateEstimate& state_estimate,
+    const quadrotor_common::ControlCommand& base_command,
+    const ros::Duration& base_computation_time) {
+  // Never wait for the shadow controller, if it is currently fetching its
+  // inputs we just skip this control cycle
+  std::unique_lock<std::mutex> shadow_controller_lock(shadow_controller_mutex_,
+                                                      std::try_to_lock);
+  if (!shadow_controller_lock.owns_lock()) {
+    return;
+  }
+
+  // If the shadow controller did not catch up with the previous inputs they
+  // are overwritten here
+  shadow_controller_state_estimate_ = state_estimate;
+  // reference_trajectory_ is rebuilt in every control cycle before the base
+  // controller runs on it, so it can be handed over by swapping instead of
+  // deep copying its list of points while main_mutex_ is held
+  std::swap(shadow_controller_reference_trajectory_, reference_trajectory_);
+  shadow_controller_base_command_ = base_command;
+  shadow_controller_base_computation_time_ = base_computation_time;
+  shadow_controller_input_handover_time_ = ros::WallTime::now();
+  shadow_controller_input_available_ = true;
+
+  shadow_controller_lock.unlock();
+  shadow_controller_cv_.notify_one();
+}
+
 template <typename Tcontroller, typename Tparams>
 void AutoPilot<Tcontroller, Tparams>::publishAutopilotFeedback(
     const States& autopilot_state, const ros::Duration& control_command_delay,
@@ -1289,10 +1598,11 @@ void AutoPilot<Tcontroller, Tparams>::publishAutopilotFeedback(
     const int trajectories_left_in_queue,
     const quadrotor_msgs::LowLevelFeedback& low_level_feedback,
     const quadrotor_common::TrajectoryPoint& reference_state,
-    const quadrotor_common::QuadStateEstimate& state_estimate) {
+    const quadrotor_common::QuadStateEstimate& state_estimate,
+    const ros::Time& time_now) {
   quadrotor_msgs::AutopilotFeedback fb_msg;
 
-  fb_msg.header.stamp = ros::Time::now();
+  fb_msg.header.stamp = time_now;
   switch (autopilot_state) {
     case States::OFF:
       fb_msg.autopilot_state = fb_msg.OFF;
@@ -1342,13 +1652,20 @@ void AutoPilot<Tcontroller, Tparams>::publishAutopilotFeedback(
 
   autopilot_feedback_pub_.publish(fb_msg);
 
-  time_last_autopilot_feedback_published_ = ros::Time::now();
+  time_last_autopilot_feedback_published_ = time_now;
 }
 
 template <typename Tcontroller, typename Tparams>
 bool AutoPilot<Tcontroller, Tparams>::loadParameters() {
+  // Fetch the whole namespace at once instead of requesting every parameter
+  // from the parameter server individually
+  parameter_dictionary::ParameterDictionary parameters;
+  if (!parameters.fetch(pnh_)) {
+    return false;
+  }
+
 #define GET_PARAM(name) \
-  if (!quadrotor_common::getParam(#name, name##_, pnh_)) return false
+  if (!parameters.getParam(#name, name##_)) return false
 
   GET_PARAM(state_estimate_timeout);
   GET_PARAM(velocity_estimate_in_world_frame);
@@ -1374,17 +1691,34 @@ bool AutoPilot<Tcontroller, Tparams>::loadParameters() {
   GET_PARAM(control_command_input_timeout);
   GET_PARAM(enable_command_feedthrough);
   GET_PARAM(predictive_control_lookahead);
+  GET_PARAM(enable_shadow_controller);
+  GET_PARAM(shadow_controller_cpu_core);
 
-  if (!base_controller_params_.loadParameters(pnh_)) {
+  if (!base_controller_params_.loadParameters(parameters)) {
     return false;
   }
 
+  if (enable_shadow_controller_) {
+    // The shadow controller uses its own gains if they are provided in the
+    // shadow_controller namespace and the base controller gains otherwise
+    if (parameters.hasParam("shadow_controller/position_controller")) {
+      if (!shadow_controller_params_.loadParameters(
+              parameters.subDictionary("shadow_controller"))) {
+        return false;
+      }
+    } else {
+      shadow_controller_params_ = base_controller_params_;
+    }
+  }
+
   return true;
 
 #undef GET_PARAM
 }
 
-template class AutoPilot<position_controller::PositionController,
-                         position_controller::PositionControllerParams>;
+template class AutoPilot<position_controller::PositionController<double>,
+                         position_controller::PositionControllerParams<double>>;
+template class AutoPilot<position_controller::PositionController<float>,
+                         position_controller::PositionControllerParams<float>>;
 
 }  // namespace autopilot
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <ros/ros.h>
+
+namespace autopilot {
+
+// Source of the time the autopilot is running on
+// The autopilot samples it once per control cycle and callback and passes the
+// sampled time on, so another clock can be injected to run it faster than
+// real time or deterministically in a simulation
+class Clock {
+ public:
+  virtual ~Clock() {}
+
+  virtual ros::Time now() const = 0;
+};
+
+// Default clock, follows the simulated time if use_sim_time is set
+class RosClock : public Clock {
+ public:
+  ros::Time now() const override { return ros::Time::now(); }
+};
+
+}  // namespace autopilot
@@ -2,12 +2,15 @@
 
 #include <geometry_msgs/PoseStamped.h>
 #include <geometry_msgs/TwistStamped.h>
+#include <polynomial_trajectories/polynomial_trajectory.h>
+#include <polynomial_trajectories/trajectory_file.h>
 #include <quadrotor_common/geometry_eigen_conversions.h>
 #include <quadrotor_common/math_common.h>
 #include <quadrotor_msgs/ControlCommand.h>
 #include <quadrotor_msgs/Trajectory.h>
 #include <quadrotor_msgs/TrajectoryPoint.h>
 #include <std_msgs/Empty.h>
+#include <trajectory_generation_helper/polynomial_trajectory_helper.h>
 
 namespace autopilot_helper {
 
@@ -24,6 +27,8 @@ AutoPilotHelper::AutoPilotHelper(const ros::NodeHandle& nh,
       "autopilot/reference_state", 1);
   trajectory_pub_ =
       nh_.advertise<quadrotor_msgs::Trajectory>("autopilot/trajectory", 1);
+  replanned_trajectory_pub_ = nh_.advertise<quadrotor_msgs::Trajectory>(
+      "autopilot/replanned_trajectory", 1);
   control_command_input_pub_ = nh_.advertise<quadrotor_msgs::ControlCommand>(
       "autopilot/control_command_input", 1);
 
@@ -258,6 +263,42 @@ void AutoPilotHelper::sendTrajectory(
   trajectory_pub_.publish(trajectory.toRosMessage());
 }
 
+void AutoPilotHelper::sendReplannedTrajectory(
+    const quadrotor_common::Trajectory& trajectory,
+    const ros::Time& start_time) const {
+  quadrotor_msgs::Trajectory msg = trajectory.toRosMessage();
+  msg.header.stamp = start_time;
+  replanned_trajectory_pub_.publish(msg);
+}
+
+bool AutoPilotHelper::sendTrajectoryFile(const std::string& file_name) const {
+  polynomial_trajectories::TrajectoryFile trajectory_file;
+  if (!trajectory_file.open(file_name)) {
+    return false;
+  }
+
+  quadrotor_common::Trajectory trajectory;
+  if (trajectory_file.content() ==
+      polynomial_trajectories::TrajectoryFileContent::POLYNOMIAL) {
+    polynomial_trajectories::PolynomialTrajectory polynomial;
+    trajectory_file.load(&polynomial);
+    trajectory = trajectory_generation_helper::polynomials::samplePolynomial(
+        polynomial, kTrajectoryFileSamplingFrequency_);
+  } else {
+    trajectory_file.load(&trajectory);
+  }
+
+  if (trajectory.points.empty()) {
+    ROS_ERROR("[%s] Trajectory file %s contains an empty trajectory.",
+              pnh_.getNamespace().c_str(), file_name.c_str());
+    return false;
+  }
+
+  sendTrajectory(trajectory);
+
+  return true;
+}
+
 void AutoPilotHelper::sendControlCommandInput(
     const quadrotor_common::ControlCommand& control_command) const {
   control_command_input_pub_.publish(control_command.toRosMessage());
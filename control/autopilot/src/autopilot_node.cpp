@@ -1,14 +1,32 @@
+#include <quadrotor_common/parameter_helper.h>
+
 #include "autopilot/autopilot.h"
 #include "position_controller/position_controller.h"
 #include "position_controller/position_controller_params.h"
 
 int main(int argc, char **argv) {
   ros::init(argc, argv, "autopilot");
-  autopilot::AutoPilot<position_controller::PositionController,
-                       position_controller::PositionControllerParams>
-      autopilot;
 
-  ros::spin();
+  // Run the position controller in single precision if requested, e.g. on
+  // onboard computers where this is considerably faster
+  bool use_single_precision_controller = false;
+  quadrotor_common::getParam("use_single_precision_controller",
+                             use_single_precision_controller, false,
+                             ros::NodeHandle("~"));
+
+  if (use_single_precision_controller) {
+    autopilot::AutoPilot<position_controller::PositionController<float>,
+                         position_controller::PositionControllerParams<float>>
+        autopilot;
+
+    ros::spin();
+  } else {
+    autopilot::AutoPilot<position_controller::PositionController<double>,
+                         position_controller::PositionControllerParams<double>>
+        autopilot;
+
+    ros::spin();
+  }
 
   return 0;
 }
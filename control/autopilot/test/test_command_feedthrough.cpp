@@ -0,0 +1,192 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include <position_controller/position_controller.h>
+#include <position_controller/position_controller_params.h>
+#include <quadrotor_msgs/AutopilotFeedback.h>
+#include <quadrotor_msgs/ControlCommand.h>
+#include <ros/ros.h>
+#include <std_msgs/Empty.h>
+
+#include "autopilot/autopilot.h"
+#include "autopilot/clock.h"
+
+namespace autopilot {
+
+namespace {
+
+// Clock that only advances when the test advances it
+class ManualClock : public Clock {
+ public:
+  explicit ManualClock(const ros::Time& time) : time_nsec_(time.toNSec()) {}
+
+  ros::Time now() const override {
+    ros::Time time;
+    time.fromNSec(time_nsec_);
+    return time;
+  }
+
+  void advance(const ros::Duration& duration) {
+    time_nsec_ += duration.toNSec();
+  }
+
+ private:
+  std::atomic<uint64_t> time_nsec_;
+};
+
+class CommandFeedthroughTest : public ::testing::Test {
+ protected:
+  CommandFeedthroughTest()
+      : nh_(),
+        pnh_("~"),
+        clock_(std::make_shared<ManualClock>(ros::Time(1000.0))),
+        spinner_(1),
+        last_feedback_stamp_(),
+        last_autopilot_state_(quadrotor_msgs::AutopilotFeedback::OFF) {
+    feedback_sub_ = nh_.subscribe(
+        "autopilot/feedback", 100, &CommandFeedthroughTest::feedbackCallback,
+        this);
+    control_command_input_pub_ = nh_.advertise<quadrotor_msgs::ControlCommand>(
+        "autopilot/control_command_input", 1);
+    off_pub_ = nh_.advertise<std_msgs::Empty>("autopilot/off", 1);
+    spinner_.start();
+  }
+
+  ~CommandFeedthroughTest() { spinner_.stop(); }
+
+  void feedbackCallback(
+      const quadrotor_msgs::AutopilotFeedback::ConstPtr& msg) {
+    {
+      std::lock_guard<std::mutex> lock(feedback_mutex_);
+      last_feedback_stamp_ = msg->header.stamp;
+      last_autopilot_state_ = msg->autopilot_state;
+    }
+    feedback_cv_.notify_all();
+  }
+
+  // Advances the clock by one step and waits for the feedback the watchdog
+  // publishes for the new time while there is no state estimate. Returns
+  // false if no such feedback arrived before the deadline.
+  bool stepClock(uint8_t* autopilot_state) {
+    clock_->advance(ros::Duration(kClockStep));
+    const ros::Time time_now = clock_->now();
+    std::unique_lock<std::mutex> lock(feedback_mutex_);
+    if (!feedback_cv_.wait_for(
+            lock, std::chrono::duration<double>(kFeedbackTimeout),
+            [this, &time_now] { return last_feedback_stamp_ >= time_now; })) {
+      return false;
+    }
+    *autopilot_state = last_autopilot_state_;
+    return true;
+  }
+
+  // Steps the clock until the feedback reports the expected state. Returns
+  // false if it does not within the given number of steps.
+  bool stepClockUntil(const uint8_t expected_state, const int max_num_steps) {
+    for (int i = 0; i < max_num_steps; i++) {
+      uint8_t autopilot_state;
+      if (!stepClock(&autopilot_state)) {
+        return false;
+      }
+      if (autopilot_state == expected_state) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool waitForConnections(const ros::Publisher& publisher) const {
+    for (int i = 0; i < 100 && publisher.getNumSubscribers() == 0; i++) {
+      ros::Duration(0.05).sleep();
+    }
+    return publisher.getNumSubscribers() > 0;
+  }
+
+  // Less than a third of the control command input timeout, longer than the
+  // feedback throttling period, so every step yields one feedback message
+  static constexpr double kClockStep = 0.02;
+  // Wall time to wait for the feedback of one clock step, the watchdog runs
+  // at 50 Hz
+  static constexpr double kFeedbackTimeout = 2.0;
+  // Far below the emergency landing duration, so the autopilot can only be
+  // OFF within these steps after receiving the off command
+  static constexpr int kMaxNumStepsToSwitch = 10;
+
+  ros::NodeHandle nh_;
+  ros::NodeHandle pnh_;
+  std::shared_ptr<ManualClock> clock_;
+  ros::AsyncSpinner spinner_;
+  ros::Subscriber feedback_sub_;
+  ros::Publisher control_command_input_pub_;
+  ros::Publisher off_pub_;
+
+  std::mutex feedback_mutex_;
+  std::condition_variable feedback_cv_;
+  ros::Time last_feedback_stamp_;
+  uint8_t last_autopilot_state_;
+};
+
+constexpr double CommandFeedthroughTest::kClockStep;
+constexpr double CommandFeedthroughTest::kFeedbackTimeout;
+constexpr int CommandFeedthroughTest::kMaxNumStepsToSwitch;
+
+}  // namespace
+
+// Every iteration switches from OFF to COMMAND_FEEDTHROUGH after the time of
+// the previous input has timed out, while the watchdog checks the timeout
+// concurrently. The watchdog must never see the new state together with the
+// time of the previous input.
+TEST_F(CommandFeedthroughTest, WatchdogKeepsFirstFeedthroughCommand) {
+  const int kNumSwitches = 20;
+
+  AutoPilot<position_controller::PositionController<double>,
+            position_controller::PositionControllerParams<double>>
+      autopilot(nh_, pnh_, clock_);
+  ASSERT_TRUE(waitForConnections(control_command_input_pub_));
+  ASSERT_TRUE(waitForConnections(off_pub_));
+
+  quadrotor_msgs::ControlCommand control_command_input;
+  control_command_input.armed = true;
+  control_command_input.collective_thrust = 9.81;
+
+  ASSERT_TRUE(stepClockUntil(quadrotor_msgs::AutopilotFeedback::OFF,
+                             kMaxNumStepsToSwitch));
+
+  for (int i = 0; i < kNumSwitches; i++) {
+    control_command_input.header.stamp = clock_->now();
+    control_command_input_pub_.publish(control_command_input);
+    ASSERT_TRUE(stepClockUntil(
+        quadrotor_msgs::AutopilotFeedback::COMMAND_FEEDTHROUGH,
+        kMaxNumStepsToSwitch))
+        << "Did not switch to COMMAND_FEEDTHROUGH in switch " << i;
+
+    // The input has not timed out yet, so the watchdog must keep the state
+    for (int j = 0; j < 2; j++) {
+      uint8_t autopilot_state;
+      ASSERT_TRUE(stepClock(&autopilot_state));
+      EXPECT_EQ(quadrotor_msgs::AutopilotFeedback::COMMAND_FEEDTHROUGH,
+                autopilot_state)
+          << "Left COMMAND_FEEDTHROUGH in switch " << i;
+    }
+
+    off_pub_.publish(std_msgs::Empty());
+    // Lets the input time out
+    clock_->advance(ros::Duration(1.0));
+    ASSERT_TRUE(stepClockUntil(quadrotor_msgs::AutopilotFeedback::OFF,
+                               kMaxNumStepsToSwitch))
+        << "Did not switch to OFF in switch " << i;
+  }
+}
+
+}  // namespace autopilot
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  ros::init(argc, argv, "test_command_feedthrough");
+  return RUN_ALL_TESTS();
+}
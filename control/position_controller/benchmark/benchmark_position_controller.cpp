@@ -0,0 +1,121 @@
+// Google Benchmark of PositionController::run in double and single precision.
+// Run with --benchmark_format=json or --benchmark_out=<file> to get machine
+// readable results that can be compared over time.
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+#include <quadrotor_common/control_command.h>
+#include <quadrotor_common/quad_state_estimate.h>
+#include <quadrotor_common/trajectory.h>
+#include <quadrotor_common/trajectory_point.h>
+#include <Eigen/Dense>
+
+#include "position_controller/position_controller.h"
+#include "position_controller/position_controller_params.h"
+
+namespace position_controller {
+
+namespace {
+
+// All inputs are drawn with a fixed seed, so every run benchmarks the same
+// controller inputs
+static constexpr int kRandomSeed = 42;
+static constexpr int kNumInputs = 64;
+
+template <typename T>
+PositionControllerParams<T> defaultParams(
+    const bool perform_aerodynamics_compensation) {
+  // Same values as in parameters/default.yaml
+  PositionControllerParams<T> params;
+  params.use_rate_mode = true;
+  params.kpxy = 10.0;
+  params.kdxy = 4.0;
+  params.kpz = 15.0;
+  params.kdz = 6.0;
+  params.krp = 12.0;
+  params.kyaw = 5.0;
+  params.pxy_error_max = 0.6;
+  params.vxy_error_max = 1.0;
+  params.pz_error_max = 0.3;
+  params.vz_error_max = 0.75;
+  params.yaw_error_max = 0.7;
+  params.perform_aerodynamics_compensation = perform_aerodynamics_compensation;
+  params.k_drag_x = 0.3;
+  params.k_drag_y = 0.3;
+  params.k_drag_z = 0.1;
+  params.k_thrust_horz = 0.01;
+
+  return params;
+}
+
+struct ControllerInput {
+  quadrotor_common::QuadStateEstimate state_estimate;
+  quadrotor_common::Trajectory reference_trajectory;
+};
+
+// Estimates close to their references as they would be during flight
+std::vector<ControllerInput> sampleInputs() {
+  std::mt19937 generator(kRandomSeed);
+  std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+  const auto random_vector = [&](const double scale) {
+    return Eigen::Vector3d(scale * uniform(generator),
+                           scale * uniform(generator),
+                           scale * uniform(generator));
+  };
+
+  std::vector<ControllerInput> inputs(kNumInputs);
+  for (ControllerInput& input : inputs) {
+    quadrotor_common::TrajectoryPoint reference_state;
+    reference_state.position = random_vector(5.0);
+    reference_state.velocity = random_vector(3.0);
+    reference_state.acceleration = random_vector(5.0);
+    reference_state.jerk = random_vector(10.0);
+    reference_state.snap = random_vector(20.0);
+    reference_state.heading = M_PI * uniform(generator);
+    reference_state.heading_rate = uniform(generator);
+    reference_state.heading_acceleration = uniform(generator);
+    input.reference_trajectory = quadrotor_common::Trajectory(reference_state);
+
+    input.state_estimate.position =
+        reference_state.position + random_vector(0.3);
+    input.state_estimate.velocity =
+        reference_state.velocity + random_vector(0.3);
+    input.state_estimate.orientation =
+        Eigen::Quaterniond(Eigen::AngleAxisd(reference_state.heading,
+                                             Eigen::Vector3d::UnitZ()) *
+                           Eigen::AngleAxisd(0.3 * uniform(generator),
+                                             Eigen::Vector3d::UnitX()) *
+                           Eigen::AngleAxisd(0.3 * uniform(generator),
+                                             Eigen::Vector3d::UnitY()));
+    input.state_estimate.bodyrates = random_vector(1.0);
+  }
+
+  return inputs;
+}
+
+// Argument: aerodynamics compensation (0 or 1)
+template <typename T>
+void BM_PositionControllerRun(benchmark::State& state) {
+  const std::vector<ControllerInput> inputs = sampleInputs();
+  const PositionControllerParams<T> params = defaultParams<T>(state.range(0));
+  PositionController<T> controller;
+
+  int i = 0;
+  for (auto _ : state) {
+    const ControllerInput& input = inputs[i];
+    quadrotor_common::ControlCommand command = controller.run(
+        input.state_estimate, input.reference_trajectory, params);
+    benchmark::DoNotOptimize(command);
+    i = (i + 1) % kNumInputs;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_PositionControllerRun, double)->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_PositionControllerRun, float)->Arg(0)->Arg(1);
+
+}  // namespace
+
+}  // namespace position_controller
+
+BENCHMARK_MAIN();
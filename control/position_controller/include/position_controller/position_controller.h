@@ -11,10 +11,20 @@
 
 namespace position_controller {
 
+// The controller is templated on the scalar type used for its internal
+// computations. Inputs and outputs are always the double precision
+// quadrotor_common types, they are only converted at the interface.
+// Explicit instantiations are provided for double and float.
+template <typename T>
 class PositionController {
  public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
+  typedef T Scalar;
+  typedef Eigen::Matrix<T, 3, 1> Vector3;
+  typedef Eigen::Matrix<T, 3, 3> Matrix3;
+  typedef Eigen::Quaternion<T> Quaternion;
+
   PositionController();
   ~PositionController();
 
@@ -22,52 +32,85 @@ class PositionController {
   quadrotor_common::ControlCommand run(
       const quadrotor_common::QuadStateEstimate& state_estimate,
       const quadrotor_common::Trajectory& reference_trajectory,
-      const PositionControllerParams& config);
+      const PositionControllerParams<T>& config);
 
  private:
-  quadrotor_common::ControlCommand computeNominalReferenceInputs(
-      const quadrotor_common::TrajectoryPoint& reference_state,
-      const Eigen::Quaterniond& attitude_estimate) const;
+  // Scalar type specific copies of the controller inputs and outputs
+  struct StateEstimate {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    explicit StateEstimate(
+        const quadrotor_common::QuadStateEstimate& state_estimate);
+
+    Vector3 position;
+    Vector3 velocity;
+    Quaternion orientation;
+    Vector3 bodyrates;
+  };
+
+  struct ReferenceState {
+    explicit ReferenceState(
+        const quadrotor_common::TrajectoryPoint& reference_state);
+
+    Vector3 position;
+    Vector3 velocity;
+    Vector3 acceleration;
+    Vector3 jerk;
+    Vector3 snap;
+    T heading;
+    T heading_rate;
+    T heading_acceleration;
+  };
+
+  struct ReferenceInputs {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    ReferenceInputs();
+
+    Quaternion orientation;
+    T collective_thrust;
+    Vector3 bodyrates;
+    Vector3 angular_accelerations;
+  };
+
+  ReferenceInputs computeNominalReferenceInputs(
+      const ReferenceState& reference_state,
+      const Quaternion& attitude_estimate) const;
 
   void computeAeroCompensatedReferenceInputs(
-      const quadrotor_common::TrajectoryPoint& reference_state,
-      const quadrotor_common::QuadStateEstimate& state_estimate,
-      const PositionControllerParams& config,
-      quadrotor_common::ControlCommand* reference_inputs,
-      Eigen::Vector3d* drag_accelerations) const;
+      const ReferenceState& reference_state,
+      const StateEstimate& state_estimate,
+      const PositionControllerParams<T>& config,
+      ReferenceInputs* reference_inputs, Vector3* drag_accelerations) const;
 
-  Eigen::Vector3d computePIDErrorAcc(
-      const quadrotor_common::QuadStateEstimate& state_estimate,
-      const quadrotor_common::TrajectoryPoint& reference_state,
-      const PositionControllerParams& config) const;
-
-  double computeDesiredCollectiveMassNormalizedThrust(
-      const Eigen::Quaterniond& attitude_estimate,
-      const Eigen::Vector3d& desired_acc,
-      const PositionControllerParams& config) const;
-
-  Eigen::Quaterniond computeDesiredAttitude(
-      const Eigen::Vector3d& desired_acceleration, const double reference_yaw,
-      const Eigen::Quaterniond& attitude_estimate) const;
-  Eigen::Vector3d computeRobustBodyXAxis(
-      const Eigen::Vector3d& x_B_prototype, const Eigen::Vector3d& x_C,
-      const Eigen::Vector3d& y_C,
-      const Eigen::Quaterniond& attitude_estimate) const;
-
-  Eigen::Vector3d computeFeedBackControlBodyrates(
-      const Eigen::Quaterniond& desired_attitude,
-      const Eigen::Quaterniond& attitude_estimate,
-      const PositionControllerParams& config) const;
-
-  bool almostZero(const double value) const;
-  bool almostZeroThrust(const double thrust_value) const;
+  Vector3 computePIDErrorAcc(const StateEstimate& state_estimate,
+                             const ReferenceState& reference_state,
+                             const PositionControllerParams<T>& config) const;
+
+  T computeDesiredCollectiveMassNormalizedThrust(
+      const Quaternion& attitude_estimate, const Vector3& desired_acc,
+      const PositionControllerParams<T>& config) const;
+
+  Quaternion computeDesiredAttitude(const Vector3& desired_acceleration,
+                                    const T reference_yaw,
+                                    const Quaternion& attitude_estimate) const;
+  Vector3 computeRobustBodyXAxis(const Vector3& x_B_prototype,
+                                 const Vector3& x_C, const Vector3& y_C,
+                                 const Quaternion& attitude_estimate) const;
+
+  Vector3 computeFeedBackControlBodyrates(
+      const Quaternion& desired_attitude, const Quaternion& attitude_estimate,
+      const PositionControllerParams<T>& config) const;
+
+  bool almostZero(const T value) const;
+  bool almostZeroThrust(const T thrust_value) const;
 
   // Constants
   static constexpr double kMinNormalizedCollectiveThrust_ = 1.0;
   static constexpr double kAlmostZeroValueThreshold_ = 0.001;
   static constexpr double kAlmostZeroThrustThreshold_ = 0.01;
 
-  const Eigen::Vector3d kGravity_ = Eigen::Vector3d(0.0, 0.0, -9.81);
+  const Vector3 kGravity_ = Vector3(0.0, 0.0, -9.81);
 };
 
 }  // namespace position_controller
@@ -1,9 +1,11 @@
 #pragma once
 
-#include <quadrotor_common/parameter_helper.h>
+#include <parameter_dictionary/parameter_dictionary.h>
+#include <ros/ros.h>
 
 namespace position_controller {
 
+template <typename T>
 class PositionControllerParams {
  public:
   PositionControllerParams()
@@ -28,105 +30,76 @@ class PositionControllerParams {
   ~PositionControllerParams() {}
 
   bool loadParameters(const ros::NodeHandle& pnh) {
-    const std::string path_rel_to_node = "position_controller";
-
-    if (!quadrotor_common::getParam(path_rel_to_node + "/use_rate_mode",
-                                    use_rate_mode, pnh)) {
+    parameter_dictionary::ParameterDictionary parameters;
+    if (!parameters.fetch(pnh)) {
       return false;
     }
 
-    if (!quadrotor_common::getParam(path_rel_to_node + "/kpxy", kpxy, pnh)) {
-      return false;
-    }
-    if (!quadrotor_common::getParam(path_rel_to_node + "/kdxy", kdxy, pnh)) {
-      return false;
-    }
+    return loadParameters(parameters);
+  }
 
-    if (!quadrotor_common::getParam(path_rel_to_node + "/kpz", kpz, pnh)) {
-      return false;
-    }
-    if (!quadrotor_common::getParam(path_rel_to_node + "/kdz", kdz, pnh)) {
-      return false;
-    }
+  // Loads the parameters from a dictionary holding the node's namespace,
+  // which avoids a parameter server request for every single parameter
+  bool loadParameters(
+      const parameter_dictionary::ParameterDictionary& parameters) {
+    const std::string path_rel_to_node = "position_controller";
 
-    if (!quadrotor_common::getParam(path_rel_to_node + "/krp", krp, pnh)) {
-      return false;
-    }
-    if (!quadrotor_common::getParam(path_rel_to_node + "/kyaw", kyaw, pnh)) {
-      return false;
-    }
+#define GET_PARAM(name) \
+  if (!parameters.getParam(path_rel_to_node + "/" #name, name)) return false
 
-    if (!quadrotor_common::getParam(path_rel_to_node + "/pxy_error_max",
-                                    pxy_error_max, pnh)) {
-      return false;
-    }
-    if (!quadrotor_common::getParam(path_rel_to_node + "/vxy_error_max",
-                                    vxy_error_max, pnh)) {
-      return false;
-    }
-    if (!quadrotor_common::getParam(path_rel_to_node + "/pz_error_max",
-                                    pz_error_max, pnh)) {
-      return false;
-    }
-    if (!quadrotor_common::getParam(path_rel_to_node + "/vz_error_max",
-                                    vz_error_max, pnh)) {
-      return false;
-    }
-    if (!quadrotor_common::getParam(path_rel_to_node + "/yaw_error_max",
-                                    yaw_error_max, pnh)) {
-      return false;
-    }
+    GET_PARAM(use_rate_mode);
 
-    if (!quadrotor_common::getParam(
-            path_rel_to_node + "/perform_aerodynamics_compensation",
-            perform_aerodynamics_compensation, pnh)) {
-      return false;
-    }
-    if (!quadrotor_common::getParam(path_rel_to_node + "/k_drag_x", k_drag_x,
-                                    pnh)) {
-      return false;
-    }
-    if (!quadrotor_common::getParam(path_rel_to_node + "/k_drag_y", k_drag_y,
-                                    pnh)) {
-      return false;
-    }
-    if (!quadrotor_common::getParam(path_rel_to_node + "/k_drag_z", k_drag_z,
-                                    pnh)) {
-      return false;
-    }
-    if (!quadrotor_common::getParam(path_rel_to_node + "/k_thrust_horz",
-                                    k_thrust_horz, pnh)) {
-      return false;
-    }
+    GET_PARAM(kpxy);
+    GET_PARAM(kdxy);
+
+    GET_PARAM(kpz);
+    GET_PARAM(kdz);
+
+    GET_PARAM(krp);
+    GET_PARAM(kyaw);
+
+    GET_PARAM(pxy_error_max);
+    GET_PARAM(vxy_error_max);
+    GET_PARAM(pz_error_max);
+    GET_PARAM(vz_error_max);
+    GET_PARAM(yaw_error_max);
+
+    GET_PARAM(perform_aerodynamics_compensation);
+    GET_PARAM(k_drag_x);
+    GET_PARAM(k_drag_y);
+    GET_PARAM(k_drag_z);
+    GET_PARAM(k_thrust_horz);
 
     return true;
+
+#undef GET_PARAM
   }
 
   // Send bodyrate commands if true, attitude commands otherwise
   bool use_rate_mode;
 
-  double kpxy;  // [1/s^2]
-  double kdxy;  // [1/s]
+  T kpxy;  // [1/s^2]
+  T kdxy;  // [1/s]
 
-  double kpz;  // [1/s^2]
-  double kdz;  // [1/s]
+  T kpz;  // [1/s^2]
+  T kdz;  // [1/s]
 
-  double krp;   // [1/s]
-  double kyaw;  // [1/s]
+  T krp;   // [1/s]
+  T kyaw;  // [1/s]
 
-  double pxy_error_max;  // [m]
-  double vxy_error_max;  // [m/s]
-  double pz_error_max;   // [m]
-  double vz_error_max;   // [m/s]
-  double yaw_error_max;  // [rad]
+  T pxy_error_max;  // [m]
+  T vxy_error_max;  // [m/s]
+  T pz_error_max;   // [m]
+  T vz_error_max;   // [m/s]
+  T yaw_error_max;  // [rad]
 
   // Whether or not to compensate for aerodynamic effects
   bool perform_aerodynamics_compensation;
-  double k_drag_x;  // x-direction rotor drag coefficient
-  double k_drag_y;  // y-direction rotor drag coefficient
-  double k_drag_z;  // z-direction rotor drag coefficient
+  T k_drag_x;  // x-direction rotor drag coefficient
+  T k_drag_y;  // y-direction rotor drag coefficient
+  T k_drag_z;  // z-direction rotor drag coefficient
   // thrust correction coefficient due to body horizontal velocity
-  double k_thrust_horz;
+  T k_thrust_horz;
 };
 
 }  // namespace position_controller
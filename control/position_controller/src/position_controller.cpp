@@ -4,11 +4,62 @@
 
 namespace position_controller {
 
-PositionController::PositionController() {}
+namespace {
 
-PositionController::~PositionController() {}
+template <typename T>
+void limit(T* value, const T min, const T max) {
+  if (*value > max) {
+    *value = max;
+  }
+  if (*value < min) {
+    *value = min;
+  }
+}
 
-quadrotor_common::ControlCommand PositionController::off() {
+template <typename T>
+Eigen::Matrix<T, 3, 3> skew(const Eigen::Matrix<T, 3, 1>& v) {
+  return (Eigen::Matrix<T, 3, 3>() << 0.0, -v.z(), v.y(), v.z(), 0.0, -v.x(),
+          -v.y(), v.x(), 0.0)
+      .finished();
+}
+
+}  // namespace
+
+template <typename T>
+PositionController<T>::StateEstimate::StateEstimate(
+    const quadrotor_common::QuadStateEstimate& state_estimate)
+    : position(state_estimate.position.cast<T>()),
+      velocity(state_estimate.velocity.cast<T>()),
+      orientation(state_estimate.orientation.cast<T>()),
+      bodyrates(state_estimate.bodyrates.cast<T>()) {}
+
+template <typename T>
+PositionController<T>::ReferenceState::ReferenceState(
+    const quadrotor_common::TrajectoryPoint& reference_state)
+    : position(reference_state.position.cast<T>()),
+      velocity(reference_state.velocity.cast<T>()),
+      acceleration(reference_state.acceleration.cast<T>()),
+      jerk(reference_state.jerk.cast<T>()),
+      snap(reference_state.snap.cast<T>()),
+      heading(T(reference_state.heading)),
+      heading_rate(T(reference_state.heading_rate)),
+      heading_acceleration(T(reference_state.heading_acceleration)) {}
+
+template <typename T>
+PositionController<T>::ReferenceInputs::ReferenceInputs()
+    : orientation(Quaternion::Identity()),
+      collective_thrust(0.0),
+      bodyrates(Vector3::Zero()),
+      angular_accelerations(Vector3::Zero()) {}
+
+template <typename T>
+PositionController<T>::PositionController() {}
+
+template <typename T>
+PositionController<T>::~PositionController() {}
+
+template <typename T>
+quadrotor_common::ControlCommand PositionController<T>::off() {
   quadrotor_common::ControlCommand command;
 
   command.zero();
@@ -16,19 +67,21 @@ quadrotor_common::ControlCommand PositionController::off() {
   return command;
 }
 
-quadrotor_common::ControlCommand PositionController::run(
-    const quadrotor_common::QuadStateEstimate& state_estimate,
+template <typename T>
+quadrotor_common::ControlCommand PositionController<T>::run(
+    const quadrotor_common::QuadStateEstimate& state_estimate_in,
     const quadrotor_common::Trajectory& reference_trajectory,
-    const PositionControllerParams& config) {
+    const PositionControllerParams<T>& config) {
   quadrotor_common::ControlCommand command;
   command.armed = true;
 
-  quadrotor_common::TrajectoryPoint reference_state(
-      reference_trajectory.points.front());
+  // Convert inputs to the scalar type of the controller
+  const StateEstimate state_estimate(state_estimate_in);
+  const ReferenceState reference_state(reference_trajectory.points.front());
 
   // Compute reference inputs
-  Eigen::Vector3d drag_accelerations = Eigen::Vector3d::Zero();
-  quadrotor_common::ControlCommand reference_inputs;
+  Vector3 drag_accelerations = Vector3::Zero();
+  ReferenceInputs reference_inputs;
   if (config.perform_aerodynamics_compensation) {
     // Compute reference inputs that compensate for aerodynamic drag
     computeAeroCompensatedReferenceInputs(reference_state, state_estimate,
@@ -36,7 +89,7 @@ quadrotor_common::ControlCommand PositionController::run(
                                           &drag_accelerations);
   } else {
     // In this case we are not considering aerodynamic accelerations
-    drag_accelerations = Eigen::Vector3d::Zero();
+    drag_accelerations = Vector3::Zero();
 
     // Compute reference inputs as feed forward terms
     reference_inputs = computeNominalReferenceInputs(
@@ -44,67 +97,73 @@ quadrotor_common::ControlCommand PositionController::run(
   }
 
   // Compute desired control commands
-  const Eigen::Vector3d pid_error_accelerations =
+  const Vector3 pid_error_accelerations =
       computePIDErrorAcc(state_estimate, reference_state, config);
-  const Eigen::Vector3d desired_acceleration = pid_error_accelerations +
-                                               reference_state.acceleration -
-                                               kGravity_ - drag_accelerations;
+  const Vector3 desired_acceleration = pid_error_accelerations +
+                                       reference_state.acceleration -
+                                       kGravity_ - drag_accelerations;
 
-  command.collective_thrust = computeDesiredCollectiveMassNormalizedThrust(
+  T collective_thrust = computeDesiredCollectiveMassNormalizedThrust(
       state_estimate.orientation, desired_acceleration, config);
   if (config.perform_aerodynamics_compensation) {
     // This compensates for an acceleration component in thrust direction due
     // to the square of the body-horizontal velocity.
-    command.collective_thrust -=
-        config.k_thrust_horz * (pow(state_estimate.velocity.x(), 2.0) +
-                                pow(state_estimate.velocity.y(), 2.0));
+    collective_thrust -=
+        config.k_thrust_horz *
+        (state_estimate.velocity.x() * state_estimate.velocity.x() +
+         state_estimate.velocity.y() * state_estimate.velocity.y());
   }
+  command.collective_thrust = collective_thrust;
 
-  const Eigen::Quaterniond desired_attitude =
+  const Quaternion desired_attitude =
       computeDesiredAttitude(desired_acceleration, reference_state.heading,
                              state_estimate.orientation);
-  const Eigen::Vector3d feedback_bodyrates = computeFeedBackControlBodyrates(
+  const Vector3 feedback_bodyrates = computeFeedBackControlBodyrates(
       desired_attitude, state_estimate.orientation, config);
 
+  Vector3 bodyrates;
   if (config.use_rate_mode) {
     command.control_mode = quadrotor_common::ControlMode::BODY_RATES;
-    command.bodyrates = reference_inputs.bodyrates + feedback_bodyrates;
+    bodyrates = reference_inputs.bodyrates + feedback_bodyrates;
   } else {
     command.control_mode = quadrotor_common::ControlMode::ATTITUDE;
-    command.orientation = desired_attitude;
+    command.orientation = desired_attitude.template cast<double>();
 
     // In ATTITUDE control mode the x-y-bodyrates contain just the feed forward
     // terms. The z-bodyrate has to be from feedback control
-    command.bodyrates = reference_inputs.bodyrates;
-    command.bodyrates.z() += feedback_bodyrates.z();
+    bodyrates = reference_inputs.bodyrates;
+    bodyrates.z() += feedback_bodyrates.z();
   }
+  command.bodyrates = bodyrates.template cast<double>();
 
-  command.angular_accelerations = reference_inputs.angular_accelerations;
+  command.angular_accelerations =
+      reference_inputs.angular_accelerations.template cast<double>();
 
   return command;
 }
 
-quadrotor_common::ControlCommand
-PositionController::computeNominalReferenceInputs(
-    const quadrotor_common::TrajectoryPoint& reference_state,
-    const Eigen::Quaterniond& attitude_estimate) const {
-  quadrotor_common::ControlCommand reference_command;
+template <typename T>
+typename PositionController<T>::ReferenceInputs
+PositionController<T>::computeNominalReferenceInputs(
+    const ReferenceState& reference_state,
+    const Quaternion& attitude_estimate) const {
+  ReferenceInputs reference_command;
 
-  const Eigen::Quaterniond q_heading = Eigen::Quaterniond(
-      Eigen::AngleAxisd(reference_state.heading, Eigen::Vector3d::UnitZ()));
+  const Quaternion q_heading = Quaternion(
+      Eigen::AngleAxis<T>(reference_state.heading, Vector3::UnitZ()));
 
-  const Eigen::Vector3d x_C = q_heading * Eigen::Vector3d::UnitX();
-  const Eigen::Vector3d y_C = q_heading * Eigen::Vector3d::UnitY();
+  const Vector3 x_C = q_heading * Vector3::UnitX();
+  const Vector3 y_C = q_heading * Vector3::UnitY();
 
-  const Eigen::Vector3d des_acc = reference_state.acceleration - kGravity_;
+  const Vector3 des_acc = reference_state.acceleration - kGravity_;
 
   // Reference attitude
-  const Eigen::Quaterniond q_W_B = computeDesiredAttitude(
+  const Quaternion q_W_B = computeDesiredAttitude(
       des_acc, reference_state.heading, attitude_estimate);
 
-  const Eigen::Vector3d x_B = q_W_B * Eigen::Vector3d::UnitX();
-  const Eigen::Vector3d y_B = q_W_B * Eigen::Vector3d::UnitY();
-  const Eigen::Vector3d z_B = q_W_B * Eigen::Vector3d::UnitZ();
+  const Vector3 x_B = q_W_B * Vector3::UnitX();
+  const Vector3 y_B = q_W_B * Vector3::UnitY();
+  const Vector3 z_B = q_W_B * Vector3::UnitZ();
 
   reference_command.orientation = q_W_B;
 
@@ -138,7 +197,7 @@ PositionController::computeNominalReferenceInputs(
     reference_command.angular_accelerations.x() = 0.0;
     reference_command.angular_accelerations.y() = 0.0;
   } else {
-    const double thrust_dot = z_B.dot(reference_state.jerk);
+    const T thrust_dot = z_B.dot(reference_state.jerk);
     reference_command.angular_accelerations.x() =
         -1.0 / reference_command.collective_thrust *
         (y_B.dot(reference_state.snap) +
@@ -173,43 +232,39 @@ PositionController::computeNominalReferenceInputs(
   return reference_command;
 }
 
-void PositionController::computeAeroCompensatedReferenceInputs(
-    const quadrotor_common::TrajectoryPoint& reference_state,
-    const quadrotor_common::QuadStateEstimate& state_estimate,
-    const PositionControllerParams& config,
-    quadrotor_common::ControlCommand* reference_inputs,
-    Eigen::Vector3d* drag_accelerations) const {
-  quadrotor_common::ControlCommand reference_command;
-
-  const Eigen::Vector3d velocity_in_body =
-      state_estimate.orientation.inverse() * reference_state.velocity;
+template <typename T>
+void PositionController<T>::computeAeroCompensatedReferenceInputs(
+    const ReferenceState& reference_state, const StateEstimate& state_estimate,
+    const PositionControllerParams<T>& config,
+    ReferenceInputs* reference_inputs, Vector3* drag_accelerations) const {
+  ReferenceInputs reference_command;
 
-  const double dx = config.k_drag_x;
-  const double dy = config.k_drag_y;
-  const double dz = config.k_drag_z;
+  const T dx = config.k_drag_x;
+  const T dy = config.k_drag_y;
+  const T dz = config.k_drag_z;
 
-  const Eigen::Quaterniond q_heading = Eigen::Quaterniond(
-      Eigen::AngleAxisd(reference_state.heading, Eigen::Vector3d::UnitZ()));
+  const Quaternion q_heading = Quaternion(
+      Eigen::AngleAxis<T>(reference_state.heading, Vector3::UnitZ()));
 
-  const Eigen::Vector3d x_C = q_heading * Eigen::Vector3d::UnitX();
-  const Eigen::Vector3d y_C = q_heading * Eigen::Vector3d::UnitY();
+  const Vector3 x_C = q_heading * Vector3::UnitX();
+  const Vector3 y_C = q_heading * Vector3::UnitY();
 
-  const Eigen::Vector3d alpha =
+  const Vector3 alpha =
       reference_state.acceleration - kGravity_ + dx * reference_state.velocity;
-  const Eigen::Vector3d beta =
+  const Vector3 beta =
       reference_state.acceleration - kGravity_ + dy * reference_state.velocity;
-  const Eigen::Vector3d gamma =
+  const Vector3 gamma =
       reference_state.acceleration - kGravity_ + dz * reference_state.velocity;
 
   // Reference attitude
-  const Eigen::Vector3d x_B_prototype = y_C.cross(alpha);
-  const Eigen::Vector3d x_B = computeRobustBodyXAxis(
+  const Vector3 x_B_prototype = y_C.cross(alpha);
+  const Vector3 x_B = computeRobustBodyXAxis(
       x_B_prototype, x_C, y_C, state_estimate.orientation);
 
-  Eigen::Vector3d y_B = beta.cross(x_B);
+  Vector3 y_B = beta.cross(x_B);
   if (almostZero(y_B.norm())) {
-    const Eigen::Vector3d z_B_estimated =
-        state_estimate.orientation * Eigen::Vector3d::UnitZ();
+    const Vector3 z_B_estimated =
+        state_estimate.orientation * Vector3::UnitZ();
     y_B = z_B_estimated.cross(x_B);
     if (almostZero(y_B.norm())) {
       y_B = y_C;
@@ -220,39 +275,38 @@ void PositionController::computeAeroCompensatedReferenceInputs(
     y_B.normalize();
   }
 
-  const Eigen::Vector3d z_B = x_B.cross(y_B);
+  const Vector3 z_B = x_B.cross(y_B);
 
-  const Eigen::Matrix3d R_W_B_ref(
-      (Eigen::Matrix3d() << x_B, y_B, z_B).finished());
+  const Matrix3 R_W_B_ref((Matrix3() << x_B, y_B, z_B).finished());
 
-  reference_command.orientation = Eigen::Quaterniond(R_W_B_ref);
+  reference_command.orientation = Quaternion(R_W_B_ref);
 
   // Reference thrust
   reference_command.collective_thrust = z_B.dot(gamma);
 
   // Rotor drag matrix
-  const Eigen::Matrix3d D = Eigen::Vector3d(dx, dy, dz).asDiagonal();
+  const Matrix3 D = Vector3(dx, dy, dz).asDiagonal();
 
   // Reference body rates and angular accelerations
-  const double B1 = reference_command.collective_thrust -
-                    (dz - dx) * z_B.dot(reference_state.velocity);
-  const double C1 = -(dx - dy) * y_B.dot(reference_state.velocity);
-  const double D1 = x_B.dot(reference_state.jerk) +
-                    dx * x_B.dot(reference_state.acceleration);
-  const double A2 = reference_command.collective_thrust +
-                    (dy - dz) * z_B.dot(reference_state.velocity);
-  const double C2 = (dx - dy) * x_B.dot(reference_state.velocity);
-  const double D2 = -y_B.dot(reference_state.jerk) -
-                    dy * y_B.dot(reference_state.acceleration);
-  const double B3 = -y_C.dot(z_B);
-  const double C3 = (y_C.cross(z_B)).norm();
-  const double D3 = reference_state.heading_rate * x_C.dot(x_B);
-
-  const double denominator = B1 * C3 - B3 * C1;
+  const T B1 = reference_command.collective_thrust -
+               (dz - dx) * z_B.dot(reference_state.velocity);
+  const T C1 = -(dx - dy) * y_B.dot(reference_state.velocity);
+  const T D1 = x_B.dot(reference_state.jerk) +
+               dx * x_B.dot(reference_state.acceleration);
+  const T A2 = reference_command.collective_thrust +
+               (dy - dz) * z_B.dot(reference_state.velocity);
+  const T C2 = (dx - dy) * x_B.dot(reference_state.velocity);
+  const T D2 = -y_B.dot(reference_state.jerk) -
+               dy * y_B.dot(reference_state.acceleration);
+  const T B3 = -y_C.dot(z_B);
+  const T C3 = (y_C.cross(z_B)).norm();
+  const T D3 = reference_state.heading_rate * x_C.dot(x_B);
+
+  const T denominator = B1 * C3 - B3 * C1;
 
   if (almostZero(denominator)) {
-    reference_command.bodyrates = Eigen::Vector3d::Zero();
-    reference_command.angular_accelerations = Eigen::Vector3d::Zero();
+    reference_command.bodyrates = Vector3::Zero();
+    reference_command.angular_accelerations = Vector3::Zero();
   } else {
     // Compute body rates
     if (almostZero(A2)) {
@@ -266,16 +320,15 @@ void PositionController::computeAeroCompensatedReferenceInputs(
     reference_command.bodyrates.z() = (B1 * D3 - B3 * D1) / denominator;
 
     // Compute angular accelerations
-    const double thrust_dot = z_B.dot(reference_state.jerk) +
-                              reference_command.bodyrates.x() * (dy - dz) *
-                                  y_B.dot(reference_state.velocity) +
-                              reference_command.bodyrates.y() * (dz - dx) *
-                                  x_B.dot(reference_state.velocity) +
-                              dz * z_B.dot(reference_state.acceleration);
-
-    const Eigen::Matrix3d omega_hat =
-        quadrotor_common::skew(reference_command.bodyrates);
-    const Eigen::Vector3d xi =
+    const T thrust_dot = z_B.dot(reference_state.jerk) +
+                         reference_command.bodyrates.x() * (dy - dz) *
+                             y_B.dot(reference_state.velocity) +
+                         reference_command.bodyrates.y() * (dz - dx) *
+                             x_B.dot(reference_state.velocity) +
+                         dz * z_B.dot(reference_state.acceleration);
+
+    const Matrix3 omega_hat = skew(reference_command.bodyrates);
+    const Vector3 xi =
         R_W_B_ref *
             (omega_hat * omega_hat * D + D * omega_hat * omega_hat +
              2.0 * omega_hat * D * omega_hat.transpose()) *
@@ -284,25 +337,25 @@ void PositionController::computeAeroCompensatedReferenceInputs(
             R_W_B_ref.transpose() * reference_state.acceleration +
         R_W_B_ref * D * R_W_B_ref.transpose() * reference_state.jerk;
 
-    const double E1 = x_B.dot(reference_state.snap) -
-                      2.0 * thrust_dot * reference_command.bodyrates.y() -
-                      reference_command.collective_thrust *
-                          reference_command.bodyrates.x() *
-                          reference_command.bodyrates.z() +
-                      x_B.dot(xi);
-    const double E2 = -y_B.dot(reference_state.snap) -
-                      2.0 * thrust_dot * reference_command.bodyrates.x() +
-                      reference_command.collective_thrust *
-                          reference_command.bodyrates.y() *
-                          reference_command.bodyrates.z() -
-                      y_B.dot(xi);
-    const double E3 = reference_state.heading_acceleration * x_C.dot(x_B) +
-                      2.0 * reference_state.heading_rate *
-                          (reference_command.bodyrates.z() * x_C.dot(y_B) -
-                           reference_command.bodyrates.y() * x_C.dot(z_B)) -
-                      reference_command.bodyrates.x() *
-                          (reference_command.bodyrates.y() * y_C.dot(y_B) +
-                           reference_command.bodyrates.z() * y_C.dot(z_B));
+    const T E1 = x_B.dot(reference_state.snap) -
+                 2.0 * thrust_dot * reference_command.bodyrates.y() -
+                 reference_command.collective_thrust *
+                     reference_command.bodyrates.x() *
+                     reference_command.bodyrates.z() +
+                 x_B.dot(xi);
+    const T E2 = -y_B.dot(reference_state.snap) -
+                 2.0 * thrust_dot * reference_command.bodyrates.x() +
+                 reference_command.collective_thrust *
+                     reference_command.bodyrates.y() *
+                     reference_command.bodyrates.z() -
+                 y_B.dot(xi);
+    const T E3 = reference_state.heading_acceleration * x_C.dot(x_B) +
+                 2.0 * reference_state.heading_rate *
+                     (reference_command.bodyrates.z() * x_C.dot(y_B) -
+                      reference_command.bodyrates.y() * x_C.dot(z_B)) -
+                 reference_command.bodyrates.x() *
+                     (reference_command.bodyrates.y() * y_C.dot(y_B) +
+                      reference_command.bodyrates.z() * y_C.dot(z_B));
 
     if (almostZero(A2)) {
       reference_command.angular_accelerations.x() = 0.0;
@@ -318,13 +371,12 @@ void PositionController::computeAeroCompensatedReferenceInputs(
   }
 
   // Transform reference rates and derivatives into estimated body frame
-  const Eigen::Matrix3d R_trans =
+  const Matrix3 R_trans =
       state_estimate.orientation.toRotationMatrix().transpose() * R_W_B_ref;
-  const Eigen::Vector3d bodyrates_ref = reference_command.bodyrates;
-  const Eigen::Vector3d angular_accelerations_ref =
+  const Vector3 bodyrates_ref = reference_command.bodyrates;
+  const Vector3 angular_accelerations_ref =
       reference_command.angular_accelerations;
-  const Eigen::Matrix3d bodyrates_est_hat =
-      quadrotor_common::skew(state_estimate.bodyrates);
+  const Matrix3 bodyrates_est_hat = skew(state_estimate.bodyrates);
 
   reference_command.bodyrates = R_trans * bodyrates_ref;
   reference_command.angular_accelerations =
@@ -339,118 +391,108 @@ void PositionController::computeAeroCompensatedReferenceInputs(
       (R_W_B_ref * (D * (R_W_B_ref.transpose() * reference_state.velocity)));
 }
 
-Eigen::Vector3d PositionController::computePIDErrorAcc(
-    const quadrotor_common::QuadStateEstimate& state_estimate,
-    const quadrotor_common::TrajectoryPoint& reference_state,
-    const PositionControllerParams& config) const {
+template <typename T>
+typename PositionController<T>::Vector3
+PositionController<T>::computePIDErrorAcc(
+    const StateEstimate& state_estimate, const ReferenceState& reference_state,
+    const PositionControllerParams<T>& config) const {
   // Compute the desired accelerations due to control errors in world frame
   // with a PID controller
-  Eigen::Vector3d acc_error;
+  Vector3 acc_error;
 
   // x acceleration
-  double x_pos_error =
-      reference_state.position.x() - state_estimate.position.x();
-  quadrotor_common::limit(&x_pos_error, -config.pxy_error_max,
-                          config.pxy_error_max);
+  T x_pos_error = reference_state.position.x() - state_estimate.position.x();
+  limit(&x_pos_error, -config.pxy_error_max, config.pxy_error_max);
 
-  double x_vel_error =
-      reference_state.velocity.x() - state_estimate.velocity.x();
-  quadrotor_common::limit(&x_vel_error, -config.vxy_error_max,
-                          config.vxy_error_max);
+  T x_vel_error = reference_state.velocity.x() - state_estimate.velocity.x();
+  limit(&x_vel_error, -config.vxy_error_max, config.vxy_error_max);
 
   acc_error.x() = config.kpxy * x_pos_error + config.kdxy * x_vel_error;
 
   // y acceleration
-  double y_pos_error =
-      reference_state.position.y() - state_estimate.position.y();
-  quadrotor_common::limit(&y_pos_error, -config.pxy_error_max,
-                          config.pxy_error_max);
+  T y_pos_error = reference_state.position.y() - state_estimate.position.y();
+  limit(&y_pos_error, -config.pxy_error_max, config.pxy_error_max);
 
-  double y_vel_error =
-      reference_state.velocity.y() - state_estimate.velocity.y();
-  quadrotor_common::limit(&y_vel_error, -config.vxy_error_max,
-                          config.vxy_error_max);
+  T y_vel_error = reference_state.velocity.y() - state_estimate.velocity.y();
+  limit(&y_vel_error, -config.vxy_error_max, config.vxy_error_max);
 
   acc_error.y() = config.kpxy * y_pos_error + config.kdxy * y_vel_error;
 
   // z acceleration
-  double z_pos_error =
-      reference_state.position.z() - state_estimate.position.z();
-  quadrotor_common::limit(&z_pos_error, -config.pz_error_max,
-                          config.pz_error_max);
+  T z_pos_error = reference_state.position.z() - state_estimate.position.z();
+  limit(&z_pos_error, -config.pz_error_max, config.pz_error_max);
 
-  double z_vel_error =
-      reference_state.velocity.z() - state_estimate.velocity.z();
-  quadrotor_common::limit(&z_vel_error, -config.vz_error_max,
-                          config.vz_error_max);
+  T z_vel_error = reference_state.velocity.z() - state_estimate.velocity.z();
+  limit(&z_vel_error, -config.vz_error_max, config.vz_error_max);
 
   acc_error.z() = config.kpz * z_pos_error + config.kdz * z_vel_error;
 
   return acc_error;
 }
 
-double PositionController::computeDesiredCollectiveMassNormalizedThrust(
-    const Eigen::Quaterniond& attitude_estimate,
-    const Eigen::Vector3d& desired_acc,
-    const PositionControllerParams& config) const {
-  const Eigen::Vector3d body_z_axis =
-      attitude_estimate * Eigen::Vector3d::UnitZ();
+template <typename T>
+T PositionController<T>::computeDesiredCollectiveMassNormalizedThrust(
+    const Quaternion& attitude_estimate, const Vector3& desired_acc,
+    const PositionControllerParams<T>& config) const {
+  const Vector3 body_z_axis = attitude_estimate * Vector3::UnitZ();
 
-  double normalized_thrust = desired_acc.dot(body_z_axis);
+  T normalized_thrust = desired_acc.dot(body_z_axis);
   if (normalized_thrust < kMinNormalizedCollectiveThrust_) {
     normalized_thrust = kMinNormalizedCollectiveThrust_;
   }
   return normalized_thrust;
 }
 
-Eigen::Quaterniond PositionController::computeDesiredAttitude(
-    const Eigen::Vector3d& desired_acceleration, const double reference_heading,
-    const Eigen::Quaterniond& attitude_estimate) const {
-  const Eigen::Quaterniond q_heading = Eigen::Quaterniond(
-      Eigen::AngleAxisd(reference_heading, Eigen::Vector3d::UnitZ()));
+template <typename T>
+typename PositionController<T>::Quaternion
+PositionController<T>::computeDesiredAttitude(
+    const Vector3& desired_acceleration, const T reference_heading,
+    const Quaternion& attitude_estimate) const {
+  const Quaternion q_heading =
+      Quaternion(Eigen::AngleAxis<T>(reference_heading, Vector3::UnitZ()));
 
   // Compute desired orientation
-  const Eigen::Vector3d x_C = q_heading * Eigen::Vector3d::UnitX();
-  const Eigen::Vector3d y_C = q_heading * Eigen::Vector3d::UnitY();
+  const Vector3 x_C = q_heading * Vector3::UnitX();
+  const Vector3 y_C = q_heading * Vector3::UnitY();
 
-  Eigen::Vector3d z_B;
+  Vector3 z_B;
   if (almostZero(desired_acceleration.norm())) {
     // In case of free fall we keep the thrust direction to be the estimated one
     // This only works assuming that we are in this condition for a very short
     // time (otherwise attitude drifts)
-    z_B = attitude_estimate * Eigen::Vector3d::UnitZ();
+    z_B = attitude_estimate * Vector3::UnitZ();
   } else {
     z_B = desired_acceleration.normalized();
   }
 
-  const Eigen::Vector3d x_B_prototype = y_C.cross(z_B);
-  const Eigen::Vector3d x_B =
+  const Vector3 x_B_prototype = y_C.cross(z_B);
+  const Vector3 x_B =
       computeRobustBodyXAxis(x_B_prototype, x_C, y_C, attitude_estimate);
 
-  const Eigen::Vector3d y_B = (z_B.cross(x_B)).normalized();
+  const Vector3 y_B = (z_B.cross(x_B)).normalized();
 
   // From the computed desired body axes we can now compose a desired attitude
-  const Eigen::Matrix3d R_W_B((Eigen::Matrix3d() << x_B, y_B, z_B).finished());
+  const Matrix3 R_W_B((Matrix3() << x_B, y_B, z_B).finished());
 
-  const Eigen::Quaterniond desired_attitude(R_W_B);
+  const Quaternion desired_attitude(R_W_B);
 
   return desired_attitude;
 }
 
-Eigen::Vector3d PositionController::computeRobustBodyXAxis(
-    const Eigen::Vector3d& x_B_prototype, const Eigen::Vector3d& x_C,
-    const Eigen::Vector3d& y_C,
-    const Eigen::Quaterniond& attitude_estimate) const {
-  Eigen::Vector3d x_B = x_B_prototype;
+template <typename T>
+typename PositionController<T>::Vector3
+PositionController<T>::computeRobustBodyXAxis(
+    const Vector3& x_B_prototype, const Vector3& x_C, const Vector3& y_C,
+    const Quaternion& attitude_estimate) const {
+  Vector3 x_B = x_B_prototype;
 
   if (almostZero(x_B.norm())) {
     // if cross(y_C, z_B) == 0, they are collinear =>
     // every x_B lies automatically in the x_C - z_C plane
 
     // Project estimated body x-axis into the x_C - z_C plane
-    const Eigen::Vector3d x_B_estimated =
-        attitude_estimate * Eigen::Vector3d::UnitX();
-    const Eigen::Vector3d x_B_projected =
+    const Vector3 x_B_estimated = attitude_estimate * Vector3::UnitX();
+    const Vector3 x_B_projected =
         x_B_estimated - (x_B_estimated.dot(y_C)) * y_C;
     if (almostZero(x_B_projected.norm())) {
       // Not too much intelligent stuff we can do in this case but it should
@@ -473,15 +515,16 @@ Eigen::Vector3d PositionController::computeRobustBodyXAxis(
   return x_B;
 }
 
-Eigen::Vector3d PositionController::computeFeedBackControlBodyrates(
-    const Eigen::Quaterniond& desired_attitude,
-    const Eigen::Quaterniond& attitude_estimate,
-    const PositionControllerParams& config) const {
+template <typename T>
+typename PositionController<T>::Vector3
+PositionController<T>::computeFeedBackControlBodyrates(
+    const Quaternion& desired_attitude, const Quaternion& attitude_estimate,
+    const PositionControllerParams<T>& config) const {
   // Compute the error quaternion
-  const Eigen::Quaterniond q_e = attitude_estimate.inverse() * desired_attitude;
+  const Quaternion q_e = attitude_estimate.inverse() * desired_attitude;
 
   // Compute desired body rates from control error
-  Eigen::Vector3d bodyrates;
+  Vector3 bodyrates;
 
   if (q_e.w() >= 0) {
     bodyrates.x() = 2.0 * config.krp * q_e.x();
@@ -496,12 +539,17 @@ Eigen::Vector3d PositionController::computeFeedBackControlBodyrates(
   return bodyrates;
 }
 
-bool PositionController::almostZero(const double value) const {
+template <typename T>
+bool PositionController<T>::almostZero(const T value) const {
   return fabs(value) < kAlmostZeroValueThreshold_;
 }
 
-bool PositionController::almostZeroThrust(const double thrust_value) const {
+template <typename T>
+bool PositionController<T>::almostZeroThrust(const T thrust_value) const {
   return fabs(thrust_value) < kAlmostZeroThrustThreshold_;
 }
 
+template class PositionController<double>;
+template class PositionController<float>;
+
 }  // namespace position_controller
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include <random>
+
+#include <quadrotor_common/control_command.h>
+#include <quadrotor_common/quad_state_estimate.h>
+#include <quadrotor_common/trajectory.h>
+#include <quadrotor_common/trajectory_point.h>
+#include <Eigen/Dense>
+
+#include "position_controller/position_controller.h"
+#include "position_controller/position_controller_params.h"
+
+namespace position_controller {
+
+namespace {
+
+template <typename T>
+PositionControllerParams<T> defaultParams(
+    const bool perform_aerodynamics_compensation) {
+  // Same values as in parameters/default.yaml
+  PositionControllerParams<T> params;
+  params.use_rate_mode = true;
+  params.kpxy = 10.0;
+  params.kdxy = 4.0;
+  params.kpz = 15.0;
+  params.kdz = 6.0;
+  params.krp = 12.0;
+  params.kyaw = 5.0;
+  params.pxy_error_max = 0.6;
+  params.vxy_error_max = 1.0;
+  params.pz_error_max = 0.3;
+  params.vz_error_max = 0.75;
+  params.yaw_error_max = 0.7;
+  params.perform_aerodynamics_compensation = perform_aerodynamics_compensation;
+  params.k_drag_x = 0.3;
+  params.k_drag_y = 0.3;
+  params.k_drag_z = 0.1;
+  params.k_thrust_horz = 0.01;
+
+  return params;
+}
+
+class PositionControllerPrecisionTest : public ::testing::TestWithParam<bool> {
+ protected:
+  PositionControllerPrecisionTest() : generator_(42), uniform_(-1.0, 1.0) {}
+
+  Eigen::Vector3d randomVector(const double scale) {
+    return scale *
+           Eigen::Vector3d(uniform_(generator_), uniform_(generator_),
+                           uniform_(generator_));
+  }
+
+  void sampleInputs(quadrotor_common::QuadStateEstimate* state_estimate,
+                    quadrotor_common::Trajectory* reference_trajectory) {
+    quadrotor_common::TrajectoryPoint reference_state;
+    reference_state.position = randomVector(5.0);
+    reference_state.velocity = randomVector(3.0);
+    reference_state.acceleration = randomVector(5.0);
+    reference_state.jerk = randomVector(10.0);
+    reference_state.snap = randomVector(20.0);
+    reference_state.heading = M_PI * uniform_(generator_);
+    reference_state.heading_rate = uniform_(generator_);
+    reference_state.heading_acceleration = uniform_(generator_);
+    *reference_trajectory = quadrotor_common::Trajectory(reference_state);
+
+    // Estimate close to the reference as it would be during flight
+    state_estimate->position = reference_state.position + randomVector(0.3);
+    state_estimate->velocity = reference_state.velocity + randomVector(0.3);
+    state_estimate->orientation =
+        Eigen::Quaterniond(Eigen::AngleAxisd(reference_state.heading,
+                                             Eigen::Vector3d::UnitZ()) *
+                           Eigen::AngleAxisd(0.3 * uniform_(generator_),
+                                             Eigen::Vector3d::UnitX()) *
+                           Eigen::AngleAxisd(0.3 * uniform_(generator_),
+                                             Eigen::Vector3d::UnitY()));
+    state_estimate->bodyrates = randomVector(1.0);
+  }
+
+  std::mt19937 generator_;
+  std::uniform_real_distribution<double> uniform_;
+};
+
+}  // namespace
+
+TEST_P(PositionControllerPrecisionTest, FloatMatchesDouble) {
+  PositionController<double> controller_double;
+  PositionController<float> controller_float;
+  const PositionControllerParams<double> params_double =
+      defaultParams<double>(GetParam());
+  const PositionControllerParams<float> params_float =
+      defaultParams<float>(GetParam());
+
+  // Tolerances are relative to the magnitude of the respective outputs
+  const double kThrustTolerance = 1e-4;
+  const double kBodyratesTolerance = 1e-3;
+  const double kAngularAccelerationsTolerance = 1e-2;
+
+  for (int i = 0; i < 1000; i++) {
+    quadrotor_common::QuadStateEstimate state_estimate;
+    quadrotor_common::Trajectory reference_trajectory;
+    sampleInputs(&state_estimate, &reference_trajectory);
+
+    const quadrotor_common::ControlCommand command_double =
+        controller_double.run(state_estimate, reference_trajectory,
+                              params_double);
+    const quadrotor_common::ControlCommand command_float =
+        controller_float.run(state_estimate, reference_trajectory,
+                             params_float);
+
+    ASSERT_EQ(command_double.control_mode, command_float.control_mode);
+    EXPECT_NEAR(command_double.collective_thrust,
+                command_float.collective_thrust,
+                kThrustTolerance *
+                    std::max(1.0, fabs(command_double.collective_thrust)));
+    EXPECT_LT((command_double.bodyrates - command_float.bodyrates).norm(),
+              kBodyratesTolerance *
+                  std::max(1.0, command_double.bodyrates.norm()));
+    EXPECT_LT((command_double.angular_accelerations -
+               command_float.angular_accelerations)
+                  .norm(),
+              kAngularAccelerationsTolerance *
+                  std::max(1.0, command_double.angular_accelerations.norm()));
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(AerodynamicsCompensation,
+                        PositionControllerPrecisionTest,
+                        ::testing::Values(false, true));
+
+}  // namespace position_controller
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,462 @@
+// Google Benchmark suite of the trajectory generation and evaluation. Run with
+// --benchmark_format=json or --benchmark_out=<file> to get machine readable
+// results that can be compared over time.
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <quadrotor_common/trajectory_point.h>
+#include <ros/duration.h>
+#include <Eigen/Dense>
+
+#include "polynomial_trajectories/constrained_polynomial_trajectories.h"
+#include "polynomial_trajectories/minimum_snap_trajectories.h"
+#include "polynomial_trajectories/polynomial_trajectories_common.h"
+#include "polynomial_trajectories/polynomial_trajectory.h"
+#include "polynomial_trajectories/polynomial_trajectory_settings.h"
+#include "polynomial_trajectories/thread_pool.h"
+
+namespace polynomial_trajectories {
+
+namespace {
+
+// All problems are drawn with a fixed seed, so every run benchmarks the same
+// problems
+static constexpr int kRandomSeed = 42;
+static constexpr double kMaxVelocity = 3.0;
+static constexpr double kMaxNormalizedThrust = 15.0;
+static constexpr double kMaxRollPitchRate = 1.5;
+static constexpr double kSegmentTime = 2.0;
+// Margin of the corridors around the straight line between the way points
+static constexpr double kCorridorMargin = 0.1;
+// Number of different problems or sample times that are cycled through
+static constexpr int kNumSamples = 64;
+
+Eigen::Vector3d randomVector(const double scale, std::mt19937* generator) {
+  std::uniform_real_distribution<double> uniform(-scale, scale);
+  return Eigen::Vector3d(uniform(*generator), uniform(*generator),
+                         uniform(*generator));
+}
+
+// Minimum snap problem through num_way_points random way points that
+// minimizes the derivative of order continuity_order
+PolynomialTrajectorySettings minimumSnapSettings(const int num_way_points,
+                                                 const int polynomial_order,
+                                                 const int continuity_order) {
+  std::mt19937 generator(kRandomSeed);
+  PolynomialTrajectorySettings trajectory_settings;
+  for (int i = 0; i < num_way_points; i++) {
+    trajectory_settings.way_points.push_back(randomVector(5.0, &generator));
+  }
+  trajectory_settings.minimization_weights =
+      Eigen::VectorXd::Unit(continuity_order + 1, continuity_order);
+  trajectory_settings.polynomial_order = polynomial_order;
+  trajectory_settings.continuity_order = continuity_order;
+  return trajectory_settings;
+}
+
+quadrotor_common::TrajectoryPoint stateAt(const Eigen::Vector3d& position) {
+  quadrotor_common::TrajectoryPoint state;
+  state.position = position;
+  return state;
+}
+
+// Axis aligned corridors that contain the straight line of each segment with
+// a margin of kCorridorMargin
+void addCorridors(const quadrotor_common::TrajectoryPoint& start_state,
+                  const quadrotor_common::TrajectoryPoint& end_state,
+                  PolynomialTrajectorySettings* trajectory_settings) {
+  std::vector<Eigen::Vector3d> way_points = trajectory_settings->way_points;
+  way_points.insert(way_points.begin(), start_state.position);
+  way_points.push_back(end_state.position);
+  for (size_t i = 0; i + 1 < way_points.size(); i++) {
+    trajectory_settings->corridor_lower_bounds.push_back(
+        way_points[i].cwiseMin(way_points[i + 1]) -
+        Eigen::Vector3d::Constant(kCorridorMargin));
+    trajectory_settings->corridor_upper_bounds.push_back(
+        way_points[i].cwiseMax(way_points[i + 1]) +
+        Eigen::Vector3d::Constant(kCorridorMargin));
+  }
+}
+
+// Random start and end states, half of them with boundary velocities and
+// accelerations
+void randomStartAndEndStates(
+    std::vector<quadrotor_common::TrajectoryPoint>* start_states,
+    std::vector<quadrotor_common::TrajectoryPoint>* end_states) {
+  std::mt19937 generator(kRandomSeed);
+  for (int i = 0; i < kNumSamples; i++) {
+    quadrotor_common::TrajectoryPoint start_state =
+        stateAt(randomVector(5.0, &generator));
+    quadrotor_common::TrajectoryPoint end_state =
+        stateAt(randomVector(5.0, &generator));
+    if (i % 2 == 1) {
+      start_state.velocity = randomVector(0.5, &generator);
+      end_state.acceleration = randomVector(0.5, &generator);
+    }
+    start_states->push_back(start_state);
+    end_states->push_back(end_state);
+  }
+}
+
+// Arguments: number of way points, polynomial order, continuity order
+void minimumSnapArguments(benchmark::internal::Benchmark* benchmark) {
+  for (const int num_way_points : {1, 4, 16}) {
+    benchmark->Args({num_way_points, 7, 3});
+    benchmark->Args({num_way_points, 9, 4});
+    benchmark->Args({num_way_points, 11, 4});
+  }
+}
+
+void minimumSnapBenchmark(benchmark::State& state,
+                          const MinimumSnapSolver solver) {
+  PolynomialTrajectorySettings trajectory_settings =
+      minimumSnapSettings(state.range(0), state.range(1), state.range(2));
+  trajectory_settings.minimum_snap_solver = solver;
+  const quadrotor_common::TrajectoryPoint start_state =
+      stateAt(Eigen::Vector3d::Zero());
+  const quadrotor_common::TrajectoryPoint end_state =
+      stateAt(Eigen::Vector3d(6.0, 0.0, 1.0));
+  const Eigen::VectorXd segment_times =
+      Eigen::VectorXd::Constant(state.range(0) + 1, kSegmentTime);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        minimum_snap_trajectories::generateMinimumSnapTrajectory(
+            segment_times, start_state, end_state, trajectory_settings));
+  }
+}
+
+void BM_GenerateMinimumSnapTrajectory(benchmark::State& state) {
+  minimumSnapBenchmark(state, MinimumSnapSolver::CONSTRAINED_QP);
+}
+BENCHMARK(BM_GenerateMinimumSnapTrajectory)
+    ->Apply(minimumSnapArguments)
+    ->Unit(benchmark::kMicrosecond);
+
+void BM_GenerateMinimumSnapTrajectoryFreeDerivatives(benchmark::State& state) {
+  minimumSnapBenchmark(state, MinimumSnapSolver::FREE_DERIVATIVES);
+}
+BENCHMARK(BM_GenerateMinimumSnapTrajectoryFreeDerivatives)
+    ->Apply(minimumSnapArguments)
+    ->Unit(benchmark::kMicrosecond);
+
+void BM_GenerateMinimumSnapTrajectoryWithWorkspace(benchmark::State& state) {
+  const PolynomialTrajectorySettings trajectory_settings =
+      minimumSnapSettings(state.range(0), state.range(1), state.range(2));
+  const quadrotor_common::TrajectoryPoint start_state =
+      stateAt(Eigen::Vector3d::Zero());
+  const quadrotor_common::TrajectoryPoint end_state =
+      stateAt(Eigen::Vector3d(6.0, 0.0, 1.0));
+  const Eigen::VectorXd segment_times =
+      Eigen::VectorXd::Constant(state.range(0) + 1, kSegmentTime);
+
+  minimum_snap_trajectories::MinimumSnapWorkspace workspace;
+  PolynomialTrajectory trajectory;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        minimum_snap_trajectories::generateMinimumSnapTrajectory(
+            segment_times, start_state, end_state, trajectory_settings,
+            &workspace, &trajectory));
+  }
+}
+BENCHMARK(BM_GenerateMinimumSnapTrajectoryWithWorkspace)
+    ->Apply(minimumSnapArguments)
+    ->Unit(benchmark::kMicrosecond);
+
+// Compare with BM_GenerateMinimumSnapTrajectory of the same arguments
+void BM_GenerateMinimumSnapTrajectoryInCorridors(benchmark::State& state) {
+  PolynomialTrajectorySettings trajectory_settings =
+      minimumSnapSettings(state.range(0), state.range(1), state.range(2));
+  const quadrotor_common::TrajectoryPoint start_state =
+      stateAt(Eigen::Vector3d::Zero());
+  const quadrotor_common::TrajectoryPoint end_state =
+      stateAt(Eigen::Vector3d(6.0, 0.0, 1.0));
+  addCorridors(start_state, end_state, &trajectory_settings);
+  const Eigen::VectorXd segment_times =
+      Eigen::VectorXd::Constant(state.range(0) + 1, kSegmentTime);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        minimum_snap_trajectories::generateMinimumSnapTrajectory(
+            segment_times, start_state, end_state, trajectory_settings));
+  }
+}
+BENCHMARK(BM_GenerateMinimumSnapTrajectoryInCorridors)
+    ->Args({4, 9, 4})
+    ->Args({16, 9, 4})
+    ->Unit(benchmark::kMicrosecond);
+
+// Arguments: number of way points
+void BM_ComputeInitialSegmentTimes(benchmark::State& state) {
+  const PolynomialTrajectorySettings trajectory_settings =
+      minimumSnapSettings(state.range(0), 9, 4);
+  const quadrotor_common::TrajectoryPoint start_state =
+      stateAt(Eigen::Vector3d::Zero());
+  const quadrotor_common::TrajectoryPoint end_state =
+      stateAt(Eigen::Vector3d(6.0, 0.0, 1.0));
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        minimum_snap_trajectories::computeInitialSegmentTimes(
+            start_state, end_state, trajectory_settings, kMaxVelocity,
+            kMaxNormalizedThrust, kMaxRollPitchRate));
+  }
+}
+BENCHMARK(BM_ComputeInitialSegmentTimes)->Arg(4)->Arg(16);
+
+// Arguments: number of way points, 1 to also refine the segment times
+void BM_GenerateMinimumSnapTrajectoryWithLimits(benchmark::State& state) {
+  const PolynomialTrajectorySettings trajectory_settings =
+      minimumSnapSettings(state.range(0), 9, 4);
+  const quadrotor_common::TrajectoryPoint start_state =
+      stateAt(Eigen::Vector3d::Zero());
+  const quadrotor_common::TrajectoryPoint end_state =
+      stateAt(Eigen::Vector3d(6.0, 0.0, 1.0));
+  const Eigen::VectorXd initial_segment_times =
+      Eigen::VectorXd::Ones(state.range(0) + 1);
+
+  for (auto _ : state) {
+    if (state.range(1) == 0) {
+      benchmark::DoNotOptimize(
+          minimum_snap_trajectories::generateMinimumSnapTrajectory(
+              initial_segment_times, start_state, end_state,
+              trajectory_settings, kMaxVelocity, kMaxNormalizedThrust,
+              kMaxRollPitchRate));
+    } else {
+      benchmark::DoNotOptimize(
+          minimum_snap_trajectories::
+              generateMinimumSnapTrajectoryWithSegmentRefinement(
+                  initial_segment_times, start_state, end_state,
+                  trajectory_settings, kMaxVelocity, kMaxNormalizedThrust,
+                  kMaxRollPitchRate));
+    }
+  }
+}
+BENCHMARK(BM_GenerateMinimumSnapTrajectoryWithLimits)
+    ->Args({4, 0})
+    ->Args({4, 1})
+    ->Args({8, 0})
+    ->Args({8, 1})
+    ->Unit(benchmark::kMillisecond);
+
+// Arguments: number of way points, 0 to seed with uniform segment times of the
+// estimated duration, 1 to seed with the estimated time of each segment. The
+// qp_solves counter is the number of minimum snap problems solved per
+// trajectory.
+void BM_EnforceLimitsFromSeed(benchmark::State& state) {
+  const PolynomialTrajectorySettings trajectory_settings =
+      minimumSnapSettings(state.range(0), 9, 4);
+  const quadrotor_common::TrajectoryPoint start_state =
+      stateAt(Eigen::Vector3d::Zero());
+  const quadrotor_common::TrajectoryPoint end_state =
+      stateAt(Eigen::Vector3d(6.0, 0.0, 1.0));
+  const Eigen::VectorXd estimated_segment_times =
+      minimum_snap_trajectories::computeInitialSegmentTimes(
+          start_state, end_state, trajectory_settings, kMaxVelocity,
+          kMaxNormalizedThrust, kMaxRollPitchRate);
+  const Eigen::VectorXd seed_segment_times =
+      state.range(1) == 0
+          ? Eigen::VectorXd(Eigen::VectorXd::Constant(
+                estimated_segment_times.size(),
+                estimated_segment_times.mean()))
+          : estimated_segment_times;
+
+  const uint64_t num_solves_before =
+      minimum_snap_trajectories::implementation::numMinimumSnapSolves();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        minimum_snap_trajectories::implementation::
+            enforceMaximumVelocityAndThrust(
+                minimum_snap_trajectories::generateMinimumSnapTrajectory(
+                    seed_segment_times, start_state, end_state,
+                    trajectory_settings),
+                trajectory_settings, kMaxVelocity, kMaxNormalizedThrust,
+                kMaxRollPitchRate));
+  }
+  state.counters["qp_solves"] = benchmark::Counter(
+      minimum_snap_trajectories::implementation::numMinimumSnapSolves() -
+          num_solves_before,
+      benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_EnforceLimitsFromSeed)
+    ->Args({4, 0})
+    ->Args({4, 1})
+    ->Args({8, 0})
+    ->Args({8, 1})
+    ->Unit(benchmark::kMillisecond);
+
+// Arguments: number of way points, 1 to also enforce the limits
+void BM_GenerateMinimumSnapRingTrajectoryWithSegmentRefinement(
+    benchmark::State& state) {
+  const PolynomialTrajectorySettings trajectory_settings =
+      minimumSnapSettings(state.range(0), 9, 4);
+  const Eigen::VectorXd initial_segment_times =
+      Eigen::VectorXd::Constant(state.range(0), kSegmentTime);
+
+  for (auto _ : state) {
+    if (state.range(1) == 0) {
+      benchmark::DoNotOptimize(
+          minimum_snap_trajectories::
+              generateMinimumSnapRingTrajectoryWithSegmentRefinement(
+                  initial_segment_times, trajectory_settings));
+    } else {
+      benchmark::DoNotOptimize(
+          minimum_snap_trajectories::
+              generateMinimumSnapRingTrajectoryWithSegmentRefinement(
+                  initial_segment_times, trajectory_settings, kMaxVelocity,
+                  kMaxNormalizedThrust, kMaxRollPitchRate));
+    }
+  }
+}
+BENCHMARK(BM_GenerateMinimumSnapRingTrajectoryWithSegmentRefinement)
+    ->Args({4, 0})
+    ->Args({4, 1})
+    ->Args({8, 0})
+    ->Args({8, 1})
+    ->Unit(benchmark::kMillisecond);
+
+// Arguments: order of continuity
+void BM_ComputeTimeOptimalTrajectory(benchmark::State& state) {
+  std::vector<quadrotor_common::TrajectoryPoint> start_states;
+  std::vector<quadrotor_common::TrajectoryPoint> end_states;
+  randomStartAndEndStates(&start_states, &end_states);
+
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        constrained_polynomial_trajectories::computeTimeOptimalTrajectory(
+            start_states[i], end_states[i], state.range(0), kMaxVelocity,
+            kMaxNormalizedThrust, kMaxRollPitchRate));
+    i = (i + 1) % kNumSamples;
+  }
+}
+BENCHMARK(BM_ComputeTimeOptimalTrajectory)
+    ->Arg(3)
+    ->Arg(5)
+    ->Unit(benchmark::kMicrosecond);
+
+// Arguments: polynomial order, the H matrix has 6 segments and 5 weights
+void BM_GenerateHMatrix(benchmark::State& state) {
+  PolynomialTrajectorySettings trajectory_settings;
+  trajectory_settings.minimization_weights = Eigen::VectorXd::Ones(5);
+  trajectory_settings.polynomial_order = state.range(0);
+  const int num_segments = 6;
+  const Eigen::VectorXd tau_dot =
+      Eigen::VectorXd::Constant(num_segments, 1.0 / kSegmentTime);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        minimum_snap_trajectories::implementation::generateHMatrix(
+            trajectory_settings, num_segments, tau_dot));
+  }
+}
+BENCHMARK(BM_GenerateHMatrix)->DenseRange(5, 11);
+
+// Cycles through sample times spread over the whole trajectory
+void getPointFromTrajectoryBenchmark(benchmark::State& state,
+                                     const PolynomialTrajectory& trajectory) {
+  std::vector<ros::Duration> sample_times;
+  for (int i = 0; i < kNumSamples; i++) {
+    sample_times.push_back(
+        ros::Duration(trajectory.T.toSec() * i / (kNumSamples - 1)));
+  }
+
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        getPointFromTrajectory(trajectory, sample_times[i]));
+    i = (i + 1) % kNumSamples;
+  }
+}
+
+// Arguments: polynomial order of a trajectory with 4 segments
+void BM_GetPointFromMinimumSnapTrajectory(benchmark::State& state) {
+  const PolynomialTrajectory trajectory =
+      minimum_snap_trajectories::generateMinimumSnapTrajectory(
+          Eigen::VectorXd::Constant(4, kSegmentTime),
+          stateAt(Eigen::Vector3d::Zero()),
+          stateAt(Eigen::Vector3d(6.0, 0.0, 1.0)),
+          minimumSnapSettings(3, state.range(0), 4));
+  getPointFromTrajectoryBenchmark(state, trajectory);
+}
+BENCHMARK(BM_GetPointFromMinimumSnapTrajectory)->Arg(7)->Arg(11);
+
+// Arguments: order of continuity
+void BM_GetPointFromFullyConstrainedTrajectory(benchmark::State& state) {
+  const PolynomialTrajectory trajectory =
+      constrained_polynomial_trajectories::computeFixedTimeTrajectory(
+          stateAt(Eigen::Vector3d::Zero()),
+          stateAt(Eigen::Vector3d(6.0, 0.0, 1.0)), state.range(0),
+          kSegmentTime);
+  getPointFromTrajectoryBenchmark(state, trajectory);
+}
+BENCHMARK(BM_GetPointFromFullyConstrainedTrajectory)->Arg(3)->Arg(5);
+
+// Arguments: number of way points of an order 9 minimum snap trajectory
+void BM_ComputeQuadRelevantMaxima(benchmark::State& state) {
+  const PolynomialTrajectory trajectory =
+      minimum_snap_trajectories::generateMinimumSnapTrajectory(
+          Eigen::VectorXd::Constant(state.range(0) + 1, kSegmentTime),
+          stateAt(Eigen::Vector3d::Zero()),
+          stateAt(Eigen::Vector3d(6.0, 0.0, 1.0)),
+          minimumSnapSettings(state.range(0), 9, 4));
+
+  for (auto _ : state) {
+    double maximal_velocity;
+    double maximal_normalized_thrust;
+    double maximal_roll_pitch_rate;
+    computeQuadRelevantMaxima(trajectory, &maximal_velocity,
+                              &maximal_normalized_thrust,
+                              &maximal_roll_pitch_rate);
+    benchmark::DoNotOptimize(maximal_velocity);
+    benchmark::DoNotOptimize(maximal_normalized_thrust);
+    benchmark::DoNotOptimize(maximal_roll_pitch_rate);
+  }
+  state.SetItemsProcessed(state.iterations() * (state.range(0) + 1));
+}
+BENCHMARK(BM_ComputeQuadRelevantMaxima)
+    ->Arg(1)
+    ->Arg(4)
+    ->Arg(16)
+    ->Unit(benchmark::kMicrosecond);
+
+// Arguments: number of way points of an order 9 minimum snap trajectory,
+// number of threads
+void BM_ComputeQuadRelevantMaximaParallel(benchmark::State& state) {
+  const PolynomialTrajectory trajectory =
+      minimum_snap_trajectories::generateMinimumSnapTrajectory(
+          Eigen::VectorXd::Constant(state.range(0) + 1, kSegmentTime),
+          stateAt(Eigen::Vector3d::Zero()),
+          stateAt(Eigen::Vector3d(6.0, 0.0, 1.0)),
+          minimumSnapSettings(state.range(0), 9, 4));
+  // The workers are kept between the evaluations, as in a refinement loop
+  ThreadPool thread_pool(state.range(1) - 1);
+
+  for (auto _ : state) {
+    double maximal_velocity;
+    double maximal_normalized_thrust;
+    double maximal_roll_pitch_rate;
+    computeQuadRelevantMaxima(trajectory, &thread_pool, &maximal_velocity,
+                              &maximal_normalized_thrust,
+                              &maximal_roll_pitch_rate);
+    benchmark::DoNotOptimize(maximal_velocity);
+    benchmark::DoNotOptimize(maximal_normalized_thrust);
+    benchmark::DoNotOptimize(maximal_roll_pitch_rate);
+  }
+  state.SetItemsProcessed(state.iterations() * (state.range(0) + 1));
+}
+BENCHMARK(BM_ComputeQuadRelevantMaximaParallel)
+    ->Args({16, 1})
+    ->Args({16, 4})
+    ->Args({64, 1})
+    ->Args({64, 4})
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+
+}  // namespace polynomial_trajectories
+
+BENCHMARK_MAIN();
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <Eigen/Dense>
+
+namespace polynomial_trajectories {
+
+// Bernstein (Bezier) representation of polynomial segments. Each row of a
+// control point matrix holds one dimension, the columns are the control points
+// of the polynomial over the normalized segment time s = [0, 1]. Due to the
+// convex hull property of the Bernstein basis, the segment stays within the
+// convex hull of its control points.
+
+// Converts polynomial coefficients in normalized time (lowest power first) to
+// the control points of the same degree
+Eigen::MatrixXd computeBernsteinControlPoints(
+    const Eigen::MatrixXd& coefficients);
+// Control points of the derivative with respect to time t = s * duration.
+// Constant polynomials result in a single zero control point.
+Eigen::MatrixXd differentiateBernsteinControlPoints(
+    const Eigen::MatrixXd& control_points, const double duration);
+// Control points of the cross product of two three dimensional polynomials,
+// the degree of the result is the sum of both degrees
+Eigen::MatrixXd computeBernsteinCrossProduct(
+    const Eigen::MatrixXd& control_points_a,
+    const Eigen::MatrixXd& control_points_b);
+// Splits the segment at s = 0.5 with de Casteljau's algorithm, both halves are
+// again parametrized over s = [0, 1]
+void splitBernsteinControlPoints(const Eigen::MatrixXd& control_points,
+                                 Eigen::MatrixXd* first_half,
+                                 Eigen::MatrixXd* second_half);
+
+}  // namespace polynomial_trajectories
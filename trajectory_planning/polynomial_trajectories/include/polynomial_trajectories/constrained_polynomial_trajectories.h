@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include <quadrotor_common/trajectory_point.h>
 #include <Eigen/Dense>
 
@@ -35,10 +37,17 @@ std::vector<Eigen::MatrixXd> computeTrajectoryCoeff(
     const quadrotor_common::TrajectoryPoint& s0,
     const quadrotor_common::TrajectoryPoint& s1, const int order_of_continuity,
     const double T);
-
-Eigen::Vector3d computeMaximaGradient(const PolynomialTrajectory& trajectory,
-                                      const Eigen::Vector3d& maxima,
-                                      const double order_of_continuity);
+// Inverse of the constraint matrix in normalized time (T = 1)
+Eigen::MatrixXd computeNormalizedConstraintMatrixInverse(
+    const int order_of_continuity);
+// Element i holds the inverse for order of continuity i, element 0 is empty
+std::vector<Eigen::MatrixXd> computeNormalizedConstraintMatrixInverses(
+    const int max_order_of_continuity);
+
+// Largest ratio between the maxima of the trajectory and the desired maxima
+// (velocity, normalized thrust, roll pitch rate)
+double computeMaximaRatio(const PolynomialTrajectory& trajectory,
+                          const Eigen::Vector3d& desired_maxima);
 }  // namespace implementation
 
 }  // namespace constrained_polynomial_trajectories
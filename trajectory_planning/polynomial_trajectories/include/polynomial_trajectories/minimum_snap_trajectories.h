@@ -1,22 +1,78 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 #include <quadrotor_common/trajectory_point.h>
+#include <ros/duration.h>
 #include <Eigen/Dense>
 
 #include "polynomial_trajectories/polynomial_trajectory.h"
 #include "polynomial_trajectories/polynomial_trajectory_settings.h"
+#include "polynomial_trajectories/thread_pool.h"
 
 namespace polynomial_trajectories {
 
 namespace minimum_snap_trajectories {
 
+// One open minimum snap trajectory to be computed by
+// generateMinimumSnapTrajectories
+struct MinimumSnapTrajectoryProblem {
+  Eigen::VectorXd segment_times;
+  quadrotor_common::TrajectoryPoint start_state;
+  quadrotor_common::TrajectoryPoint end_state;
+  PolynomialTrajectorySettings trajectory_settings;
+  bool segment_refinement = false;
+  // The maxima are only enforced if enforce_maxima is set
+  bool enforce_maxima = false;
+  double max_velocity = 0.0;
+  double max_normalized_thrust = 0.0;
+  double max_roll_pitch_rate = 0.0;
+};
+
+// Memory for the matrices and vectors of the equality constrained minimum
+// snap QP. It grows to the largest problem it was used for and is reused by
+// later calls, so solving problems with the same number of segments,
+// polynomial order, continuity order and number of dimensions does not
+// allocate any memory after the first call.
+struct MinimumSnapWorkspace {
+  PolynomialTrajectorySettings trajectory_settings;
+  Eigen::VectorXd tau_dot;
+  Eigen::MatrixXd H;
+  Eigen::MatrixXd A_eq;
+  Eigen::MatrixXd A_lagrange;
+  Eigen::ColPivHouseholderQR<Eigen::MatrixXd> A_lagrange_factor;
+  Eigen::VectorXd way_points_1D;
+  Eigen::VectorXd f;
+  Eigen::VectorXd b_eq;
+  Eigen::VectorXd b_lagrange;
+  Eigen::VectorXd rotated_b_lagrange;
+  Eigen::VectorXd lagrange_solution;
+  Eigen::VectorXd H_solution;
+};
+
+// Without corridors and with the CONSTRAINED_QP solver, the problem is solved
+// in a thread_local workspace. It is never shrunk, i.e. every thread that
+// called this function keeps the memory of the largest problem it solved
+// until the thread exits.
 PolynomialTrajectory generateMinimumSnapTrajectory(
     const Eigen::VectorXd& segment_times,
     const quadrotor_common::TrajectoryPoint& start_state,
     const quadrotor_common::TrajectoryPoint& end_state,
     const PolynomialTrajectorySettings& trajectory_settings);
+// Same as above but solves the problem in workspace and writes the result to
+// trajectory, whose coefficient matrices are reused as well. Without
+// corridors and with the CONSTRAINED_QP solver, repeated calls with problems
+// of the same size do not allocate any memory. The Lagrange system is
+// factorized once for all dimensions. Other problems are solved by the
+// function above. Returns false if no trajectory could be computed.
+bool generateMinimumSnapTrajectory(
+    const Eigen::VectorXd& segment_times,
+    const quadrotor_common::TrajectoryPoint& start_state,
+    const quadrotor_common::TrajectoryPoint& end_state,
+    const PolynomialTrajectorySettings& trajectory_settings,
+    MinimumSnapWorkspace* workspace, PolynomialTrajectory* trajectory);
 PolynomialTrajectory generateMinimumSnapTrajectory(
     const Eigen::VectorXd& initial_segment_times,
     const quadrotor_common::TrajectoryPoint& start_state,
@@ -38,6 +94,46 @@ PolynomialTrajectory generateMinimumSnapTrajectoryWithSegmentRefinement(
     const double max_velocity, const double max_normalized_thrust,
     const double max_roll_pitch_rate);
 
+// Segment times of a point mass that flies along the straight lines between
+// the way points with a jerk limited trapezoidal velocity profile on each
+// segment. The speed at each way point is reduced with the turn angle there.
+// The acceleration limit accounts for gravity and the jerk limit follows from
+// rotating the maximum thrust with max_roll_pitch_rate. This is a fast
+// estimate that tends to be shorter than the feasible minimum snap segment
+// times and is used to seed the generation with limits.
+Eigen::VectorXd computeInitialSegmentTimes(
+    const quadrotor_common::TrajectoryPoint& start_state,
+    const quadrotor_common::TrajectoryPoint& end_state,
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const double max_velocity, const double max_normalized_thrust,
+    const double max_roll_pitch_rate);
+Eigen::VectorXd computeInitialRingSegmentTimes(
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const double max_velocity, const double max_normalized_thrust,
+    const double max_roll_pitch_rate);
+
+// Receding horizon replanning of an open minimum snap trajectory. Only the
+// next horizon_segments segments after time_from_start are optimized again,
+// starting from start_state (usually the current reference state) and ending
+// in the state at the start of the remaining segments, which are kept as they
+// are. The replanning time therefore only depends on the horizon and not on
+// the length of the trajectory. The way points and segment times of the
+// horizon are taken from trajectory, trajectory_settings only provides the
+// weights, orders and solver. The remainder of the current segment is merged
+// with the next one if it is too short to be optimized on its own.
+// The result starts at time_from_start of trajectory and is continuous up to
+// the jerk and heading acceleration where the kept segments start (the
+// replanned headings may be shifted by a multiple of 2 pi). The heading is
+// replanned if trajectory has a heading dimension, independent of the heading
+// settings in trajectory_settings. Its optimization cost only covers the
+// replanned segments. Corridors are not supported.
+PolynomialTrajectory replanMinimumSnapTrajectory(
+    const PolynomialTrajectory& trajectory,
+    const ros::Duration& time_from_start,
+    const quadrotor_common::TrajectoryPoint& start_state,
+    const int horizon_segments,
+    const PolynomialTrajectorySettings& trajectory_settings);
+
 PolynomialTrajectory generateMinimumSnapRingTrajectory(
     const Eigen::VectorXd& segment_times,
     const PolynomialTrajectorySettings& trajectory_settings);
@@ -56,6 +152,14 @@ PolynomialTrajectory generateMinimumSnapRingTrajectoryWithSegmentRefinement(
     const double max_velocity, const double max_normalized_thrust,
     const double max_roll_pitch_rate);
 
+// Solves all problems on num_threads threads (including the calling thread)
+// and returns the trajectories in the order of the problems
+std::vector<PolynomialTrajectory> generateMinimumSnapTrajectories(
+    const std::vector<MinimumSnapTrajectoryProblem>& problems,
+    const int num_threads);
+PolynomialTrajectory generateMinimumSnapTrajectory(
+    const MinimumSnapTrajectoryProblem& problem);
+
 // these functions should not be used from the outside
 namespace implementation {
 Eigen::MatrixXd generate1DTrajectory(const int num_polynoms,
@@ -65,21 +169,120 @@ Eigen::MatrixXd generate1DTrajectory(const int num_polynoms,
                                      const Eigen::MatrixXd& A,
                                      const Eigen::VectorXd& b,
                                      double* optimization_cost);
+Eigen::MatrixXd generate1DTrajectoryInCorridor(
+    const int num_polynoms, const int polynomial_order,
+    const Eigen::MatrixXd& H, const Eigen::VectorXd& f,
+    const Eigen::MatrixXd& A_eq, const Eigen::VectorXd& b_eq,
+    const Eigen::MatrixXd& A_ineq, const Eigen::VectorXd& b_ineq,
+    double* optimization_cost);
+Eigen::MatrixXd generate1DTrajectoryFreeDerivatives(
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const std::vector<Eigen::MatrixXd>& segment_solution_maps,
+    const Eigen::MatrixXd& H, const Eigen::VectorXd& f,
+    const Eigen::VectorXd& way_points_1D,
+    const Eigen::Vector3d& start_conditions,
+    const Eigen::Vector3d& end_conditions, const bool ring_trajectory,
+    double* optimization_cost);
+
+Eigen::MatrixXd generateFixedWayPointValues(
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const Eigen::VectorXd& way_points_1D,
+    const Eigen::Vector3d& start_conditions,
+    const Eigen::Vector3d& end_conditions, const bool ring_trajectory);
+void generateFreeDerivativesSystem(
+    const std::vector<Eigen::MatrixXd>& segment_cost_matrices,
+    const bool ring_trajectory, std::vector<Eigen::MatrixXd>* diagonal_blocks,
+    std::vector<Eigen::MatrixXd>* lower_blocks);
+Eigen::VectorXd generateFreeDerivativesRhs(
+    const std::vector<Eigen::MatrixXd>& segment_solution_maps,
+    const std::vector<Eigen::MatrixXd>& segment_hessians,
+    const std::vector<Eigen::MatrixXd>& segment_cost_matrices,
+    const Eigen::VectorXd& f, const Eigen::MatrixXd& way_point_values,
+    const bool ring_trajectory);
+void setFreeWayPointDerivatives(const Eigen::VectorXd& free_derivatives,
+                                const bool ring_trajectory,
+                                Eigen::MatrixXd* way_point_values);
+Eigen::MatrixXd generateFreeDerivativesCoefficients(
+    const std::vector<Eigen::MatrixXd>& segment_solution_maps,
+    const std::vector<Eigen::MatrixXd>& segment_hessians,
+    const Eigen::VectorXd& f, const Eigen::MatrixXd& way_point_values,
+    double* optimization_cost);
+
+std::vector<Eigen::MatrixXd> generateSegmentSolutionMaps(
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const int num_polynoms, const Eigen::VectorXd& tau_dot,
+    const Eigen::MatrixXd& H);
+Eigen::MatrixXd generateSegmentSolutionMap(
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const double tau_dot, const Eigen::MatrixXd& H_k);
+Eigen::MatrixXd generateSegmentCostMatrix(
+    const Eigen::MatrixXd& segment_solution_map, const Eigen::MatrixXd& H_k);
+std::vector<Eigen::MatrixXd> splitBlockDiagonalMatrix(
+    const Eigen::MatrixXd& matrix, const int num_blocks);
+Eigen::MatrixXd generateEndPointDerivativesMatrix(const int poly_order,
+                                                  const int continuity_order,
+                                                  const double tau_dot);
+bool solveBlockTridiagonalSystem(
+    const std::vector<Eigen::MatrixXd>& diagonal_blocks,
+    const std::vector<Eigen::MatrixXd>& lower_blocks,
+    const Eigen::VectorXd& rhs, Eigen::VectorXd* solution);
+bool factorBlockTridiagonalSystem(
+    const std::vector<Eigen::MatrixXd>& diagonal_blocks,
+    const std::vector<Eigen::MatrixXd>& lower_blocks, const int first_block,
+    std::vector<Eigen::LLT<Eigen::MatrixXd>>* diagonal_factors,
+    std::vector<Eigen::MatrixXd>* lower_factors);
+Eigen::VectorXd solveFactoredBlockTridiagonalSystem(
+    const std::vector<Eigen::LLT<Eigen::MatrixXd>>& diagonal_factors,
+    const std::vector<Eigen::MatrixXd>& lower_factors,
+    const Eigen::VectorXd& rhs);
 
 Eigen::MatrixXd generateHMatrix(
     const PolynomialTrajectorySettings& trajectory_settings,
     const int num_polynoms, const Eigen::VectorXd& tau_dot);
+void generateHMatrix(const PolynomialTrajectorySettings& trajectory_settings,
+                     const int num_polynoms, const Eigen::VectorXd& tau_dot,
+                     Eigen::MatrixXd* H);
+Eigen::MatrixXd computeHessianBasisBlock(const int poly_order,
+                                         const int derivative_order);
+std::vector<std::vector<Eigen::MatrixXd>> computeHessianBasisBlocks(
+    const int max_poly_order);
 Eigen::VectorXd generateFVector(
     const PolynomialTrajectorySettings& trajectory_settings,
     const Eigen::VectorXd& way_points_1D, const int num_polynoms);
+void generateFVector(const PolynomialTrajectorySettings& trajectory_settings,
+                     const Eigen::VectorXd& way_points_1D,
+                     const int num_polynoms, Eigen::VectorXd* f);
 Eigen::MatrixXd generateEqualityConstraintsAMatrix(
     const PolynomialTrajectorySettings& trajectory_settings,
     const int num_polynoms, const Eigen::VectorXd& tau_dot);
+void generateEqualityConstraintsAMatrix(
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const int num_polynoms, const Eigen::VectorXd& tau_dot,
+    Eigen::MatrixXd* A);
 Eigen::VectorXd generateEqualityConstraintsBVector(
     const PolynomialTrajectorySettings& trajectory_settings,
     const int num_polynoms, const Eigen::VectorXd& way_points_1D,
     const Eigen::Vector3d& start_conditions,
     const Eigen::Vector3d& end_conditions);
+void generateEqualityConstraintsBVector(
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const int num_polynoms, const Eigen::VectorXd& way_points_1D,
+    const Eigen::Vector3d& start_conditions,
+    const Eigen::Vector3d& end_conditions, Eigen::VectorXd* b);
+
+// Way points have to include the start and end position for open trajectories
+bool areWayPointsInsideCorridors(
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const int num_polynoms, const bool ring_trajectory);
+// Keeps the Bernstein control points of all segments inside their corridor.
+// The first and last control point of each segment are its end points, which
+// are already fixed by the way point constraints.
+Eigen::MatrixXd generateCorridorConstraintsAMatrix(
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const int num_polynoms);
+Eigen::VectorXd generateCorridorConstraintsBVector(
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const int num_polynoms, const int dimension);
 
 Eigen::MatrixXd generateRingEqualityConstraintsAMatrix(
     const PolynomialTrajectorySettings& trajectory_settings,
@@ -88,16 +291,25 @@ Eigen::VectorXd generateRingEqualityConstraintsBVector(
     const PolynomialTrajectorySettings& trajectory_settings,
     const int num_polynoms, const Eigen::VectorXd& way_points_1D);
 
+Eigen::VectorXd computeConstraintDerivativeOrders(
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const int num_polynoms, const bool ring_trajectory);
 Eigen::VectorXd computeCostGradient(
     const PolynomialTrajectory& initial_trajectory,
     const PolynomialTrajectorySettings& trajectory_settings);
 Eigen::VectorXd computeSearchDirection(
     const PolynomialTrajectory& initial_trajectory,
     const Eigen::VectorXd& gradient);
+// Returns nullptr if the line search steps are evaluated sequentially
+std::unique_ptr<ThreadPool> createLineSearchThreadPool(
+    const PolynomialTrajectorySettings& trajectory_settings);
+// Evaluates the steps of each batch on thread_pool, which is created once per
+// refinement by createLineSearchThreadPool and may be nullptr
 Eigen::VectorXd updateSegmentTimes(
     const PolynomialTrajectory& initial_trajectory,
     const Eigen::VectorXd& gradient,
-    const PolynomialTrajectorySettings& trajectory_settings);
+    const PolynomialTrajectorySettings& trajectory_settings,
+    ThreadPool* thread_pool);
 
 PolynomialTrajectory enforceMaximumVelocityAndThrust(
     const PolynomialTrajectory& initial_trajectory,
@@ -110,21 +322,87 @@ bool computeMaximaGradient(
     const PolynomialTrajectorySettings& trajectory_settings,
     Eigen::Vector3d* gradient);
 
-std::vector<Eigen::MatrixXd> reorganiceCoefficientsSegmentWise(
+// Shared setup of both solvers of open minimum snap trajectories. Checks the
+// way points and heading way points against the segment times and writes the
+// settings of a feasible optimization problem, whose way points include the
+// start and end position, to feasible_trajectory_settings. Sets all members
+// of trajectory except the coefficients, which are only sized for the
+// dimensions to optimize. Returns false after logging the reason if the
+// problem is invalid.
+bool setUpOpenMinimumSnapProblem(
+    const Eigen::VectorXd& segment_times,
+    const quadrotor_common::TrajectoryPoint& start_state,
+    const quadrotor_common::TrajectoryPoint& end_state,
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const bool free_derivatives,
+    PolynomialTrajectorySettings* feasible_trajectory_settings,
+    PolynomialTrajectory* trajectory);
+// Way points of dimension (3 is the heading) of an open trajectory set up by
+// setUpOpenMinimumSnapProblem and the derivatives at its start and end
+void getOpenWayPoints1D(
+    const PolynomialTrajectorySettings& feasible_trajectory_settings,
+    const quadrotor_common::TrajectoryPoint& start_state,
+    const quadrotor_common::TrajectoryPoint& end_state, const int dimension,
+    Eigen::VectorXd* way_points_1D, Eigen::Vector3d* start_conditions,
+    Eigen::Vector3d* end_conditions);
+PolynomialCoefficients reorganiceCoefficientsSegmentWise(
     const std::vector<Eigen::MatrixXd>& coefficients, const int num_segments,
     const int polynomial_order);
 PolynomialTrajectorySettings ensureFeasibleTrajectorySettings(
     const PolynomialTrajectorySettings& original_trajectory_settings,
     const int min_poly_order);
+void ensureFeasibleTrajectorySettings(
+    const PolynomialTrajectorySettings& original_trajectory_settings,
+    const int min_poly_order,
+    PolynomialTrajectorySettings* new_trajectory_settings);
 std::vector<Eigen::Vector3d> addStartAndEndToWayPointList(
     const std::vector<Eigen::Vector3d>& intermediate_way_points,
     const Eigen::Vector3d& start_position, const Eigen::Vector3d& end_position);
 
+// Way points of open trajectories have to include the start and end position,
+// ring trajectories close the loop from the last to the first way point
+Eigen::VectorXd computeJerkLimitedSegmentTimes(
+    const std::vector<Eigen::Vector3d>& way_points, const bool ring_trajectory,
+    const double start_speed, const double end_speed,
+    const double max_velocity, const double max_normalized_thrust,
+    const double max_roll_pitch_rate);
+// Number of minimum snap problems the calling thread has solved so far, lets
+// benchmarks compare the work of different seeds
+uint64_t numMinimumSnapSolves();
+// Seed segment times of the generation with limits. Uniform initial segment
+// times carry no information about the individual segments, so the estimated
+// time of each segment is used. Otherwise the ratios of the initial segment
+// times are kept and scaled to the estimated duration.
+Eigen::VectorXd computeSeedSegmentTimes(
+    const Eigen::VectorXd& initial_segment_times,
+    const Eigen::VectorXd& estimated_segment_times);
+// Maximum acceleration along direction with normalized thrust below
+// max_normalized_thrust
+double computeMaxAcceleration(const Eigen::Vector3d& direction,
+                              const double max_normalized_thrust);
+// Time of a jerk limited speed change of speed_change >= 0
+double computeSpeedChangeTime(const double speed_change,
+                              const double max_acceleration,
+                              const double max_jerk);
+
 Eigen::VectorXd solveQuadraticProgram(const Eigen::MatrixXd& H,
                                       const Eigen::VectorXd& f,
                                       const Eigen::MatrixXd& A_eq,
                                       const Eigen::VectorXd& b_eq,
                                       double* objective_value);
+// Assembles and factorizes the system of the optimality conditions of
+// min x' H x + f' x subject to A_eq x = b_eq, whose right hand side is
+// [-f; b_eq] and whose solution is [x; lagrange multipliers]
+void factorizeLagrangeSystem(
+    const Eigen::MatrixXd& H, const Eigen::MatrixXd& A_eq,
+    Eigen::MatrixXd* A_lagrange,
+    Eigen::ColPivHouseholderQR<Eigen::MatrixXd>* A_lagrange_factor);
+// Solves the factorized system without allocating memory if
+// rotated_b_lagrange and lagrange_solution already have the right size
+void solveFactorizedLagrangeSystem(
+    const Eigen::ColPivHouseholderQR<Eigen::MatrixXd>& A_lagrange_factor,
+    const Eigen::VectorXd& b_lagrange, Eigen::VectorXd* rotated_b_lagrange,
+    Eigen::VectorXd* lagrange_solution);
 }  // namespace implementation
 
 }  // namespace minimum_snap_trajectories
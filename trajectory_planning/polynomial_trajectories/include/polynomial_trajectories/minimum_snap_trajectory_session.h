@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+
+#include <quadrotor_common/trajectory_point.h>
+#include <Eigen/Dense>
+
+#include "polynomial_trajectories/polynomial_trajectory.h"
+#include "polynomial_trajectories/polynomial_trajectory_settings.h"
+
+namespace polynomial_trajectories {
+
+// Keeps the state of an open minimum snap trajectory such that it can be
+// recomputed quickly after a small change of its way points or segment times.
+// The trajectory is computed with the free derivatives formulation (see
+// MinimumSnapSolver::FREE_DERIVATIVES). Moving way points only requires a new
+// right hand side, changing segment times or inserting and removing way
+// points only recomputes the affected segments and refactors the reduced
+// system from the first affected way point on.
+// Way point indices refer to trajectory_settings.way_points, i.e. they do not
+// include the start and end position.
+// Heading way points are not supported, the heading of the trajectory is
+// zero.
+class MinimumSnapTrajectorySession {
+ public:
+  MinimumSnapTrajectorySession(
+      const Eigen::VectorXd& segment_times,
+      const quadrotor_common::TrajectoryPoint& start_state,
+      const quadrotor_common::TrajectoryPoint& end_state,
+      const PolynomialTrajectorySettings& trajectory_settings);
+
+  ~MinimumSnapTrajectorySession();
+
+  bool moveWayPoint(const int index, const Eigen::Vector3d& position);
+  // Splits the segment ending at the way point at index, i.e. the new way
+  // point is inserted before it
+  bool insertWayPoint(const int index, const Eigen::Vector3d& position,
+                      const double segment_time_before,
+                      const double segment_time_after);
+  // Merges the two segments adjacent to the way point
+  bool removeWayPoint(const int index, const double merged_segment_time);
+  bool setSegmentTime(const int segment, const double segment_time);
+
+  PolynomialTrajectory trajectory();
+
+  int numWayPoints() const;
+  int numSegments() const;
+
+ private:
+  void updateSegment(const int segment);
+  void invalidateFactorization(const int first_segment);
+  bool validSegmentTime(const double segment_time) const;
+
+  bool valid_;
+  PolynomialTrajectorySettings trajectory_settings_;
+  quadrotor_common::TrajectoryPoint start_state_;
+  quadrotor_common::TrajectoryPoint end_state_;
+  // Includes start and end position
+  std::vector<Eigen::Vector3d> way_points_;
+  std::vector<double> segment_times_;
+
+  // Per segment data that only depends on its segment time
+  std::vector<Eigen::MatrixXd> segment_hessians_;
+  std::vector<Eigen::MatrixXd> segment_solution_maps_;
+  std::vector<Eigen::MatrixXd> segment_cost_matrices_;
+
+  // Factorization of the reduced system, valid for the blocks before
+  // first_invalid_block_
+  std::vector<Eigen::LLT<Eigen::MatrixXd>> diagonal_factors_;
+  std::vector<Eigen::MatrixXd> lower_factors_;
+  int first_invalid_block_;
+};
+
+}  // namespace polynomial_trajectories
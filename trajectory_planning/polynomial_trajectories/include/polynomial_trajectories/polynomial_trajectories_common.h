@@ -5,13 +5,24 @@
 #include <Eigen/Dense>
 
 #include "polynomial_trajectories/polynomial_trajectory.h"
+#include "polynomial_trajectories/thread_pool.h"
 
 namespace polynomial_trajectories {
 
 quadrotor_common::TrajectoryPoint getPointFromTrajectory(
     const PolynomialTrajectory& trajectory,
     const ros::Duration& time_from_start);
+// Evaluates the polynomials in the first three or four rows of coefficients
+// and their first four derivatives at t in a single pass, column k of
+// derivatives holds the k-th derivative. The last row is zero for
+// coefficients with three rows.
+void evaluatePolynomialDerivatives(
+    const Eigen::Ref<const Eigen::MatrixXd>& coefficients,
+    const bool highest_power_first, const double t,
+    Eigen::Matrix<double, 4, 5>* derivatives);
 Eigen::VectorXd computeFactorials(const int length, const int order);
+// Entry index of computeFactorials, (index + 1) * ... * (index + 1 + order)
+double computeFactorial(const int index, const int order);
 Eigen::VectorXd dVec(const int number_of_coefficients,
                      const int derivative_order);
 Eigen::VectorXd tVec(const int number_of_coefficients,
@@ -19,10 +30,29 @@ Eigen::VectorXd tVec(const int number_of_coefficients,
 void computeMaxima(const PolynomialTrajectory& trajectory,
                    double* maximal_velocity, double* maximal_acceleration,
                    double* maximal_jerk, double* maximal_snap);
+// Samples the trajectory every 10 ms. Samples within the same segment are
+// evaluated together in vectorized batches.
 void computeQuadRelevantMaxima(const PolynomialTrajectory& trajectory,
                                double* maximal_velocity,
                                double* maximal_normalized_thrust,
                                double* maximal_roll_pitch_rate);
+// Same as above, but splits the samples into contiguous time intervals that
+// are evaluated by the calling thread and the workers of thread_pool and
+// reduces their maxima. The pool is meant to be reused between calls, with
+// nullptr the samples are evaluated sequentially.
+void computeQuadRelevantMaxima(const PolynomialTrajectory& trajectory,
+                               ThreadPool* thread_pool,
+                               double* maximal_velocity,
+                               double* maximal_normalized_thrust,
+                               double* maximal_roll_pitch_rate);
+// Conservative feasibility check that bounds velocity, normalized thrust and
+// roll/pitch rate of each segment by the convex hull of its Bernstein control
+// points. Segments whose bounds exceed a limit are subdivided a few times
+// before giving up, so a return value of false does not imply that the
+// trajectory actually violates the limits.
+bool isTrajectoryGuaranteedFeasibleUnderConstraints(
+    const PolynomialTrajectory& trajectory, const double max_velocity,
+    const double max_normalized_thrust, const double max_roll_pitch_rate);
 bool isStartAndEndStateFeasibleUnderConstraints(
     const quadrotor_common::TrajectoryPoint& start_state,
     const quadrotor_common::TrajectoryPoint& end_state,
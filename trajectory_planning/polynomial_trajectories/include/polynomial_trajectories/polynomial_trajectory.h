@@ -17,15 +17,66 @@ enum class TrajectoryType {
   MINIMUM_SNAP_RING_OPTIMIZED_SEGMENTS
 };
 
+// Polynomial coefficients of all segments of a trajectory in one contiguous
+// buffer. All segments have the same number of dimensions (rows) and
+// coefficients (columns). The segments are stored one after the other, each
+// as column major matrix, so the dimensions of one coefficient are next to
+// each other in the order in which the evaluation reads them.
+// Segments are accessed as Eigen::Map views into the buffer.
+class PolynomialCoefficients {
+ public:
+  typedef Eigen::Map<Eigen::MatrixXd> SegmentMap;
+  typedef Eigen::Map<const Eigen::MatrixXd> ConstSegmentMap;
+
+  PolynomialCoefficients();
+  // All segments need to have the same size
+  explicit PolynomialCoefficients(
+      const std::vector<Eigen::MatrixXd>& segments);
+
+  // The values are undefined after resizing
+  void resize(const int num_segments, const int dimension,
+              const int num_coefficients);
+  void setZero();
+  void clear();
+
+  size_t size() const { return num_segments_; }
+  bool empty() const { return num_segments_ == 0; }
+  int dimension() const { return dimension_; }
+  int numCoefficients() const { return num_coefficients_; }
+  // The coefficients of segment i start at data() + i * segmentSize()
+  int segmentSize() const { return dimension_ * num_coefficients_; }
+  const double* data() const { return buffer_.data(); }
+  double* data() { return buffer_.data(); }
+
+  SegmentMap operator[](const int segment) {
+    return SegmentMap(buffer_.data() + segment * segmentSize(), dimension_,
+                      num_coefficients_);
+  }
+  ConstSegmentMap operator[](const int segment) const {
+    return ConstSegmentMap(buffer_.data() + segment * segmentSize(),
+                           dimension_, num_coefficients_);
+  }
+  SegmentMap front() { return (*this)[0]; }
+  ConstSegmentMap front() const { return (*this)[0]; }
+  SegmentMap back() { return (*this)[num_segments_ - 1]; }
+  ConstSegmentMap back() const { return (*this)[num_segments_ - 1]; }
+
+ private:
+  int num_segments_;
+  int dimension_;
+  int num_coefficients_;
+  Eigen::VectorXd buffer_;
+};
+
 struct PolynomialTrajectory {
   PolynomialTrajectory();
   virtual ~PolynomialTrajectory();
 
   TrajectoryType trajectory_type;
   // Polynomial coefficients
-  // Each element of this vector contains the coefficients for one polynomial
-  // segment (rows: dimension, columns: order)
-  std::vector<Eigen::MatrixXd> coeff;
+  // Each element contains the coefficients for one polynomial segment
+  // (rows: dimension, columns: order)
+  PolynomialCoefficients coeff;
   ros::Duration T;
   quadrotor_common::TrajectoryPoint start_state;
   quadrotor_common::TrajectoryPoint end_state;
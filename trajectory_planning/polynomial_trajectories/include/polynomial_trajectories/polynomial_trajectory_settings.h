@@ -1,11 +1,21 @@
 #pragma once
 
+#include <vector>
+
 #include <polynomial_trajectories/polynomial_trajectory.h>
 
 #include "Eigen/Dense"
 
 namespace polynomial_trajectories {
 
+enum class MinimumSnapSolver {
+  // Optimize all polynomial coefficients subject to equality constraints
+  CONSTRAINED_QP,
+  // Optimize only the free derivatives at the way points, which requires
+  // polynomial_order >= 2 * continuity_order + 1
+  FREE_DERIVATIVES
+};
+
 struct PolynomialTrajectorySettings {
   PolynomialTrajectorySettings() = default;
 
@@ -24,6 +34,28 @@ struct PolynomialTrajectorySettings {
   Eigen::VectorXd minimization_weights;
   int polynomial_order = 0;
   int continuity_order = 0;
+  MinimumSnapSolver minimum_snap_solver = MinimumSnapSolver::CONSTRAINED_QP;
+  // Optional heading at the way points. If given (one per way point), the
+  // heading is optimized as fourth dimension of the trajectory with the same
+  // segment times and weights as the position. Start and end heading, heading
+  // rate and heading acceleration are taken from the start and end state.
+  // Headings are not wrapped, i.e. consecutive values should not differ by
+  // more than pi to turn the short way.
+  std::vector<double> heading_way_points;
+  // Optimizes the heading as fourth dimension also without heading way
+  // points, e.g. for a single segment from the start to the end heading.
+  // Given heading way points always imply it.
+  bool optimize_heading = false;
+  // Optional axis aligned safety corridors, either empty or one lower and
+  // upper bound per segment. The Bernstein control points of each segment are
+  // kept inside its corridor, which guarantees that the whole segment stays
+  // inside. Corridors are always solved as constrained QP, independent of
+  // minimum_snap_solver.
+  std::vector<Eigen::Vector3d> corridor_lower_bounds;
+  std::vector<Eigen::Vector3d> corridor_upper_bounds;
+  // Number of backtracking line search steps that are evaluated concurrently
+  // when optimizing segment times, 1 evaluates them one after the other
+  int line_search_threads = 1;
 };
 
 }  // namespace polynomial_trajectories
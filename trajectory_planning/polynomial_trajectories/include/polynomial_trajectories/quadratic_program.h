@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+
+#include <Eigen/Dense>
+
+namespace polynomial_trajectories {
+
+// Solves min x' H x + f' x subject to A_eq x = b_eq and A_ineq x <= b_ineq
+// with the dual active set method of Goldfarb and Idnani. The equality
+// constraints are eliminated first, which requires them to be linearly
+// independent and H to be positive definite on their null space.
+// If active_set is given, the inequality constraints it contains are used to
+// warm start the solver (a cold start is done if they do not form a dual
+// feasible starting point) and it receives the indices of the inequality
+// constraints that are active at the solution.
+// Returns false if the problem is infeasible or not strictly convex.
+bool solveActiveSetQuadraticProgram(
+    const Eigen::MatrixXd& H, const Eigen::VectorXd& f,
+    const Eigen::MatrixXd& A_eq, const Eigen::VectorXd& b_eq,
+    const Eigen::MatrixXd& A_ineq, const Eigen::VectorXd& b_ineq,
+    std::vector<int>* active_set, Eigen::VectorXd* solution,
+    double* objective_value);
+
+}  // namespace polynomial_trajectories
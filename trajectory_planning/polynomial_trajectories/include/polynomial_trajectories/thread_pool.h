@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace polynomial_trajectories {
+
+// Minimal pool of worker threads to evaluate independent tasks concurrently.
+// The calling thread of parallelFor works on the tasks as well, so a pool
+// with zero worker threads runs all tasks sequentially in order.
+class ThreadPool {
+ public:
+  explicit ThreadPool(const int num_worker_threads);
+
+  ~ThreadPool();
+
+  // Calls task(i) for every i in [0, num_tasks) and returns once all of them
+  // have finished. Concurrent calls are serialized.
+  void parallelFor(const int num_tasks,
+                   const std::function<void(const int)>& task);
+
+  int numWorkerThreads() const;
+
+ private:
+  void workerThread();
+  // Expects mutex_ to be locked by lock and a task to be available
+  void runNextTask(std::unique_lock<std::mutex>* lock);
+
+  std::vector<std::thread> worker_threads_;
+  std::atomic_bool stop_worker_threads_;
+
+  // Protects the current job below
+  std::mutex mutex_;
+  std::condition_variable task_available_;
+  std::condition_variable tasks_finished_;
+  const std::function<void(const int)>* task_;
+  int num_tasks_;
+  int next_task_;
+  int num_finished_tasks_;
+
+  std::mutex parallel_for_mutex_;
+};
+
+}  // namespace polynomial_trajectories
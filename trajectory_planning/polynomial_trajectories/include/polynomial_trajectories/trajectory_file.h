@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <quadrotor_common/trajectory.h>
+#include <quadrotor_common/trajectory_point.h>
+#include <Eigen/Dense>
+
+#include "polynomial_trajectories/polynomial_trajectory.h"
+
+namespace polynomial_trajectories {
+
+// Binary trajectory files store polynomial or sampled trajectories as fixed
+// size records in native byte order. A memory mapped file can therefore be
+// used in place without any parsing.
+// Layout of a file:
+//   TrajectoryFileHeader
+//   POLYNOMIAL: start and end state as TrajectoryPointRecord, the segment
+//               times and the coefficient matrices of all segments (column
+//               major)
+//   SAMPLED: one TrajectoryPointRecord per trajectory point
+// The version has to be increased with every change of the layout.
+
+static constexpr uint32_t kTrajectoryFileMagic = 0x54475052;  // "RPGT"
+static constexpr uint32_t kTrajectoryFileVersion = 1;
+
+enum class TrajectoryFileContent : uint32_t { POLYNOMIAL = 1, SAMPLED = 2 };
+
+struct TrajectoryFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t content;
+  // PolynomialTrajectory::trajectory_type or
+  // quadrotor_common::Trajectory::trajectory_type
+  uint32_t trajectory_type;
+  // Number of segments or number of points
+  uint64_t count;
+  // Size of the coefficient matrices, zero for sampled trajectories
+  uint32_t dimension;
+  uint32_t num_coefficients;
+  double duration;
+  double optimization_cost;
+};
+
+struct TrajectoryPointRecord {
+  double time_from_start;
+  double position[3];
+  // w, x, y, z
+  double orientation[4];
+  double velocity[3];
+  double acceleration[3];
+  double jerk[3];
+  double snap[3];
+  double bodyrates[3];
+  double angular_acceleration[3];
+  double angular_jerk[3];
+  double angular_snap[3];
+  double heading;
+  double heading_rate;
+  double heading_acceleration;
+};
+
+bool saveTrajectoryFile(const std::string& file_name,
+                        const PolynomialTrajectory& trajectory);
+bool saveTrajectoryFile(const std::string& file_name,
+                        const quadrotor_common::Trajectory& trajectory);
+
+TrajectoryPointRecord toTrajectoryPointRecord(
+    const quadrotor_common::TrajectoryPoint& point);
+quadrotor_common::TrajectoryPoint fromTrajectoryPointRecord(
+    const TrajectoryPointRecord& record);
+
+// Read only memory mapping of a trajectory file. The accessors refer to the
+// mapped memory and are only valid while the file is open.
+class TrajectoryFile {
+ public:
+  TrajectoryFile();
+  TrajectoryFile(const TrajectoryFile&) = delete;
+  TrajectoryFile& operator=(const TrajectoryFile&) = delete;
+
+  ~TrajectoryFile();
+
+  bool open(const std::string& file_name);
+  void close();
+  bool isOpen() const;
+
+  const TrajectoryFileHeader& header() const;
+  TrajectoryFileContent content() const;
+
+  // Polynomial trajectories
+  int numSegments() const;
+  Eigen::Map<const Eigen::VectorXd> segmentTimes() const;
+  Eigen::Map<const Eigen::MatrixXd> coefficients(const int segment) const;
+
+  // Sampled trajectories
+  int numPoints() const;
+  const TrajectoryPointRecord& point(const int index) const;
+
+  // Copy the file content into the corresponding trajectory type
+  bool load(PolynomialTrajectory* trajectory) const;
+  bool load(quadrotor_common::Trajectory* trajectory) const;
+
+ private:
+  const TrajectoryPointRecord* records() const;
+
+  const char* data_;
+  size_t size_;
+};
+
+}  // namespace polynomial_trajectories
@@ -0,0 +1,98 @@
+#include "polynomial_trajectories/bernstein_polynomials.h"
+
+namespace polynomial_trajectories {
+
+namespace {
+
+// binomial(degree, i) for i = 0..degree
+Eigen::VectorXd computeBinomials(const int degree) {
+  Eigen::VectorXd binomials(degree + 1);
+  binomials(0) = 1.0;
+  for (int i = 1; i <= degree; i++) {
+    binomials(i) = binomials(i - 1) * (degree - i + 1) / i;
+  }
+  return binomials;
+}
+
+}  // namespace
+
+Eigen::MatrixXd computeBernsteinControlPoints(
+    const Eigen::MatrixXd& coefficients) {
+  // b_k = sum_{i=0}^{k} binomial(k, i) / binomial(n, i) * a_i
+  const int degree = coefficients.cols() - 1;
+
+  Eigen::MatrixXd control_points =
+      Eigen::MatrixXd::Zero(coefficients.rows(), coefficients.cols());
+  const Eigen::VectorXd degree_binomials = computeBinomials(degree);
+
+  for (int k = 0; k <= degree; k++) {
+    double binomial = 1.0;  // binomial(k, i)
+    for (int i = 0; i <= k; i++) {
+      control_points.col(k) +=
+          binomial / degree_binomials(i) * coefficients.col(i);
+      binomial = binomial * (k - i) / (i + 1);
+    }
+  }
+
+  return control_points;
+}
+
+Eigen::MatrixXd differentiateBernsteinControlPoints(
+    const Eigen::MatrixXd& control_points, const double duration) {
+  const int degree = control_points.cols() - 1;
+  if (degree < 1) {
+    return Eigen::MatrixXd::Zero(control_points.rows(), 1);
+  }
+
+  return degree / duration *
+         (control_points.rightCols(degree) - control_points.leftCols(degree));
+}
+
+Eigen::MatrixXd computeBernsteinCrossProduct(
+    const Eigen::MatrixXd& control_points_a,
+    const Eigen::MatrixXd& control_points_b) {
+  // c_k = sum_{i+j=k} binomial(m, i) * binomial(n, j) / binomial(m+n, k) *
+  //       a_i x b_j
+  const int degree_a = control_points_a.cols() - 1;
+  const int degree_b = control_points_b.cols() - 1;
+
+  const Eigen::VectorXd binomials_a = computeBinomials(degree_a);
+  const Eigen::VectorXd binomials_b = computeBinomials(degree_b);
+  const Eigen::VectorXd binomials_product =
+      computeBinomials(degree_a + degree_b);
+
+  Eigen::MatrixXd control_points =
+      Eigen::MatrixXd::Zero(3, degree_a + degree_b + 1);
+  for (int i = 0; i <= degree_a; i++) {
+    const Eigen::Vector3d a = control_points_a.col(i).head<3>();
+    for (int j = 0; j <= degree_b; j++) {
+      control_points.col(i + j) +=
+          binomials_a(i) * binomials_b(j) / binomials_product(i + j) *
+          a.cross(control_points_b.col(j).head<3>());
+    }
+  }
+
+  return control_points;
+}
+
+void splitBernsteinControlPoints(const Eigen::MatrixXd& control_points,
+                                 Eigen::MatrixXd* first_half,
+                                 Eigen::MatrixXd* second_half) {
+  const int num_control_points = control_points.cols();
+  first_half->resize(control_points.rows(), num_control_points);
+  second_half->resize(control_points.rows(), num_control_points);
+
+  // In iteration i, the first num_control_points - i columns of points hold
+  // the i-th level of de Casteljau's triangle
+  Eigen::MatrixXd points = control_points;
+  for (int i = 0; i < num_control_points; i++) {
+    const int num_points = num_control_points - i;
+    first_half->col(i) = points.col(0);
+    second_half->col(num_points - 1) = points.col(num_points - 1);
+    for (int j = 0; j < num_points - 1; j++) {
+      points.col(j) = 0.5 * (points.col(j) + points.col(j + 1));
+    }
+  }
+}
+
+}  // namespace polynomial_trajectories
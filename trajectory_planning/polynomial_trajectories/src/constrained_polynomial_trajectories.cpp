@@ -7,6 +7,8 @@
 namespace polynomial_trajectories {
 namespace constrained_polynomial_trajectories {
 
+static constexpr int kMaxCachedOrderOfContinuity = 10;
+
 PolynomialTrajectory computeTimeOptimalTrajectory(
     const quadrotor_common::TrajectoryPoint& s0,
     const quadrotor_common::TrajectoryPoint& s1, const int order_of_continuity,
@@ -40,140 +42,121 @@ PolynomialTrajectory computeTimeOptimalTrajectory(
         max_velocity / acc_towards_s1_max + distance / max_velocity;
   }
 
-  // Compute initial trajectory such that limits must be violated
-  PolynomialTrajectory initial_trajectory;
-  initial_trajectory.trajectory_type =
-      polynomial_trajectories::TrajectoryType::FULLY_CONSTRAINED;
-  initial_trajectory.start_state = s0;
-  initial_trajectory.start_state.time_from_start = ros::Duration(0.0);
-  initial_trajectory.end_state = s1;
-  initial_trajectory.number_of_segments = 1;
-  initial_trajectory.T = ros::Duration(init_trajectory_duration);
-  initial_trajectory.end_state.time_from_start = initial_trajectory.T;
-  initial_trajectory.coeff = implementation::computeTrajectoryCoeff(
-      s0, s1, order_of_continuity, initial_trajectory.T.toSec());
-  initial_trajectory.segment_times.resize(1);
-  initial_trajectory.segment_times(0) = initial_trajectory.T.toSec();
-
-  PolynomialTrajectory trajectory = initial_trajectory;
-  Eigen::Vector3d desired_maxima =
+  // The largest ratio between the maxima of a trajectory and the desired
+  // maxima has to be in [kMinAcceptedMaximaRatio, 1]
+  const Eigen::Vector3d desired_maxima =
       Eigen::Vector3d(max_velocity, max_normalized_thrust, max_roll_pitch_rate);
-  Eigen::Vector3d prev_maxima;
-  computeQuadRelevantMaxima(trajectory, &prev_maxima.x(), &prev_maxima.y(),
-                            &prev_maxima.z());
-
-  while (prev_maxima.x() <= 1.01 * desired_maxima.x() &&
-         prev_maxima.y() <= 1.01 * desired_maxima.y() &&
-         prev_maxima.z() <= 1.01 * desired_maxima.z()) {
-    if ((prev_maxima.x() >= 0.99 * desired_maxima.x() ||
-         prev_maxima.y() >= 0.99 * desired_maxima.y() ||
-         prev_maxima.z() >= 0.99 * desired_maxima.z()) &&
-        (prev_maxima.x() <= desired_maxima.x() &&
-         prev_maxima.y() <= desired_maxima.y() &&
-         prev_maxima.z() <= desired_maxima.z())) {
-      return trajectory;
-    }
-
-    trajectory.T = ros::Duration(0.9 * trajectory.T.toSec());
-    trajectory.end_state.time_from_start = trajectory.T;
-    trajectory.segment_times(0) = trajectory.T.toSec();
-    trajectory.coeff = implementation::computeTrajectoryCoeff(
-        s0, s1, order_of_continuity, trajectory.T.toSec());
-
-    computeQuadRelevantMaxima(trajectory, &prev_maxima.x(), &prev_maxima.y(),
-                              &prev_maxima.z());
+  const double kMinAcceptedMaximaRatio = 0.99;
+  const int kMaxIterations = 30;
+
+  PolynomialTrajectory trajectory = computeFixedTimeTrajectory(
+      s0, s1, order_of_continuity, init_trajectory_duration);
+  double maxima_ratio =
+      implementation::computeMaximaRatio(trajectory, desired_maxima);
+  if (!(maxima_ratio > 0.0)) {
+    // The trajectory does not move
+    return trajectory;
   }
 
-  // compute gradient of maxima with respect to T
-  Eigen::Vector3d maxima_gradient = implementation::computeMaximaGradient(
-      trajectory, prev_maxima, order_of_continuity);
-
-  // Iteratively optimize execution time
-  const int max_iterations = 15;
-  for (int i = 0; i < max_iterations; i++) {
-    Eigen::Vector3d new_intersections =
-        (desired_maxima - prev_maxima).cwiseQuotient(maxima_gradient) +
-        trajectory.T.toSec() * Eigen::Vector3d::Ones();
-
-    for (int i = 0; i < 3; i++) {
-      if (fabs(maxima_gradient(i)) < 5e-2) {
-        // make it negative since we will filter this out later
-        new_intersections(i) = -1.0;
+  // Find the root of log(maxima_ratio) over log(T) in a bracket [lower,
+  // upper] where the lower duration violates the maxima and the upper one
+  // satisfies them. Velocity scales with 1 / T and the higher derivatives with
+  // higher powers of 1 / T, so the logarithms are close to linear and the
+  // root finding converges in a few iterations.
+  double lower_log_duration = 0.0;
+  double lower_log_ratio = 0.0;
+  bool lower_found = false;
+  double upper_log_duration = 0.0;
+  double upper_log_ratio = 0.0;
+  bool upper_found = false;
+  // Side of the bracket that was replaced in the last iteration
+  bool lower_replaced_last = false;
+  bool upper_replaced_last = false;
+  PolynomialTrajectory feasible_trajectory;
+  PolynomialTrajectory best_trajectory = trajectory;
+  double best_maxima_ratio = maxima_ratio;
+
+  // Until the limit is bracketed, T is scaled by maxima_ratio^step_factor.
+  // With step_factor = 1 this exactly reaches the velocity limit if the
+  // velocity is the active constraint. The step is enlarged for every attempt
+  // that stays on the same side of the limit but never by more than
+  // kMaxLogDurationStep.
+  const double kMaxLogDurationStep = log(4.0);
+  double step_factor = 1.0;
+
+  double log_duration = log(init_trajectory_duration);
+  double log_ratio = log(maxima_ratio);
+  for (int i = 0; i < kMaxIterations; i++) {
+    if (maxima_ratio <= 1.0) {
+      if (maxima_ratio >= kMinAcceptedMaximaRatio) {
+        return trajectory;
       }
-    }
-
-    Eigen::Vector3d prev_gradient = maxima_gradient;
-    PolynomialTrajectory prev_trajectory = trajectory;
-    bool exhaustivly_search_minimum = false;
-    Eigen::Vector3d maxima;
-
-    if (new_intersections.maxCoeff() > initial_trajectory.T.toSec()) {
-      // recompute trajectory with new duration
-      trajectory.T = ros::Duration(new_intersections.maxCoeff());
-      trajectory.end_state.time_from_start = trajectory.T;
-      trajectory.segment_times(0) = trajectory.T.toSec();
-      trajectory.coeff = implementation::computeTrajectoryCoeff(
-          s0, s1, order_of_continuity, trajectory.T.toSec());
-
-      computeQuadRelevantMaxima(trajectory, &maxima.x(), &maxima.y(),
-                                &maxima.z());
-
-      if (maxima.x() <= 1.01 * desired_maxima.x() &&
-          maxima.y() <= 1.01 * desired_maxima.y() &&
-          maxima.z() <= 1.01 * desired_maxima.z()) {
-        // we are close enough at the limits so we stop here
-        break;
+      // Illinois modification: halve the value at an end of the bracket that
+      // is kept twice in a row to avoid slow one sided convergence
+      if (upper_replaced_last) {
+        lower_log_ratio *= 0.5;
       }
-
-      // compute gradient of maxima with respect to T
-      maxima_gradient = implementation::computeMaximaGradient(
-          trajectory, maxima, order_of_continuity);
-
-      // check if gradient flipped sign
-      if ((prev_gradient.cwiseProduct(maxima_gradient)).minCoeff() < 0.0) {
-        trajectory = prev_trajectory;
-        maxima_gradient = prev_gradient;
-        exhaustivly_search_minimum = true;
+      upper_log_duration = log_duration;
+      upper_log_ratio = log_ratio;
+      upper_found = true;
+      upper_replaced_last = true;
+      lower_replaced_last = false;
+      feasible_trajectory = trajectory;
+    } else if (upper_found || !lower_found || log_ratio < lower_log_ratio) {
+      if (lower_replaced_last && upper_found) {
+        upper_log_ratio *= 0.5;
       }
+      lower_log_duration = log_duration;
+      lower_log_ratio = log_ratio;
+      lower_found = true;
+      lower_replaced_last = true;
+      upper_replaced_last = false;
     } else {
-      exhaustivly_search_minimum = true;
+      // A longer duration made the violation worse, which happens if
+      // nonzero boundary accelerations cause velocities that grow with the
+      // duration. Retry with half the previous step.
+      step_factor *= 0.25;
     }
 
-    if (exhaustivly_search_minimum) {
-      for (int j = i; j < max_iterations; j++) {
-        trajectory.T = ros::Duration(1.1 * trajectory.T.toSec());
-        trajectory.end_state.time_from_start = trajectory.T;
-        trajectory.segment_times(0) = trajectory.T.toSec();
-        trajectory.coeff = implementation::computeTrajectoryCoeff(
-            s0, s1, order_of_continuity, trajectory.T.toSec());
-
-        computeQuadRelevantMaxima(trajectory, &maxima.x(), &maxima.y(),
-                                  &maxima.z());
-        if ((maxima.x() > desired_maxima.x() &&
-             maxima.x() > prev_maxima.x() + 1e-6) ||
-            (maxima.y() > desired_maxima.y() &&
-             maxima.y() > prev_maxima.y() + 1e-6) ||
-            (maxima.z() > desired_maxima.z() &&
-             maxima.z() > prev_maxima.z() + 1e-6)) {
-          trajectory = prev_trajectory;
-          break;
-        }
-        if (maxima.x() <= 1.01 * desired_maxima.x() &&
-            maxima.y() <= 1.01 * desired_maxima.y() &&
-            maxima.z() <= 1.01 * desired_maxima.z()) {
-          // Reached desired maxima so we take this trajectory
-          break;
-        }
-        prev_maxima = maxima;
-        prev_trajectory = trajectory;
-      }
+    if (maxima_ratio < best_maxima_ratio) {
+      best_trajectory = trajectory;
+      best_maxima_ratio = maxima_ratio;
+    }
 
-      break;
+    if (lower_found && upper_found) {
+      // Regula falsi step within the bracket
+      log_duration = (lower_log_duration * upper_log_ratio -
+                      upper_log_duration * lower_log_ratio) /
+                     (upper_log_ratio - lower_log_ratio);
+    } else {
+      const double base_log_duration =
+          lower_found ? lower_log_duration : upper_log_duration;
+      const double base_log_ratio =
+          lower_found ? lower_log_ratio : upper_log_ratio;
+      log_duration =
+          base_log_duration +
+          std::max(-kMaxLogDurationStep,
+                   std::min(step_factor * base_log_ratio, kMaxLogDurationStep));
+      step_factor *= 2.0;
     }
-    prev_maxima = maxima;
+
+    trajectory = computeFixedTimeTrajectory(s0, s1, order_of_continuity,
+                                            exp(log_duration));
+    maxima_ratio =
+        implementation::computeMaximaRatio(trajectory, desired_maxima);
+    log_ratio = log(maxima_ratio);
   }
 
-  return trajectory;
+  if (maxima_ratio <= 1.0) {
+    return trajectory;
+  }
+  if (upper_found) {
+    return feasible_trajectory;
+  }
+  if (maxima_ratio < best_maxima_ratio) {
+    return trajectory;
+  }
+  return best_trajectory;
 }
 
 PolynomialTrajectory computeFixedTimeTrajectory(
@@ -189,8 +172,9 @@ PolynomialTrajectory computeFixedTimeTrajectory(
   trajectory.number_of_segments = 1;
   trajectory.T = ros::Duration(execution_time);
   trajectory.end_state.time_from_start = trajectory.T;
-  trajectory.coeff = implementation::computeTrajectoryCoeff(
-      s0, s1, order_of_continuity, execution_time);
+  trajectory.coeff =
+      PolynomialCoefficients(implementation::computeTrajectoryCoeff(
+          s0, s1, order_of_continuity, execution_time));
 
   trajectory.segment_times.resize(1);
   trajectory.segment_times(0) = trajectory.T.toSec();
@@ -231,25 +215,44 @@ std::vector<Eigen::MatrixXd> implementation::computeTrajectoryCoeff(
     const quadrotor_common::TrajectoryPoint& s1, const int order_of_continuity,
     const double T) {
   int number_of_coefficients = 2 * order_of_continuity;
-  Eigen::MatrixXd p_coeff = Eigen::MatrixXd::Zero(3, number_of_coefficients);
 
-  // solve the problem for each axis
+  // The constraint matrix in normalized time tau = t / T only depends on the
+  // order of continuity so its inverse is computed once
+  static const std::vector<Eigen::MatrixXd> normalized_inverses =
+      computeNormalizedConstraintMatrixInverses(
+          kMaxCachedOrderOfContinuity);
+  Eigen::MatrixXd uncached_inverse;
+  if (order_of_continuity > kMaxCachedOrderOfContinuity) {
+    uncached_inverse =
+        computeNormalizedConstraintMatrixInverse(order_of_continuity);
+  }
+  const Eigen::MatrixXd& normalized_inverse =
+      order_of_continuity > kMaxCachedOrderOfContinuity
+          ? uncached_inverse
+          : normalized_inverses[order_of_continuity];
+
+  // The k-th derivative with respect to tau is T^k times the one with
+  // respect to t
+  Eigen::MatrixXd b = Eigen::MatrixXd::Zero(number_of_coefficients, 3);
   for (int axis = 0; axis < 3; axis++) {
-    Eigen::MatrixXd A =
-        Eigen::MatrixXd::Zero(number_of_coefficients, number_of_coefficients);
-    Eigen::VectorXd b = Eigen::VectorXd::Zero(number_of_coefficients);
-
-    A.topLeftCorner(order_of_continuity, number_of_coefficients) =
-        implementation::computeConstraintMatriceA(order_of_continuity, 0.0);
-    A.bottomLeftCorner(order_of_continuity, number_of_coefficients) =
-        implementation::computeConstraintMatriceA(order_of_continuity, T);
-
-    b.head(order_of_continuity) = implementation::computeConstraintMatriceB(
-        order_of_continuity, s0, axis);
-    b.tail(order_of_continuity) = implementation::computeConstraintMatriceB(
-        order_of_continuity, s1, axis);
+    b.col(axis).head(order_of_continuity) =
+        implementation::computeConstraintMatriceB(order_of_continuity, s0,
+                                                  axis);
+    b.col(axis).tail(order_of_continuity) =
+        implementation::computeConstraintMatriceB(order_of_continuity, s1,
+                                                  axis);
+  }
+  for (int k = 1; k < order_of_continuity; k++) {
+    const double T_k = pow(T, k);
+    b.row(k) *= T_k;
+    b.row(order_of_continuity + k) *= T_k;
+  }
 
-    p_coeff.row(axis) = A.inverse() * b;
+  // Coefficients of tau^i are T^i times the coefficients of t^i
+  const Eigen::MatrixXd normalized_coeff = normalized_inverse * b;
+  Eigen::MatrixXd p_coeff = Eigen::MatrixXd::Zero(3, number_of_coefficients);
+  for (int i = 0; i < number_of_coefficients; i++) {
+    p_coeff.col(i) = normalized_coeff.row(i).transpose() / pow(T, i);
   }
 
   std::vector<Eigen::MatrixXd> coeff_vec;
@@ -258,24 +261,39 @@ std::vector<Eigen::MatrixXd> implementation::computeTrajectoryCoeff(
   return coeff_vec;
 }
 
-Eigen::Vector3d implementation::computeMaximaGradient(
-    const PolynomialTrajectory& trajectory, const Eigen::Vector3d& maxima,
-    const double order_of_continuity) {
-  PolynomialTrajectory gradient_trajectory = trajectory;
-  gradient_trajectory.T = ros::Duration(1.01 * trajectory.T.toSec());
-  gradient_trajectory.segment_times(0) = gradient_trajectory.T.toSec();
-  gradient_trajectory.coeff = implementation::computeTrajectoryCoeff(
-      trajectory.start_state, trajectory.end_state, order_of_continuity,
-      gradient_trajectory.T.toSec());
-  Eigen::Vector3d gradient_trajectory_maxima;
-  computeQuadRelevantMaxima(
-      gradient_trajectory, &gradient_trajectory_maxima.x(),
-      &gradient_trajectory_maxima.y(), &gradient_trajectory_maxima.z());
-
-  Eigen::Vector3d gradient = (gradient_trajectory_maxima - maxima) /
-                             (gradient_trajectory.T - trajectory.T).toSec();
-
-  return gradient;
+Eigen::MatrixXd implementation::computeNormalizedConstraintMatrixInverse(
+    const int order_of_continuity) {
+  const int number_of_coefficients = 2 * order_of_continuity;
+
+  Eigen::MatrixXd A =
+      Eigen::MatrixXd::Zero(number_of_coefficients, number_of_coefficients);
+  A.topRows(order_of_continuity) =
+      implementation::computeConstraintMatriceA(order_of_continuity, 0.0);
+  A.bottomRows(order_of_continuity) =
+      implementation::computeConstraintMatriceA(order_of_continuity, 1.0);
+
+  return A.inverse();
+}
+
+std::vector<Eigen::MatrixXd>
+implementation::computeNormalizedConstraintMatrixInverses(
+    const int max_order_of_continuity) {
+  std::vector<Eigen::MatrixXd> inverses(max_order_of_continuity + 1);
+  for (int order = 1; order <= max_order_of_continuity; order++) {
+    inverses[order] = computeNormalizedConstraintMatrixInverse(order);
+  }
+
+  return inverses;
+}
+
+double implementation::computeMaximaRatio(
+    const PolynomialTrajectory& trajectory,
+    const Eigen::Vector3d& desired_maxima) {
+  Eigen::Vector3d maxima;
+  computeQuadRelevantMaxima(trajectory, &maxima.x(), &maxima.y(),
+                            &maxima.z());
+
+  return maxima.cwiseQuotient(desired_maxima).maxCoeff();
 }
 
 }  // namespace constrained_polynomial_trajectories
@@ -1,57 +1,71 @@
 #include "polynomial_trajectories/minimum_snap_trajectories.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+
 #include <ros/ros.h>
 
+#include "polynomial_trajectories/bernstein_polynomials.h"
 #include "polynomial_trajectories/polynomial_trajectories_common.h"
+#include "polynomial_trajectories/quadratic_program.h"
+#include "polynomial_trajectories/thread_pool.h"
 
 namespace polynomial_trajectories {
 
 namespace minimum_snap_trajectories {
 
+// Minimum snap problems solved by each thread, see
+// implementation::numMinimumSnapSolves()
+static thread_local uint64_t num_minimum_snap_solves = 0;
+
 PolynomialTrajectory generateMinimumSnapTrajectory(
     const Eigen::VectorXd& segment_times,
     const quadrotor_common::TrajectoryPoint& start_state,
     const quadrotor_common::TrajectoryPoint& end_state,
     const PolynomialTrajectorySettings& trajectory_settings) {
+  const bool corridors = !trajectory_settings.corridor_lower_bounds.empty() ||
+                         !trajectory_settings.corridor_upper_bounds.empty();
+  if (!corridors && trajectory_settings.minimum_snap_solver ==
+                        MinimumSnapSolver::CONSTRAINED_QP) {
+    // Keep the memory of the equality constrained QP between the calls of
+    // each thread, such as the ones of the segment time refinement. It keeps
+    // the size of the largest problem the thread has solved until the thread
+    // exits.
+    static thread_local MinimumSnapWorkspace workspace;
+    PolynomialTrajectory minimum_snap_trajectory;
+    generateMinimumSnapTrajectory(segment_times, start_state, end_state,
+                                  trajectory_settings, &workspace,
+                                  &minimum_snap_trajectory);
+    return minimum_snap_trajectory;
+  }
+
+  // Only the free derivatives and the QP with corridors are solved here
+  const bool free_derivatives = !corridors;
+
+  num_minimum_snap_solves++;
+  PolynomialTrajectory minimum_snap_trajectory;
+  PolynomialTrajectorySettings new_trajectory_settings;
+  if (!implementation::setUpOpenMinimumSnapProblem(
+          segment_times, start_state, end_state, trajectory_settings,
+          free_derivatives, &new_trajectory_settings,
+          &minimum_snap_trajectory)) {
+    return PolynomialTrajectory();
+  }
   const int num_segments = segment_times.size();
 
-  if (num_segments != trajectory_settings.way_points.size() + 1) {
+  if (corridors && !implementation::areWayPointsInsideCorridors(
+                       new_trajectory_settings, num_segments, false)) {
     ROS_ERROR(
-        "[%s] Number of way points and segments are not agreeing. "
-        "(Need num_segments == num_waypoints + 1 for open trajectories.)",
+        "[%s] Need one corridor per segment that contains both end points of "
+        "the segment.",
         ros::this_node::getName().c_str());
     return PolynomialTrajectory();
   }
 
-  PolynomialTrajectory minimum_snap_trajectory;
-  minimum_snap_trajectory.trajectory_type =
-      polynomial_trajectories::TrajectoryType::MINIMUM_SNAP;
-  minimum_snap_trajectory.number_of_segments = num_segments;
-  minimum_snap_trajectory.segment_times = segment_times;
-
-  minimum_snap_trajectory.start_state = start_state;
-  minimum_snap_trajectory.start_state.time_from_start = ros::Duration(0.0);
-  minimum_snap_trajectory.end_state = end_state;
-
-  minimum_snap_trajectory.optimization_cost = 0.0;  // will be reset later on
-  minimum_snap_trajectory.T = ros::Duration(segment_times.sum());
-  minimum_snap_trajectory.end_state.time_from_start = minimum_snap_trajectory.T;
-
-  // Ensure trajectory settings that result in feasible optimization problem
-  const int min_poly_order = 2 +
-                             ceil(trajectory_settings.continuity_order *
-                                  (num_segments + 1) / float(num_segments)) -
-                             1;
-  PolynomialTrajectorySettings new_trajectory_settings =
-      implementation::ensureFeasibleTrajectorySettings(trajectory_settings,
-                                                       min_poly_order);
-
-  // Add start and end position to way points vector
-  new_trajectory_settings.way_points =
-      implementation::addStartAndEndToWayPointList(
-          trajectory_settings.way_points, start_state.position,
-          end_state.position);
-
   // Compute tau dot
   // Definition: tau(i) = (time - wp_times_zero_start_(i)) /
   //     (wp_times_zero_start_(i+1) - wp_times_zero_start_(i))
@@ -65,35 +79,59 @@ PolynomialTrajectory generateMinimumSnapTrajectory(
   // Compute common matrices used for optimization later on
   Eigen::MatrixXd H = implementation::generateHMatrix(new_trajectory_settings,
                                                       num_segments, tau_dot);
-  Eigen::MatrixXd A_eq = implementation::generateEqualityConstraintsAMatrix(
-      new_trajectory_settings, num_segments, tau_dot);
-
-  std::vector<Eigen::MatrixXd> coefficients;
-  // Compute trajectory for each spatial dimension
-  for (int d = 0; d < 3; d++) {
-    Eigen::VectorXd way_points_d = Eigen::VectorXd::Zero(num_segments + 1);
-    for (int i = 0; i < num_segments + 1; i++) {
-      Eigen::VectorXd way_point_i = new_trajectory_settings.way_points[i];
-      way_points_d(i) = way_point_i(d);
-    }
+  Eigen::MatrixXd A_eq;
+  Eigen::MatrixXd A_ineq;
+  std::vector<Eigen::MatrixXd> segment_solution_maps;
+  if (free_derivatives) {
+    segment_solution_maps = implementation::generateSegmentSolutionMaps(
+        new_trajectory_settings, num_segments, tau_dot, H);
+  } else {
+    A_eq = implementation::generateEqualityConstraintsAMatrix(
+        new_trajectory_settings, num_segments, tau_dot);
+    A_ineq = implementation::generateCorridorConstraintsAMatrix(
+        new_trajectory_settings, num_segments);
+  }
 
-    Eigen::Vector3d start_conditions(start_state.velocity(d),
-                                     start_state.acceleration(d),
-                                     start_state.jerk(d));
-    Eigen::Vector3d end_conditions(
-        end_state.velocity(d), end_state.acceleration(d), end_state.jerk(d));
+  // Compute trajectory for each spatial dimension and the heading
+  for (int d = 0; d < minimum_snap_trajectory.coeff.dimension(); d++) {
+    Eigen::VectorXd way_points_d;
+    Eigen::Vector3d start_conditions;
+    Eigen::Vector3d end_conditions;
+    implementation::getOpenWayPoints1D(new_trajectory_settings, start_state,
+                                       end_state, d, &way_points_d,
+                                       &start_conditions, &end_conditions);
 
     Eigen::MatrixXd coefficients_for_this_dimension;
     Eigen::VectorXd f = implementation::generateFVector(
         new_trajectory_settings, way_points_d, num_segments);
-    Eigen::VectorXd b_eq = implementation::generateEqualityConstraintsBVector(
-        new_trajectory_settings, num_segments, way_points_d, start_conditions,
-        end_conditions);
 
     double cost_dimension;
-    coefficients_for_this_dimension = implementation::generate1DTrajectory(
-        num_segments, new_trajectory_settings.polynomial_order, H, f, A_eq,
-        b_eq, &cost_dimension);
+    if (free_derivatives) {
+      coefficients_for_this_dimension =
+          implementation::generate1DTrajectoryFreeDerivatives(
+              new_trajectory_settings, segment_solution_maps, H, f,
+              way_points_d, start_conditions, end_conditions, false,
+              &cost_dimension);
+    } else {
+      Eigen::VectorXd b_eq =
+          implementation::generateEqualityConstraintsBVector(
+              new_trajectory_settings, num_segments, way_points_d,
+              start_conditions, end_conditions);
+      if (d < 3) {
+        coefficients_for_this_dimension =
+            implementation::generate1DTrajectoryInCorridor(
+                num_segments, new_trajectory_settings.polynomial_order, H, f,
+                A_eq, b_eq, A_ineq,
+                implementation::generateCorridorConstraintsBVector(
+                    new_trajectory_settings, num_segments, d),
+                &cost_dimension);
+      } else {
+        // The corridors do not bound the heading
+        coefficients_for_this_dimension = implementation::generate1DTrajectory(
+            num_segments, new_trajectory_settings.polynomial_order, H, f, A_eq,
+            b_eq, &cost_dimension);
+      }
+    }
     if (cost_dimension > 1e20 || std::isnan(cost_dimension)) {
       ROS_ERROR("[%s] Could not solve quadratic program.",
                 ros::this_node::getName().c_str());
@@ -103,16 +141,102 @@ PolynomialTrajectory generateMinimumSnapTrajectory(
     }
 
     minimum_snap_trajectory.optimization_cost += cost_dimension;
-    coefficients.push_back(coefficients_for_this_dimension);
+    for (int k = 0; k < num_segments; k++) {
+      minimum_snap_trajectory.coeff[k].row(d) =
+          coefficients_for_this_dimension.row(k);
+    }
   }
 
-  minimum_snap_trajectory.coeff =
-      implementation::reorganiceCoefficientsSegmentWise(
-          coefficients, num_segments, new_trajectory_settings.polynomial_order);
-
   return minimum_snap_trajectory;
 }
 
+bool generateMinimumSnapTrajectory(
+    const Eigen::VectorXd& segment_times,
+    const quadrotor_common::TrajectoryPoint& start_state,
+    const quadrotor_common::TrajectoryPoint& end_state,
+    const PolynomialTrajectorySettings& trajectory_settings,
+    MinimumSnapWorkspace* workspace, PolynomialTrajectory* trajectory) {
+  const bool corridors = !trajectory_settings.corridor_lower_bounds.empty() ||
+                         !trajectory_settings.corridor_upper_bounds.empty();
+  if (corridors || trajectory_settings.minimum_snap_solver !=
+                       MinimumSnapSolver::CONSTRAINED_QP) {
+    *trajectory = generateMinimumSnapTrajectory(segment_times, start_state,
+                                                end_state, trajectory_settings);
+    return trajectory->trajectory_type !=
+           polynomial_trajectories::TrajectoryType::UNDEFINED;
+  }
+
+  num_minimum_snap_solves++;
+  if (!implementation::setUpOpenMinimumSnapProblem(
+          segment_times, start_state, end_state, trajectory_settings, false,
+          &workspace->trajectory_settings, trajectory)) {
+    *trajectory = PolynomialTrajectory();
+    return false;
+  }
+  const PolynomialTrajectorySettings& new_trajectory_settings =
+      workspace->trajectory_settings;
+  const int num_segments = segment_times.size();
+  const int poly_order = new_trajectory_settings.polynomial_order;
+  const int num_variables = (poly_order + 1) * num_segments;
+
+  // Compute the common matrices and factorize the Lagrange system once for
+  // all dimensions
+  workspace->tau_dot = segment_times.cwiseInverse();
+  implementation::generateHMatrix(new_trajectory_settings, num_segments,
+                                  workspace->tau_dot, &workspace->H);
+  implementation::generateEqualityConstraintsAMatrix(
+      new_trajectory_settings, num_segments, workspace->tau_dot,
+      &workspace->A_eq);
+  implementation::factorizeLagrangeSystem(workspace->H, workspace->A_eq,
+                                          &workspace->A_lagrange,
+                                          &workspace->A_lagrange_factor);
+
+  // Compute trajectory for each spatial dimension and the heading
+  for (int d = 0; d < trajectory->coeff.dimension(); d++) {
+    Eigen::Vector3d start_conditions;
+    Eigen::Vector3d end_conditions;
+    implementation::getOpenWayPoints1D(
+        new_trajectory_settings, start_state, end_state, d,
+        &workspace->way_points_1D, &start_conditions, &end_conditions);
+
+    implementation::generateFVector(new_trajectory_settings,
+                                    workspace->way_points_1D, num_segments,
+                                    &workspace->f);
+    implementation::generateEqualityConstraintsBVector(
+        new_trajectory_settings, num_segments, workspace->way_points_1D,
+        start_conditions, end_conditions, &workspace->b_eq);
+    workspace->b_lagrange.resize(num_variables + workspace->b_eq.size());
+    workspace->b_lagrange.head(num_variables) = -workspace->f;
+    workspace->b_lagrange.tail(workspace->b_eq.size()) = workspace->b_eq;
+
+    implementation::solveFactorizedLagrangeSystem(
+        workspace->A_lagrange_factor, workspace->b_lagrange,
+        &workspace->rotated_b_lagrange, &workspace->lagrange_solution);
+    const Eigen::VectorBlock<Eigen::VectorXd> solution =
+        workspace->lagrange_solution.head(num_variables);
+
+    workspace->H_solution.resize(num_variables);
+    workspace->H_solution.noalias() = workspace->H * solution;
+    const double cost_dimension = solution.dot(workspace->H_solution) +
+                                  workspace->f.dot(solution);
+    if (cost_dimension > 1e20 || std::isnan(cost_dimension)) {
+      ROS_ERROR("[%s] Could not solve quadratic program.",
+                ros::this_node::getName().c_str());
+      trajectory->trajectory_type =
+          polynomial_trajectories::TrajectoryType::UNDEFINED;
+      return false;
+    }
+
+    trajectory->optimization_cost += cost_dimension;
+    for (int k = 0; k < num_segments; k++) {
+      trajectory->coeff[k].row(d) =
+          solution.segment(k * (poly_order + 1), poly_order + 1).transpose();
+    }
+  }
+
+  return true;
+}
+
 PolynomialTrajectory generateMinimumSnapTrajectory(
     const Eigen::VectorXd& initial_segment_times,
     const quadrotor_common::TrajectoryPoint& start_state,
@@ -132,51 +256,18 @@ PolynomialTrajectory generateMinimumSnapTrajectory(
     return PolynomialTrajectory();
   }
 
-  // Compute straight line distance of trajectory
-  double straight_line_distance = 0.0;
-  if (trajectory_settings.way_points.size() == 0) {
-    straight_line_distance = (end_state.position - start_state.position).norm();
-  } else {
-    straight_line_distance +=
-        (trajectory_settings.way_points.front() - start_state.position).norm();
-    straight_line_distance +=
-        (end_state.position - trajectory_settings.way_points.back()).norm();
-    for (int i = 0; i < trajectory_settings.way_points.size() - 1; i++) {
-      straight_line_distance += (trajectory_settings.way_points[i + 1] -
-                                 trajectory_settings.way_points[i])
-                                    .norm();
-    }
-  }
+  // Seed with jerk limited trapezoidal velocity profiles along the way points
+  // considering max velocity, max thrust and the turns at the way points
+  const Eigen::VectorXd seed_segment_times =
+      implementation::computeSeedSegmentTimes(
+          initial_segment_times,
+          computeInitialSegmentTimes(start_state, end_state,
+                                     trajectory_settings, max_velocity,
+                                     max_normalized_thrust,
+                                     max_roll_pitch_rate));
 
-  // Compute initial trajectory duration from a trapezoidal trajectory
-  // considering max velocity and max thrust
-  double init_trajectory_duration = straight_line_distance / max_velocity;
-  if ((end_state.position - start_state.position).norm() >= 0.01) {
-    double n_z = ((end_state.position - start_state.position).normalized()).z();
-    double acc_towards_s1_max = std::max(
-        -n_z * 9.81 + sqrt(9.81 * 9.81 * (n_z * n_z - 1.0) +
-                           max_normalized_thrust * max_normalized_thrust),
-        -n_z * 9.81 - sqrt(9.81 * 9.81 * (n_z * n_z - 1.0) +
-                           max_normalized_thrust * max_normalized_thrust));
-
-    if (max_velocity >= sqrt(acc_towards_s1_max * straight_line_distance)) {
-      init_trajectory_duration =
-          2 * sqrt(straight_line_distance / acc_towards_s1_max);
-    } else {
-      init_trajectory_duration = max_velocity / acc_towards_s1_max +
-                                 straight_line_distance / max_velocity;
-    }
-  }
-
-  const Eigen::VectorXd& bounds_violating_segment_times =
-      initial_segment_times / initial_segment_times.sum() *
-      init_trajectory_duration;
-
-  // Compute initial trajectory such that bounds on velocity and thrust must
-  // be violated
-  PolynomialTrajectory initial_trajectory =
-      generateMinimumSnapTrajectory(bounds_violating_segment_times, start_state,
-                                    end_state, trajectory_settings);
+  PolynomialTrajectory initial_trajectory = generateMinimumSnapTrajectory(
+      seed_segment_times, start_state, end_state, trajectory_settings);
 
   if (initial_trajectory.trajectory_type ==
       polynomial_trajectories::TrajectoryType::UNDEFINED) {
@@ -203,7 +294,7 @@ PolynomialTrajectory generateMinimumSnapTrajectoryWithSegmentRefinement(
       polynomial_trajectories::TrajectoryType::UNDEFINED) {
     return initial_trajectory;
   }
-  initial_trajectory.trajectory_type ==
+  initial_trajectory.trajectory_type =
       polynomial_trajectories::TrajectoryType::MINIMUM_SNAP_OPTIMIZED_SEGMENTS;
 
   if (trajectory_settings.way_points.empty()) {
@@ -216,16 +307,22 @@ PolynomialTrajectory generateMinimumSnapTrajectoryWithSegmentRefinement(
   std::vector<double> costs;
   costs.push_back(initial_trajectory.optimization_cost);
 
+  // The line search threads are kept for all refinement iterations
+  const std::unique_ptr<ThreadPool> line_search_thread_pool =
+      implementation::createLineSearchThreadPool(trajectory_settings);
+
   const int max_refinement_iterations = 20;
   for (int i = 0; i < max_refinement_iterations; i++) {
     Eigen::VectorXd gradient =
         implementation::computeCostGradient(trajectory, trajectory_settings);
 
     Eigen::VectorXd segment_times = implementation::updateSegmentTimes(
-        trajectory, gradient, trajectory_settings);
+        trajectory, gradient, trajectory_settings,
+        line_search_thread_pool.get());
 
     trajectory = generateMinimumSnapTrajectory(segment_times, start_state,
                                                end_state, trajectory_settings);
+    trajectory.trajectory_type = initial_trajectory.trajectory_type;
 
     if (fabs(costs.back() - trajectory.optimization_cost) < 1e-2) {
       costs.push_back(trajectory.optimization_cost);
@@ -258,52 +355,19 @@ PolynomialTrajectory generateMinimumSnapTrajectoryWithSegmentRefinement(
     return PolynomialTrajectory();
   }
 
-  // Compute straight line distance of trajectory
-  double straight_line_distance = 0.0;
-  if (trajectory_settings.way_points.size() == 0) {
-    straight_line_distance = (end_state.position - start_state.position).norm();
-  } else {
-    straight_line_distance +=
-        (trajectory_settings.way_points.front() - start_state.position).norm();
-    straight_line_distance +=
-        (end_state.position - trajectory_settings.way_points.back()).norm();
-    for (int i = 0; i < trajectory_settings.way_points.size() - 1; i++) {
-      straight_line_distance += (trajectory_settings.way_points[i + 1] -
-                                 trajectory_settings.way_points[i])
-                                    .norm();
-    }
-  }
-
-  // Compute initial trajectory duration from a trapezoidal trajectory
-  // considering max velocity and max thrust
-  double init_trajectory_duration = straight_line_distance / max_velocity;
-  if ((end_state.position - start_state.position).norm() >= 0.01) {
-    double n_z = ((end_state.position - start_state.position).normalized()).z();
-    double acc_towards_s1_max = std::max(
-        -n_z * 9.81 + sqrt(9.81 * 9.81 * (n_z * n_z - 1.0) +
-                           max_normalized_thrust * max_normalized_thrust),
-        -n_z * 9.81 - sqrt(9.81 * 9.81 * (n_z * n_z - 1.0) +
-                           max_normalized_thrust * max_normalized_thrust));
-
-    if (max_velocity >= sqrt(acc_towards_s1_max * straight_line_distance)) {
-      init_trajectory_duration =
-          2 * sqrt(straight_line_distance / acc_towards_s1_max);
-    } else {
-      init_trajectory_duration = max_velocity / acc_towards_s1_max +
-                                 straight_line_distance / max_velocity;
-    }
-  }
-
-  const Eigen::VectorXd& bounds_violating_segment_times =
-      initial_segment_times / initial_segment_times.sum() *
-      init_trajectory_duration;
+  // Seed with jerk limited trapezoidal velocity profiles along the way points
+  // considering max velocity, max thrust and the turns at the way points
+  const Eigen::VectorXd seed_segment_times =
+      implementation::computeSeedSegmentTimes(
+          initial_segment_times,
+          computeInitialSegmentTimes(start_state, end_state,
+                                     trajectory_settings, max_velocity,
+                                     max_normalized_thrust,
+                                     max_roll_pitch_rate));
 
-  // Compute initial trajectory such that bounds on velocity and thrust must
-  // be violated
   PolynomialTrajectory initial_trajectory =
       generateMinimumSnapTrajectoryWithSegmentRefinement(
-          bounds_violating_segment_times, start_state, end_state,
-          trajectory_settings);
+          seed_segment_times, start_state, end_state, trajectory_settings);
 
   if (initial_trajectory.trajectory_type ==
       polynomial_trajectories::TrajectoryType::UNDEFINED) {
@@ -318,9 +382,200 @@ PolynomialTrajectory generateMinimumSnapTrajectoryWithSegmentRefinement(
   return trajectory;
 }
 
+Eigen::VectorXd computeInitialSegmentTimes(
+    const quadrotor_common::TrajectoryPoint& start_state,
+    const quadrotor_common::TrajectoryPoint& end_state,
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const double max_velocity, const double max_normalized_thrust,
+    const double max_roll_pitch_rate) {
+  return implementation::computeJerkLimitedSegmentTimes(
+      implementation::addStartAndEndToWayPointList(
+          trajectory_settings.way_points, start_state.position,
+          end_state.position),
+      false, start_state.velocity.norm(), end_state.velocity.norm(),
+      max_velocity, max_normalized_thrust, max_roll_pitch_rate);
+}
+
+Eigen::VectorXd computeInitialRingSegmentTimes(
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const double max_velocity, const double max_normalized_thrust,
+    const double max_roll_pitch_rate) {
+  return implementation::computeJerkLimitedSegmentTimes(
+      trajectory_settings.way_points, true, 0.0, 0.0, max_velocity,
+      max_normalized_thrust, max_roll_pitch_rate);
+}
+
+// Shorter remainders of the current segment are merged with the next segment
+// when replanning
+static constexpr double kMinReplanningSegmentTime = 0.1;
+
+PolynomialTrajectory replanMinimumSnapTrajectory(
+    const PolynomialTrajectory& trajectory,
+    const ros::Duration& time_from_start,
+    const quadrotor_common::TrajectoryPoint& start_state,
+    const int horizon_segments,
+    const PolynomialTrajectorySettings& trajectory_settings) {
+  if (trajectory.trajectory_type !=
+          polynomial_trajectories::TrajectoryType::MINIMUM_SNAP &&
+      trajectory.trajectory_type != polynomial_trajectories::TrajectoryType::
+                                        MINIMUM_SNAP_OPTIMIZED_SEGMENTS) {
+    ROS_ERROR("[%s] Only open minimum snap trajectories can be replanned.",
+              ros::this_node::getName().c_str());
+    return PolynomialTrajectory();
+  }
+  if (horizon_segments < 1) {
+    ROS_ERROR("[%s] The replanning horizon needs at least one segment.",
+              ros::this_node::getName().c_str());
+    return PolynomialTrajectory();
+  }
+  const double time_eval = time_from_start.toSec();
+  if (time_eval < 0.0 || time_eval >= trajectory.T.toSec()) {
+    ROS_ERROR(
+        "[%s] Can not replan the trajectory at t = %f, it is defined for "
+        "t = [%f, %f).",
+        ros::this_node::getName().c_str(), time_eval, 0.0,
+        trajectory.T.toSec());
+    return PolynomialTrajectory();
+  }
+
+  const int num_segments = trajectory.number_of_segments;
+  // The heading is replanned together with the position if the trajectory
+  // has a heading dimension, also on horizons without a way point
+  const bool optimize_heading = trajectory.coeff.dimension() > 3;
+
+  // Figure out which segment is executed at time_from_start
+  int first_segment = 0;
+  double first_segment_end_time = trajectory.segment_times(0);
+  while (first_segment < num_segments - 1 &&
+         time_eval >= first_segment_end_time) {
+    first_segment++;
+    first_segment_end_time += trajectory.segment_times(first_segment);
+  }
+  const double remaining_time = first_segment_end_time - time_eval;
+
+  const bool merge_first_segment = remaining_time < kMinReplanningSegmentTime &&
+                                   first_segment < num_segments - 1;
+  const int last_segment =
+      std::min(first_segment + horizon_segments - (merge_first_segment ? 0 : 1),
+               num_segments - 1);
+
+  // Position, heading and their derivatives in normalized time
+  Eigen::Matrix<double, 4, 5> derivatives;
+
+  // Headings are not wrapped, so the heading way points are shifted by the
+  // multiple of 2 pi that brings the trajectory closest to the start heading
+  double heading_offset = 0.0;
+  if (optimize_heading) {
+    const double tau =
+        1.0 - remaining_time / trajectory.segment_times(first_segment);
+    evaluatePolynomialDerivatives(trajectory.coeff[first_segment], true, tau,
+                                  &derivatives);
+    heading_offset =
+        2.0 * M_PI *
+        std::round((start_state.heading - derivatives(3, 0)) / (2.0 * M_PI));
+  }
+
+  // Way points and segment times of the horizon
+  PolynomialTrajectorySettings horizon_settings = trajectory_settings;
+  horizon_settings.way_points.clear();
+  horizon_settings.heading_way_points.clear();
+  horizon_settings.optimize_heading = optimize_heading;
+  horizon_settings.corridor_lower_bounds.clear();
+  horizon_settings.corridor_upper_bounds.clear();
+  Eigen::VectorXd horizon_segment_times(last_segment - first_segment + 1 -
+                                        (merge_first_segment ? 1 : 0));
+  horizon_segment_times(0) = remaining_time;
+  int horizon_segment = 0;
+  for (int i = first_segment + 1; i <= last_segment; i++) {
+    if (i == first_segment + 1 && merge_first_segment) {
+      horizon_segment_times(0) += trajectory.segment_times(i);
+      continue;
+    }
+    evaluatePolynomialDerivatives(trajectory.coeff[i], true, 0.0,
+                                  &derivatives);
+    horizon_settings.way_points.push_back(derivatives.col(0).head<3>());
+    if (optimize_heading) {
+      horizon_settings.heading_way_points.push_back(derivatives(3, 0) +
+                                                    heading_offset);
+    }
+    horizon_segment_times(++horizon_segment) = trajectory.segment_times(i);
+  }
+
+  // End in the state where the kept segments start or in the end state of
+  // the trajectory if the horizon reaches it
+  const bool horizon_reaches_end = last_segment == num_segments - 1;
+  const int end_segment =
+      horizon_reaches_end ? last_segment : last_segment + 1;
+  const double end_tau_dot = 1.0 / trajectory.segment_times(end_segment);
+  evaluatePolynomialDerivatives(trajectory.coeff[end_segment], true,
+                                horizon_reaches_end ? 1.0 : 0.0, &derivatives);
+  quadrotor_common::TrajectoryPoint end_state;
+  end_state.position = derivatives.col(0).head<3>();
+  end_state.velocity = end_tau_dot * derivatives.col(1).head<3>();
+  end_state.acceleration =
+      pow(end_tau_dot, 2.0) * derivatives.col(2).head<3>();
+  end_state.jerk = pow(end_tau_dot, 3.0) * derivatives.col(3).head<3>();
+  end_state.heading = derivatives(3, 0) + heading_offset;
+  end_state.heading_rate = end_tau_dot * derivatives(3, 1);
+  end_state.heading_acceleration = pow(end_tau_dot, 2.0) * derivatives(3, 2);
+
+  const PolynomialTrajectory horizon_trajectory = generateMinimumSnapTrajectory(
+      horizon_segment_times, start_state, end_state, horizon_settings);
+  if (horizon_trajectory.trajectory_type ==
+      polynomial_trajectories::TrajectoryType::UNDEFINED) {
+    return PolynomialTrajectory();
+  }
+  if (horizon_trajectory.coeff.dimension() != trajectory.coeff.dimension()) {
+    ROS_ERROR(
+        "[%s] The replanned horizon has %d dimensions but the trajectory has "
+        "%d, can not append the kept segments.",
+        ros::this_node::getName().c_str(), horizon_trajectory.coeff.dimension(),
+        trajectory.coeff.dimension());
+    return PolynomialTrajectory();
+  }
+
+  // Append the kept segments
+  const int num_kept_segments = num_segments - 1 - last_segment;
+  PolynomialTrajectory replanned_trajectory = horizon_trajectory;
+  replanned_trajectory.trajectory_type = trajectory.trajectory_type;
+  replanned_trajectory.number_of_segments =
+      horizon_trajectory.number_of_segments + num_kept_segments;
+  replanned_trajectory.segment_times.resize(
+      replanned_trajectory.number_of_segments);
+  replanned_trajectory.segment_times.head(
+      horizon_trajectory.number_of_segments) =
+      horizon_trajectory.segment_times;
+  replanned_trajectory.segment_times.tail(num_kept_segments) =
+      trajectory.segment_times.tail(num_kept_segments);
+  // All segments share one size, so segments of a lower polynomial order are
+  // padded with zero coefficients for the highest powers
+  const int num_coefficients =
+      std::max(horizon_trajectory.coeff.numCoefficients(),
+               trajectory.coeff.numCoefficients());
+  replanned_trajectory.coeff.resize(replanned_trajectory.number_of_segments,
+                                    horizon_trajectory.coeff.dimension(),
+                                    num_coefficients);
+  replanned_trajectory.coeff.setZero();
+  for (int k = 0; k < replanned_trajectory.number_of_segments; k++) {
+    const PolynomialCoefficients::ConstSegmentMap segment =
+        k < horizon_trajectory.number_of_segments
+            ? horizon_trajectory.coeff[k]
+            : trajectory.coeff[k - horizon_trajectory.number_of_segments +
+                               num_segments - num_kept_segments];
+    replanned_trajectory.coeff[k].rightCols(segment.cols()) = segment;
+  }
+  replanned_trajectory.T =
+      ros::Duration(replanned_trajectory.segment_times.sum());
+  replanned_trajectory.end_state = trajectory.end_state;
+  replanned_trajectory.end_state.time_from_start = replanned_trajectory.T;
+
+  return replanned_trajectory;
+}
+
 PolynomialTrajectory generateMinimumSnapRingTrajectory(
     const Eigen::VectorXd& segment_times,
     const PolynomialTrajectorySettings& trajectory_settings) {
+  num_minimum_snap_solves++;
   if (trajectory_settings.way_points.size() <= 2) {
     ROS_ERROR(
         "[%s] To create a ring trajectory, at least 2 way points must be "
@@ -337,6 +592,16 @@ PolynomialTrajectory generateMinimumSnapRingTrajectory(
     return PolynomialTrajectory();
   }
 
+  const bool optimize_heading = trajectory_settings.optimize_heading ||
+                                !trajectory_settings.heading_way_points.empty();
+  if (optimize_heading && trajectory_settings.heading_way_points.size() !=
+                              trajectory_settings.way_points.size()) {
+    ROS_ERROR(
+        "[%s] Number of heading way points and way points are not agreeing.",
+        ros::this_node::getName().c_str());
+    return PolynomialTrajectory();
+  }
+
   if (trajectory_settings.way_points.size() <= 2) {
     ROS_ERROR(
         "[%s] To create a ring trajectory, at least 2 DISTINCT way points must "
@@ -358,9 +623,25 @@ PolynomialTrajectory generateMinimumSnapRingTrajectory(
   minimum_snap_trajectory.optimization_cost = 0.0;  // will be reset later on
   minimum_snap_trajectory.T = ros::Duration(segment_times.sum());
 
+  const bool corridors = !trajectory_settings.corridor_lower_bounds.empty() ||
+                         !trajectory_settings.corridor_upper_bounds.empty();
+  if (corridors && !implementation::areWayPointsInsideCorridors(
+                       trajectory_settings, num_segments, true)) {
+    ROS_ERROR(
+        "[%s] Need one corridor per segment that contains both end points of "
+        "the segment.",
+        ros::this_node::getName().c_str());
+    return PolynomialTrajectory();
+  }
+
   // Ensure trajectory settings that result in feasible optimization problem
   PolynomialTrajectorySettings new_trajectory_settings = trajectory_settings;
-  const int min_poly_order = trajectory_settings.continuity_order + 1;
+  const bool free_derivatives = !corridors &&
+                                trajectory_settings.minimum_snap_solver ==
+                                    MinimumSnapSolver::FREE_DERIVATIVES;
+  const int min_poly_order =
+      free_derivatives ? 2 * trajectory_settings.continuity_order + 1
+                       : trajectory_settings.continuity_order + 1;
   new_trajectory_settings = implementation::ensureFeasibleTrajectorySettings(
       trajectory_settings, min_poly_order);
 
@@ -377,29 +658,64 @@ PolynomialTrajectory generateMinimumSnapRingTrajectory(
   // Compute common matrices used for optimization later on
   Eigen::MatrixXd H = implementation::generateHMatrix(new_trajectory_settings,
                                                       num_segments, tau_dot);
-  Eigen::MatrixXd A_eq = implementation::generateRingEqualityConstraintsAMatrix(
-      new_trajectory_settings, num_segments, tau_dot);
+  Eigen::MatrixXd A_eq;
+  Eigen::MatrixXd A_ineq;
+  std::vector<Eigen::MatrixXd> segment_solution_maps;
+  if (free_derivatives) {
+    segment_solution_maps = implementation::generateSegmentSolutionMaps(
+        new_trajectory_settings, num_segments, tau_dot, H);
+  } else {
+    A_eq = implementation::generateRingEqualityConstraintsAMatrix(
+        new_trajectory_settings, num_segments, tau_dot);
+  }
+  if (corridors) {
+    A_ineq = implementation::generateCorridorConstraintsAMatrix(
+        new_trajectory_settings, num_segments);
+  }
 
   std::vector<Eigen::MatrixXd> coefficients;
-  // Compute trajectory for each spatial dimension
-  for (int d = 0; d < 3; d++) {
+  // Compute trajectory for each spatial dimension and the heading
+  const int num_dimensions = optimize_heading ? 4 : 3;
+  for (int d = 0; d < num_dimensions; d++) {
     Eigen::VectorXd way_points_d = Eigen::VectorXd::Zero(num_waypoints);
     for (int i = 0; i < num_waypoints; i++) {
-      Eigen::VectorXd way_point_i = trajectory_settings.way_points[i];
-      way_points_d(i) = way_point_i(d);
+      if (d < 3) {
+        Eigen::VectorXd way_point_i = trajectory_settings.way_points[i];
+        way_points_d(i) = way_point_i(d);
+      } else {
+        way_points_d(i) = trajectory_settings.heading_way_points[i];
+      }
     }
 
     Eigen::MatrixXd coefficients_for_this_dimension;
     Eigen::VectorXd f = implementation::generateFVector(
         new_trajectory_settings, way_points_d, num_segments);
-    Eigen::VectorXd b_eq =
-        implementation::generateRingEqualityConstraintsBVector(
-            new_trajectory_settings, num_segments, way_points_d);
 
     double cost_dimension;
-    coefficients_for_this_dimension = implementation::generate1DTrajectory(
-        num_segments, new_trajectory_settings.polynomial_order, H, f, A_eq,
-        b_eq, &cost_dimension);
+    if (free_derivatives) {
+      coefficients_for_this_dimension =
+          implementation::generate1DTrajectoryFreeDerivatives(
+              new_trajectory_settings, segment_solution_maps, H, f,
+              way_points_d, Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero(),
+              true, &cost_dimension);
+    } else {
+      Eigen::VectorXd b_eq =
+          implementation::generateRingEqualityConstraintsBVector(
+              new_trajectory_settings, num_segments, way_points_d);
+      if (corridors && d < 3) {
+        coefficients_for_this_dimension =
+            implementation::generate1DTrajectoryInCorridor(
+                num_segments, new_trajectory_settings.polynomial_order, H, f,
+                A_eq, b_eq, A_ineq,
+                implementation::generateCorridorConstraintsBVector(
+                    new_trajectory_settings, num_segments, d),
+                &cost_dimension);
+      } else {
+        coefficients_for_this_dimension = implementation::generate1DTrajectory(
+            num_segments, new_trajectory_settings.polynomial_order, H, f, A_eq,
+            b_eq, &cost_dimension);
+      }
+    }
     if (cost_dimension > 1e20 || std::isnan(cost_dimension)) {
       ROS_ERROR("[%s] Could not solve quadratic program.",
                 ros::this_node::getName().c_str());
@@ -433,24 +749,16 @@ PolynomialTrajectory generateMinimumSnapRingTrajectory(
     const PolynomialTrajectorySettings& trajectory_settings,
     const double max_velocity, const double max_normalized_thrust,
     const double max_roll_pitch_rate) {
-  // Compute initial trajectory such that bounds on velocity and thrust must
-  // be violated
-  double straight_line_distance = 0.0;
-  for (int i = 0; i < trajectory_settings.way_points.size() - 1; i++) {
-    straight_line_distance += (trajectory_settings.way_points[i + 1] -
-                               trajectory_settings.way_points[i])
-                                  .norm();
-  }
-  straight_line_distance += (trajectory_settings.way_points.front() -
-                             trajectory_settings.way_points.back())
-                                .norm();
-
-  const Eigen::VectorXd& bounds_violating_segment_times =
-      initial_segment_times / initial_segment_times.sum() *
-      straight_line_distance / max_velocity;
+  // Seed with jerk limited trapezoidal velocity profiles around the ring
+  const Eigen::VectorXd seed_segment_times =
+      implementation::computeSeedSegmentTimes(
+          initial_segment_times,
+          computeInitialRingSegmentTimes(trajectory_settings, max_velocity,
+                                         max_normalized_thrust,
+                                         max_roll_pitch_rate));
 
   PolynomialTrajectory initial_trajectory = generateMinimumSnapRingTrajectory(
-      bounds_violating_segment_times, trajectory_settings);
+      seed_segment_times, trajectory_settings);
 
   if (initial_trajectory.trajectory_type ==
       polynomial_trajectories::TrajectoryType::UNDEFINED) {
@@ -476,7 +784,7 @@ PolynomialTrajectory generateMinimumSnapRingTrajectoryWithSegmentRefinement(
       polynomial_trajectories::TrajectoryType::UNDEFINED) {
     return initial_trajectory;
   }
-  initial_trajectory.trajectory_type ==
+  initial_trajectory.trajectory_type =
       polynomial_trajectories::TrajectoryType::
           MINIMUM_SNAP_RING_OPTIMIZED_SEGMENTS;
 
@@ -490,16 +798,22 @@ PolynomialTrajectory generateMinimumSnapRingTrajectoryWithSegmentRefinement(
   std::vector<double> costs;
   costs.push_back(initial_trajectory.optimization_cost);
 
+  // The line search threads are kept for all refinement iterations
+  const std::unique_ptr<ThreadPool> line_search_thread_pool =
+      implementation::createLineSearchThreadPool(trajectory_settings);
+
   const int max_refinement_iterations = 20;
   for (int i = 0; i < max_refinement_iterations; i++) {
     Eigen::VectorXd gradient =
         implementation::computeCostGradient(trajectory, trajectory_settings);
 
     Eigen::VectorXd segment_times = implementation::updateSegmentTimes(
-        trajectory, gradient, trajectory_settings);
+        trajectory, gradient, trajectory_settings,
+        line_search_thread_pool.get());
 
     trajectory =
         generateMinimumSnapRingTrajectory(segment_times, trajectory_settings);
+    trajectory.trajectory_type = initial_trajectory.trajectory_type;
 
     if (fabs(costs.back() - trajectory.optimization_cost) < 1e-2) {
       costs.push_back(trajectory.optimization_cost);
@@ -518,25 +832,18 @@ PolynomialTrajectory generateMinimumSnapRingTrajectoryWithSegmentRefinement(
     const PolynomialTrajectorySettings& trajectory_settings,
     const double max_velocity, const double max_normalized_thrust,
     const double max_roll_pitch_rate) {
-  // Compute initial trajectory such that bounds on velocity and thrust must
-  // be violated
-  double straight_line_distance = 0.0;
-  for (int i = 0; i < trajectory_settings.way_points.size() - 1; i++) {
-    straight_line_distance += (trajectory_settings.way_points[i + 1] -
-                               trajectory_settings.way_points[i])
-                                  .norm();
-  }
-  straight_line_distance += (trajectory_settings.way_points.front() -
-                             trajectory_settings.way_points.back())
-                                .norm();
-
-  const Eigen::VectorXd& bounds_violating_segment_times =
-      initial_segment_times / initial_segment_times.sum() *
-      straight_line_distance / max_velocity;
+  // Seed with jerk limited trapezoidal velocity profiles around the ring
+  // considering max velocity, max thrust and the turns at the way points
+  const Eigen::VectorXd seed_segment_times =
+      implementation::computeSeedSegmentTimes(
+          initial_segment_times,
+          computeInitialRingSegmentTimes(trajectory_settings, max_velocity,
+                                         max_normalized_thrust,
+                                         max_roll_pitch_rate));
 
   PolynomialTrajectory initial_trajectory =
       generateMinimumSnapRingTrajectoryWithSegmentRefinement(
-          bounds_violating_segment_times, trajectory_settings);
+          seed_segment_times, trajectory_settings);
 
   if (initial_trajectory.trajectory_type ==
       polynomial_trajectories::TrajectoryType::UNDEFINED) {
@@ -551,8 +858,49 @@ PolynomialTrajectory generateMinimumSnapRingTrajectoryWithSegmentRefinement(
   return trajectory;
 }
 
+std::vector<PolynomialTrajectory> generateMinimumSnapTrajectories(
+    const std::vector<MinimumSnapTrajectoryProblem>& problems,
+    const int num_threads) {
+  std::vector<PolynomialTrajectory> trajectories(problems.size());
+
+  // Threads take the next unsolved problem once they are done, so problems
+  // of different sizes are balanced between them
+  ThreadPool thread_pool(std::max(num_threads, 1) - 1);
+  thread_pool.parallelFor(problems.size(), [&](const int i) {
+    trajectories[i] = generateMinimumSnapTrajectory(problems[i]);
+  });
+
+  return trajectories;
+}
+
+PolynomialTrajectory generateMinimumSnapTrajectory(
+    const MinimumSnapTrajectoryProblem& problem) {
+  if (problem.segment_refinement && problem.enforce_maxima) {
+    return generateMinimumSnapTrajectoryWithSegmentRefinement(
+        problem.segment_times, problem.start_state, problem.end_state,
+        problem.trajectory_settings, problem.max_velocity,
+        problem.max_normalized_thrust, problem.max_roll_pitch_rate);
+  }
+  if (problem.segment_refinement) {
+    return generateMinimumSnapTrajectoryWithSegmentRefinement(
+        problem.segment_times, problem.start_state, problem.end_state,
+        problem.trajectory_settings);
+  }
+  if (problem.enforce_maxima) {
+    return generateMinimumSnapTrajectory(
+        problem.segment_times, problem.start_state, problem.end_state,
+        problem.trajectory_settings, problem.max_velocity,
+        problem.max_normalized_thrust, problem.max_roll_pitch_rate);
+  }
+  return generateMinimumSnapTrajectory(problem.segment_times,
+                                       problem.start_state, problem.end_state,
+                                       problem.trajectory_settings);
+}
+
 namespace implementation {
 
+static constexpr int kMaxCachedPolynomialOrder = 15;
+
 Eigen::MatrixXd generate1DTrajectory(const int num_polynoms,
                                      const int polynomial_order,
                                      const Eigen::MatrixXd& H,
@@ -571,117 +919,610 @@ Eigen::MatrixXd generate1DTrajectory(const int num_polynoms,
   return coefficients;
 }
 
+Eigen::MatrixXd generate1DTrajectoryInCorridor(
+    const int num_polynoms, const int polynomial_order,
+    const Eigen::MatrixXd& H, const Eigen::VectorXd& f,
+    const Eigen::MatrixXd& A_eq, const Eigen::VectorXd& b_eq,
+    const Eigen::MatrixXd& A_ineq, const Eigen::VectorXd& b_ineq,
+    double* optimization_cost) {
+  Eigen::VectorXd solution;
+  if (!solveActiveSetQuadraticProgram(H, f, A_eq, b_eq, A_ineq, b_ineq,
+                                      nullptr, &solution, optimization_cost)) {
+    // Reported as failure by the caller
+    *optimization_cost = std::numeric_limits<double>::quiet_NaN();
+    return Eigen::MatrixXd::Zero(num_polynoms, polynomial_order + 1);
+  }
+
+  Eigen::MatrixXd coefficients;
+  coefficients = Eigen::Map<Eigen::MatrixXd>(
+      solution.data(), polynomial_order + 1, num_polynoms);
+  coefficients.transposeInPlace();
+
+  return coefficients;
+}
+
+Eigen::MatrixXd generate1DTrajectoryFreeDerivatives(
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const std::vector<Eigen::MatrixXd>& segment_solution_maps,
+    const Eigen::MatrixXd& H, const Eigen::VectorXd& f,
+    const Eigen::VectorXd& way_points_1D,
+    const Eigen::Vector3d& start_conditions,
+    const Eigen::Vector3d& end_conditions, const bool ring_trajectory,
+    double* optimization_cost) {
+  // Every segment is parametrized by the position and the derivatives up to
+  // the continuity order at its start and end point. Positions and the
+  // derivatives at the start and end of open trajectories are fixed, the
+  // remaining derivatives are shared between adjacent segments and are the
+  // only optimization variables. Since each of them only appears in the two
+  // adjacent segments, the resulting system is block tridiagonal (cyclic for
+  // ring trajectories)
+  const int num_polynoms = segment_solution_maps.size();
+  const std::vector<Eigen::MatrixXd> segment_hessians =
+      splitBlockDiagonalMatrix(H, num_polynoms);
+  std::vector<Eigen::MatrixXd> segment_cost_matrices;
+  for (int k = 0; k < num_polynoms; k++) {
+    segment_cost_matrices.push_back(generateSegmentCostMatrix(
+        segment_solution_maps[k], segment_hessians[k]));
+  }
+
+  Eigen::MatrixXd way_point_values = generateFixedWayPointValues(
+      trajectory_settings, way_points_1D, start_conditions, end_conditions,
+      ring_trajectory);
+
+  std::vector<Eigen::MatrixXd> diagonal_blocks;
+  std::vector<Eigen::MatrixXd> lower_blocks;
+  generateFreeDerivativesSystem(segment_cost_matrices, ring_trajectory,
+                                &diagonal_blocks, &lower_blocks);
+  const Eigen::VectorXd rhs = generateFreeDerivativesRhs(
+      segment_solution_maps, segment_hessians, segment_cost_matrices, f,
+      way_point_values, ring_trajectory);
+
+  Eigen::VectorXd free_derivatives;
+  bool solved = true;
+  if (ring_trajectory) {
+    // The cyclic coupling breaks the tridiagonal structure, so the (still
+    // small) reduced system is solved densely
+    const int num_blocks = diagonal_blocks.size();
+    const int block_size = trajectory_settings.continuity_order;
+    Eigen::MatrixXd M = Eigen::MatrixXd::Zero(rhs.size(), rhs.size());
+    for (int i = 0; i < num_blocks; i++) {
+      const int j = (i + num_blocks - 1) % num_blocks;
+      M.block(i * block_size, i * block_size, block_size, block_size) +=
+          diagonal_blocks[i];
+      M.block(i * block_size, j * block_size, block_size, block_size) +=
+          lower_blocks[i];
+      M.block(j * block_size, i * block_size, block_size, block_size) +=
+          lower_blocks[i].transpose();
+    }
+    const Eigen::LLT<Eigen::MatrixXd> llt(M);
+    solved = llt.info() == Eigen::Success;
+    free_derivatives = llt.solve(rhs);
+  } else if (!diagonal_blocks.empty()) {
+    solved = solveBlockTridiagonalSystem(diagonal_blocks, lower_blocks, rhs,
+                                         &free_derivatives);
+  }
+
+  if (!solved) {
+    *optimization_cost = std::numeric_limits<double>::infinity();
+    return Eigen::MatrixXd::Zero(num_polynoms,
+                                 trajectory_settings.polynomial_order + 1);
+  }
+
+  setFreeWayPointDerivatives(free_derivatives, ring_trajectory,
+                             &way_point_values);
+
+  return generateFreeDerivativesCoefficients(segment_solution_maps,
+                                             segment_hessians, f,
+                                             way_point_values,
+                                             optimization_cost);
+}
+
+Eigen::MatrixXd generateFixedWayPointValues(
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const Eigen::VectorXd& way_points_1D,
+    const Eigen::Vector3d& start_conditions,
+    const Eigen::Vector3d& end_conditions, const bool ring_trajectory) {
+  // Each column contains the position and the derivatives at one way point,
+  // free derivatives are zero until they are solved for
+  const int continuity_order = trajectory_settings.continuity_order;
+  const int num_way_points = way_points_1D.size();
+
+  Eigen::MatrixXd way_point_values =
+      Eigen::MatrixXd::Zero(continuity_order + 1, num_way_points);
+  way_point_values.row(0) = way_points_1D.transpose();
+  if (!ring_trajectory) {
+    for (int k = 0; k < std::min(continuity_order, 3); k++) {
+      way_point_values(k + 1, 0) = start_conditions(k);
+      way_point_values(k + 1, num_way_points - 1) = end_conditions(k);
+    }
+  }
+
+  return way_point_values;
+}
+
+void generateFreeDerivativesSystem(
+    const std::vector<Eigen::MatrixXd>& segment_cost_matrices,
+    const bool ring_trajectory, std::vector<Eigen::MatrixXd>* diagonal_blocks,
+    std::vector<Eigen::MatrixXd>* lower_blocks) {
+  // lower_blocks[i] couples free way point i with free way point i - 1, for
+  // ring trajectories the first one couples the first and the last way point
+  const int num_polynoms = segment_cost_matrices.size();
+  const int num_end_point_values = segment_cost_matrices.front().rows() / 2;
+  const int continuity_order = num_end_point_values - 1;
+  const int num_free_way_points =
+      ring_trajectory ? num_polynoms : num_polynoms - 1;
+
+  diagonal_blocks->assign(
+      num_free_way_points,
+      Eigen::MatrixXd::Zero(continuity_order, continuity_order));
+  lower_blocks->assign(
+      num_free_way_points,
+      Eigen::MatrixXd::Zero(continuity_order, continuity_order));
+
+  for (int k = 0; k < num_polynoms; k++) {
+    const Eigen::MatrixXd& Q = segment_cost_matrices[k];
+    // Free way point indices of the segment's start and end, -1 if fixed
+    const int start_index = ring_trajectory ? k : k - 1;
+    const int end_index = ring_trajectory
+                              ? (k + 1) % num_polynoms
+                              : (k + 1 < num_polynoms ? k : -1);
+
+    if (start_index >= 0) {
+      (*diagonal_blocks)[start_index] +=
+          Q.block(1, 1, continuity_order, continuity_order);
+    }
+    if (end_index >= 0) {
+      (*diagonal_blocks)[end_index] +=
+          Q.block(num_end_point_values + 1, num_end_point_values + 1,
+                  continuity_order, continuity_order);
+    }
+    if (start_index >= 0 && end_index >= 0) {
+      (*lower_blocks)[end_index] += Q.block(
+          num_end_point_values + 1, 1, continuity_order, continuity_order);
+    }
+  }
+}
+
+Eigen::VectorXd generateFreeDerivativesRhs(
+    const std::vector<Eigen::MatrixXd>& segment_solution_maps,
+    const std::vector<Eigen::MatrixXd>& segment_hessians,
+    const std::vector<Eigen::MatrixXd>& segment_cost_matrices,
+    const Eigen::VectorXd& f, const Eigen::MatrixXd& way_point_values,
+    const bool ring_trajectory) {
+  const int num_polynoms = segment_solution_maps.size();
+  const int num_coefficients = segment_hessians.front().rows();
+  const int num_end_point_values = way_point_values.rows();
+  const int continuity_order = num_end_point_values - 1;
+  const int num_way_points = way_point_values.cols();
+  const int num_free_way_points =
+      ring_trajectory ? num_polynoms : num_polynoms - 1;
+
+  Eigen::VectorXd rhs =
+      Eigen::VectorXd::Zero(continuity_order * num_free_way_points);
+  for (int k = 0; k < num_polynoms; k++) {
+    const Eigen::MatrixXd& H_k = segment_hessians[k];
+    const Eigen::MatrixXd& Q = segment_cost_matrices[k];
+    const Eigen::VectorXd f_k =
+        f.segment(k * num_coefficients, num_coefficients);
+
+    // Coefficients as a function of the end point values: c = G * e + g
+    // The cost of the segment is then e' * Q * e + q' * e + const
+    const Eigen::MatrixXd G =
+        segment_solution_maps[k].rightCols(2 * num_end_point_values);
+    const Eigen::VectorXd g =
+        -segment_solution_maps[k].leftCols(num_coefficients) * f_k;
+    const Eigen::VectorXd q = G.transpose() * (2.0 * H_k * g + f_k);
+
+    Eigen::VectorXd fixed_end_point_values(2 * num_end_point_values);
+    fixed_end_point_values << way_point_values.col(k),
+        way_point_values.col((k + 1) % num_way_points);
+    const Eigen::VectorXd segment_rhs =
+        -(0.5 * q + Q * fixed_end_point_values);
+
+    const int start_index = ring_trajectory ? k : k - 1;
+    const int end_index = ring_trajectory
+                              ? (k + 1) % num_polynoms
+                              : (k + 1 < num_polynoms ? k : -1);
+    if (start_index >= 0) {
+      rhs.segment(start_index * continuity_order, continuity_order) +=
+          segment_rhs.segment(1, continuity_order);
+    }
+    if (end_index >= 0) {
+      rhs.segment(end_index * continuity_order, continuity_order) +=
+          segment_rhs.segment(num_end_point_values + 1, continuity_order);
+    }
+  }
+
+  return rhs;
+}
+
+void setFreeWayPointDerivatives(const Eigen::VectorXd& free_derivatives,
+                                const bool ring_trajectory,
+                                Eigen::MatrixXd* way_point_values) {
+  const int continuity_order = way_point_values->rows() - 1;
+  const int num_free_way_points = free_derivatives.size() / continuity_order;
+
+  for (int i = 0; i < num_free_way_points; i++) {
+    const int way_point = ring_trajectory ? i : i + 1;
+    way_point_values->block(1, way_point, continuity_order, 1) =
+        free_derivatives.segment(i * continuity_order, continuity_order);
+  }
+}
+
+Eigen::MatrixXd generateFreeDerivativesCoefficients(
+    const std::vector<Eigen::MatrixXd>& segment_solution_maps,
+    const std::vector<Eigen::MatrixXd>& segment_hessians,
+    const Eigen::VectorXd& f, const Eigen::MatrixXd& way_point_values,
+    double* optimization_cost) {
+  const int num_polynoms = segment_solution_maps.size();
+  const int num_coefficients = segment_hessians.front().rows();
+  const int num_end_point_values = way_point_values.rows();
+  const int num_way_points = way_point_values.cols();
+
+  Eigen::MatrixXd coefficients(num_polynoms, num_coefficients);
+  *optimization_cost = 0.0;
+  for (int k = 0; k < num_polynoms; k++) {
+    const Eigen::VectorXd f_k =
+        f.segment(k * num_coefficients, num_coefficients);
+    Eigen::VectorXd rhs_k(num_coefficients + 2 * num_end_point_values);
+    rhs_k << -f_k, way_point_values.col(k),
+        way_point_values.col((k + 1) % num_way_points);
+    const Eigen::VectorXd c_k = segment_solution_maps[k] * rhs_k;
+
+    coefficients.row(k) = c_k.transpose();
+    *optimization_cost += c_k.dot(segment_hessians[k] * c_k) + f_k.dot(c_k);
+  }
+
+  return coefficients;
+}
+
+std::vector<Eigen::MatrixXd> generateSegmentSolutionMaps(
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const int num_polynoms, const Eigen::VectorXd& tau_dot,
+    const Eigen::MatrixXd& H) {
+  const std::vector<Eigen::MatrixXd> segment_hessians =
+      splitBlockDiagonalMatrix(H, num_polynoms);
+
+  std::vector<Eigen::MatrixXd> segment_solution_maps;
+  for (int k = 0; k < num_polynoms; k++) {
+    segment_solution_maps.push_back(generateSegmentSolutionMap(
+        trajectory_settings, tau_dot(k), segment_hessians[k]));
+  }
+
+  return segment_solution_maps;
+}
+
+Eigen::MatrixXd generateSegmentSolutionMap(
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const double tau_dot, const Eigen::MatrixXd& H_k) {
+  // The map W solves the segment's equality constrained problem for given
+  // end point values e such that c = W * [-f_k; e]
+  // The problem is solved in the null space of the end point constraints
+  // E * c = e rather than through its KKT system, which is badly scaled for
+  // short segments. With E' = [Q1 Q2] * [R; 0] the coefficients are
+  // c = Q1 * R^-T * e + Q2 * z where z minimizes the remaining cost
+  const int poly_order = trajectory_settings.polynomial_order;
+  const int num_end_point_values = trajectory_settings.continuity_order + 1;
+  const int num_constraints = 2 * num_end_point_values;
+  const int num_interior_values = poly_order + 1 - num_constraints;
+
+  // Rows of E are normalized since the derivatives scale very differently
+  const Eigen::MatrixXd E = generateEndPointDerivativesMatrix(
+      poly_order, trajectory_settings.continuity_order, tau_dot);
+  const Eigen::VectorXd row_scales = E.rowwise().norm().cwiseInverse();
+
+  const Eigen::HouseholderQR<Eigen::MatrixXd> qr(
+      (row_scales.asDiagonal() * E).transpose());
+  const Eigen::MatrixXd Q = qr.householderQ();
+  const Eigen::MatrixXd Q2 = Q.rightCols(num_interior_values);
+  const Eigen::MatrixXd particular_map =
+      qr.matrixQR()
+          .topRows(num_constraints)
+          .triangularView<Eigen::Upper>()
+          .solve(Q.leftCols(num_constraints).transpose())
+          .transpose() *
+      row_scales.asDiagonal();
+
+  Eigen::MatrixXd W =
+      Eigen::MatrixXd::Zero(poly_order + 1, poly_order + 1 + num_constraints);
+  W.rightCols(num_constraints) = particular_map;
+  if (num_interior_values > 0) {
+    // Multiplying with Q2 last keeps the correction in the null space of E
+    const Eigen::LLT<Eigen::MatrixXd> reduced_hessian_llt(
+        2.0 * Q2.transpose() * H_k * Q2);
+    W.leftCols(poly_order + 1) =
+        Q2 * reduced_hessian_llt.solve(Q2.transpose());
+    W.rightCols(num_constraints) -=
+        Q2 * reduced_hessian_llt.solve(Q2.transpose() *
+                                       (2.0 * H_k * particular_map));
+  }
+
+  return W;
+}
+
+Eigen::MatrixXd generateSegmentCostMatrix(
+    const Eigen::MatrixXd& segment_solution_map, const Eigen::MatrixXd& H_k) {
+  // Quadratic part of the segment cost as a function of its end point values
+  const int num_coefficients = H_k.rows();
+  const Eigen::MatrixXd G = segment_solution_map.rightCols(
+      segment_solution_map.cols() - num_coefficients);
+
+  return G.transpose() * H_k * G;
+}
+
+std::vector<Eigen::MatrixXd> splitBlockDiagonalMatrix(
+    const Eigen::MatrixXd& matrix, const int num_blocks) {
+  const int block_size = matrix.rows() / num_blocks;
+
+  std::vector<Eigen::MatrixXd> blocks;
+  for (int k = 0; k < num_blocks; k++) {
+    blocks.push_back(
+        matrix.block(k * block_size, k * block_size, block_size, block_size));
+  }
+
+  return blocks;
+}
+
+Eigen::MatrixXd generateEndPointDerivativesMatrix(const int poly_order,
+                                                  const int continuity_order,
+                                                  const double tau_dot) {
+  // Maps the coefficients of one segment to its position and derivatives up
+  // to the continuity order at the start (first rows) and at the end (last
+  // rows) of the segment
+  Eigen::MatrixXd E =
+      Eigen::MatrixXd::Zero(2 * (continuity_order + 1), poly_order + 1);
+
+  for (int k = 0; k < continuity_order + 1; k++) {
+    for (int i = 0; i < poly_order + 1; i++) {
+      const int power = poly_order - i;
+      if (power < k) {
+        continue;
+      }
+      double factor = 1.0;
+      for (int j = 0; j < k; j++) {
+        factor *= power - j;
+      }
+      if (power == k) {
+        E(k, i) = factor * pow(tau_dot, k);
+      }
+      E(continuity_order + 1 + k, i) = factor * pow(tau_dot, k);
+    }
+  }
+
+  return E;
+}
+
+bool solveBlockTridiagonalSystem(
+    const std::vector<Eigen::MatrixXd>& diagonal_blocks,
+    const std::vector<Eigen::MatrixXd>& lower_blocks,
+    const Eigen::VectorXd& rhs, Eigen::VectorXd* solution) {
+  std::vector<Eigen::LLT<Eigen::MatrixXd>> diagonal_factors;
+  std::vector<Eigen::MatrixXd> lower_factors;
+  if (!factorBlockTridiagonalSystem(diagonal_blocks, lower_blocks, 0,
+                                    &diagonal_factors, &lower_factors)) {
+    return false;
+  }
+
+  *solution = solveFactoredBlockTridiagonalSystem(diagonal_factors,
+                                                  lower_factors, rhs);
+
+  return true;
+}
+
+bool factorBlockTridiagonalSystem(
+    const std::vector<Eigen::MatrixXd>& diagonal_blocks,
+    const std::vector<Eigen::MatrixXd>& lower_blocks, const int first_block,
+    std::vector<Eigen::LLT<Eigen::MatrixXd>>* diagonal_factors,
+    std::vector<Eigen::MatrixXd>* lower_factors) {
+  // Block Cholesky factorization M = L * L' where L is lower block
+  // bidiagonal, computed in time linear in the number of blocks
+  // lower_blocks[i] is the block coupling row i with column i - 1
+  // The factors of the blocks before first_block only depend on the blocks
+  // before it and are kept, which allows to refactor after local changes
+  const int num_blocks = diagonal_blocks.size();
+  diagonal_factors->resize(num_blocks);
+  lower_factors->resize(num_blocks);
+
+  for (int i = std::max(first_block, 0); i < num_blocks; i++) {
+    Eigen::MatrixXd schur_complement = diagonal_blocks[i];
+    if (i > 0) {
+      (*lower_factors)[i] = (*diagonal_factors)[i - 1]
+                                .matrixL()
+                                .solve(lower_blocks[i].transpose())
+                                .transpose();
+      schur_complement -=
+          (*lower_factors)[i] * (*lower_factors)[i].transpose();
+    }
+    (*diagonal_factors)[i].compute(schur_complement);
+    if ((*diagonal_factors)[i].info() != Eigen::Success) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+Eigen::VectorXd solveFactoredBlockTridiagonalSystem(
+    const std::vector<Eigen::LLT<Eigen::MatrixXd>>& diagonal_factors,
+    const std::vector<Eigen::MatrixXd>& lower_factors,
+    const Eigen::VectorXd& rhs) {
+  const int num_blocks = diagonal_factors.size();
+  if (num_blocks == 0) {
+    return Eigen::VectorXd();
+  }
+  const int block_size = rhs.size() / num_blocks;
+
+  // Forward substitution
+  Eigen::VectorXd y(rhs.size());
+  for (int i = 0; i < num_blocks; i++) {
+    Eigen::VectorXd y_i = rhs.segment(i * block_size, block_size);
+    if (i > 0) {
+      y_i -= lower_factors[i] * y.segment((i - 1) * block_size, block_size);
+    }
+    y.segment(i * block_size, block_size) =
+        diagonal_factors[i].matrixL().solve(y_i);
+  }
+
+  // Backward substitution
+  Eigen::VectorXd solution(rhs.size());
+  for (int i = num_blocks - 1; i >= 0; i--) {
+    Eigen::VectorXd x_i = y.segment(i * block_size, block_size);
+    if (i < num_blocks - 1) {
+      x_i -= lower_factors[i + 1].transpose() *
+             solution.segment((i + 1) * block_size, block_size);
+    }
+    solution.segment(i * block_size, block_size) =
+        diagonal_factors[i].matrixU().solve(x_i);
+  }
+
+  return solution;
+}
+
 Eigen::MatrixXd generateHMatrix(
     const PolynomialTrajectorySettings& trajectory_settings,
     const int num_polynoms, const Eigen::VectorXd& tau_dot) {
+  Eigen::MatrixXd H;
+  generateHMatrix(trajectory_settings, num_polynoms, tau_dot, &H);
+  return H;
+}
+
+void generateHMatrix(const PolynomialTrajectorySettings& trajectory_settings,
+                     const int num_polynoms, const Eigen::VectorXd& tau_dot,
+                     Eigen::MatrixXd* H) {
   // up to which order derivatives should be minimized
   const int k_r = trajectory_settings.minimization_weights.size() - 1;
   const int poly_order = trajectory_settings.polynomial_order;
 
-  // Some factorials we are going to use multiple times
-  Eigen::VectorXd factorials = Eigen::VectorXd::Ones(poly_order + 1);
-  for (int i = 2; i < poly_order + 1; i++) {
-    factorials(i) = i * factorials(i - 1);
-  }
+  // The basis blocks only depend on the polynomial and derivative order, so
+  // they are computed once for all commonly used polynomial orders
+  static const std::vector<std::vector<Eigen::MatrixXd>> basis_blocks =
+      computeHessianBasisBlocks(kMaxCachedPolynomialOrder);
 
   // Initialize zero H matrix
-  Eigen::MatrixXd H = Eigen::MatrixXd::Zero((poly_order + 1) * num_polynoms,
-                                            (poly_order + 1) * num_polynoms);
+  H->setZero((poly_order + 1) * num_polynoms, (poly_order + 1) * num_polynoms);
 
   // Create the H matrix
   for (int hh = 0; hh < std::min(poly_order, k_r + 1); hh++) {
-    if (trajectory_settings.minimization_weights(hh) != 0.0) {
-      const int num_terms = poly_order - hh + 1;
-
-      // Create a basis matrix which is used for computations later on
-      Eigen::MatrixXd H_basis = Eigen::MatrixXd::Zero(num_terms, num_terms);
-      for (int i = 0; i < num_terms; i++) {
-        for (int j = 0; j < num_terms; j++) {
-          double numerator =
-              factorials(poly_order - i) / factorials(poly_order - i - hh) *
-              factorials(poly_order - j) / factorials(poly_order - j - hh);
-          double denominator = 2.0 * (poly_order - hh) + 1 - i - j;
-          H_basis(i, j) = numerator / denominator;
-        }
-      }
+    const double weight = trajectory_settings.minimization_weights(hh);
+    if (weight == 0.0) {
+      continue;
+    }
 
-      // Create another basis matrix
-      Eigen::MatrixXd H_times = Eigen::MatrixXd::Zero(num_terms, num_terms);
-      for (int i = 0; i < num_terms; i++) {
-        for (int j = 0; j < num_terms; j++) {
-          H_times(i, j) = 1.0;
-        }
-      }
+    Eigen::MatrixXd uncached_basis_block;
+    if (poly_order > kMaxCachedPolynomialOrder) {
+      uncached_basis_block = computeHessianBasisBlock(poly_order, hh);
+    }
+    const Eigen::MatrixXd& H_basis = poly_order > kMaxCachedPolynomialOrder
+                                         ? uncached_basis_block
+                                         : basis_blocks[poly_order][hh];
+
+    const int num_terms = poly_order - hh + 1;
+    for (int k = 0; k < num_polynoms; k++) {
+      H->block(k * (poly_order + 1), k * (poly_order + 1), num_terms,
+               num_terms) += (weight * pow(tau_dot(k), 2.0 * hh)) * H_basis;
+    }
+  }
+}
 
-      Eigen::MatrixXd H_hh = Eigen::MatrixXd::Zero(
-          (poly_order + 1) * num_polynoms, (poly_order + 1) * num_polynoms);
-      for (int k = 0; k < num_polynoms; k++) {
-        H_hh.block(k * (poly_order + 1), k * (poly_order + 1), num_terms,
-                   num_terms) =
-            H_times.cwiseProduct(H_basis) * pow(tau_dot(k), 2.0 * hh);
-      }
+Eigen::MatrixXd computeHessianBasisBlock(const int poly_order,
+                                         const int derivative_order) {
+  // Integral over [0, 1] of the products of the derivatives of the
+  // monomials, ordered from the highest power
+  const int num_terms = poly_order - derivative_order + 1;
 
-      Eigen::MatrixXd weight_matrix = Eigen::MatrixXd::Zero(
-          (poly_order + 1) * num_polynoms, (poly_order + 1) * num_polynoms);
-      for (int i = 0; i < num_polynoms; i++) {
-        weight_matrix.block(i * (poly_order + 1), i * (poly_order + 1),
-                            poly_order + 1, poly_order + 1) =
-            trajectory_settings.minimization_weights(hh) *
-            Eigen::MatrixXd::Ones(poly_order + 1, poly_order + 1);
-      }
+  // Some factorials we are going to use multiple times
+  Eigen::VectorXd factorials = Eigen::VectorXd::Ones(poly_order + 1);
+  for (int i = 2; i < poly_order + 1; i++) {
+    factorials(i) = i * factorials(i - 1);
+  }
 
-      H += H_hh.cwiseProduct(weight_matrix);
+  Eigen::MatrixXd H_basis(num_terms, num_terms);
+  for (int i = 0; i < num_terms; i++) {
+    for (int j = 0; j < num_terms; j++) {
+      const double numerator =
+          factorials(poly_order - i) /
+          factorials(poly_order - i - derivative_order) *
+          factorials(poly_order - j) /
+          factorials(poly_order - j - derivative_order);
+      const double denominator =
+          2.0 * (poly_order - derivative_order) + 1 - i - j;
+      H_basis(i, j) = numerator / denominator;
     }
   }
 
-  return H;
+  return H_basis;
+}
+
+std::vector<std::vector<Eigen::MatrixXd>> computeHessianBasisBlocks(
+    const int max_poly_order) {
+  std::vector<std::vector<Eigen::MatrixXd>> basis_blocks(max_poly_order + 1);
+  for (int poly_order = 0; poly_order <= max_poly_order; poly_order++) {
+    for (int hh = 0; hh < poly_order; hh++) {
+      basis_blocks[poly_order].push_back(
+          computeHessianBasisBlock(poly_order, hh));
+    }
+  }
+
+  return basis_blocks;
 }
 
 Eigen::VectorXd generateFVector(
     const PolynomialTrajectorySettings& trajectory_settings,
     const Eigen::VectorXd& way_points_1D, const int num_polynoms) {
+  Eigen::VectorXd f;
+  generateFVector(trajectory_settings, way_points_1D, num_polynoms, &f);
+  return f;
+}
+
+void generateFVector(const PolynomialTrajectorySettings& trajectory_settings,
+                     const Eigen::VectorXd& way_points_1D,
+                     const int num_polynoms, Eigen::VectorXd* f) {
   const int poly_order = trajectory_settings.polynomial_order;
 
-  Eigen::VectorXd f = Eigen::VectorXd::Zero((poly_order + 1) * num_polynoms);
+  f->setZero((poly_order + 1) * num_polynoms);
 
-  if (trajectory_settings.minimization_weights(0) == 0.0) {
-    f.setZero();
-    return f;
+  const double weight = trajectory_settings.minimization_weights(0);
+  if (weight == 0.0) {
+    return;
   }
 
   for (int k = 0; k < num_polynoms; k++) {
-    // Create a basis vector which is used for computations later on
-    Eigen::VectorXd f_k = Eigen::VectorXd::Zero(poly_order + 1);
     for (int i = 0; i < poly_order + 1; i++) {
-      f_k(i) = -2.0 * ((way_points_1D(k + 1) - way_points_1D(k)) /
-                           (poly_order + 2 - i) +
-                       way_points_1D(k) / (poly_order + 1 - i));
+      (*f)(k * (poly_order + 1) + i) =
+          weight * -2.0 *
+          ((way_points_1D(k + 1) - way_points_1D(k)) / (poly_order + 2 - i) +
+           way_points_1D(k) / (poly_order + 1 - i));
     }
-    f.segment(k * (poly_order + 1), poly_order + 1) = f_k;
   }
-  f *= trajectory_settings.minimization_weights(0);
-
-  return f;
 }
 
 Eigen::MatrixXd generateEqualityConstraintsAMatrix(
     const PolynomialTrajectorySettings& trajectory_settings,
     const int num_polynoms, const Eigen::VectorXd& tau_dot) {
+  Eigen::MatrixXd A;
+  generateEqualityConstraintsAMatrix(trajectory_settings, num_polynoms,
+                                     tau_dot, &A);
+  return A;
+}
+
+void generateEqualityConstraintsAMatrix(
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const int num_polynoms, const Eigen::VectorXd& tau_dot,
+    Eigen::MatrixXd* A) {
   const int poly_order = trajectory_settings.polynomial_order;
   const int continuity_order = trajectory_settings.continuity_order;
   const int num_constraints =
       2 * num_polynoms + continuity_order * (num_polynoms + 1);
 
-  Eigen::MatrixXd A =
-      Eigen::MatrixXd::Zero(num_constraints, (poly_order + 1) * num_polynoms);
+  A->setZero(num_constraints, (poly_order + 1) * num_polynoms);
 
   //
   // Create position constraints at waypoints
   //
   for (int i = 0; i < num_polynoms; i++) {
-    A(2 * i, (poly_order + 1) * i + poly_order) = 1.0;
+    (*A)(2 * i, (poly_order + 1) * i + poly_order) = 1.0;
     for (int j = 0; j < poly_order + 1; j++) {
-      A(2 * i + 1, (poly_order + 1) * i + j) = 1.0;
+      (*A)(2 * i + 1, (poly_order + 1) * i + j) = 1.0;
     }
   }
 
@@ -689,34 +1530,31 @@ Eigen::MatrixXd generateEqualityConstraintsAMatrix(
   // Create constraints for continuity of the derivatives of position
   //
   for (int k = 0; k < continuity_order; k++) {
-    Eigen::VectorXd factors = computeFactorials(poly_order - k, k);
     for (int j = 0; j < num_polynoms - 1; j++) {
       for (int i = 0; i < poly_order - k; i++) {
-        A(2 * num_polynoms + k * (num_polynoms - 1) + j,
-          j * (poly_order + 1) + i) =
-            factors(poly_order - k - 1 - i) * pow(tau_dot(j), k + 1);
+        (*A)(2 * num_polynoms + k * (num_polynoms - 1) + j,
+             j * (poly_order + 1) + i) =
+            computeFactorial(poly_order - k - 1 - i, k) *
+            pow(tau_dot(j), k + 1);
       }
-      A(2 * num_polynoms + k * (num_polynoms - 1) + j,
-        (j + 1) * (poly_order + 1) + (poly_order - 1 - k)) =
-          -factors(0) * pow(tau_dot(j + 1), k + 1);
+      (*A)(2 * num_polynoms + k * (num_polynoms - 1) + j,
+           (j + 1) * (poly_order + 1) + (poly_order - 1 - k)) =
+          -computeFactorial(0, k) * pow(tau_dot(j + 1), k + 1);
     }
   }
 
   // Create constraints for the derivatives of position at the start and end
   // point
   for (int k = 0; k < continuity_order; k++) {
-    Eigen::VectorXd factors = computeFactorials(poly_order - k, k);
-    A(2 * num_polynoms + continuity_order * (num_polynoms - 1) + k * 2,
-      poly_order - 1 - k) = factors(0) * pow(tau_dot(0), k + 1);
+    (*A)(2 * num_polynoms + continuity_order * (num_polynoms - 1) + k * 2,
+         poly_order - 1 - k) = computeFactorial(0, k) * pow(tau_dot(0), k + 1);
     for (int i = 0; i < poly_order - k; i++) {
-      A(2 * num_polynoms + continuity_order * (num_polynoms - 1) + k * 2 + 1,
-        (num_polynoms - 1) * (poly_order + 1) + i) =
-          factors(poly_order - k - 1 - i) *
+      (*A)(2 * num_polynoms + continuity_order * (num_polynoms - 1) + k * 2 + 1,
+           (num_polynoms - 1) * (poly_order + 1) + i) =
+          computeFactorial(poly_order - k - 1 - i, k) *
           pow(tau_dot(num_polynoms - 1), k + 1);
     }
   }
-
-  return A;
 }
 
 Eigen::VectorXd generateEqualityConstraintsBVector(
@@ -724,29 +1562,116 @@ Eigen::VectorXd generateEqualityConstraintsBVector(
     const int num_polynoms, const Eigen::VectorXd& way_points_1D,
     const Eigen::Vector3d& start_conditions,
     const Eigen::Vector3d& end_conditions) {
+  Eigen::VectorXd b;
+  generateEqualityConstraintsBVector(trajectory_settings, num_polynoms,
+                                     way_points_1D, start_conditions,
+                                     end_conditions, &b);
+  return b;
+}
+
+void generateEqualityConstraintsBVector(
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const int num_polynoms, const Eigen::VectorXd& way_points_1D,
+    const Eigen::Vector3d& start_conditions,
+    const Eigen::Vector3d& end_conditions, Eigen::VectorXd* b) {
   const int continuity_order = trajectory_settings.continuity_order;
   const int num_constraints =
       2 * num_polynoms + continuity_order * (num_polynoms + 1);
 
-  Eigen::VectorXd b = Eigen::VectorXd::Zero(num_constraints);
+  b->setZero(num_constraints);
 
   // Create position constraints
-  b(0) = way_points_1D(0);                // trajectory starting point
+  (*b)(0) = way_points_1D(0);             // trajectory starting point
   for (int i = 1; i < num_polynoms; i++)  // intermediate waypoints
   {
-    b(i * 2 - 1) = way_points_1D(i);
-    b(i * 2) = way_points_1D(i);
+    (*b)(i * 2 - 1) = way_points_1D(i);
+    (*b)(i * 2) = way_points_1D(i);
   }
-  b(2 * num_polynoms - 1) =
+  (*b)(2 * num_polynoms - 1) =
       way_points_1D(num_polynoms);  // trajectory end point
 
   // Create constraints for the derivatives of position at the start and end
   // point
   for (int k = 0; k < std::min(continuity_order, 3); k++) {
-    b(2 * num_polynoms + continuity_order * (num_polynoms - 1) + k * 2) =
+    (*b)(2 * num_polynoms + continuity_order * (num_polynoms - 1) + k * 2) =
         start_conditions(k);
-    b(2 * num_polynoms + continuity_order * (num_polynoms - 1) + k * 2 + 1) =
-        end_conditions(k);
+    (*b)(2 * num_polynoms + continuity_order * (num_polynoms - 1) + k * 2 +
+         1) = end_conditions(k);
+  }
+}
+
+bool areWayPointsInsideCorridors(
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const int num_polynoms, const bool ring_trajectory) {
+  if (int(trajectory_settings.corridor_lower_bounds.size()) != num_polynoms ||
+      int(trajectory_settings.corridor_upper_bounds.size()) != num_polynoms) {
+    return false;
+  }
+
+  const int num_way_points = trajectory_settings.way_points.size();
+  for (int i = 0; i < num_polynoms; i++) {
+    const Eigen::Vector3d& lower = trajectory_settings.corridor_lower_bounds[i];
+    const Eigen::Vector3d& upper = trajectory_settings.corridor_upper_bounds[i];
+    const Eigen::Vector3d& start = trajectory_settings.way_points[i];
+    const Eigen::Vector3d& end =
+        trajectory_settings
+            .way_points[ring_trajectory ? (i + 1) % num_way_points : i + 1];
+    if ((start.array() < lower.array()).any() ||
+        (start.array() > upper.array()).any() ||
+        (end.array() < lower.array()).any() ||
+        (end.array() > upper.array()).any()) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+Eigen::MatrixXd generateCorridorConstraintsAMatrix(
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const int num_polynoms) {
+  const int poly_order = trajectory_settings.polynomial_order;
+  const int num_inner_control_points = std::max(0, poly_order - 1);
+
+  // Maps the coefficients of a segment (highest power first) to its control
+  // points
+  const Eigen::MatrixXd control_point_map =
+      computeBernsteinControlPoints(
+          Eigen::MatrixXd::Identity(poly_order + 1, poly_order + 1))
+          .transpose()
+          .rowwise()
+          .reverse();
+
+  // Upper bounds of all segments followed by their lower bounds
+  const int num_rows = num_polynoms * num_inner_control_points;
+  Eigen::MatrixXd A =
+      Eigen::MatrixXd::Zero(2 * num_rows, (poly_order + 1) * num_polynoms);
+  const Eigen::MatrixXd inner_control_points =
+      control_point_map.middleRows(1, num_inner_control_points);
+  for (int i = 0; i < num_polynoms; i++) {
+    A.block(i * num_inner_control_points, i * (poly_order + 1),
+            num_inner_control_points, poly_order + 1) = inner_control_points;
+    A.block(num_rows + i * num_inner_control_points, i * (poly_order + 1),
+            num_inner_control_points, poly_order + 1) = -inner_control_points;
+  }
+
+  return A;
+}
+
+Eigen::VectorXd generateCorridorConstraintsBVector(
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const int num_polynoms, const int dimension) {
+  const int num_inner_control_points =
+      std::max(0, trajectory_settings.polynomial_order - 1);
+  const int num_rows = num_polynoms * num_inner_control_points;
+
+  Eigen::VectorXd b(2 * num_rows);
+  for (int i = 0; i < num_polynoms; i++) {
+    b.segment(i * num_inner_control_points, num_inner_control_points)
+        .setConstant(trajectory_settings.corridor_upper_bounds[i](dimension));
+    b.segment(num_rows + i * num_inner_control_points,
+              num_inner_control_points)
+        .setConstant(-trajectory_settings.corridor_lower_bounds[i](dimension));
   }
 
   return b;
@@ -814,42 +1739,203 @@ Eigen::VectorXd generateRingEqualityConstraintsBVector(
   return b;
 }
 
+Eigen::VectorXd computeConstraintDerivativeOrders(
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const int num_polynoms, const bool ring_trajectory) {
+  const int continuity_order = trajectory_settings.continuity_order;
+  // Rows are ordered as in generate<Ring>EqualityConstraintsAMatrix
+  const int num_continuity_constraints =
+      ring_trajectory ? num_polynoms : num_polynoms - 1;
+
+  Eigen::VectorXd orders = Eigen::VectorXd::Zero(
+      2 * num_polynoms + continuity_order * num_continuity_constraints +
+      (ring_trajectory ? 0 : 2 * continuity_order));
+
+  // Position constraints are of order 0
+  for (int k = 0; k < continuity_order; k++) {
+    orders.segment(2 * num_polynoms + k * num_continuity_constraints,
+                   num_continuity_constraints)
+        .setConstant(k + 1);
+    if (!ring_trajectory) {
+      orders.segment(2 * num_polynoms +
+                         continuity_order * num_continuity_constraints + k * 2,
+                     2)
+          .setConstant(k + 1);
+    }
+  }
+
+  return orders;
+}
+
+// Corridor constraints with less slack than this, relative to their bound,
+// are considered active at the solution
+static constexpr double kActiveCorridorConstraintTolerance = 1e-6;
+
 Eigen::VectorXd computeCostGradient(
     const PolynomialTrajectory& initial_trajectory,
     const PolynomialTrajectorySettings& trajectory_settings) {
-  int num_segments = int(initial_trajectory.segment_times.size());
+  // The cost gradient with respect to the segment times is computed
+  // analytically from the solution of the quadratic program.
+  // The optimal cost is J = c' * H * c + f' * c subject to A * c = b and the
+  // corridor constraints, where only H and A depend on the segment times.
+  // With the Lagrange multipliers lambda of the solution it follows from the
+  // envelope theorem that
+  //   dJ/dT_k = c' * dH/dT_k * c + lambda' * dA/dT_k * c
+  // Every entry of H and A that belongs to segment k is a power of
+  // tau_dot(k) = 1 / T_k, so the derivatives only require scaling these
+  // entries by their exponent
+  const int num_segments = int(initial_trajectory.segment_times.size());
   Eigen::VectorXd gradient = Eigen::VectorXd::Zero(num_segments);
+  if (num_segments < 2 || initial_trajectory.coeff.empty()) {
+    return gradient;
+  }
 
-  for (int segment = 0; segment < num_segments; segment++) {
-    // compute delta S
-    Eigen::VectorXd delta_s =
-        -1.0 / (num_segments - 1) * Eigen::VectorXd::Ones(num_segments);
-    delta_s(segment) = 1.0;
+  const bool ring_trajectory =
+      initial_trajectory.trajectory_type ==
+          polynomial_trajectories::TrajectoryType::MINIMUM_SNAP_RING ||
+      initial_trajectory.trajectory_type ==
+          polynomial_trajectories::TrajectoryType::
+              MINIMUM_SNAP_RING_OPTIMIZED_SEGMENTS;
+
+  // Reconstruct the settings the trajectory was computed with
+  PolynomialTrajectorySettings new_trajectory_settings = trajectory_settings;
+  new_trajectory_settings.polynomial_order =
+      initial_trajectory.coeff.front().cols() - 1;
+  new_trajectory_settings.minimization_weights =
+      trajectory_settings.minimization_weights /
+      trajectory_settings.minimization_weights.maxCoeff();
+  if (!ring_trajectory) {
+    new_trajectory_settings.way_points = addStartAndEndToWayPointList(
+        trajectory_settings.way_points, initial_trajectory.start_state.position,
+        initial_trajectory.end_state.position);
+  }
+  const int poly_order = new_trajectory_settings.polynomial_order;
+  const int num_way_points = new_trajectory_settings.way_points.size();
 
-    // compute new segment times
-    double gradient_computation_step_size = 0.01;
-    Eigen::VectorXd segment_times = initial_trajectory.segment_times +
-                                    gradient_computation_step_size * delta_s;
+  Eigen::VectorXd tau_dot(num_segments);
+  for (int i = 0; i < num_segments; i++) {
+    tau_dot(i) = 1.0 / initial_trajectory.segment_times(i);
+  }
 
-    // compute new cost by solving optimization with new segment times
-    PolynomialTrajectory trajectory;
-    if (initial_trajectory.trajectory_type ==
-        polynomial_trajectories::TrajectoryType::
-            MINIMUM_SNAP_OPTIMIZED_SEGMENTS) {
-      trajectory = generateMinimumSnapTrajectory(
-          segment_times, initial_trajectory.start_state,
-          initial_trajectory.end_state, trajectory_settings);
-    } else if (initial_trajectory.trajectory_type ==
-               polynomial_trajectories::TrajectoryType::
-                   MINIMUM_SNAP_RING_OPTIMIZED_SEGMENTS) {
-      trajectory =
-          generateMinimumSnapRingTrajectory(segment_times, trajectory_settings);
+  const Eigen::MatrixXd H = generateHMatrix(new_trajectory_settings,
+                                            num_segments, tau_dot);
+  const Eigen::MatrixXd A_eq =
+      ring_trajectory ? generateRingEqualityConstraintsAMatrix(
+                            new_trajectory_settings, num_segments, tau_dot)
+                      : generateEqualityConstraintsAMatrix(
+                            new_trajectory_settings, num_segments, tau_dot);
+  const Eigen::VectorXd constraint_orders = computeConstraintDerivativeOrders(
+      new_trajectory_settings, num_segments, ring_trajectory);
+
+  // The block of H belonging to segment k is
+  //   sum_h(w_h * H_h * tau_dot(k)^(2 * h))
+  // so its derivative with respect to T_k is the block of an H matrix with
+  // weights 2 * h * w_h scaled by -tau_dot(k)
+  PolynomialTrajectorySettings derivative_settings = new_trajectory_settings;
+  for (int h = 0; h < derivative_settings.minimization_weights.size(); h++) {
+    derivative_settings.minimization_weights(h) *= 2.0 * h;
+  }
+  const Eigen::MatrixXd H_derivative =
+      generateHMatrix(derivative_settings, num_segments, tau_dot);
+
+  const Eigen::ColPivHouseholderQR<Eigen::MatrixXd> A_eq_transposed_qr(
+      A_eq.transpose());
+
+  // Corridor constraints do not depend on the segment times, but the active
+  // ones contribute to the stationarity condition the multipliers are
+  // recovered from
+  const bool corridors = !trajectory_settings.corridor_lower_bounds.empty() ||
+                         !trajectory_settings.corridor_upper_bounds.empty();
+  Eigen::MatrixXd A_ineq;
+  if (corridors) {
+    A_ineq = generateCorridorConstraintsAMatrix(new_trajectory_settings,
+                                                num_segments);
+  }
+
+  // Gradient of the cost with respect to the individual segment times, summed
+  // over the spatial dimensions and the heading if it was optimized
+  Eigen::VectorXd segment_time_gradient = Eigen::VectorXd::Zero(num_segments);
+  for (int d = 0; d < initial_trajectory.coeff.dimension(); d++) {
+    Eigen::VectorXd coefficients((poly_order + 1) * num_segments);
+    for (int k = 0; k < num_segments; k++) {
+      coefficients.segment(k * (poly_order + 1), poly_order + 1) =
+          initial_trajectory.coeff[k].row(d).transpose();
+    }
+
+    // Same way points as used to generate the trajectory
+    Eigen::VectorXd way_points_d = Eigen::VectorXd::Zero(num_way_points);
+    if (d < 3) {
+      for (int i = 0; i < num_way_points; i++) {
+        way_points_d(i) = new_trajectory_settings.way_points[i](d);
+      }
+    } else if (ring_trajectory) {
+      for (int i = 0; i < num_way_points; i++) {
+        way_points_d(i) = trajectory_settings.heading_way_points[i];
+      }
+    } else {
+      way_points_d(0) = initial_trajectory.start_state.heading;
+      for (int i = 1; i < num_way_points - 1; i++) {
+        way_points_d(i) = trajectory_settings.heading_way_points[i - 1];
+      }
+      way_points_d(num_way_points - 1) = initial_trajectory.end_state.heading;
     }
+    const Eigen::VectorXd f =
+        generateFVector(new_trajectory_settings, way_points_d, num_segments);
+
+    // Recover the Lagrange multipliers from the stationarity condition
+    // 2 * H * c + f + A' * lambda + A_active' * mu = 0
+    std::vector<int> active_constraints;
+    if (corridors && d < 3) {
+      const Eigen::VectorXd b_ineq = generateCorridorConstraintsBVector(
+          new_trajectory_settings, num_segments, d);
+      const Eigen::VectorXd slack = b_ineq - A_ineq * coefficients;
+      for (int i = 0; i < slack.size(); i++) {
+        if (slack(i) <= kActiveCorridorConstraintTolerance *
+                            std::max(1.0, std::fabs(b_ineq(i)))) {
+          active_constraints.push_back(i);
+        }
+      }
+    }
+    Eigen::VectorXd lambda;
+    if (active_constraints.empty()) {
+      lambda = A_eq_transposed_qr.solve(-(2.0 * H * coefficients + f));
+    } else {
+      Eigen::MatrixXd A_transposed(A_eq.cols(),
+                                   A_eq.rows() + active_constraints.size());
+      A_transposed.leftCols(A_eq.rows()) = A_eq.transpose();
+      for (size_t i = 0; i < active_constraints.size(); i++) {
+        A_transposed.col(A_eq.rows() + i) =
+            A_ineq.row(active_constraints[i]).transpose();
+      }
+      lambda = A_transposed.colPivHouseholderQr()
+                   .solve(-(2.0 * H * coefficients + f))
+                   .head(A_eq.rows());
+    }
+    const Eigen::VectorXd weighted_lambda =
+        lambda.cwiseProduct(constraint_orders);
+
+    for (int k = 0; k < num_segments; k++) {
+      const Eigen::VectorXd c_k =
+          coefficients.segment(k * (poly_order + 1), poly_order + 1);
+      const double cost_derivative =
+          c_k.dot(H_derivative.block(k * (poly_order + 1),
+                                     k * (poly_order + 1), poly_order + 1,
+                                     poly_order + 1) *
+                  c_k);
+      const double constraints_derivative = weighted_lambda.dot(
+          A_eq.middleCols(k * (poly_order + 1), poly_order + 1) * c_k);
+      segment_time_gradient(k) -=
+          tau_dot(k) * (cost_derivative + constraints_derivative);
+    }
+  }
 
-    // add element to gradient
+  // Directional derivatives for increasing one segment time while decreasing
+  // all others such that the total time stays the same
+  const double gradient_sum = segment_time_gradient.sum();
+  for (int segment = 0; segment < num_segments; segment++) {
     gradient(segment) =
-        (trajectory.optimization_cost - initial_trajectory.optimization_cost) /
-        gradient_computation_step_size;
+        segment_time_gradient(segment) -
+        (gradient_sum - segment_time_gradient(segment)) / (num_segments - 1);
   }
 
   return gradient;
@@ -890,12 +1976,27 @@ Eigen::VectorXd computeSearchDirection(
   return search_direction;
 }
 
+std::unique_ptr<ThreadPool> createLineSearchThreadPool(
+    const PolynomialTrajectorySettings& trajectory_settings) {
+  if (trajectory_settings.line_search_threads <= 1) {
+    // The line search steps are evaluated one after the other
+    return nullptr;
+  }
+  // The calling thread evaluates one step of each batch itself
+  return std::unique_ptr<ThreadPool>(
+      new ThreadPool(trajectory_settings.line_search_threads - 1));
+}
+
+// The line search gives up and keeps the segment times once the steps become
+// negligible, which happens if the search direction is no descent direction
+// due to numerical errors
+static constexpr double kMinLineSearchStepRatio = 1e-8;
+
 Eigen::VectorXd updateSegmentTimes(
     const PolynomialTrajectory& initial_trajectory,
     const Eigen::VectorXd& gradient,
-    const PolynomialTrajectorySettings& trajectory_settings) {
-  Eigen::VectorXd updated_segment_times;
-
+    const PolynomialTrajectorySettings& trajectory_settings,
+    ThreadPool* thread_pool) {
   const Eigen::VectorXd search_direction =
       computeSearchDirection(initial_trajectory, gradient);
   double step_ratio = 1.0;
@@ -903,35 +2004,59 @@ Eigen::VectorXd updateSegmentTimes(
   const double backtracking_alpha = 0.1;
   const double backtracking_beta = 0.5;
 
-  for (;;) {
-    Eigen::VectorXd step = step_ratio * search_direction;
-
-    updated_segment_times = initial_trajectory.segment_times + step;
+  // The steps of one batch are evaluated concurrently and the first one that
+  // satisfies the Armijo condition is taken, which is the same step the
+  // sequential backtracking would find
+  const int batch_size = std::max(trajectory_settings.line_search_threads, 1);
 
+  std::vector<Eigen::VectorXd> batch_segment_times(batch_size);
+  std::vector<double> batch_costs(batch_size);
+  const std::function<void(const int)> evaluate_step = [&](const int i) {
     // compute new cost by solving optimization with new segment times
     PolynomialTrajectory trajectory;
     if (initial_trajectory.trajectory_type ==
         polynomial_trajectories::TrajectoryType::
             MINIMUM_SNAP_OPTIMIZED_SEGMENTS) {
       trajectory = generateMinimumSnapTrajectory(
-          updated_segment_times, initial_trajectory.start_state,
+          batch_segment_times[i], initial_trajectory.start_state,
           initial_trajectory.end_state, trajectory_settings);
     } else if (initial_trajectory.trajectory_type ==
                polynomial_trajectories::TrajectoryType::
                    MINIMUM_SNAP_RING_OPTIMIZED_SEGMENTS) {
-      trajectory = generateMinimumSnapRingTrajectory(updated_segment_times,
+      trajectory = generateMinimumSnapRingTrajectory(batch_segment_times[i],
                                                      trajectory_settings);
     }
+    batch_costs[i] = trajectory.optimization_cost;
+  };
 
-    step_ratio *= backtracking_beta;
-    if (trajectory.optimization_cost <
-        initial_trajectory.optimization_cost +
-            backtracking_alpha * step.dot(gradient)) {
-      break;
+  for (;;) {
+    std::vector<Eigen::VectorXd> batch_steps(batch_size);
+    for (int i = 0; i < batch_size; i++) {
+      batch_steps[i] = step_ratio * search_direction;
+      batch_segment_times[i] =
+          initial_trajectory.segment_times + batch_steps[i];
+      step_ratio *= backtracking_beta;
+    }
+
+    if (thread_pool != nullptr) {
+      thread_pool->parallelFor(batch_size, evaluate_step);
+    } else {
+      for (int i = 0; i < batch_size; i++) {
+        evaluate_step(i);
+      }
     }
-  }
 
-  return updated_segment_times;
+    for (int i = 0; i < batch_size; i++) {
+      if (batch_costs[i] <
+          initial_trajectory.optimization_cost +
+              backtracking_alpha * batch_steps[i].dot(gradient)) {
+        return batch_segment_times[i];
+      }
+    }
+    if (step_ratio < kMinLineSearchStepRatio) {
+      return initial_trajectory.segment_times;
+    }
+  }
 }
 
 PolynomialTrajectory enforceMaximumVelocityAndThrust(
@@ -953,19 +2078,27 @@ PolynomialTrajectory enforceMaximumVelocityAndThrust(
       Eigen::Vector3d(max_velocity, max_normalized_thrust, max_roll_pitch_rate);
 
   Eigen::Vector3d prev_maxima;
-  computeQuadRelevantMaxima(trajectory, &prev_maxima.x(), &prev_maxima.y(),
-                            &prev_maxima.z());
-
-  while (prev_maxima.x() <= 1.01 * desired_maxima.x() &&
-         prev_maxima.y() <= 1.01 * desired_maxima.y() &&
-         prev_maxima.z() <= 1.01 * desired_maxima.z()) {
-    if ((prev_maxima.x() >= 0.99 * desired_maxima.x() ||
-         prev_maxima.y() >= 0.99 * desired_maxima.y() ||
-         prev_maxima.z() >= 0.99 * desired_maxima.z()) &&
-        (prev_maxima.x() <= desired_maxima.x() &&
-         prev_maxima.y() <= desired_maxima.y() &&
-         prev_maxima.z() <= desired_maxima.z())) {
-      return trajectory;
+  while (true) {
+    // As long as the Bernstein bounds guarantee that all maxima stay below 99%
+    // of the limits, the trajectory is sped up without sampling its maxima
+    if (!isTrajectoryGuaranteedFeasibleUnderConstraints(
+            trajectory, 0.99 * desired_maxima.x(), 0.99 * desired_maxima.y(),
+            0.99 * desired_maxima.z())) {
+      computeQuadRelevantMaxima(trajectory, &prev_maxima.x(),
+                                &prev_maxima.y(), &prev_maxima.z());
+      if (prev_maxima.x() > 1.01 * desired_maxima.x() ||
+          prev_maxima.y() > 1.01 * desired_maxima.y() ||
+          prev_maxima.z() > 1.01 * desired_maxima.z()) {
+        break;
+      }
+      if ((prev_maxima.x() >= 0.99 * desired_maxima.x() ||
+           prev_maxima.y() >= 0.99 * desired_maxima.y() ||
+           prev_maxima.z() >= 0.99 * desired_maxima.z()) &&
+          (prev_maxima.x() <= desired_maxima.x() &&
+           prev_maxima.y() <= desired_maxima.y() &&
+           prev_maxima.z() <= desired_maxima.z())) {
+        return trajectory;
+      }
     }
 
     if (initial_trajectory.trajectory_type ==
@@ -990,9 +2123,6 @@ PolynomialTrajectory enforceMaximumVelocityAndThrust(
         polynomial_trajectories::TrajectoryType::UNDEFINED) {
       return trajectory;
     }
-
-    computeQuadRelevantMaxima(trajectory, &prev_maxima.x(), &prev_maxima.y(),
-                              &prev_maxima.z());
   }
 
   // compute gradient of maxima with respect to T
@@ -1177,22 +2307,119 @@ bool computeMaximaGradient(
   return true;
 }
 
-std::vector<Eigen::MatrixXd> reorganiceCoefficientsSegmentWise(
-    const std::vector<Eigen::MatrixXd>& coefficients, const int num_segments,
-    const int polynomial_order) {
-  std::vector<Eigen::MatrixXd> reorganized_coefficients;
+bool setUpOpenMinimumSnapProblem(
+    const Eigen::VectorXd& segment_times,
+    const quadrotor_common::TrajectoryPoint& start_state,
+    const quadrotor_common::TrajectoryPoint& end_state,
+    const PolynomialTrajectorySettings& trajectory_settings,
+    const bool free_derivatives,
+    PolynomialTrajectorySettings* feasible_trajectory_settings,
+    PolynomialTrajectory* trajectory) {
+  const int num_segments = segment_times.size();
 
-  // Reorganize coefficients such that each element of the vector contains the
-  // coefficients for one trajectory segment
-  for (int segment = 0; segment < num_segments; segment++) {
-    Eigen::MatrixXd segment_coeff =
-        Eigen::MatrixXd::Zero(3, polynomial_order + 1);
+  if (num_segments != int(trajectory_settings.way_points.size()) + 1) {
+    ROS_ERROR(
+        "[%s] Number of way points and segments are not agreeing. "
+        "(Need num_segments == num_waypoints + 1 for open trajectories.)",
+        ros::this_node::getName().c_str());
+    return false;
+  }
+
+  const bool optimize_heading = trajectory_settings.optimize_heading ||
+                                !trajectory_settings.heading_way_points.empty();
+  if (optimize_heading && trajectory_settings.heading_way_points.size() !=
+                              trajectory_settings.way_points.size()) {
+    ROS_ERROR(
+        "[%s] Number of heading way points and way points are not agreeing.",
+        ros::this_node::getName().c_str());
+    return false;
+  }
+
+  // Ensure trajectory settings that result in feasible optimization problem
+  const int min_poly_order =
+      free_derivatives ? 2 * trajectory_settings.continuity_order + 1
+                       : 2 +
+                             ceil(trajectory_settings.continuity_order *
+                                  (num_segments + 1) / float(num_segments)) -
+                             1;
+  ensureFeasibleTrajectorySettings(trajectory_settings, min_poly_order,
+                                   feasible_trajectory_settings);
+
+  // Add start and end position to way points vector, which keeps its memory
+  // if the settings are reused for problems of the same size
+  std::vector<Eigen::Vector3d>& way_points =
+      feasible_trajectory_settings->way_points;
+  way_points.insert(way_points.begin(), start_state.position);
+  way_points.push_back(end_state.position);
+
+  trajectory->trajectory_type =
+      polynomial_trajectories::TrajectoryType::MINIMUM_SNAP;
+  trajectory->number_of_segments = num_segments;
+  trajectory->segment_times = segment_times;
+
+  trajectory->start_state = start_state;
+  trajectory->start_state.time_from_start = ros::Duration(0.0);
+  trajectory->end_state = end_state;
+
+  trajectory->optimization_cost = 0.0;
+  trajectory->T = ros::Duration(segment_times.sum());
+  trajectory->end_state.time_from_start = trajectory->T;
+
+  trajectory->coeff.resize(num_segments, optimize_heading ? 4 : 3,
+                           feasible_trajectory_settings->polynomial_order + 1);
+
+  return true;
+}
+
+void getOpenWayPoints1D(
+    const PolynomialTrajectorySettings& feasible_trajectory_settings,
+    const quadrotor_common::TrajectoryPoint& start_state,
+    const quadrotor_common::TrajectoryPoint& end_state, const int dimension,
+    Eigen::VectorXd* way_points_1D, Eigen::Vector3d* start_conditions,
+    Eigen::Vector3d* end_conditions) {
+  const int num_way_points = feasible_trajectory_settings.way_points.size();
+  way_points_1D->resize(num_way_points);
+  if (dimension < 3) {
+    for (int i = 0; i < num_way_points; i++) {
+      (*way_points_1D)(i) =
+          feasible_trajectory_settings.way_points[i](dimension);
+    }
 
-    for (int dimension = 0; dimension < 3; dimension++) {
-      segment_coeff.row(dimension) = coefficients[dimension].row(segment);
+    *start_conditions = Eigen::Vector3d(start_state.velocity(dimension),
+                                        start_state.acceleration(dimension),
+                                        start_state.jerk(dimension));
+    *end_conditions = Eigen::Vector3d(end_state.velocity(dimension),
+                                      end_state.acceleration(dimension),
+                                      end_state.jerk(dimension));
+  } else {
+    (*way_points_1D)(0) = start_state.heading;
+    for (int i = 1; i < num_way_points - 1; i++) {
+      (*way_points_1D)(i) =
+          feasible_trajectory_settings.heading_way_points[i - 1];
     }
+    (*way_points_1D)(num_way_points - 1) = end_state.heading;
+
+    *start_conditions = Eigen::Vector3d(start_state.heading_rate,
+                                        start_state.heading_acceleration, 0.0);
+    *end_conditions = Eigen::Vector3d(end_state.heading_rate,
+                                      end_state.heading_acceleration, 0.0);
+  }
+}
 
-    reorganized_coefficients.push_back(segment_coeff);
+PolynomialCoefficients reorganiceCoefficientsSegmentWise(
+    const std::vector<Eigen::MatrixXd>& coefficients, const int num_segments,
+    const int polynomial_order) {
+  // Reorganize coefficients such that each segment contains the coefficients
+  // of all dimensions
+  const int num_dimensions = coefficients.size();
+  PolynomialCoefficients reorganized_coefficients;
+  reorganized_coefficients.resize(num_segments, num_dimensions,
+                                  polynomial_order + 1);
+  for (int segment = 0; segment < num_segments; segment++) {
+    for (int dimension = 0; dimension < num_dimensions; dimension++) {
+      reorganized_coefficients[segment].row(dimension) =
+          coefficients[dimension].row(segment);
+    }
   }
 
   return reorganized_coefficients;
@@ -1213,15 +2440,188 @@ std::vector<Eigen::Vector3d> addStartAndEndToWayPointList(
   return way_points;
 }
 
+// Estimated segment times are at least kMinInitialSegmentTime
+static constexpr double kMinInitialSegmentTime = 0.05;
+
+Eigen::VectorXd computeJerkLimitedSegmentTimes(
+    const std::vector<Eigen::Vector3d>& way_points, const bool ring_trajectory,
+    const double start_speed, const double end_speed,
+    const double max_velocity, const double max_normalized_thrust,
+    const double max_roll_pitch_rate) {
+  const int num_way_points = way_points.size();
+  const int num_segments =
+      ring_trajectory ? num_way_points : num_way_points - 1;
+  if (num_segments < 1) {
+    return Eigen::VectorXd();
+  }
+
+  // Rotating the thrust vector changes the acceleration with at most
+  // max_normalized_thrust * max_roll_pitch_rate
+  const double max_jerk = max_roll_pitch_rate > 0.0
+                              ? max_normalized_thrust * max_roll_pitch_rate
+                              : std::numeric_limits<double>::infinity();
+
+  std::vector<double> lengths(num_segments);
+  std::vector<Eigen::Vector3d> directions(num_segments);
+  std::vector<double> max_accelerations(num_segments);
+  std::vector<double> max_decelerations(num_segments);
+  for (int i = 0; i < num_segments; i++) {
+    const Eigen::Vector3d segment =
+        way_points[(i + 1) % num_way_points] - way_points[i];
+    lengths[i] = segment.norm();
+    directions[i] = lengths[i] > 0.0 ? Eigen::Vector3d(segment / lengths[i])
+                                     : Eigen::Vector3d::Zero();
+    max_accelerations[i] =
+        computeMaxAcceleration(directions[i], max_normalized_thrust);
+    max_decelerations[i] =
+        computeMaxAcceleration(-directions[i], max_normalized_thrust);
+  }
+
+  // Speed at the way points (speeds[i] at the start of segment i), reduced
+  // from max_velocity when turning and to full stop when turning around
+  std::vector<double> speeds(num_segments + 1);
+  for (int i = 0; i <= num_segments; i++) {
+    if (!ring_trajectory && i == 0) {
+      speeds[i] = std::min(start_speed, max_velocity);
+    } else if (!ring_trajectory && i == num_segments) {
+      speeds[i] = std::min(end_speed, max_velocity);
+    } else {
+      const double cos_turn_angle =
+          directions[(i + num_segments - 1) % num_segments].dot(
+              directions[i % num_segments]);
+      speeds[i] = 0.5 * (1.0 + cos_turn_angle) * max_velocity;
+    }
+  }
+
+  // Limit the speeds to what can be reached over the segments, ring
+  // trajectories need a second pass to propagate the limits over the loop
+  const int num_passes = ring_trajectory ? 2 : 1;
+  for (int pass = 0; pass < num_passes; pass++) {
+    for (int i = 0; i < num_segments; i++) {
+      speeds[i + 1] = std::min(
+          speeds[i + 1], sqrt(speeds[i] * speeds[i] +
+                              2.0 * max_accelerations[i] * lengths[i]));
+    }
+    for (int i = num_segments - 1; i >= 0; i--) {
+      speeds[i] = std::min(speeds[i], sqrt(speeds[i + 1] * speeds[i + 1] +
+                                           2.0 * max_decelerations[i] *
+                                               lengths[i]));
+    }
+    if (ring_trajectory) {
+      speeds[num_segments] = std::min(speeds[0], speeds[num_segments]);
+      speeds[0] = speeds[num_segments];
+    }
+  }
+
+  Eigen::VectorXd segment_times(num_segments);
+  for (int i = 0; i < num_segments; i++) {
+    const double v_in = speeds[i];
+    const double v_out = speeds[i + 1];
+    // Distance covered while accelerating from v_in to the peak speed and
+    // decelerating to v_out, the speed changes are symmetric in time
+    const auto speed_change_distance = [&](const double peak_speed) {
+      return 0.5 * (v_in + peak_speed) *
+                 computeSpeedChangeTime(peak_speed - v_in,
+                                        max_accelerations[i], max_jerk) +
+             0.5 * (peak_speed + v_out) *
+                 computeSpeedChangeTime(peak_speed - v_out,
+                                        max_decelerations[i], max_jerk);
+    };
+
+    double peak_speed = max_velocity;
+    if (speed_change_distance(max_velocity) > lengths[i]) {
+      // Bisect the peak speed that exactly covers the segment
+      double lower_speed = std::max(v_in, v_out);
+      double upper_speed = max_velocity;
+      for (int j = 0; j < 30; j++) {
+        const double speed = 0.5 * (lower_speed + upper_speed);
+        if (speed_change_distance(speed) > lengths[i]) {
+          upper_speed = speed;
+        } else {
+          lower_speed = speed;
+        }
+      }
+      peak_speed = lower_speed;
+    }
+
+    const double change_time =
+        computeSpeedChangeTime(peak_speed - v_in, max_accelerations[i],
+                               max_jerk) +
+        computeSpeedChangeTime(peak_speed - v_out, max_decelerations[i],
+                               max_jerk);
+    const double cruise_distance =
+        std::max(lengths[i] - speed_change_distance(peak_speed), 0.0);
+    segment_times(i) = change_time;
+    if (peak_speed > 0.0) {
+      segment_times(i) += cruise_distance / peak_speed;
+    }
+    segment_times(i) = std::max(segment_times(i), kMinInitialSegmentTime);
+  }
+
+  return segment_times;
+}
+
+uint64_t numMinimumSnapSolves() { return num_minimum_snap_solves; }
+
+// Relative tolerance below which initial segment times count as uniform
+static constexpr double kUniformSegmentTimesTolerance = 1e-9;
+
+Eigen::VectorXd computeSeedSegmentTimes(
+    const Eigen::VectorXd& initial_segment_times,
+    const Eigen::VectorXd& estimated_segment_times) {
+  if (initial_segment_times.size() == estimated_segment_times.size() &&
+      initial_segment_times.maxCoeff() - initial_segment_times.minCoeff() <=
+          kUniformSegmentTimesTolerance * initial_segment_times.maxCoeff()) {
+    return estimated_segment_times;
+  }
+
+  return initial_segment_times / initial_segment_times.sum() *
+         estimated_segment_times.sum();
+}
+
+double computeMaxAcceleration(const Eigen::Vector3d& direction,
+                              const double max_normalized_thrust) {
+  // Largest a with |a * direction + g| = max_normalized_thrust
+  const double gravity = 9.81;
+  const double n_z = direction.z();
+  const double radicand = gravity * gravity * (n_z * n_z - 1.0) +
+                          max_normalized_thrust * max_normalized_thrust;
+  // Keep a small positive acceleration if the thrust can not accelerate along
+  // direction at all
+  return std::max(-n_z * gravity + sqrt(std::max(radicand, 0.0)), 0.1);
+}
+
+double computeSpeedChangeTime(const double speed_change,
+                              const double max_acceleration,
+                              const double max_jerk) {
+  if (speed_change <= 0.0) {
+    return 0.0;
+  }
+  if (speed_change >= max_acceleration * max_acceleration / max_jerk) {
+    // Constant acceleration phase between the jerk phases
+    return speed_change / max_acceleration + max_acceleration / max_jerk;
+  }
+  return 2.0 * sqrt(speed_change / max_jerk);
+}
+
 PolynomialTrajectorySettings ensureFeasibleTrajectorySettings(
     const PolynomialTrajectorySettings& original_trajectory_settings,
     const int min_poly_order) {
-  PolynomialTrajectorySettings new_trajectory_settings =
-      original_trajectory_settings;
+  PolynomialTrajectorySettings new_trajectory_settings;
+  ensureFeasibleTrajectorySettings(original_trajectory_settings,
+                                   min_poly_order, &new_trajectory_settings);
+  return new_trajectory_settings;
+}
+
+void ensureFeasibleTrajectorySettings(
+    const PolynomialTrajectorySettings& original_trajectory_settings,
+    const int min_poly_order,
+    PolynomialTrajectorySettings* new_trajectory_settings) {
+  *new_trajectory_settings = original_trajectory_settings;
 
   // enforce minimum necessary polynomial order
   if (original_trajectory_settings.polynomial_order < min_poly_order) {
-    new_trajectory_settings.polynomial_order = min_poly_order;
+    new_trajectory_settings->polynomial_order = min_poly_order;
     ROS_WARN_THROTTLE(
         1.0,
         "[%s] Requested polynomial order (%d) is too small to enforce "
@@ -1235,11 +2635,9 @@ PolynomialTrajectorySettings ensureFeasibleTrajectorySettings(
   // Ensure non zero minimization weight on position (otherwise QP solver
   // cannot handle the problem)
   // Also, the weights are normalized such that the largest one is equal to 1
-  new_trajectory_settings.minimization_weights =
+  new_trajectory_settings->minimization_weights =
       original_trajectory_settings.minimization_weights /
       original_trajectory_settings.minimization_weights.maxCoeff();
-
-  return new_trajectory_settings;
 }
 
 Eigen::VectorXd solveQuadraticProgram(const Eigen::MatrixXd& H,
@@ -1250,16 +2648,17 @@ Eigen::VectorXd solveQuadraticProgram(const Eigen::MatrixXd& H,
   Eigen::VectorXd solution;
 
   // Try to solve problem as Lagrange optimization (using lagrange multipliers)
-  Eigen::MatrixXd A_lagrange =
-      Eigen::MatrixXd::Zero(H.rows() + A_eq.rows(), H.rows() + A_eq.rows());
-  A_lagrange.block(0, 0, H.cols(), H.rows()) = 2.0 * H.transpose();
-  A_lagrange.block(0, H.rows(), A_eq.cols(), A_eq.rows()) = A_eq.transpose();
-  A_lagrange.block(H.cols(), 0, A_eq.rows(), A_eq.cols()) = A_eq;
+  Eigen::MatrixXd A_lagrange;
+  Eigen::ColPivHouseholderQR<Eigen::MatrixXd> A_lagrange_factor;
+  factorizeLagrangeSystem(H, A_eq, &A_lagrange, &A_lagrange_factor);
   Eigen::VectorXd b_lagrange = Eigen::VectorXd::Zero(H.rows() + A_eq.rows());
   b_lagrange.segment(0, H.rows()) = -f;
   b_lagrange.segment(H.rows(), A_eq.rows()) = b_eq;
 
-  Eigen::VectorXd x = A_lagrange.colPivHouseholderQr().solve(b_lagrange);
+  Eigen::VectorXd rotated_b_lagrange;
+  Eigen::VectorXd x;
+  solveFactorizedLagrangeSystem(A_lagrange_factor, b_lagrange,
+                                &rotated_b_lagrange, &x);
   solution = x.segment(0, H.rows());
 
   *objective_value = solution.transpose() * H * solution + f.dot(solution);
@@ -1267,6 +2666,50 @@ Eigen::VectorXd solveQuadraticProgram(const Eigen::MatrixXd& H,
   return solution;
 }
 
+void factorizeLagrangeSystem(
+    const Eigen::MatrixXd& H, const Eigen::MatrixXd& A_eq,
+    Eigen::MatrixXd* A_lagrange,
+    Eigen::ColPivHouseholderQR<Eigen::MatrixXd>* A_lagrange_factor) {
+  A_lagrange->setZero(H.rows() + A_eq.rows(), H.rows() + A_eq.rows());
+  A_lagrange->block(0, 0, H.cols(), H.rows()) = 2.0 * H.transpose();
+  A_lagrange->block(0, H.rows(), A_eq.cols(), A_eq.rows()) = A_eq.transpose();
+  A_lagrange->block(H.cols(), 0, A_eq.rows(), A_eq.cols()) = A_eq;
+
+  A_lagrange_factor->compute(*A_lagrange);
+}
+
+void solveFactorizedLagrangeSystem(
+    const Eigen::ColPivHouseholderQR<Eigen::MatrixXd>& A_lagrange_factor,
+    const Eigen::VectorXd& b_lagrange, Eigen::VectorXd* rotated_b_lagrange,
+    Eigen::VectorXd* lagrange_solution) {
+  // Same steps as ColPivHouseholderQR::solve, which allocates temporaries
+  // for the right hand side and the Householder reflections: x = P R^-1 Q' b
+  const int num_rows = A_lagrange_factor.rows();
+  const int num_nonzero_pivots = A_lagrange_factor.nonzeroPivots();
+
+  *rotated_b_lagrange = b_lagrange;
+  for (int k = 0; k < num_nonzero_pivots; k++) {
+    double householder_workspace;
+    rotated_b_lagrange->tail(num_rows - k).applyHouseholderOnTheLeft(
+        A_lagrange_factor.matrixQR().col(k).tail(num_rows - k - 1),
+        A_lagrange_factor.hCoeffs()(k), &householder_workspace);
+  }
+  A_lagrange_factor.matrixQR()
+      .topLeftCorner(num_nonzero_pivots, num_nonzero_pivots)
+      .triangularView<Eigen::Upper>()
+      .solveInPlace(rotated_b_lagrange->head(num_nonzero_pivots));
+
+  lagrange_solution->resize(A_lagrange_factor.cols());
+  for (int i = 0; i < num_nonzero_pivots; i++) {
+    (*lagrange_solution)(A_lagrange_factor.colsPermutation().indices()(i)) =
+        (*rotated_b_lagrange)(i);
+  }
+  for (int i = num_nonzero_pivots; i < A_lagrange_factor.cols(); i++) {
+    (*lagrange_solution)(A_lagrange_factor.colsPermutation().indices()(i)) =
+        0.0;
+  }
+}
+
 }  // namespace implementation
 
 }  // namespace minimum_snap_trajectories
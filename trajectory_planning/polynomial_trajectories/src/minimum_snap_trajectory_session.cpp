@@ -0,0 +1,286 @@
+#include "polynomial_trajectories/minimum_snap_trajectory_session.h"
+
+#include <ros/ros.h>
+
+#include "polynomial_trajectories/minimum_snap_trajectories.h"
+
+namespace polynomial_trajectories {
+
+MinimumSnapTrajectorySession::MinimumSnapTrajectorySession(
+    const Eigen::VectorXd& segment_times,
+    const quadrotor_common::TrajectoryPoint& start_state,
+    const quadrotor_common::TrajectoryPoint& end_state,
+    const PolynomialTrajectorySettings& trajectory_settings)
+    : valid_(false),
+      start_state_(start_state),
+      end_state_(end_state),
+      first_invalid_block_(0) {
+  const int num_segments = segment_times.size();
+
+  if (num_segments != int(trajectory_settings.way_points.size()) + 1) {
+    ROS_ERROR(
+        "[%s] Number of way points and segments are not agreeing. "
+        "(Need num_segments == num_waypoints + 1 for open trajectories.)",
+        ros::this_node::getName().c_str());
+    return;
+  }
+  for (int i = 0; i < num_segments; i++) {
+    if (!validSegmentTime(segment_times(i))) {
+      return;
+    }
+  }
+
+  if (trajectory_settings.optimize_heading ||
+      !trajectory_settings.heading_way_points.empty()) {
+    ROS_WARN(
+        "[%s] Heading way points are not supported by minimum snap trajectory "
+        "sessions and are ignored.",
+        ros::this_node::getName().c_str());
+  }
+
+  // Ensure trajectory settings that allow the free derivatives formulation
+  trajectory_settings_ =
+      minimum_snap_trajectories::implementation::
+          ensureFeasibleTrajectorySettings(
+              trajectory_settings,
+              2 * trajectory_settings.continuity_order + 1);
+  trajectory_settings_.minimum_snap_solver =
+      MinimumSnapSolver::FREE_DERIVATIVES;
+  trajectory_settings_.heading_way_points.clear();
+  trajectory_settings_.optimize_heading = false;
+
+  way_points_ =
+      minimum_snap_trajectories::implementation::addStartAndEndToWayPointList(
+          trajectory_settings.way_points, start_state.position,
+          end_state.position);
+  segment_times_.assign(segment_times.data(),
+                        segment_times.data() + num_segments);
+
+  segment_hessians_.resize(num_segments);
+  segment_solution_maps_.resize(num_segments);
+  segment_cost_matrices_.resize(num_segments);
+  for (int i = 0; i < num_segments; i++) {
+    updateSegment(i);
+  }
+
+  valid_ = true;
+}
+
+MinimumSnapTrajectorySession::~MinimumSnapTrajectorySession() {}
+
+bool MinimumSnapTrajectorySession::moveWayPoint(
+    const int index, const Eigen::Vector3d& position) {
+  if (!valid_ || index < 0 || index >= numWayPoints()) {
+    ROS_ERROR("[%s] Invalid way point index %d.",
+              ros::this_node::getName().c_str(), index);
+    return false;
+  }
+
+  // Way point positions only enter the right hand side of the reduced system
+  way_points_[index + 1] = position;
+
+  return true;
+}
+
+bool MinimumSnapTrajectorySession::insertWayPoint(
+    const int index, const Eigen::Vector3d& position,
+    const double segment_time_before, const double segment_time_after) {
+  if (!valid_ || index < 0 || index > numWayPoints()) {
+    ROS_ERROR("[%s] Invalid way point index %d.",
+              ros::this_node::getName().c_str(), index);
+    return false;
+  }
+  if (!validSegmentTime(segment_time_before) ||
+      !validSegmentTime(segment_time_after)) {
+    return false;
+  }
+
+  // The way point at index + 1 (including the start position) splits
+  // segment index into two
+  way_points_.insert(way_points_.begin() + index + 1, position);
+  segment_times_[index] = segment_time_before;
+  segment_times_.insert(segment_times_.begin() + index + 1,
+                        segment_time_after);
+  segment_hessians_.insert(segment_hessians_.begin() + index + 1,
+                           Eigen::MatrixXd());
+  segment_solution_maps_.insert(segment_solution_maps_.begin() + index + 1,
+                                Eigen::MatrixXd());
+  segment_cost_matrices_.insert(segment_cost_matrices_.begin() + index + 1,
+                                Eigen::MatrixXd());
+  updateSegment(index);
+  updateSegment(index + 1);
+  invalidateFactorization(index);
+
+  return true;
+}
+
+bool MinimumSnapTrajectorySession::removeWayPoint(
+    const int index, const double merged_segment_time) {
+  if (!valid_ || index < 0 || index >= numWayPoints()) {
+    ROS_ERROR("[%s] Invalid way point index %d.",
+              ros::this_node::getName().c_str(), index);
+    return false;
+  }
+  if (!validSegmentTime(merged_segment_time)) {
+    return false;
+  }
+
+  // The segments index and index + 1 are merged into one
+  way_points_.erase(way_points_.begin() + index + 1);
+  segment_times_[index] = merged_segment_time;
+  segment_times_.erase(segment_times_.begin() + index + 1);
+  segment_hessians_.erase(segment_hessians_.begin() + index + 1);
+  segment_solution_maps_.erase(segment_solution_maps_.begin() + index + 1);
+  segment_cost_matrices_.erase(segment_cost_matrices_.begin() + index + 1);
+  updateSegment(index);
+  invalidateFactorization(index);
+
+  return true;
+}
+
+bool MinimumSnapTrajectorySession::setSegmentTime(const int segment,
+                                                  const double segment_time) {
+  if (!valid_ || segment < 0 || segment >= numSegments()) {
+    ROS_ERROR("[%s] Invalid segment index %d.",
+              ros::this_node::getName().c_str(), segment);
+    return false;
+  }
+  if (!validSegmentTime(segment_time)) {
+    return false;
+  }
+
+  segment_times_[segment] = segment_time;
+  updateSegment(segment);
+  invalidateFactorization(segment);
+
+  return true;
+}
+
+PolynomialTrajectory MinimumSnapTrajectorySession::trajectory() {
+  if (!valid_) {
+    return PolynomialTrajectory();
+  }
+
+  namespace implementation = minimum_snap_trajectories::implementation;
+
+  const int num_segments = numSegments();
+
+  // Assembling the reduced system is cheap compared to computing the
+  // segment data, only its factorization is updated incrementally
+  std::vector<Eigen::MatrixXd> diagonal_blocks;
+  std::vector<Eigen::MatrixXd> lower_blocks;
+  implementation::generateFreeDerivativesSystem(
+      segment_cost_matrices_, false, &diagonal_blocks, &lower_blocks);
+  if (first_invalid_block_ < int(diagonal_blocks.size())) {
+    if (!implementation::factorBlockTridiagonalSystem(
+            diagonal_blocks, lower_blocks, first_invalid_block_,
+            &diagonal_factors_, &lower_factors_)) {
+      ROS_ERROR("[%s] Could not solve quadratic program.",
+                ros::this_node::getName().c_str());
+      return PolynomialTrajectory();
+    }
+  }
+  first_invalid_block_ = diagonal_blocks.size();
+
+  PolynomialTrajectory minimum_snap_trajectory;
+  minimum_snap_trajectory.trajectory_type =
+      polynomial_trajectories::TrajectoryType::MINIMUM_SNAP;
+  minimum_snap_trajectory.number_of_segments = num_segments;
+  minimum_snap_trajectory.segment_times =
+      Eigen::Map<const Eigen::VectorXd>(segment_times_.data(), num_segments);
+
+  minimum_snap_trajectory.start_state = start_state_;
+  minimum_snap_trajectory.start_state.time_from_start = ros::Duration(0.0);
+  minimum_snap_trajectory.end_state = end_state_;
+
+  minimum_snap_trajectory.optimization_cost = 0.0;
+  minimum_snap_trajectory.T =
+      ros::Duration(minimum_snap_trajectory.segment_times.sum());
+  minimum_snap_trajectory.end_state.time_from_start = minimum_snap_trajectory.T;
+
+  std::vector<Eigen::MatrixXd> coefficients;
+  // Compute trajectory for each spatial dimension
+  for (int d = 0; d < 3; d++) {
+    Eigen::VectorXd way_points_d = Eigen::VectorXd::Zero(num_segments + 1);
+    for (int i = 0; i < num_segments + 1; i++) {
+      way_points_d(i) = way_points_[i](d);
+    }
+
+    const Eigen::Vector3d start_conditions(start_state_.velocity(d),
+                                           start_state_.acceleration(d),
+                                           start_state_.jerk(d));
+    const Eigen::Vector3d end_conditions(end_state_.velocity(d),
+                                         end_state_.acceleration(d),
+                                         end_state_.jerk(d));
+
+    const Eigen::VectorXd f = implementation::generateFVector(
+        trajectory_settings_, way_points_d, num_segments);
+    Eigen::MatrixXd way_point_values =
+        implementation::generateFixedWayPointValues(
+            trajectory_settings_, way_points_d, start_conditions,
+            end_conditions, false);
+
+    const Eigen::VectorXd rhs = implementation::generateFreeDerivativesRhs(
+        segment_solution_maps_, segment_hessians_, segment_cost_matrices_, f,
+        way_point_values, false);
+    implementation::setFreeWayPointDerivatives(
+        implementation::solveFactoredBlockTridiagonalSystem(
+            diagonal_factors_, lower_factors_, rhs),
+        false, &way_point_values);
+
+    double cost_dimension;
+    coefficients.push_back(implementation::generateFreeDerivativesCoefficients(
+        segment_solution_maps_, segment_hessians_, f, way_point_values,
+        &cost_dimension));
+    minimum_snap_trajectory.optimization_cost += cost_dimension;
+  }
+
+  minimum_snap_trajectory.coeff =
+      implementation::reorganiceCoefficientsSegmentWise(
+          coefficients, num_segments, trajectory_settings_.polynomial_order);
+
+  return minimum_snap_trajectory;
+}
+
+int MinimumSnapTrajectorySession::numWayPoints() const {
+  return int(way_points_.size()) - 2;
+}
+
+int MinimumSnapTrajectorySession::numSegments() const {
+  return segment_times_.size();
+}
+
+void MinimumSnapTrajectorySession::updateSegment(const int segment) {
+  namespace implementation = minimum_snap_trajectories::implementation;
+
+  Eigen::VectorXd tau_dot(1);
+  tau_dot(0) = 1.0 / segment_times_[segment];
+
+  segment_hessians_[segment] =
+      implementation::generateHMatrix(trajectory_settings_, 1, tau_dot);
+  segment_solution_maps_[segment] = implementation::generateSegmentSolutionMap(
+      trajectory_settings_, tau_dot(0), segment_hessians_[segment]);
+  segment_cost_matrices_[segment] = implementation::generateSegmentCostMatrix(
+      segment_solution_maps_[segment], segment_hessians_[segment]);
+}
+
+void MinimumSnapTrajectorySession::invalidateFactorization(
+    const int first_segment) {
+  // Segment i couples the free derivatives at way points i and i + 1 which
+  // are the blocks i - 1 and i of the reduced system
+  first_invalid_block_ =
+      std::min(first_invalid_block_, std::max(first_segment - 1, 0));
+}
+
+bool MinimumSnapTrajectorySession::validSegmentTime(
+    const double segment_time) const {
+  if (!(segment_time > 0.0)) {
+    ROS_ERROR("[%s] Segment times must be positive.",
+              ros::this_node::getName().c_str());
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace polynomial_trajectories
@@ -1,9 +1,163 @@
 #include "polynomial_trajectories/polynomial_trajectories_common.h"
 
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include <quadrotor_common/math_common.h>
 #include <ros/ros.h>
 
+#include "polynomial_trajectories/bernstein_polynomials.h"
+#include "polynomial_trajectories/thread_pool.h"
+
 namespace polynomial_trajectories {
 
+namespace {
+
+// Number of times a segment is halved before its bounds are considered
+// inconclusive
+static constexpr int kMaxBernsteinSubdivisions = 6;
+
+bool areBernsteinBoundsWithinLimits(
+    const Eigen::MatrixXd& velocity_control_points,
+    const Eigen::MatrixXd& acceleration_control_points,
+    const Eigen::MatrixXd& jerk_control_points, const double max_velocity,
+    const double max_normalized_thrust, const double max_roll_pitch_rate,
+    const int remaining_subdivisions) {
+  const Eigen::Vector3d gravity(0.0, 0.0, 9.81);
+  const Eigen::MatrixXd thrust_control_points =
+      acceleration_control_points.colwise() + gravity;
+
+  // The first and last control points lie on the trajectory, so a violation
+  // there can not be resolved by subdividing
+  const int last_velocity = velocity_control_points.cols() - 1;
+  const int last_thrust = thrust_control_points.cols() - 1;
+  if (velocity_control_points.col(0).norm() > max_velocity ||
+      velocity_control_points.col(last_velocity).norm() > max_velocity ||
+      thrust_control_points.col(0).norm() > max_normalized_thrust ||
+      thrust_control_points.col(last_thrust).norm() > max_normalized_thrust) {
+    return false;
+  }
+
+  const double velocity_bound =
+      velocity_control_points.colwise().norm().maxCoeff();
+  const double thrust_bound = thrust_control_points.colwise().norm().maxCoeff();
+
+  // The roll/pitch rate equals |thrust x jerk| / |thrust|^2. A lower bound on
+  // the thrust is its smallest projection onto the mean thrust direction.
+  double roll_pitch_rate_bound = std::numeric_limits<double>::infinity();
+  const Eigen::Vector3d mean_thrust = thrust_control_points.rowwise().mean();
+  if (mean_thrust.norm() > 0.0) {
+    const double min_thrust =
+        (mean_thrust.normalized().transpose() * thrust_control_points)
+            .minCoeff();
+    if (min_thrust > 0.0) {
+      roll_pitch_rate_bound =
+          computeBernsteinCrossProduct(thrust_control_points,
+                                       jerk_control_points)
+              .colwise()
+              .norm()
+              .maxCoeff() /
+          (min_thrust * min_thrust);
+    }
+  }
+
+  if (velocity_bound <= max_velocity && thrust_bound <= max_normalized_thrust &&
+      roll_pitch_rate_bound <= max_roll_pitch_rate) {
+    return true;
+  }
+
+  if (remaining_subdivisions <= 0) {
+    return false;
+  }
+
+  Eigen::MatrixXd velocity_halves[2];
+  Eigen::MatrixXd acceleration_halves[2];
+  Eigen::MatrixXd jerk_halves[2];
+  splitBernsteinControlPoints(velocity_control_points, &velocity_halves[0],
+                              &velocity_halves[1]);
+  splitBernsteinControlPoints(acceleration_control_points,
+                              &acceleration_halves[0],
+                              &acceleration_halves[1]);
+  splitBernsteinControlPoints(jerk_control_points, &jerk_halves[0],
+                              &jerk_halves[1]);
+  for (int i = 0; i < 2; i++) {
+    if (!areBernsteinBoundsWithinLimits(
+            velocity_halves[i], acceleration_halves[i], jerk_halves[i],
+            max_velocity, max_normalized_thrust, max_roll_pitch_rate,
+            remaining_subdivisions - 1)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Time between two samples of computeQuadRelevantMaxima
+static constexpr double kMaximaSamplingTime = 0.01;
+// Number of sample times that are evaluated together in one vectorized pass
+static constexpr int kMaximaSampleBatchSize = 8;
+
+typedef Eigen::Array<double, kMaximaSampleBatchSize, 1> SampleBatch;
+
+// Updates the squared velocity, normalized thrust and roll/pitch rate maxima
+// with the values at the normalized sample times taus of a segment whose
+// coefficients are given highest power first
+void updateSquaredQuadRelevantMaxima(
+    const Eigen::Ref<const Eigen::MatrixXd>& coefficients,
+    const double tau_dot, const SampleBatch& taus,
+    Eigen::Vector3d* squared_maxima) {
+  const double gravity = 9.81;
+
+  SampleBatch squared_velocity = SampleBatch::Zero();
+  SampleBatch squared_thrust = SampleBatch::Zero();
+  SampleBatch squared_jerk = SampleBatch::Zero();
+  SampleBatch thrust_dot_jerk = SampleBatch::Zero();
+  for (int d = 0; d < 3; d++) {
+    // Horner's scheme as in evaluatePolynomialDerivatives, but for all sample
+    // times at once. partial_sums[k] ends up holding the k-th derivative
+    // divided by k!.
+    SampleBatch partial_sums[4];
+    for (int k = 0; k < 4; k++) {
+      partial_sums[k].setZero();
+    }
+    for (int j = 0; j < coefficients.cols(); j++) {
+      for (int k = std::min(j, 3); k > 0; k--) {
+        partial_sums[k] = partial_sums[k] * taus + partial_sums[k - 1];
+      }
+      partial_sums[0] = partial_sums[0] * taus + coefficients(d, j);
+    }
+
+    const SampleBatch velocity = tau_dot * partial_sums[1];
+    SampleBatch thrust = 2.0 * pow(tau_dot, 2.0) * partial_sums[2];
+    if (d == 2) {
+      thrust += gravity;
+    }
+    const SampleBatch jerk = 6.0 * pow(tau_dot, 3.0) * partial_sums[3];
+
+    squared_velocity += velocity.square();
+    squared_thrust += thrust.square();
+    squared_jerk += jerk.square();
+    thrust_dot_jerk += thrust * jerk;
+  }
+
+  // Same as computeRollPitchRateNormFromTrajectoryPoint, the jerk orthogonal
+  // to the thrust direction divided by the thrust
+  const SampleBatch squared_roll_pitch_rate =
+      ((squared_jerk - thrust_dot_jerk.square() / squared_thrust) /
+       squared_thrust)
+          .max(0.0);
+
+  squared_maxima->x() =
+      std::max(squared_maxima->x(), squared_velocity.maxCoeff());
+  squared_maxima->y() =
+      std::max(squared_maxima->y(), squared_thrust.maxCoeff());
+  squared_maxima->z() =
+      std::max(squared_maxima->z(), squared_roll_pitch_rate.maxCoeff());
+}
+
+}  // namespace
+
 quadrotor_common::TrajectoryPoint getPointFromTrajectory(
     const PolynomialTrajectory& trajectory,
     const ros::Duration& time_from_start) {
@@ -23,8 +177,6 @@ quadrotor_common::TrajectoryPoint getPointFromTrajectory(
   }
 
   const int dimension = trajectory.coeff[0].rows();
-  const int poly_order = trajectory.coeff[0].cols() - 1;
-  const int num_polynoms = trajectory.number_of_segments;
 
   // Check if the dimension of the computed trajectory is at least 3
   if (dimension < 3) {
@@ -63,30 +215,21 @@ quadrotor_common::TrajectoryPoint getPointFromTrajectory(
     }
   }
 
+  // Position, heading for trajectories with four dimensions, and their first
+  // four derivatives in the columns
+  Eigen::Matrix<double, 4, 5> derivatives;
+
   if (trajectory.trajectory_type ==
       polynomial_trajectories::TrajectoryType::FULLY_CONSTRAINED) {
-    const int number_of_coefficients = trajectory.coeff[0].cols();
-
-    for (int axis = 0; axis < 3; axis++) {
-      desired_state.position(axis) =
-          trajectory.coeff[0].row(axis) *
-          (dVec(number_of_coefficients, 0).asDiagonal() *
-           tVec(number_of_coefficients, 0, time_eval));
-      desired_state.velocity(axis) =
-          trajectory.coeff[0].row(axis) *
-          (dVec(number_of_coefficients, 1).asDiagonal() *
-           tVec(number_of_coefficients, 1, time_eval));
-      desired_state.acceleration(axis) =
-          trajectory.coeff[0].row(axis) *
-          (dVec(number_of_coefficients, 2).asDiagonal() *
-           tVec(number_of_coefficients, 2, time_eval));
-      desired_state.jerk(axis) = trajectory.coeff[0].row(axis) *
-                                 (dVec(number_of_coefficients, 3).asDiagonal() *
-                                  tVec(number_of_coefficients, 3, time_eval));
-      desired_state.snap(axis) = trajectory.coeff[0].row(axis) *
-                                 (dVec(number_of_coefficients, 4).asDiagonal() *
-                                  tVec(number_of_coefficients, 4, time_eval));
-    }
+    // Coefficients are given in real time, lowest power first
+    evaluatePolynomialDerivatives(trajectory.coeff[0], false, time_eval,
+                                  &derivatives);
+
+    desired_state.position = derivatives.col(0).head<3>();
+    desired_state.velocity = derivatives.col(1).head<3>();
+    desired_state.acceleration = derivatives.col(2).head<3>();
+    desired_state.jerk = derivatives.col(3).head<3>();
+    desired_state.snap = derivatives.col(4).head<3>();
   } else if (trajectory.trajectory_type ==
                  polynomial_trajectories::TrajectoryType::MINIMUM_SNAP ||
              trajectory.trajectory_type ==
@@ -108,65 +251,32 @@ quadrotor_common::TrajectoryPoint getPointFromTrajectory(
       }
     }
 
-    // Compute desired state from trajectory
-    Eigen::Vector3d desired_position = Eigen::Vector3d::Zero();
-    Eigen::Vector3d desired_velocity = Eigen::Vector3d::Zero();
-    Eigen::Vector3d desired_acceleration = Eigen::Vector3d::Zero();
-    Eigen::Vector3d desired_jerk = Eigen::Vector3d::Zero();
-    Eigen::Vector3d desired_snap = Eigen::Vector3d::Zero();
-
-    Eigen::VectorXd velocity_factorials = computeFactorials(poly_order, 0);
-    Eigen::VectorXd acceleration_factorials =
-        computeFactorials(poly_order - 1, 1);
-    Eigen::VectorXd jerk_factorials = computeFactorials(poly_order - 2, 2);
-    Eigen::VectorXd snap_factorials = computeFactorials(poly_order - 3, 3);
-
     // time with which coefficients are computed
     const double tau = (time_eval - trajectory.segment_times.head(m).sum()) /
                        trajectory.segment_times(m);
-
-    Eigen::VectorXd tau_dot(num_polynoms);
-    for (int i = 0; i < num_polynoms; i++) {
-      tau_dot(i) = 1.0 / trajectory.segment_times(i);
+    const double tau_dot = 1.0 / trajectory.segment_times(m);
+
+    // Coefficients are given in normalized time, highest power first
+    evaluatePolynomialDerivatives(trajectory.coeff[m], true, tau,
+                                  &derivatives);
+
+    desired_state.position = derivatives.col(0).head<3>();
+    desired_state.velocity = tau_dot * derivatives.col(1).head<3>();
+    desired_state.acceleration =
+        pow(tau_dot, 2.0) * derivatives.col(2).head<3>();
+    desired_state.jerk = pow(tau_dot, 3.0) * derivatives.col(3).head<3>();
+    desired_state.snap = pow(tau_dot, 4.0) * derivatives.col(4).head<3>();
+    if (dimension > 3) {
+      desired_state.heading =
+          quadrotor_common::wrapMinusPiToPi(derivatives(3, 0));
+      desired_state.heading_rate = tau_dot * derivatives(3, 1);
+      desired_state.heading_acceleration =
+          pow(tau_dot, 2.0) * derivatives(3, 2);
+    } else {
+      desired_state.heading = 0.0;
+      desired_state.heading_rate = 0.0;
+      desired_state.heading_acceleration = 0.0;
     }
-
-    for (int d = 0; d < 3; d++) {
-      Eigen::MatrixXd segment_coefficients = trajectory.coeff[m];
-      for (int i = 0; i < poly_order + 1; i++) {
-        desired_position(d) +=
-            segment_coefficients(d, i) * pow(tau, poly_order - i);
-      }
-      for (int i = 0; i < poly_order; i++) {
-        desired_velocity(d) += velocity_factorials(poly_order - 1 - i) *
-                               segment_coefficients(d, i) *
-                               pow(tau, poly_order - 1 - i) * tau_dot(m);
-      }
-      for (int i = 0; i < poly_order - 1; i++) {
-        desired_acceleration(d) += acceleration_factorials(poly_order - 2 - i) *
-                                   segment_coefficients(d, i) *
-                                   pow(tau, poly_order - 2 - i) *
-                                   pow(tau_dot(m), 2.0);
-      }
-      for (int i = 0; i < poly_order - 2; i++) {
-        desired_jerk(d) += jerk_factorials(poly_order - 3 - i) *
-                           segment_coefficients(d, i) *
-                           pow(tau, poly_order - 3 - i) * pow(tau_dot(m), 3.0);
-      }
-      for (int i = 0; i < poly_order - 3; i++) {
-        desired_snap(d) += snap_factorials(poly_order - 4 - i) *
-                           segment_coefficients(d, i) *
-                           pow(tau, poly_order - 4 - i) * pow(tau_dot(m), 4.0);
-      }
-    }
-
-    desired_state.position = desired_position;
-    desired_state.velocity = desired_velocity;
-    desired_state.acceleration = desired_acceleration;
-    desired_state.jerk = desired_jerk;
-    desired_state.snap = desired_snap;
-    desired_state.heading = 0.0;
-    desired_state.heading_rate = 0.0;
-    desired_state.heading_acceleration = 0.0;
   }
 
   desired_state.time_from_start = ros::Duration(time_eval);
@@ -174,20 +284,62 @@ quadrotor_common::TrajectoryPoint getPointFromTrajectory(
   return desired_state;
 }
 
+void evaluatePolynomialDerivatives(
+    const Eigen::Ref<const Eigen::MatrixXd>& coefficients,
+    const bool highest_power_first, const double t,
+    Eigen::Matrix<double, 4, 5>* derivatives) {
+  const int num_derivatives = derivatives->cols();
+  const int num_coefficients = coefficients.cols();
+  const bool four_dimensions = coefficients.rows() > 3;
+
+  // Horner's scheme extended to derivatives. After processing a coefficient,
+  // partial_sums[k] holds the k-th derivative divided by k! of the polynomial
+  // formed by the coefficients processed so far. All dimensions are processed
+  // together in one packet, padded for three dimensions.
+  Eigen::Array4d partial_sums[5];
+  for (int k = 0; k < num_derivatives; k++) {
+    partial_sums[k].setZero();
+  }
+
+  for (int j = 0; j < num_coefficients; j++) {
+    const int i = highest_power_first ? j : num_coefficients - 1 - j;
+    const Eigen::Array4d coefficient(
+        coefficients(0, i), coefficients(1, i), coefficients(2, i),
+        four_dimensions ? coefficients(3, i) : 0.0);
+    for (int k = std::min(j, num_derivatives - 1); k > 0; k--) {
+      partial_sums[k] = partial_sums[k] * t + partial_sums[k - 1];
+    }
+    partial_sums[0] = partial_sums[0] * t + coefficient;
+  }
+
+  double factorial = 1.0;
+  for (int k = 0; k < num_derivatives; k++) {
+    if (k > 0) {
+      factorial *= k;
+    }
+    derivatives->col(k) = factorial * partial_sums[k].matrix();
+  }
+}
+
 Eigen::VectorXd computeFactorials(const int length, const int order) {
   Eigen::VectorXd factorials = Eigen::VectorXd::Zero(length);
 
   for (int i = 0; i < length; i++) {
-    int temp = 1;
-    for (int k = 0; k < order + 1; k++) {
-      temp *= (i + 1 + k);
-    }
-    factorials(i) = temp;
+    factorials(i) = computeFactorial(i, order);
   }
 
   return factorials;
 }
 
+double computeFactorial(const int index, const int order) {
+  int factorial = 1;
+  for (int k = 0; k < order + 1; k++) {
+    factorial *= (index + 1 + k);
+  }
+
+  return factorial;
+}
+
 // TODO: These two functions (computeFactorials and dVec) are very similar,
 // they should be mergable
 Eigen::VectorXd dVec(const int number_of_coefficients,
@@ -264,45 +416,178 @@ void computeQuadRelevantMaxima(const PolynomialTrajectory& trajectory,
                                double* maximal_velocity,
                                double* maximal_normalized_thrust,
                                double* maximal_roll_pitch_rate) {
+  computeQuadRelevantMaxima(trajectory, nullptr, maximal_velocity,
+                            maximal_normalized_thrust,
+                            maximal_roll_pitch_rate);
+}
+
+void computeQuadRelevantMaxima(const PolynomialTrajectory& trajectory,
+                               ThreadPool* thread_pool,
+                               double* maximal_velocity,
+                               double* maximal_normalized_thrust,
+                               double* maximal_roll_pitch_rate) {
   if (trajectory.trajectory_type ==
       polynomial_trajectories::TrajectoryType::UNDEFINED) {
     ROS_ERROR("Could not compute maxima since trajectory type is UNDEFINED");
     return;
   }
+  if (trajectory.coeff.empty() || trajectory.coeff.dimension() < 3) {
+    ROS_ERROR("[%s] Could not compute maxima of a trajectory without "
+              "three dimensional polynomial coefficients.",
+              ros::this_node::getName().c_str());
+    return;
+  }
 
-  *maximal_velocity = 0.0;
-  *maximal_normalized_thrust = 0.0;
-  *maximal_roll_pitch_rate = 0.0;
-
-  const Eigen::Vector3d gravity(0.0, 0.0, 9.81);
+  // All trajectory types are evaluated as segments in normalized time with
+  // the coefficients given highest power first
+  const PolynomialCoefficients* coefficients = &trajectory.coeff;
+  Eigen::VectorXd segment_times = trajectory.segment_times;
+  PolynomialCoefficients normalized_coefficients;
+  if (trajectory.trajectory_type ==
+      polynomial_trajectories::TrajectoryType::FULLY_CONSTRAINED) {
+    const double duration = trajectory.T.toSec();
+    const int num_coefficients = trajectory.coeff.numCoefficients();
+    normalized_coefficients.resize(1, trajectory.coeff.dimension(),
+                                   num_coefficients);
+    double duration_power = 1.0;
+    for (int i = 0; i < num_coefficients; i++) {
+      normalized_coefficients[0].col(num_coefficients - 1 - i) =
+          duration_power * trajectory.coeff[0].col(i);
+      duration_power *= duration;
+    }
+    coefficients = &normalized_coefficients;
+    segment_times = Eigen::VectorXd::Constant(1, duration);
+  }
+  const int num_segments = coefficients->size();
+  if (segment_times.size() != num_segments) {
+    ROS_ERROR("[%s] Number of segment times and polynomials are not agreeing.",
+              ros::this_node::getName().c_str());
+    return;
+  }
+  Eigen::VectorXd segment_end_times(num_segments);
+  double segment_end_time = 0.0;
+  for (int i = 0; i < num_segments; i++) {
+    segment_end_time += segment_times(i);
+    segment_end_times(i) = segment_end_time;
+  }
 
-  double dt = 0.01;
+  // The samples k * kMaximaSamplingTime up to the duration are split into
+  // contiguous intervals, one per thread. Within each interval, samples of the
+  // same segment are evaluated in batches.
+  const int num_samples =
+      static_cast<int>(trajectory.T.toSec() / kMaximaSamplingTime) + 1;
+  const int num_threads =
+      thread_pool == nullptr ? 1 : thread_pool->numWorkerThreads() + 1;
+  const int num_tasks = std::max(1, std::min(num_threads, num_samples));
+  std::vector<Eigen::Vector3d> squared_maxima(num_tasks,
+                                              Eigen::Vector3d::Zero());
+  const auto evaluate_samples = [&](const int task) {
+    const int end_sample = (task + 1) * num_samples / num_tasks;
+    int sample = task * num_samples / num_tasks;
+    int segment = 0;
+    while (sample < end_sample) {
+      // A sample at the end of a segment belongs to that segment, as in
+      // getPointFromTrajectory
+      while (segment < num_segments - 1 &&
+             sample * kMaximaSamplingTime > segment_end_times(segment)) {
+        segment++;
+      }
+      const double segment_start_time =
+          segment_end_times(segment) - segment_times(segment);
+
+      SampleBatch taus;
+      int batch_size = 0;
+      do {
+        taus(batch_size) = (sample * kMaximaSamplingTime - segment_start_time) /
+                           segment_times(segment);
+        batch_size++;
+        sample++;
+      } while (batch_size < kMaximaSampleBatchSize && sample < end_sample &&
+               (segment == num_segments - 1 ||
+                sample * kMaximaSamplingTime <= segment_end_times(segment)));
+      // Repeating a sample time does not change the maxima
+      taus.tail(kMaximaSampleBatchSize - batch_size)
+          .setConstant(taus(batch_size - 1));
+
+      updateSquaredQuadRelevantMaxima((*coefficients)[segment].topRows(3),
+                                      1.0 / segment_times(segment), taus,
+                                      &squared_maxima[task]);
+    }
+  };
 
-  double t = 0.0;
-  while (t <= trajectory.T.toSec()) {
-    quadrotor_common::TrajectoryPoint state =
-        getPointFromTrajectory(trajectory, ros::Duration(t));
+  if (num_tasks > 1) {
+    thread_pool->parallelFor(num_tasks, evaluate_samples);
+  } else {
+    evaluate_samples(0);
+  }
 
-    const double velocity = state.velocity.norm();
+  Eigen::Vector3d maxima = Eigen::Vector3d::Zero();
+  for (const Eigen::Vector3d& task_maxima : squared_maxima) {
+    maxima = maxima.cwiseMax(task_maxima);
+  }
+  maxima = maxima.cwiseSqrt();
 
-    const double thrust = (state.acceleration + gravity).norm();
+  *maximal_velocity = maxima.x();
+  *maximal_normalized_thrust = maxima.y();
+  *maximal_roll_pitch_rate = maxima.z();
+}
 
-    const double roll_pitch_rate =
-        computeRollPitchRateNormFromTrajectoryPoint(state);
+bool isTrajectoryGuaranteedFeasibleUnderConstraints(
+    const PolynomialTrajectory& trajectory, const double max_velocity,
+    const double max_normalized_thrust, const double max_roll_pitch_rate) {
+  if (trajectory.trajectory_type ==
+          polynomial_trajectories::TrajectoryType::UNDEFINED ||
+      trajectory.coeff.empty() || trajectory.coeff[0].rows() < 3) {
+    return false;
+  }
 
-    if (velocity > *maximal_velocity) {
-      *maximal_velocity = velocity;
+  // Coefficients in normalized time, lowest power first, and the duration of
+  // every segment
+  std::vector<Eigen::MatrixXd> segment_coefficients;
+  std::vector<double> segment_durations;
+  if (trajectory.trajectory_type ==
+      polynomial_trajectories::TrajectoryType::FULLY_CONSTRAINED) {
+    const double duration = trajectory.T.toSec();
+    Eigen::MatrixXd coefficients = trajectory.coeff[0].topRows(3);
+    double duration_power = 1.0;
+    for (int i = 0; i < coefficients.cols(); i++) {
+      coefficients.col(i) *= duration_power;
+      duration_power *= duration;
     }
-    if (thrust > *maximal_normalized_thrust) {
-      *maximal_normalized_thrust = thrust;
+    segment_coefficients.push_back(coefficients);
+    segment_durations.push_back(duration);
+  } else {
+    for (int i = 0; i < trajectory.number_of_segments; i++) {
+      segment_coefficients.push_back(
+          trajectory.coeff[i].topRows(3).rowwise().reverse());
+      segment_durations.push_back(trajectory.segment_times(i));
     }
+  }
 
-    if (roll_pitch_rate > *maximal_roll_pitch_rate) {
-      *maximal_roll_pitch_rate = roll_pitch_rate;
+  for (size_t i = 0; i < segment_coefficients.size(); i++) {
+    if (segment_durations[i] <= 0.0) {
+      return false;
+    }
+    const Eigen::MatrixXd position_control_points =
+        computeBernsteinControlPoints(segment_coefficients[i]);
+    const Eigen::MatrixXd velocity_control_points =
+        differentiateBernsteinControlPoints(position_control_points,
+                                            segment_durations[i]);
+    const Eigen::MatrixXd acceleration_control_points =
+        differentiateBernsteinControlPoints(velocity_control_points,
+                                            segment_durations[i]);
+    const Eigen::MatrixXd jerk_control_points =
+        differentiateBernsteinControlPoints(acceleration_control_points,
+                                            segment_durations[i]);
+    if (!areBernsteinBoundsWithinLimits(
+            velocity_control_points, acceleration_control_points,
+            jerk_control_points, max_velocity, max_normalized_thrust,
+            max_roll_pitch_rate, kMaxBernsteinSubdivisions)) {
+      return false;
     }
-
-    t += dt;
   }
+
+  return true;
 }
 
 bool isStartAndEndStateFeasibleUnderConstraints(
@@ -2,6 +2,35 @@
 
 namespace polynomial_trajectories {
 
+PolynomialCoefficients::PolynomialCoefficients()
+    : num_segments_(0), dimension_(0), num_coefficients_(0), buffer_() {}
+
+PolynomialCoefficients::PolynomialCoefficients(
+    const std::vector<Eigen::MatrixXd>& segments)
+    : PolynomialCoefficients() {
+  if (segments.empty()) {
+    return;
+  }
+
+  resize(segments.size(), segments.front().rows(), segments.front().cols());
+  for (int i = 0; i < num_segments_; i++) {
+    (*this)[i] = segments[i];
+  }
+}
+
+void PolynomialCoefficients::resize(const int num_segments,
+                                    const int dimension,
+                                    const int num_coefficients) {
+  num_segments_ = num_segments;
+  dimension_ = dimension;
+  num_coefficients_ = num_coefficients;
+  buffer_.resize(num_segments * dimension * num_coefficients);
+}
+
+void PolynomialCoefficients::setZero() { buffer_.setZero(); }
+
+void PolynomialCoefficients::clear() { resize(0, 0, 0); }
+
 PolynomialTrajectory::PolynomialTrajectory()
     : trajectory_type(TrajectoryType::UNDEFINED),
       coeff(),
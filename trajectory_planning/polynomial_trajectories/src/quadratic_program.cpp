@@ -0,0 +1,226 @@
+#include "polynomial_trajectories/quadratic_program.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace polynomial_trajectories {
+
+namespace {
+
+// Constraints are considered violated if their slack is below
+// -kFeasibilityTolerance * (1 + |b|)
+static constexpr double kFeasibilityTolerance = 1e-9;
+// A constraint is linearly dependent on the active ones if the primal step
+// direction vanishes relative to the unconstrained step
+static constexpr double kLinearDependenceTolerance = 1e-10;
+
+Eigen::MatrixXd activeNormals(const Eigen::MatrixXd& normals,
+                              const std::vector<int>& active_set) {
+  Eigen::MatrixXd active_normals(normals.rows(), active_set.size());
+  for (size_t j = 0; j < active_set.size(); j++) {
+    active_normals.col(j) = normals.col(active_set[j]);
+  }
+  return active_normals;
+}
+
+// Dual active set method of Goldfarb and Idnani for
+// min 0.5 y' Q y + c' y subject to normals' y >= offsets with Q positive
+// definite. active_set and multipliers have to describe a dual feasible
+// starting point for y.
+bool solveDualActiveSet(const Eigen::LLT<Eigen::MatrixXd>& Q_factor,
+                        const Eigen::MatrixXd& normals,
+                        const Eigen::VectorXd& offsets,
+                        std::vector<int>* active_set,
+                        Eigen::VectorXd* multipliers, Eigen::VectorXd* y) {
+  const int num_constraints = normals.cols();
+  const int max_steps = 10 * (num_constraints + y->size()) + 10;
+
+  int num_steps = 0;
+  while (true) {
+    // Add the most violated constraint
+    const Eigen::VectorXd slacks = normals.transpose() * (*y) - offsets;
+    int violated = -1;
+    double min_slack = 0.0;
+    for (int i = 0; i < num_constraints; i++) {
+      if (std::find(active_set->begin(), active_set->end(), i) !=
+          active_set->end()) {
+        continue;
+      }
+      if (slacks(i) < -kFeasibilityTolerance * (1.0 + std::abs(offsets(i))) &&
+          slacks(i) < min_slack) {
+        violated = i;
+        min_slack = slacks(i);
+      }
+    }
+    if (violated < 0) {
+      return true;
+    }
+
+    const Eigen::VectorXd n_p = normals.col(violated);
+    const Eigen::VectorXd unconstrained_step = Q_factor.solve(n_p);
+    double violated_multiplier = 0.0;
+    while (true) {
+      if (++num_steps > max_steps) {
+        return false;
+      }
+
+      // Primal step direction z in the null space of the active normals N
+      // and the change of the active multipliers r
+      const Eigen::MatrixXd N = activeNormals(normals, *active_set);
+      Eigen::VectorXd z = unconstrained_step;
+      Eigen::VectorXd r(active_set->size());
+      if (!active_set->empty()) {
+        const Eigen::MatrixXd Q_inverse_N = Q_factor.solve(N);
+        const Eigen::LLT<Eigen::MatrixXd> M_factor(N.transpose() *
+                                                   Q_inverse_N);
+        if (M_factor.info() != Eigen::Success) {
+          return false;
+        }
+        r = M_factor.solve(N.transpose() * unconstrained_step);
+        z -= Q_inverse_N * r;
+      }
+
+      // Largest step that keeps the multipliers non-negative
+      double partial_step = std::numeric_limits<double>::infinity();
+      int blocking = -1;
+      for (int j = 0; j < r.size(); j++) {
+        if (r(j) > 0.0 && (*multipliers)(j) / r(j) < partial_step) {
+          partial_step = (*multipliers)(j) / r(j);
+          blocking = j;
+        }
+      }
+      // Step that satisfies the violated constraint
+      double full_step = std::numeric_limits<double>::infinity();
+      if (z.norm() > kLinearDependenceTolerance * unconstrained_step.norm()) {
+        full_step = -(n_p.dot(*y) - offsets(violated)) / z.dot(n_p);
+      }
+
+      if (blocking < 0 && std::isinf(full_step)) {
+        // The violated constraint can not be satisfied
+        return false;
+      }
+
+      const double step = std::min(partial_step, full_step);
+      if (!std::isinf(full_step)) {
+        *y += step * z;
+      }
+      *multipliers -= step * r;
+      violated_multiplier += step;
+
+      if (full_step <= partial_step) {
+        active_set->push_back(violated);
+        multipliers->conservativeResize(multipliers->size() + 1);
+        (*multipliers)(multipliers->size() - 1) = violated_multiplier;
+        break;
+      }
+
+      // Drop the blocking constraint and try again
+      active_set->erase(active_set->begin() + blocking);
+      Eigen::VectorXd remaining_multipliers(multipliers->size() - 1);
+      remaining_multipliers << multipliers->head(blocking),
+          multipliers->tail(multipliers->size() - 1 - blocking);
+      *multipliers = remaining_multipliers;
+    }
+  }
+}
+
+}  // namespace
+
+bool solveActiveSetQuadraticProgram(
+    const Eigen::MatrixXd& H, const Eigen::VectorXd& f,
+    const Eigen::MatrixXd& A_eq, const Eigen::VectorXd& b_eq,
+    const Eigen::MatrixXd& A_ineq, const Eigen::VectorXd& b_ineq,
+    std::vector<int>* active_set, Eigen::VectorXd* solution,
+    double* objective_value) {
+  const int num_variables = H.rows();
+  const int num_equalities = A_eq.rows();
+
+  // Eliminate the equality constraints, x = x_p + Z y where the columns of Z
+  // span the null space of A_eq
+  Eigen::VectorXd x_p = Eigen::VectorXd::Zero(num_variables);
+  Eigen::MatrixXd Z = Eigen::MatrixXd::Identity(num_variables, num_variables);
+  if (num_equalities > 0) {
+    const Eigen::ColPivHouseholderQR<Eigen::MatrixXd> qr(A_eq.transpose());
+    if (qr.rank() < num_equalities) {
+      return false;
+    }
+    const Eigen::MatrixXd Q_full = qr.householderQ();
+    const Eigen::MatrixXd range_basis = Q_full.leftCols(num_equalities);
+    x_p = range_basis * (A_eq * range_basis).partialPivLu().solve(b_eq);
+    Z = Q_full.rightCols(num_variables - num_equalities);
+  }
+
+  // Reduced problem min 0.5 y' Q y + c' y subject to normals' y >= offsets
+  const Eigen::MatrixXd Q = 2.0 * Z.transpose() * H * Z;
+  const Eigen::VectorXd c = Z.transpose() * (2.0 * H * x_p + f);
+  const Eigen::MatrixXd normals = -(A_ineq * Z).transpose();
+  const Eigen::VectorXd offsets = A_ineq * x_p - b_ineq;
+
+  Eigen::VectorXd y = Eigen::VectorXd::Zero(Z.cols());
+  std::vector<int> active_constraints;
+  Eigen::VectorXd multipliers;
+  if (Z.cols() == 0) {
+    // The equality constraints fully determine the solution
+    if ((offsets.array() >
+         kFeasibilityTolerance * (1.0 + offsets.array().abs()))
+            .any()) {
+      return false;
+    }
+  } else {
+    const Eigen::LLT<Eigen::MatrixXd> Q_factor(Q);
+    if (Q_factor.info() != Eigen::Success) {
+      return false;
+    }
+
+    // Warm start with the minimum on the given active constraints if all
+    // their multipliers are non-negative
+    if (active_set != nullptr && !active_set->empty()) {
+      bool valid_warm_start = true;
+      for (size_t j = 0; j < active_set->size(); j++) {
+        if ((*active_set)[j] < 0 || (*active_set)[j] >= normals.cols() ||
+            std::find(active_set->begin(), active_set->begin() + j,
+                      (*active_set)[j]) != active_set->begin() + j) {
+          valid_warm_start = false;
+        }
+      }
+      if (valid_warm_start) {
+        const Eigen::MatrixXd N = activeNormals(normals, *active_set);
+        Eigen::VectorXd active_offsets(active_set->size());
+        for (size_t j = 0; j < active_set->size(); j++) {
+          active_offsets(j) = offsets((*active_set)[j]);
+        }
+        const Eigen::MatrixXd Q_inverse_N = Q_factor.solve(N);
+        const Eigen::LLT<Eigen::MatrixXd> M_factor(N.transpose() *
+                                                   Q_inverse_N);
+        if (M_factor.info() == Eigen::Success) {
+          multipliers = M_factor.solve(active_offsets +
+                                       N.transpose() * Q_factor.solve(c));
+          if (multipliers.minCoeff() >= 0.0) {
+            active_constraints = *active_set;
+            y = Q_factor.solve(N * multipliers - c);
+          }
+        }
+      }
+    }
+    if (active_constraints.empty()) {
+      multipliers.resize(0);
+      y = -Q_factor.solve(c);
+    }
+
+    if (!solveDualActiveSet(Q_factor, normals, offsets, &active_constraints,
+                            &multipliers, &y)) {
+      return false;
+    }
+  }
+
+  *solution = x_p + Z * y;
+  *objective_value = solution->transpose() * H * (*solution) + f.dot(*solution);
+  if (active_set != nullptr) {
+    *active_set = active_constraints;
+  }
+
+  return true;
+}
+
+}  // namespace polynomial_trajectories
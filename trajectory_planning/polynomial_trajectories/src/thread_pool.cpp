@@ -0,0 +1,76 @@
+#include "polynomial_trajectories/thread_pool.h"
+
+namespace polynomial_trajectories {
+
+ThreadPool::ThreadPool(const int num_worker_threads)
+    : stop_worker_threads_(false),
+      task_(nullptr),
+      num_tasks_(0),
+      next_task_(0),
+      num_finished_tasks_(0) {
+  for (int i = 0; i < num_worker_threads; i++) {
+    worker_threads_.push_back(std::thread(&ThreadPool::workerThread, this));
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_worker_threads_ = true;
+  }
+  task_available_.notify_all();
+  for (std::thread& worker_thread : worker_threads_) {
+    if (worker_thread.joinable()) {
+      worker_thread.join();
+    }
+  }
+}
+
+void ThreadPool::parallelFor(const int num_tasks,
+                             const std::function<void(const int)>& task) {
+  std::lock_guard<std::mutex> parallel_for_lock(parallel_for_mutex_);
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  task_ = &task;
+  num_tasks_ = num_tasks;
+  next_task_ = 0;
+  num_finished_tasks_ = 0;
+  task_available_.notify_all();
+
+  while (next_task_ < num_tasks_) {
+    runNextTask(&lock);
+  }
+  tasks_finished_.wait(
+      lock, [this] { return num_finished_tasks_ >= num_tasks_; });
+
+  task_ = nullptr;
+}
+
+int ThreadPool::numWorkerThreads() const { return worker_threads_.size(); }
+
+void ThreadPool::workerThread() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stop_worker_threads_) {
+    if (task_ != nullptr && next_task_ < num_tasks_) {
+      runNextTask(&lock);
+    } else {
+      task_available_.wait(lock);
+    }
+  }
+}
+
+void ThreadPool::runNextTask(std::unique_lock<std::mutex>* lock) {
+  const std::function<void(const int)>* task = task_;
+  const int task_index = next_task_++;
+
+  lock->unlock();
+  (*task)(task_index);
+  lock->lock();
+
+  num_finished_tasks_++;
+  if (num_finished_tasks_ >= num_tasks_) {
+    tasks_finished_.notify_all();
+  }
+}
+
+}  // namespace polynomial_trajectories
@@ -0,0 +1,341 @@
+#include "polynomial_trajectories/trajectory_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+#include <ros/ros.h>
+
+namespace polynomial_trajectories {
+
+// The layout must not depend on the compiler's padding
+static_assert(sizeof(TrajectoryFileHeader) == 48,
+              "Unexpected size of TrajectoryFileHeader");
+static_assert(sizeof(TrajectoryPointRecord) == 35 * sizeof(double),
+              "Unexpected size of TrajectoryPointRecord");
+
+namespace {
+
+void toArray(const Eigen::Vector3d& vector, double* array) {
+  Eigen::Map<Eigen::Vector3d> array_map(array);
+  array_map = vector;
+}
+
+Eigen::Vector3d fromArray(const double* array) {
+  return Eigen::Map<const Eigen::Vector3d>(array);
+}
+
+size_t payloadSize(const TrajectoryFileHeader& header) {
+  if (header.content ==
+      static_cast<uint32_t>(TrajectoryFileContent::POLYNOMIAL)) {
+    return 2 * sizeof(TrajectoryPointRecord) +
+           header.count * sizeof(double) +
+           header.count * header.dimension * header.num_coefficients *
+               sizeof(double);
+  }
+  return header.count * sizeof(TrajectoryPointRecord);
+}
+
+bool writeFile(const std::string& file_name, const TrajectoryFileHeader& header,
+               const std::vector<TrajectoryPointRecord>& records,
+               const std::vector<double>& values) {
+  std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(records.data()),
+             records.size() * sizeof(TrajectoryPointRecord));
+  file.write(reinterpret_cast<const char*>(values.data()),
+             values.size() * sizeof(double));
+  file.close();
+
+  if (!file) {
+    ROS_ERROR("[%s] Could not write trajectory file %s.",
+              ros::this_node::getName().c_str(), file_name.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace
+
+bool saveTrajectoryFile(const std::string& file_name,
+                        const PolynomialTrajectory& trajectory) {
+  if (trajectory.trajectory_type == TrajectoryType::UNDEFINED ||
+      trajectory.coeff.empty()) {
+    ROS_ERROR("[%s] Cannot save undefined polynomial trajectory.",
+              ros::this_node::getName().c_str());
+    return false;
+  }
+
+  TrajectoryFileHeader header = {};
+  header.magic = kTrajectoryFileMagic;
+  header.version = kTrajectoryFileVersion;
+  header.content = static_cast<uint32_t>(TrajectoryFileContent::POLYNOMIAL);
+  header.trajectory_type = static_cast<uint32_t>(trajectory.trajectory_type);
+  header.count = trajectory.coeff.size();
+  header.dimension = trajectory.coeff.dimension();
+  header.num_coefficients = trajectory.coeff.numCoefficients();
+  header.duration = trajectory.T.toSec();
+  header.optimization_cost = trajectory.optimization_cost;
+
+  if (trajectory.segment_times.size() != int(trajectory.coeff.size())) {
+    ROS_ERROR("[%s] Number of segment times and polynomials are not agreeing.",
+              ros::this_node::getName().c_str());
+    return false;
+  }
+
+  std::vector<double> values(trajectory.segment_times.data(),
+                             trajectory.segment_times.data() +
+                                 trajectory.segment_times.size());
+  // The coefficients are stored in the same layout as in the file
+  values.insert(values.end(), trajectory.coeff.data(),
+                trajectory.coeff.data() +
+                    trajectory.coeff.size() * trajectory.coeff.segmentSize());
+
+  return writeFile(file_name, header,
+                   {toTrajectoryPointRecord(trajectory.start_state),
+                    toTrajectoryPointRecord(trajectory.end_state)},
+                   values);
+}
+
+bool saveTrajectoryFile(const std::string& file_name,
+                        const quadrotor_common::Trajectory& trajectory) {
+  TrajectoryFileHeader header = {};
+  header.magic = kTrajectoryFileMagic;
+  header.version = kTrajectoryFileVersion;
+  header.content = static_cast<uint32_t>(TrajectoryFileContent::SAMPLED);
+  header.trajectory_type = static_cast<uint32_t>(trajectory.trajectory_type);
+  header.count = trajectory.points.size();
+  if (!trajectory.points.empty()) {
+    header.duration = (trajectory.points.back().time_from_start -
+                       trajectory.points.front().time_from_start)
+                          .toSec();
+  }
+
+  std::vector<TrajectoryPointRecord> records;
+  records.reserve(trajectory.points.size());
+  for (const quadrotor_common::TrajectoryPoint& point : trajectory.points) {
+    records.push_back(toTrajectoryPointRecord(point));
+  }
+
+  return writeFile(file_name, header, records, std::vector<double>());
+}
+
+TrajectoryPointRecord toTrajectoryPointRecord(
+    const quadrotor_common::TrajectoryPoint& point) {
+  TrajectoryPointRecord record;
+  record.time_from_start = point.time_from_start.toSec();
+  toArray(point.position, record.position);
+  record.orientation[0] = point.orientation.w();
+  record.orientation[1] = point.orientation.x();
+  record.orientation[2] = point.orientation.y();
+  record.orientation[3] = point.orientation.z();
+  toArray(point.velocity, record.velocity);
+  toArray(point.acceleration, record.acceleration);
+  toArray(point.jerk, record.jerk);
+  toArray(point.snap, record.snap);
+  toArray(point.bodyrates, record.bodyrates);
+  toArray(point.angular_acceleration, record.angular_acceleration);
+  toArray(point.angular_jerk, record.angular_jerk);
+  toArray(point.angular_snap, record.angular_snap);
+  record.heading = point.heading;
+  record.heading_rate = point.heading_rate;
+  record.heading_acceleration = point.heading_acceleration;
+
+  return record;
+}
+
+quadrotor_common::TrajectoryPoint fromTrajectoryPointRecord(
+    const TrajectoryPointRecord& record) {
+  quadrotor_common::TrajectoryPoint point;
+  point.time_from_start = ros::Duration(record.time_from_start);
+  point.position = fromArray(record.position);
+  point.orientation =
+      Eigen::Quaterniond(record.orientation[0], record.orientation[1],
+                         record.orientation[2], record.orientation[3]);
+  point.velocity = fromArray(record.velocity);
+  point.acceleration = fromArray(record.acceleration);
+  point.jerk = fromArray(record.jerk);
+  point.snap = fromArray(record.snap);
+  point.bodyrates = fromArray(record.bodyrates);
+  point.angular_acceleration = fromArray(record.angular_acceleration);
+  point.angular_jerk = fromArray(record.angular_jerk);
+  point.angular_snap = fromArray(record.angular_snap);
+  point.heading = record.heading;
+  point.heading_rate = record.heading_rate;
+  point.heading_acceleration = record.heading_acceleration;
+
+  return point;
+}
+
+TrajectoryFile::TrajectoryFile() : data_(nullptr), size_(0) {}
+
+TrajectoryFile::~TrajectoryFile() { close(); }
+
+bool TrajectoryFile::open(const std::string& file_name) {
+  close();
+
+  const int file_descriptor = ::open(file_name.c_str(), O_RDONLY);
+  if (file_descriptor < 0) {
+    ROS_ERROR("[%s] Could not open trajectory file %s.",
+              ros::this_node::getName().c_str(), file_name.c_str());
+    return false;
+  }
+
+  struct stat file_status;
+  if (fstat(file_descriptor, &file_status) != 0 ||
+      size_t(file_status.st_size) < sizeof(TrajectoryFileHeader)) {
+    ROS_ERROR("[%s] Trajectory file %s is too small.",
+              ros::this_node::getName().c_str(), file_name.c_str());
+    ::close(file_descriptor);
+    return false;
+  }
+
+  void* data = mmap(nullptr, file_status.st_size, PROT_READ, MAP_PRIVATE,
+                    file_descriptor, 0);
+  // The mapping stays valid after closing the file descriptor
+  ::close(file_descriptor);
+  if (data == MAP_FAILED) {
+    ROS_ERROR("[%s] Could not map trajectory file %s.",
+              ros::this_node::getName().c_str(), file_name.c_str());
+    return false;
+  }
+  data_ = static_cast<const char*>(data);
+  size_ = file_status.st_size;
+
+  const TrajectoryFileHeader& file_header = header();
+  if (file_header.magic != kTrajectoryFileMagic) {
+    ROS_ERROR(
+        "[%s] %s is not a trajectory file or was written with a different "
+        "byte order.",
+        ros::this_node::getName().c_str(), file_name.c_str());
+    close();
+    return false;
+  }
+  if (file_header.version != kTrajectoryFileVersion) {
+    ROS_ERROR("[%s] Trajectory file %s has version %u, expected version %u.",
+              ros::this_node::getName().c_str(), file_name.c_str(),
+              file_header.version, kTrajectoryFileVersion);
+    close();
+    return false;
+  }
+  if ((file_header.content !=
+           static_cast<uint32_t>(TrajectoryFileContent::POLYNOMIAL) &&
+       file_header.content !=
+           static_cast<uint32_t>(TrajectoryFileContent::SAMPLED)) ||
+      size_ != sizeof(TrajectoryFileHeader) + payloadSize(file_header)) {
+    ROS_ERROR("[%s] Trajectory file %s is corrupted.",
+              ros::this_node::getName().c_str(), file_name.c_str());
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+void TrajectoryFile::close() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+}
+
+bool TrajectoryFile::isOpen() const { return data_ != nullptr; }
+
+const TrajectoryFileHeader& TrajectoryFile::header() const {
+  return *reinterpret_cast<const TrajectoryFileHeader*>(data_);
+}
+
+TrajectoryFileContent TrajectoryFile::content() const {
+  return static_cast<TrajectoryFileContent>(header().content);
+}
+
+int TrajectoryFile::numSegments() const {
+  if (content() != TrajectoryFileContent::POLYNOMIAL) {
+    return 0;
+  }
+  return header().count;
+}
+
+Eigen::Map<const Eigen::VectorXd> TrajectoryFile::segmentTimes() const {
+  const double* segment_times =
+      reinterpret_cast<const double*>(records() + 2);
+  return Eigen::Map<const Eigen::VectorXd>(segment_times, numSegments());
+}
+
+Eigen::Map<const Eigen::MatrixXd> TrajectoryFile::coefficients(
+    const int segment) const {
+  const int rows = header().dimension;
+  const int cols = header().num_coefficients;
+  const double* coefficients =
+      segmentTimes().data() + numSegments() + segment * rows * cols;
+  return Eigen::Map<const Eigen::MatrixXd>(coefficients, rows, cols);
+}
+
+int TrajectoryFile::numPoints() const {
+  if (content() != TrajectoryFileContent::SAMPLED) {
+    return 0;
+  }
+  return header().count;
+}
+
+const TrajectoryPointRecord& TrajectoryFile::point(const int index) const {
+  return records()[index];
+}
+
+bool TrajectoryFile::load(PolynomialTrajectory* trajectory) const {
+  if (!isOpen() || content() != TrajectoryFileContent::POLYNOMIAL) {
+    ROS_ERROR("[%s] Trajectory file does not contain a polynomial trajectory.",
+              ros::this_node::getName().c_str());
+    return false;
+  }
+
+  trajectory->trajectory_type =
+      static_cast<TrajectoryType>(header().trajectory_type);
+  trajectory->number_of_segments = numSegments();
+  trajectory->T = ros::Duration(header().duration);
+  trajectory->optimization_cost = header().optimization_cost;
+  trajectory->start_state = fromTrajectoryPointRecord(records()[0]);
+  trajectory->end_state = fromTrajectoryPointRecord(records()[1]);
+  trajectory->segment_times = segmentTimes();
+  trajectory->coeff.resize(numSegments(), header().dimension,
+                           header().num_coefficients);
+  if (numSegments() > 0) {
+    std::copy(coefficients(0).data(),
+              coefficients(0).data() +
+                  numSegments() * trajectory->coeff.segmentSize(),
+              trajectory->coeff.data());
+  }
+
+  return true;
+}
+
+bool TrajectoryFile::load(quadrotor_common::Trajectory* trajectory) const {
+  if (!isOpen() || content() != TrajectoryFileContent::SAMPLED) {
+    ROS_ERROR("[%s] Trajectory file does not contain a sampled trajectory.",
+              ros::this_node::getName().c_str());
+    return false;
+  }
+
+  trajectory->trajectory_type =
+      static_cast<quadrotor_common::Trajectory::TrajectoryType>(
+          header().trajectory_type);
+  trajectory->points.clear();
+  for (int i = 0; i < numPoints(); i++) {
+    trajectory->points.push_back(fromTrajectoryPointRecord(point(i)));
+  }
+
+  return true;
+}
+
+const TrajectoryPointRecord* TrajectoryFile::records() const {
+  return reinterpret_cast<const TrajectoryPointRecord*>(
+      data_ + sizeof(TrajectoryFileHeader));
+}
+
+}  // namespace polynomial_trajectories
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <random>
+
+#include <Eigen/Dense>
+
+#include "polynomial_trajectories/bernstein_polynomials.h"
+#include "polynomial_trajectories/polynomial_trajectories_common.h"
+
+namespace polynomial_trajectories {
+
+namespace {
+
+Eigen::Vector3d evaluateBernstein(const Eigen::MatrixXd& control_points,
+                                  const double s) {
+  const int degree = control_points.cols() - 1;
+  Eigen::Vector3d value = Eigen::Vector3d::Zero();
+  double binomial = 1.0;
+  for (int k = 0; k <= degree; k++) {
+    value += binomial * std::pow(s, k) * std::pow(1.0 - s, degree - k) *
+             control_points.col(k);
+    binomial = binomial * (degree - k) / (k + 1);
+  }
+  return value;
+}
+
+}  // namespace
+
+TEST(BernsteinPolynomialsTest, RepresentSamePolynomial) {
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+
+  for (int num_coefficients = 1; num_coefficients < 12; num_coefficients++) {
+    Eigen::MatrixXd coefficients(3, num_coefficients);
+    for (int i = 0; i < coefficients.size(); i++) {
+      coefficients(i) = uniform(generator);
+    }
+    const double duration = 2.0 + uniform(generator);
+
+    const Eigen::MatrixXd control_points =
+        computeBernsteinControlPoints(coefficients);
+    const Eigen::MatrixXd velocity_control_points =
+        differentiateBernsteinControlPoints(control_points, duration);
+    Eigen::MatrixXd first_half, second_half;
+    splitBernsteinControlPoints(control_points, &first_half, &second_half);
+
+    for (int j = 0; j <= 10; j++) {
+      const double s = 0.1 * j;
+      Eigen::Matrix<double, 4, 5> derivatives;
+      evaluatePolynomialDerivatives(coefficients, false, s, &derivatives);
+
+      EXPECT_LT((evaluateBernstein(control_points, s) -
+                 derivatives.col(0).head<3>())
+                    .norm(),
+                1e-10);
+      EXPECT_LT((evaluateBernstein(velocity_control_points, s) -
+                 derivatives.col(1).head<3>() / duration)
+                    .norm(),
+                1e-10);
+      if (s <= 0.5) {
+        EXPECT_LT((evaluateBernstein(first_half, 2.0 * s) -
+                   derivatives.col(0).head<3>())
+                      .norm(),
+                  1e-10);
+      } else {
+        EXPECT_LT((evaluateBernstein(second_half, 2.0 * s - 1.0) -
+                   derivatives.col(0).head<3>())
+                      .norm(),
+                  1e-10);
+      }
+    }
+  }
+}
+
+TEST(BernsteinPolynomialsTest, CrossProduct) {
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+
+  Eigen::MatrixXd coefficients_a(3, 6);
+  Eigen::MatrixXd coefficients_b(3, 3);
+  for (int i = 0; i < coefficients_a.size(); i++) {
+    coefficients_a(i) = uniform(generator);
+  }
+  for (int i = 0; i < coefficients_b.size(); i++) {
+    coefficients_b(i) = uniform(generator);
+  }
+
+  const Eigen::MatrixXd cross_product = computeBernsteinCrossProduct(
+      computeBernsteinControlPoints(coefficients_a),
+      computeBernsteinControlPoints(coefficients_b));
+  ASSERT_EQ(8, cross_product.cols());
+
+  for (int j = 0; j <= 10; j++) {
+    const double s = 0.1 * j;
+    Eigen::Matrix<double, 4, 5> derivatives_a, derivatives_b;
+    evaluatePolynomialDerivatives(coefficients_a, false, s, &derivatives_a);
+    evaluatePolynomialDerivatives(coefficients_b, false, s, &derivatives_b);
+    const Eigen::Vector3d expected =
+        derivatives_a.col(0).head<3>().cross(derivatives_b.col(0).head<3>());
+    EXPECT_LT((evaluateBernstein(cross_product, s) - expected).norm(), 1e-10);
+  }
+}
+
+}  // namespace polynomial_trajectories
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include <random>
+
+#include <quadrotor_common/trajectory_point.h>
+#include <Eigen/Dense>
+
+#include "polynomial_trajectories/constrained_polynomial_trajectories.h"
+#include "polynomial_trajectories/polynomial_trajectory.h"
+
+namespace polynomial_trajectories {
+
+TEST(TrajectoryCoefficientsTest, SatisfyBoundaryConditions) {
+  quadrotor_common::TrajectoryPoint start_state;
+  start_state.position = Eigen::Vector3d(1.0, -2.0, 0.5);
+  start_state.velocity = Eigen::Vector3d(0.5, 0.2, -0.1);
+  start_state.jerk = Eigen::Vector3d(0.3, 0.0, -0.2);
+  quadrotor_common::TrajectoryPoint end_state;
+  end_state.position = Eigen::Vector3d(-3.0, 4.0, 2.0);
+  end_state.acceleration = Eigen::Vector3d(0.1, -0.4, 0.2);
+
+  namespace implementation =
+      constrained_polynomial_trajectories::implementation;
+  for (int order_of_continuity = 1; order_of_continuity <= 12;
+       order_of_continuity++) {
+    for (const double T : {0.5, 2.0, 7.0}) {
+      const Eigen::MatrixXd coefficients =
+          implementation::computeTrajectoryCoeff(start_state, end_state,
+                                                 order_of_continuity, T)
+              .front();
+      const Eigen::MatrixXd A_start =
+          implementation::computeConstraintMatriceA(order_of_continuity, 0.0);
+      const Eigen::MatrixXd A_end =
+          implementation::computeConstraintMatriceA(order_of_continuity, T);
+      for (int axis = 0; axis < 3; axis++) {
+        const Eigen::VectorXd c = coefficients.row(axis).transpose();
+        const Eigen::VectorXd b_start =
+            implementation::computeConstraintMatriceB(order_of_continuity,
+                                                      start_state, axis);
+        const Eigen::VectorXd b_end = implementation::computeConstraintMatriceB(
+            order_of_continuity, end_state, axis);
+        // The constraint matrices are badly conditioned for high orders, so
+        // the residual is compared relative to the magnitude of the terms
+        EXPECT_LT((A_start * c - b_start).norm(),
+                  1e-10 * (A_start.norm() * c.norm() + b_start.norm()));
+        EXPECT_LT((A_end * c - b_end).norm(),
+                  1e-10 * (A_end.norm() * c.norm() + b_end.norm()));
+      }
+    }
+  }
+}
+
+TEST(TimeOptimalTrajectoryTest, ReachesLimitsWithoutViolatingThem) {
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+  const auto random_vector = [&](const double scale) {
+    return Eigen::Vector3d(scale * uniform(generator),
+                           scale * uniform(generator),
+                           scale * uniform(generator));
+  };
+
+  const Eigen::Vector3d desired_maxima(3.0, 15.0, 1.5);
+  for (int i = 0; i < 50; i++) {
+    quadrotor_common::TrajectoryPoint start_state;
+    start_state.position = random_vector(5.0);
+    quadrotor_common::TrajectoryPoint end_state;
+    end_state.position = random_vector(5.0);
+    if (i % 2 == 1) {
+      // Boundary accelerations make the maxima non monotonic in the duration
+      start_state.velocity = random_vector(0.5);
+      end_state.acceleration = random_vector(0.5);
+    }
+
+    const PolynomialTrajectory trajectory =
+        constrained_polynomial_trajectories::computeTimeOptimalTrajectory(
+            start_state, end_state, 5, desired_maxima.x(), desired_maxima.y(),
+            desired_maxima.z());
+    ASSERT_EQ(TrajectoryType::FULLY_CONSTRAINED, trajectory.trajectory_type);
+
+    const double maxima_ratio =
+        constrained_polynomial_trajectories::implementation::
+            computeMaximaRatio(trajectory, desired_maxima);
+    EXPECT_LE(maxima_ratio, 1.0);
+    EXPECT_GE(maxima_ratio, 0.99);
+  }
+}
+
+}  // namespace polynomial_trajectories
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,872 @@
+#include <gtest/gtest.h>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <quadrotor_common/trajectory_point.h>
+#include <Eigen/Dense>
+
+#include "polynomial_trajectories/minimum_snap_trajectories.h"
+#include "polynomial_trajectories/polynomial_trajectories_common.h"
+#include "polynomial_trajectories/polynomial_trajectory.h"
+#include "polynomial_trajectories/polynomial_trajectory_settings.h"
+
+namespace polynomial_trajectories {
+
+namespace {
+
+struct SolverTestCase {
+  int polynomial_order;
+  int continuity_order;
+  std::vector<double> minimization_weights;
+};
+
+class FreeDerivativesSolverTest
+    : public ::testing::TestWithParam<SolverTestCase> {
+ protected:
+  FreeDerivativesSolverTest() : generator_(42), uniform_(-1.0, 1.0) {}
+
+  Eigen::Vector3d randomVector(const double scale) {
+    return scale *
+           Eigen::Vector3d(uniform_(generator_), uniform_(generator_),
+                           uniform_(generator_));
+  }
+
+  PolynomialTrajectorySettings settings(const int num_way_points) {
+    PolynomialTrajectorySettings trajectory_settings;
+    for (int i = 0; i < num_way_points; i++) {
+      trajectory_settings.way_points.push_back(randomVector(5.0));
+    }
+    const std::vector<double>& weights = GetParam().minimization_weights;
+    trajectory_settings.minimization_weights =
+        Eigen::Map<const Eigen::VectorXd>(weights.data(), weights.size());
+    trajectory_settings.polynomial_order = GetParam().polynomial_order;
+    trajectory_settings.continuity_order = GetParam().continuity_order;
+    return trajectory_settings;
+  }
+
+  Eigen::VectorXd segmentTimes(const int num_segments) {
+    Eigen::VectorXd segment_times(num_segments);
+    for (int i = 0; i < num_segments; i++) {
+      segment_times(i) = 1.5 + uniform_(generator_);
+    }
+    return segment_times;
+  }
+
+  void expectSameTrajectory(const PolynomialTrajectory& reference,
+                            const PolynomialTrajectory& trajectory) {
+    // Tolerances are relative to the magnitude of the reference, the
+    // coefficients of high order polynomials are only loosely determined by
+    // the cost
+    const double kCostTolerance = 1e-6;
+    const double kCoefficientTolerance = 1e-4;
+
+    ASSERT_EQ(reference.trajectory_type, trajectory.trajectory_type);
+    ASSERT_EQ(reference.coeff.size(), trajectory.coeff.size());
+    EXPECT_NEAR(reference.optimization_cost, trajectory.optimization_cost,
+                kCostTolerance * std::max(1.0, reference.optimization_cost));
+    for (int i = 0; i < int(reference.coeff.size()); i++) {
+      ASSERT_EQ(reference.coeff[i].cols(), trajectory.coeff[i].cols());
+      EXPECT_LT((reference.coeff[i] - trajectory.coeff[i]).norm(),
+                kCoefficientTolerance *
+                    std::max(1.0, reference.coeff[i].norm()));
+    }
+  }
+
+  std::mt19937 generator_;
+  std::uniform_real_distribution<double> uniform_;
+};
+
+// Central differences of the optimization cost in the directions of
+// computeCostGradient, which increase one segment time and decrease all
+// others such that the total time stays the same
+Eigen::VectorXd computeFiniteDifferenceCostGradient(
+    const std::function<PolynomialTrajectory(const Eigen::VectorXd&)>&
+        generate,
+    const Eigen::VectorXd& segment_times) {
+  const double kStep = 1e-5;
+
+  const int num_segments = segment_times.size();
+  Eigen::VectorXd gradient(num_segments);
+  for (int k = 0; k < num_segments; k++) {
+    Eigen::VectorXd direction =
+        Eigen::VectorXd::Constant(num_segments, -1.0 / (num_segments - 1));
+    direction(k) = 1.0;
+    gradient(k) =
+        (generate(segment_times + kStep * direction).optimization_cost -
+         generate(segment_times - kStep * direction).optimization_cost) /
+        (2.0 * kStep);
+  }
+
+  return gradient;
+}
+
+class RecedingHorizonTest : public ::testing::Test {
+ protected:
+  RecedingHorizonTest() {
+    trajectory_settings_.way_points = {
+        Eigen::Vector3d(2.0, 0.0, 1.0), Eigen::Vector3d(3.0, 2.0, 1.5),
+        Eigen::Vector3d(1.0, 3.0, 1.0), Eigen::Vector3d(-1.0, 2.0, 0.5),
+        Eigen::Vector3d(-1.0, 0.0, 1.0)};
+    trajectory_settings_.heading_way_points = {0.5, 1.0, 1.5, 1.0, 0.5};
+    trajectory_settings_.minimization_weights =
+        Eigen::Vector4d(0.0, 1.0, 1.0, 1.0);
+    trajectory_settings_.polynomial_order = 9;
+    trajectory_settings_.continuity_order = 4;
+    end_state_.position = Eigen::Vector3d(0.0, 0.0, 1.0);
+    segment_times_.resize(6);
+    segment_times_ << 1.5, 1.2, 1.4, 1.3, 1.1, 1.5;
+
+    trajectory_ = minimum_snap_trajectories::generateMinimumSnapTrajectory(
+        segment_times_, quadrotor_common::TrajectoryPoint(), end_state_,
+        trajectory_settings_);
+  }
+
+  PolynomialTrajectorySettings trajectory_settings_;
+  quadrotor_common::TrajectoryPoint end_state_;
+  Eigen::VectorXd segment_times_;
+  PolynomialTrajectory trajectory_;
+};
+
+}  // namespace
+
+TEST_P(FreeDerivativesSolverTest, OpenTrajectoryMatchesConstrainedQP) {
+  for (int num_way_points = 0; num_way_points < 8; num_way_points++) {
+    PolynomialTrajectorySettings trajectory_settings =
+        settings(num_way_points);
+    const Eigen::VectorXd segment_times = segmentTimes(num_way_points + 1);
+
+    quadrotor_common::TrajectoryPoint start_state;
+    start_state.position = randomVector(5.0);
+    start_state.velocity = randomVector(1.0);
+    start_state.acceleration = randomVector(1.0);
+    quadrotor_common::TrajectoryPoint end_state;
+    end_state.position = randomVector(5.0);
+    end_state.jerk = randomVector(1.0);
+
+    trajectory_settings.minimum_snap_solver =
+        MinimumSnapSolver::CONSTRAINED_QP;
+    const PolynomialTrajectory reference =
+        minimum_snap_trajectories::generateMinimumSnapTrajectory(
+            segment_times, start_state, end_state, trajectory_settings);
+    trajectory_settings.minimum_snap_solver =
+        MinimumSnapSolver::FREE_DERIVATIVES;
+    const PolynomialTrajectory trajectory =
+        minimum_snap_trajectories::generateMinimumSnapTrajectory(
+            segment_times, start_state, end_state, trajectory_settings);
+
+    expectSameTrajectory(reference, trajectory);
+  }
+}
+
+TEST_P(FreeDerivativesSolverTest, RingTrajectoryMatchesConstrainedQP) {
+  for (int num_way_points = 3; num_way_points < 8; num_way_points++) {
+    PolynomialTrajectorySettings trajectory_settings =
+        settings(num_way_points);
+    const Eigen::VectorXd segment_times = segmentTimes(num_way_points);
+
+    trajectory_settings.minimum_snap_solver =
+        MinimumSnapSolver::CONSTRAINED_QP;
+    const PolynomialTrajectory reference =
+        minimum_snap_trajectories::generateMinimumSnapRingTrajectory(
+            segment_times, trajectory_settings);
+    trajectory_settings.minimum_snap_solver =
+        MinimumSnapSolver::FREE_DERIVATIVES;
+    const PolynomialTrajectory trajectory =
+        minimum_snap_trajectories::generateMinimumSnapRingTrajectory(
+            segment_times, trajectory_settings);
+
+    expectSameTrajectory(reference, trajectory);
+  }
+}
+
+TEST(SegmentRefinementTest, ParallelLineSearchMatchesSequential) {
+  PolynomialTrajectorySettings trajectory_settings;
+  trajectory_settings.way_points = {Eigen::Vector3d(2.0, 0.0, 1.0),
+                                    Eigen::Vector3d(2.0, 3.0, 2.0),
+                                    Eigen::Vector3d(-1.0, 4.0, 1.0),
+                                    Eigen::Vector3d(-3.0, 1.0, 2.0)};
+  trajectory_settings.minimization_weights =
+      Eigen::Vector4d(0.0, 1.0, 1.0, 1.0);
+  trajectory_settings.polynomial_order = 9;
+  trajectory_settings.continuity_order = 4;
+  const Eigen::VectorXd segment_times = Eigen::VectorXd::Constant(5, 2.0);
+
+  quadrotor_common::TrajectoryPoint start_state;
+  quadrotor_common::TrajectoryPoint end_state;
+  end_state.position = Eigen::Vector3d(0.0, 0.0, 1.0);
+
+  trajectory_settings.line_search_threads = 1;
+  const PolynomialTrajectory sequential = minimum_snap_trajectories::
+      generateMinimumSnapTrajectoryWithSegmentRefinement(
+          segment_times, start_state, end_state, trajectory_settings);
+  const PolynomialTrajectory sequential_ring = minimum_snap_trajectories::
+      generateMinimumSnapRingTrajectoryWithSegmentRefinement(
+          segment_times.head(4), trajectory_settings);
+
+  trajectory_settings.line_search_threads = 4;
+  const PolynomialTrajectory parallel = minimum_snap_trajectories::
+      generateMinimumSnapTrajectoryWithSegmentRefinement(
+          segment_times, start_state, end_state, trajectory_settings);
+  const PolynomialTrajectory parallel_ring = minimum_snap_trajectories::
+      generateMinimumSnapRingTrajectoryWithSegmentRefinement(
+          segment_times.head(4), trajectory_settings);
+
+  // The same steps are taken so the results are identical
+  EXPECT_EQ(sequential.segment_times, parallel.segment_times);
+  EXPECT_EQ(sequential.optimization_cost, parallel.optimization_cost);
+  EXPECT_EQ(sequential_ring.segment_times, parallel_ring.segment_times);
+  EXPECT_EQ(sequential_ring.optimization_cost,
+            parallel_ring.optimization_cost);
+}
+
+TEST(SegmentRefinementTest, LineSearchTerminatesWithoutArmijoStep) {
+  PolynomialTrajectorySettings trajectory_settings;
+  trajectory_settings.way_points = {Eigen::Vector3d(2.0, 0.0, 1.0),
+                                    Eigen::Vector3d(2.0, 3.0, 2.0),
+                                    Eigen::Vector3d(-1.0, 4.0, 1.0),
+                                    Eigen::Vector3d(-3.0, 1.0, 2.0)};
+  trajectory_settings.minimization_weights =
+      Eigen::Vector4d(0.0, 1.0, 1.0, 1.0);
+  trajectory_settings.polynomial_order = 9;
+  trajectory_settings.continuity_order = 4;
+  Eigen::VectorXd segment_times(4);
+  segment_times << 1.5, 2.0, 1.0, 2.5;
+
+  PolynomialTrajectory trajectory =
+      minimum_snap_trajectories::generateMinimumSnapRingTrajectory(
+          segment_times, trajectory_settings);
+  ASSERT_EQ(TrajectoryType::MINIMUM_SNAP_RING, trajectory.trajectory_type);
+  trajectory.trajectory_type =
+      TrajectoryType::MINIMUM_SNAP_RING_OPTIMIZED_SEGMENTS;
+  const Eigen::VectorXd gradient =
+      minimum_snap_trajectories::implementation::computeCostGradient(
+          trajectory, trajectory_settings);
+  ASSERT_GT(gradient.norm(), 0.0);
+
+  // A gradient that overestimates the cost decrease by orders of magnitude
+  // lets no step satisfy the Armijo condition, the line search has to give up
+  // instead of shrinking the step forever
+  const Eigen::VectorXd inconsistent_gradient = 1e6 * gradient;
+  for (const int line_search_threads : {1, 4}) {
+    trajectory_settings.line_search_threads = line_search_threads;
+    const std::unique_ptr<ThreadPool> thread_pool =
+        minimum_snap_trajectories::implementation::createLineSearchThreadPool(
+            trajectory_settings);
+    const Eigen::VectorXd updated_segment_times =
+        minimum_snap_trajectories::implementation::updateSegmentTimes(
+            trajectory, inconsistent_gradient, trajectory_settings,
+            thread_pool.get());
+    EXPECT_EQ(segment_times, updated_segment_times);
+  }
+}
+
+TEST(CostGradientTest, MatchesFiniteDifferences) {
+  const double kTolerance = 1e-4;
+
+  PolynomialTrajectorySettings trajectory_settings;
+  trajectory_settings.way_points = {Eigen::Vector3d(2.0, 0.0, 1.0),
+                                    Eigen::Vector3d(2.0, 3.0, 2.0),
+                                    Eigen::Vector3d(-1.0, 4.0, 1.0),
+                                    Eigen::Vector3d(-3.0, 1.0, 2.0)};
+  trajectory_settings.minimization_weights =
+      Eigen::Vector4d(0.0, 1.0, 1.0, 1.0);
+  trajectory_settings.polynomial_order = 9;
+  trajectory_settings.continuity_order = 4;
+  Eigen::VectorXd segment_times(5);
+  segment_times << 1.5, 2.0, 1.0, 2.5, 1.8;
+
+  quadrotor_common::TrajectoryPoint start_state;
+  start_state.velocity = Eigen::Vector3d(0.5, 0.0, 0.0);
+  quadrotor_common::TrajectoryPoint end_state;
+  end_state.position = Eigen::Vector3d(0.0, 0.0, 1.0);
+
+  const auto generate_open = [&](const Eigen::VectorXd& times) {
+    return minimum_snap_trajectories::generateMinimumSnapTrajectory(
+        times, start_state, end_state, trajectory_settings);
+  };
+  const PolynomialTrajectory open_trajectory = generate_open(segment_times);
+  ASSERT_EQ(TrajectoryType::MINIMUM_SNAP, open_trajectory.trajectory_type);
+  const Eigen::VectorXd open_gradient =
+      minimum_snap_trajectories::implementation::computeCostGradient(
+          open_trajectory, trajectory_settings);
+  const Eigen::VectorXd expected_open_gradient =
+      computeFiniteDifferenceCostGradient(generate_open, segment_times);
+  EXPECT_LT((open_gradient - expected_open_gradient).norm(),
+            kTolerance * std::max(1.0, expected_open_gradient.norm()))
+      << "Gradient: " << open_gradient.transpose()
+      << ", expected: " << expected_open_gradient.transpose();
+
+  const auto generate_ring = [&](const Eigen::VectorXd& times) {
+    return minimum_snap_trajectories::generateMinimumSnapRingTrajectory(
+        times, trajectory_settings);
+  };
+  const Eigen::VectorXd ring_segment_times = segment_times.head(4);
+  const PolynomialTrajectory ring_trajectory =
+      generate_ring(ring_segment_times);
+  ASSERT_EQ(TrajectoryType::MINIMUM_SNAP_RING, ring_trajectory.trajectory_type);
+  const Eigen::VectorXd ring_gradient =
+      minimum_snap_trajectories::implementation::computeCostGradient(
+          ring_trajectory, trajectory_settings);
+  const Eigen::VectorXd expected_ring_gradient =
+      computeFiniteDifferenceCostGradient(generate_ring, ring_segment_times);
+  EXPECT_LT((ring_gradient - expected_ring_gradient).norm(),
+            kTolerance * std::max(1.0, expected_ring_gradient.norm()))
+      << "Gradient: " << ring_gradient.transpose()
+      << ", expected: " << expected_ring_gradient.transpose();
+}
+
+TEST(CostGradientTest, IncludesHeading) {
+  const double kTolerance = 1e-4;
+
+  PolynomialTrajectorySettings trajectory_settings;
+  trajectory_settings.way_points = {Eigen::Vector3d(2.0, 0.0, 1.0),
+                                    Eigen::Vector3d(2.0, 3.0, 2.0),
+                                    Eigen::Vector3d(-1.0, 4.0, 1.0)};
+  trajectory_settings.heading_way_points = {0.5, 1.5, 3.0};
+  trajectory_settings.minimization_weights =
+      Eigen::Vector4d(0.0, 1.0, 1.0, 1.0);
+  trajectory_settings.polynomial_order = 9;
+  trajectory_settings.continuity_order = 4;
+  Eigen::VectorXd segment_times(4);
+  segment_times << 1.5, 2.0, 1.0, 2.5;
+
+  quadrotor_common::TrajectoryPoint start_state;
+  start_state.heading = -0.5;
+  start_state.heading_rate = 0.2;
+  quadrotor_common::TrajectoryPoint end_state;
+  end_state.position = Eigen::Vector3d(0.0, 0.0, 1.0);
+  end_state.heading = 2.0;
+
+  const auto generate_open = [&](const Eigen::VectorXd& times) {
+    return minimum_snap_trajectories::generateMinimumSnapTrajectory(
+        times, start_state, end_state, trajectory_settings);
+  };
+  const PolynomialTrajectory open_trajectory = generate_open(segment_times);
+  ASSERT_EQ(4, open_trajectory.coeff.dimension());
+  const Eigen::VectorXd open_gradient =
+      minimum_snap_trajectories::implementation::computeCostGradient(
+          open_trajectory, trajectory_settings);
+  const Eigen::VectorXd expected_open_gradient =
+      computeFiniteDifferenceCostGradient(generate_open, segment_times);
+  EXPECT_LT((open_gradient - expected_open_gradient).norm(),
+            kTolerance * std::max(1.0, expected_open_gradient.norm()))
+      << "Gradient: " << open_gradient.transpose()
+      << ", expected: " << expected_open_gradient.transpose();
+
+  const auto generate_ring = [&](const Eigen::VectorXd& times) {
+    return minimum_snap_trajectories::generateMinimumSnapRingTrajectory(
+        times, trajectory_settings);
+  };
+  const Eigen::VectorXd ring_segment_times = segment_times.head(3);
+  const PolynomialTrajectory ring_trajectory =
+      generate_ring(ring_segment_times);
+  ASSERT_EQ(4, ring_trajectory.coeff.dimension());
+  const Eigen::VectorXd ring_gradient =
+      minimum_snap_trajectories::implementation::computeCostGradient(
+          ring_trajectory, trajectory_settings);
+  const Eigen::VectorXd expected_ring_gradient =
+      computeFiniteDifferenceCostGradient(generate_ring, ring_segment_times);
+  EXPECT_LT((ring_gradient - expected_ring_gradient).norm(),
+            kTolerance * std::max(1.0, expected_ring_gradient.norm()))
+      << "Gradient: " << ring_gradient.transpose()
+      << ", expected: " << expected_ring_gradient.transpose();
+}
+
+TEST(CostGradientTest, AccountsForActiveCorridors) {
+  const double kTolerance = 1e-4;
+
+  // Around a corner, the corridors are active
+  PolynomialTrajectorySettings trajectory_settings;
+  trajectory_settings.way_points.push_back(Eigen::Vector3d(2.0, 0.0, 0.0));
+  trajectory_settings.minimization_weights =
+      Eigen::Vector4d(0.0, 0.0, 0.0, 1.0);
+  trajectory_settings.polynomial_order = 9;
+  trajectory_settings.continuity_order = 4;
+  trajectory_settings.corridor_lower_bounds = {
+      Eigen::Vector3d(-0.1, -0.1, -0.1), Eigen::Vector3d(1.9, -0.1, -0.1)};
+  trajectory_settings.corridor_upper_bounds = {
+      Eigen::Vector3d(2.1, 0.1, 0.1), Eigen::Vector3d(2.1, 2.1, 0.1)};
+  quadrotor_common::TrajectoryPoint start_state;
+  quadrotor_common::TrajectoryPoint end_state;
+  end_state.position = Eigen::Vector3d(2.0, 2.0, 0.0);
+  const Eigen::VectorXd segment_times = Eigen::Vector2d(1.2, 1.8);
+
+  const auto generate = [&](const Eigen::VectorXd& times) {
+    return minimum_snap_trajectories::generateMinimumSnapTrajectory(
+        times, start_state, end_state, trajectory_settings);
+  };
+  const PolynomialTrajectory trajectory = generate(segment_times);
+  ASSERT_EQ(TrajectoryType::MINIMUM_SNAP, trajectory.trajectory_type);
+
+  // Make sure the corridors actually change the trajectory
+  PolynomialTrajectorySettings unconstrained_settings = trajectory_settings;
+  unconstrained_settings.corridor_lower_bounds.clear();
+  unconstrained_settings.corridor_upper_bounds.clear();
+  ASSERT_GT(trajectory.optimization_cost,
+            minimum_snap_trajectories::generateMinimumSnapTrajectory(
+                segment_times, start_state, end_state, unconstrained_settings)
+                    .optimization_cost *
+                1.01);
+
+  const Eigen::VectorXd gradient =
+      minimum_snap_trajectories::implementation::computeCostGradient(
+          trajectory, trajectory_settings);
+  const Eigen::VectorXd expected_gradient =
+      computeFiniteDifferenceCostGradient(generate, segment_times);
+  EXPECT_LT((gradient - expected_gradient).norm(),
+            kTolerance * std::max(1.0, expected_gradient.norm()))
+      << "Gradient: " << gradient.transpose()
+      << ", expected: " << expected_gradient.transpose();
+}
+
+TEST(BatchGenerationTest, MatchesIndividualTrajectories) {
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> uniform(-5.0, 5.0);
+
+  std::vector<minimum_snap_trajectories::MinimumSnapTrajectoryProblem>
+      problems(20);
+  for (int i = 0; i < int(problems.size()); i++) {
+    const int num_way_points = i % 5;
+    for (int j = 0; j < num_way_points; j++) {
+      problems[i].trajectory_settings.way_points.push_back(Eigen::Vector3d(
+          uniform(generator), uniform(generator), uniform(generator)));
+    }
+    problems[i].trajectory_settings.minimization_weights =
+        Eigen::Vector4d(0.0, 1.0, 1.0, 1.0);
+    problems[i].trajectory_settings.polynomial_order = 9;
+    problems[i].trajectory_settings.continuity_order = 4;
+    problems[i].segment_times =
+        Eigen::VectorXd::Constant(num_way_points + 1, 2.0);
+    problems[i].end_state.position = Eigen::Vector3d(
+        uniform(generator), uniform(generator), uniform(generator));
+    problems[i].segment_refinement = (i % 2 == 0);
+  }
+
+  const std::vector<PolynomialTrajectory> trajectories =
+      minimum_snap_trajectories::generateMinimumSnapTrajectories(problems, 4);
+
+  ASSERT_EQ(problems.size(), trajectories.size());
+  for (int i = 0; i < int(problems.size()); i++) {
+    const PolynomialTrajectory reference =
+        minimum_snap_trajectories::generateMinimumSnapTrajectory(problems[i]);
+    EXPECT_EQ(reference.segment_times, trajectories[i].segment_times);
+    EXPECT_EQ(reference.optimization_cost, trajectories[i].optimization_cost);
+  }
+}
+
+TEST(HeadingTest, OptimizesHeadingAsFourthDimension) {
+  PolynomialTrajectorySettings trajectory_settings;
+  trajectory_settings.way_points.push_back(Eigen::Vector3d(2.0, 0.0, 1.0));
+  trajectory_settings.way_points.push_back(Eigen::Vector3d(2.0, 2.0, 1.0));
+  trajectory_settings.minimization_weights =
+      Eigen::Vector4d(0.0, 1.0, 1.0, 1.0);
+  trajectory_settings.polynomial_order = 9;
+  trajectory_settings.continuity_order = 4;
+  quadrotor_common::TrajectoryPoint start_state;
+  start_state.heading = -0.5;
+  start_state.heading_rate = 0.2;
+  quadrotor_common::TrajectoryPoint end_state;
+  end_state.position = Eigen::Vector3d(0.0, 2.0, 1.0);
+  end_state.heading = 2.0;
+  const Eigen::VectorXd segment_times = Eigen::Vector3d(1.5, 1.0, 2.0);
+
+  const PolynomialTrajectory position_only =
+      minimum_snap_trajectories::generateMinimumSnapTrajectory(
+          segment_times, start_state, end_state, trajectory_settings);
+
+  const std::vector<double> heading_way_points = {0.5, 1.5};
+  trajectory_settings.heading_way_points = heading_way_points;
+  for (const MinimumSnapSolver solver :
+       {MinimumSnapSolver::CONSTRAINED_QP,
+        MinimumSnapSolver::FREE_DERIVATIVES}) {
+    trajectory_settings.minimum_snap_solver = solver;
+    const PolynomialTrajectory trajectory =
+        minimum_snap_trajectories::generateMinimumSnapTrajectory(
+            segment_times, start_state, end_state, trajectory_settings);
+    ASSERT_EQ(TrajectoryType::MINIMUM_SNAP, trajectory.trajectory_type);
+    ASSERT_EQ(4, trajectory.coeff[0].rows());
+
+    // The position is not affected by the heading
+    for (int i = 0; i < 3; i++) {
+      EXPECT_LT((trajectory.coeff[i].topRows(3) - position_only.coeff[i])
+                    .norm(),
+                1e-6 * std::max(1.0, position_only.coeff[i].norm()));
+    }
+    EXPECT_GT(trajectory.optimization_cost, position_only.optimization_cost);
+
+    const quadrotor_common::TrajectoryPoint start =
+        getPointFromTrajectory(trajectory, ros::Duration(0.0));
+    EXPECT_NEAR(start_state.heading, start.heading, 1e-6);
+    EXPECT_NEAR(start_state.heading_rate, start.heading_rate, 1e-6);
+    EXPECT_NEAR(heading_way_points[0],
+                getPointFromTrajectory(trajectory, ros::Duration(1.5)).heading,
+                1e-6);
+    EXPECT_NEAR(heading_way_points[1],
+                getPointFromTrajectory(trajectory, ros::Duration(2.5)).heading,
+                1e-6);
+    const quadrotor_common::TrajectoryPoint end =
+        getPointFromTrajectory(trajectory, ros::Duration(4.5));
+    EXPECT_NEAR(end_state.heading, end.heading, 1e-6);
+    EXPECT_NEAR(0.0, end.heading_rate, 1e-6);
+    EXPECT_NEAR(0.0, end.heading_acceleration, 1e-6);
+
+    // Heading rate and acceleration are continuous at the way points
+    for (const double t : {1.5, 2.5}) {
+      const quadrotor_common::TrajectoryPoint before =
+          getPointFromTrajectory(trajectory, ros::Duration(t - 1e-6));
+      const quadrotor_common::TrajectoryPoint after =
+          getPointFromTrajectory(trajectory, ros::Duration(t + 1e-6));
+      EXPECT_NEAR(before.heading_rate, after.heading_rate, 1e-4);
+      EXPECT_NEAR(before.heading_acceleration, after.heading_acceleration,
+                  1e-4);
+    }
+  }
+
+  // One heading per way point is required
+  trajectory_settings.heading_way_points.pop_back();
+  EXPECT_EQ(TrajectoryType::UNDEFINED,
+            minimum_snap_trajectories::generateMinimumSnapTrajectory(
+                segment_times, start_state, end_state, trajectory_settings)
+                .trajectory_type);
+}
+
+TEST(InitialSegmentTimesTest, JerkLimitedTrapezoidalProfile) {
+  const double max_velocity = 5.0;
+  const double max_normalized_thrust = 15.0;
+  const double max_roll_pitch_rate = 3.0;
+  const double max_acceleration =
+      sqrt(max_normalized_thrust * max_normalized_thrust - 9.81 * 9.81);
+  const double max_jerk = max_normalized_thrust * max_roll_pitch_rate;
+
+  // Rest to rest along a long horizontal line reaches the maximum velocity
+  PolynomialTrajectorySettings trajectory_settings;
+  quadrotor_common::TrajectoryPoint start_state;
+  quadrotor_common::TrajectoryPoint end_state;
+  end_state.position = Eigen::Vector3d(20.0, 0.0, 0.0);
+  const Eigen::VectorXd straight_times =
+      minimum_snap_trajectories::computeInitialSegmentTimes(
+          start_state, end_state, trajectory_settings, max_velocity,
+          max_normalized_thrust, max_roll_pitch_rate);
+  ASSERT_EQ(1, straight_times.size());
+  EXPECT_NEAR(max_velocity / max_acceleration + max_acceleration / max_jerk +
+                  20.0 / max_velocity,
+              straight_times(0), 1e-9);
+
+  // Turning at the way point takes longer than flying straight through it
+  trajectory_settings.way_points.push_back(Eigen::Vector3d(10.0, 0.0, 0.0));
+  const double straight_through =
+      minimum_snap_trajectories::computeInitialSegmentTimes(
+          start_state, end_state, trajectory_settings, max_velocity,
+          max_normalized_thrust, max_roll_pitch_rate)
+          .sum();
+  EXPECT_NEAR(straight_times(0), straight_through, 1e-6);
+  end_state.position = Eigen::Vector3d(10.0, 10.0, 0.0);
+  const double right_angle =
+      minimum_snap_trajectories::computeInitialSegmentTimes(
+          start_state, end_state, trajectory_settings, max_velocity,
+          max_normalized_thrust, max_roll_pitch_rate)
+          .sum();
+  end_state.position = Eigen::Vector3d(0.0, 0.0, 0.0);
+  const double turn_around =
+      minimum_snap_trajectories::computeInitialSegmentTimes(
+          start_state, end_state, trajectory_settings, max_velocity,
+          max_normalized_thrust, max_roll_pitch_rate)
+          .sum();
+  EXPECT_GT(right_angle, straight_through);
+  EXPECT_GT(turn_around, right_angle);
+
+  // Ring trajectories have one segment per way point
+  trajectory_settings.way_points = {
+      Eigen::Vector3d(0.0, 0.0, 1.0), Eigen::Vector3d(5.0, 0.0, 1.0),
+      Eigen::Vector3d(5.0, 5.0, 1.0), Eigen::Vector3d(0.0, 5.0, 1.0)};
+  const Eigen::VectorXd ring_times =
+      minimum_snap_trajectories::computeInitialRingSegmentTimes(
+          trajectory_settings, max_velocity, max_normalized_thrust,
+          max_roll_pitch_rate);
+  ASSERT_EQ(4, ring_times.size());
+  for (int i = 1; i < 4; i++) {
+    EXPECT_NEAR(ring_times(0), ring_times(i), 1e-6);
+  }
+
+  // Uniform initial segment times are replaced by the estimate of each
+  // segment, others keep their ratios and are scaled to the estimated
+  // duration
+  const Eigen::VectorXd estimated_times = Eigen::Vector3d(1.0, 2.0, 3.0);
+  EXPECT_EQ(estimated_times,
+            minimum_snap_trajectories::implementation::computeSeedSegmentTimes(
+                Eigen::Vector3d::Constant(2.0), estimated_times));
+  EXPECT_LT((Eigen::Vector3d(1.0, 1.0, 4.0) -
+             minimum_snap_trajectories::implementation::
+                 computeSeedSegmentTimes(Eigen::Vector3d(0.5, 0.5, 2.0),
+                                         estimated_times))
+                .norm(),
+            1e-12);
+}
+
+TEST_F(RecedingHorizonTest, ReplansOnlyTheHorizon) {
+  ASSERT_EQ(TrajectoryType::MINIMUM_SNAP, trajectory_.trajectory_type);
+
+  // Replan the rest of the second segment and the next one from a disturbed
+  // reference state
+  const double replanning_time = 2.0;
+  quadrotor_common::TrajectoryPoint current_state =
+      getPointFromTrajectory(trajectory_, ros::Duration(replanning_time));
+  current_state.position += Eigen::Vector3d(0.1, -0.1, 0.05);
+  current_state.velocity += Eigen::Vector3d(0.2, 0.0, -0.1);
+  current_state.heading += 0.1;
+  const PolynomialTrajectory replanned =
+      minimum_snap_trajectories::replanMinimumSnapTrajectory(
+          trajectory_, ros::Duration(replanning_time), current_state, 2,
+          trajectory_settings_);
+  ASSERT_EQ(TrajectoryType::MINIMUM_SNAP, replanned.trajectory_type);
+  ASSERT_EQ(5, replanned.number_of_segments);
+  EXPECT_NEAR(trajectory_.T.toSec() - replanning_time, replanned.T.toSec(),
+              1e-9);
+  EXPECT_NEAR(0.7, replanned.segment_times(0), 1e-9);
+
+  // The segments after the horizon are kept
+  for (int i = 2; i < 5; i++) {
+    EXPECT_EQ(trajectory_.coeff[i + 1], replanned.coeff[i]);
+    EXPECT_EQ(segment_times_(i + 1), replanned.segment_times(i));
+  }
+
+  const quadrotor_common::TrajectoryPoint start =
+      getPointFromTrajectory(replanned, ros::Duration(0.0));
+  EXPECT_LT((current_state.position - start.position).norm(), 1e-6);
+  EXPECT_LT((current_state.velocity - start.velocity).norm(), 1e-6);
+  EXPECT_NEAR(current_state.heading, start.heading, 1e-6);
+
+  // The horizon passes the way point and connects smoothly to the kept
+  // segments
+  const double way_point_time = replanned.segment_times(0);
+  EXPECT_LT((trajectory_settings_.way_points[1] -
+             getPointFromTrajectory(replanned, ros::Duration(way_point_time))
+                 .position)
+                .norm(),
+            1e-6);
+  const double splice_time = replanned.segment_times.head(2).sum();
+  const quadrotor_common::TrajectoryPoint before =
+      getPointFromTrajectory(replanned, ros::Duration(splice_time - 1e-6));
+  const quadrotor_common::TrajectoryPoint after =
+      getPointFromTrajectory(replanned, ros::Duration(splice_time + 1e-6));
+  EXPECT_LT((before.position - after.position).norm(), 1e-4);
+  EXPECT_LT((before.velocity - after.velocity).norm(), 1e-4);
+  EXPECT_LT((before.acceleration - after.acceleration).norm(), 1e-4);
+  EXPECT_LT((before.jerk - after.jerk).norm(), 1e-3);
+  EXPECT_NEAR(before.heading, after.heading, 1e-4);
+  EXPECT_NEAR(before.heading_rate, after.heading_rate, 1e-4);
+
+  // A short remainder of the current segment is merged with the next one
+  const double late_replanning_time = 2.65;
+  const PolynomialTrajectory merged =
+      minimum_snap_trajectories::replanMinimumSnapTrajectory(
+          trajectory_, ros::Duration(late_replanning_time),
+          getPointFromTrajectory(trajectory_,
+                                 ros::Duration(late_replanning_time)),
+          2, trajectory_settings_);
+  ASSERT_EQ(TrajectoryType::MINIMUM_SNAP, merged.trajectory_type);
+  ASSERT_EQ(4, merged.number_of_segments);
+  EXPECT_NEAR(1.45, merged.segment_times(0), 1e-9);
+  EXPECT_EQ(trajectory_.coeff.back(), merged.coeff.back());
+
+  // The horizon is limited by the end of the trajectory
+  const PolynomialTrajectory end_reached =
+      minimum_snap_trajectories::replanMinimumSnapTrajectory(
+          trajectory_, ros::Duration(6.0),
+          getPointFromTrajectory(trajectory_, ros::Duration(6.0)), 5,
+          trajectory_settings_);
+  ASSERT_EQ(TrajectoryType::MINIMUM_SNAP, end_reached.trajectory_type);
+  ASSERT_EQ(2, end_reached.number_of_segments);
+  EXPECT_LT((end_state_.position -
+             getPointFromTrajectory(end_reached, end_reached.T).position)
+                .norm(),
+            1e-6);
+
+  EXPECT_EQ(TrajectoryType::UNDEFINED,
+            minimum_snap_trajectories::replanMinimumSnapTrajectory(
+                trajectory_, trajectory_.T, end_state_, 2, trajectory_settings_)
+                .trajectory_type);
+}
+
+TEST_F(RecedingHorizonTest, ReplansHeadingWithoutWayPoints) {
+  ASSERT_EQ(4, trajectory_.coeff.dimension());
+
+  // A single segment horizon has no way point, but the heading still needs
+  // to be replanned to append the kept segments
+  const double replanning_time = 2.0;
+  quadrotor_common::TrajectoryPoint current_state =
+      getPointFromTrajectory(trajectory_, ros::Duration(replanning_time));
+  current_state.heading += 0.1;
+  const PolynomialTrajectory single_segment =
+      minimum_snap_trajectories::replanMinimumSnapTrajectory(
+          trajectory_, ros::Duration(replanning_time), current_state, 1,
+          trajectory_settings_);
+  ASSERT_EQ(TrajectoryType::MINIMUM_SNAP, single_segment.trajectory_type);
+  ASSERT_EQ(4, single_segment.coeff.dimension());
+  ASSERT_EQ(5, single_segment.number_of_segments);
+  for (int i = 1; i < 5; i++) {
+    EXPECT_EQ(trajectory_.coeff[i + 1], single_segment.coeff[i]);
+  }
+  EXPECT_NEAR(
+      current_state.heading,
+      getPointFromTrajectory(single_segment, ros::Duration(0.0)).heading,
+      1e-6);
+  const double splice_time = single_segment.segment_times(0);
+  const quadrotor_common::TrajectoryPoint before =
+      getPointFromTrajectory(single_segment, ros::Duration(splice_time - 1e-6));
+  const quadrotor_common::TrajectoryPoint after =
+      getPointFromTrajectory(single_segment, ros::Duration(splice_time + 1e-6));
+  EXPECT_NEAR(before.heading, after.heading, 1e-4);
+  EXPECT_NEAR(before.heading_rate, after.heading_rate, 1e-4);
+
+  // Inside the last segment the horizon ends in the end state
+  const double last_segment_time = 7.5;
+  current_state =
+      getPointFromTrajectory(trajectory_, ros::Duration(last_segment_time));
+  current_state.heading += 0.1;
+  const PolynomialTrajectory last_segment =
+      minimum_snap_trajectories::replanMinimumSnapTrajectory(
+          trajectory_, ros::Duration(last_segment_time), current_state, 2,
+          trajectory_settings_);
+  ASSERT_EQ(TrajectoryType::MINIMUM_SNAP, last_segment.trajectory_type);
+  ASSERT_EQ(4, last_segment.coeff.dimension());
+  ASSERT_EQ(1, last_segment.number_of_segments);
+  EXPECT_NEAR(
+      current_state.heading,
+      getPointFromTrajectory(last_segment, ros::Duration(0.0)).heading,
+      1e-6);
+  EXPECT_NEAR(end_state_.heading,
+              getPointFromTrajectory(last_segment, last_segment.T).heading,
+              1e-6);
+}
+
+TEST(CorridorTest, KeepsTrajectoryInsideCorridors) {
+  // Around a corner, the unconstrained trajectory leaves the corridors
+  PolynomialTrajectorySettings trajectory_settings;
+  trajectory_settings.way_points.push_back(Eigen::Vector3d(2.0, 0.0, 0.0));
+  trajectory_settings.minimization_weights =
+      Eigen::Vector4d(0.0, 0.0, 0.0, 1.0);
+  trajectory_settings.polynomial_order = 9;
+  trajectory_settings.continuity_order = 4;
+  quadrotor_common::TrajectoryPoint start_state;
+  quadrotor_common::TrajectoryPoint end_state;
+  end_state.position = Eigen::Vector3d(2.0, 2.0, 0.0);
+  const Eigen::VectorXd segment_times = Eigen::Vector2d(1.5, 1.5);
+
+  const PolynomialTrajectory unconstrained =
+      minimum_snap_trajectories::generateMinimumSnapTrajectory(
+          segment_times, start_state, end_state, trajectory_settings);
+
+  // Wide corridors do not change the trajectory
+  trajectory_settings.corridor_lower_bounds = {
+      Eigen::Vector3d::Constant(-10.0), Eigen::Vector3d::Constant(-10.0)};
+  trajectory_settings.corridor_upper_bounds = {
+      Eigen::Vector3d::Constant(10.0), Eigen::Vector3d::Constant(10.0)};
+  const PolynomialTrajectory wide =
+      minimum_snap_trajectories::generateMinimumSnapTrajectory(
+          segment_times, start_state, end_state, trajectory_settings);
+  ASSERT_EQ(TrajectoryType::MINIMUM_SNAP, wide.trajectory_type);
+  EXPECT_NEAR(unconstrained.optimization_cost, wide.optimization_cost,
+              1e-6 * unconstrained.optimization_cost);
+  for (int i = 0; i < 2; i++) {
+    EXPECT_LT((unconstrained.coeff[i] - wide.coeff[i]).norm(), 1e-6);
+  }
+
+  trajectory_settings.corridor_lower_bounds = {
+      Eigen::Vector3d(-0.1, -0.1, -0.1), Eigen::Vector3d(1.9, -0.1, -0.1)};
+  trajectory_settings.corridor_upper_bounds = {
+      Eigen::Vector3d(2.1, 0.1, 0.1), Eigen::Vector3d(2.1, 2.1, 0.1)};
+  const PolynomialTrajectory constrained =
+      minimum_snap_trajectories::generateMinimumSnapTrajectory(
+          segment_times, start_state, end_state, trajectory_settings);
+  ASSERT_EQ(TrajectoryType::MINIMUM_SNAP, constrained.trajectory_type);
+  EXPECT_GT(constrained.optimization_cost, unconstrained.optimization_cost);
+
+  bool unconstrained_inside = true;
+  for (int i = 0; i <= 300; i++) {
+    const double t = 0.01 * i;
+    const int segment = t <= segment_times(0) ? 0 : 1;
+    const Eigen::Array3d lower =
+        trajectory_settings.corridor_lower_bounds[segment].array();
+    const Eigen::Array3d upper =
+        trajectory_settings.corridor_upper_bounds[segment].array();
+    const Eigen::Array3d position =
+        getPointFromTrajectory(constrained, ros::Duration(t)).position.array();
+    EXPECT_TRUE((position >= lower - 1e-9).all() &&
+                (position <= upper + 1e-9).all())
+        << "t = " << t;
+    const Eigen::Array3d unconstrained_position =
+        getPointFromTrajectory(unconstrained, ros::Duration(t))
+            .position.array();
+    unconstrained_inside &= (unconstrained_position >= lower).all() &&
+                            (unconstrained_position <= upper).all();
+  }
+  EXPECT_FALSE(unconstrained_inside);
+
+  // Way points outside of their corridors are rejected
+  trajectory_settings.corridor_upper_bounds[1].y() = 1.0;
+  EXPECT_EQ(TrajectoryType::UNDEFINED,
+            minimum_snap_trajectories::generateMinimumSnapTrajectory(
+                segment_times, start_state, end_state, trajectory_settings)
+                .trajectory_type);
+}
+
+TEST(BlockTridiagonalSolverTest, MatchesDenseSolution) {
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+
+  const int kNumBlocks = 6;
+  const int kBlockSize = 3;
+  std::vector<Eigen::MatrixXd> diagonal_blocks(kNumBlocks);
+  std::vector<Eigen::MatrixXd> lower_blocks(
+      kNumBlocks, Eigen::MatrixXd::Zero(kBlockSize, kBlockSize));
+  Eigen::MatrixXd M =
+      Eigen::MatrixXd::Zero(kNumBlocks * kBlockSize, kNumBlocks * kBlockSize);
+  for (int i = 0; i < kNumBlocks; i++) {
+    // Diagonally dominant blocks result in a positive definite matrix
+    Eigen::MatrixXd random_block(kBlockSize, kBlockSize);
+    for (int j = 0; j < random_block.size(); j++) {
+      random_block(j) = uniform(generator);
+    }
+    diagonal_blocks[i] =
+        random_block * random_block.transpose() +
+        10.0 * Eigen::MatrixXd::Identity(kBlockSize, kBlockSize);
+    M.block(i * kBlockSize, i * kBlockSize, kBlockSize, kBlockSize) =
+        diagonal_blocks[i];
+    if (i > 0) {
+      for (int j = 0; j < lower_blocks[i].size(); j++) {
+        lower_blocks[i](j) = uniform(generator);
+      }
+      M.block(i * kBlockSize, (i - 1) * kBlockSize, kBlockSize, kBlockSize) =
+          lower_blocks[i];
+      M.block((i - 1) * kBlockSize, i * kBlockSize, kBlockSize, kBlockSize) =
+          lower_blocks[i].transpose();
+    }
+  }
+  Eigen::VectorXd rhs(kNumBlocks * kBlockSize);
+  for (int i = 0; i < rhs.size(); i++) {
+    rhs(i) = uniform(generator);
+  }
+
+  Eigen::VectorXd solution;
+  ASSERT_TRUE(minimum_snap_trajectories::implementation::
+                  solveBlockTridiagonalSystem(diagonal_blocks, lower_blocks,
+                                              rhs, &solution));
+  EXPECT_LT((M * solution - rhs).norm(), 1e-10);
+}
+
+INSTANTIATE_TEST_CASE_P(
+    Settings, FreeDerivativesSolverTest,
+    ::testing::Values(SolverTestCase{11, 4, {0.0, 1.0, 1.0, 1.0, 1.0}},
+                      SolverTestCase{9, 4, {0.0, 0.0, 0.0, 0.0, 1.0}},
+                      SolverTestCase{7, 3, {0.0, 0.0, 0.0, 1.0}},
+                      SolverTestCase{10, 3, {0.0, 0.0, 1.0, 0.0, 1.0}}));
+
+}  // namespace polynomial_trajectories
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+#include <quadrotor_common/trajectory_point.h>
+#include <Eigen/Dense>
+
+#include "polynomial_trajectories/minimum_snap_trajectories.h"
+#include "polynomial_trajectories/minimum_snap_trajectory_session.h"
+#include "polynomial_trajectories/polynomial_trajectory.h"
+#include "polynomial_trajectories/polynomial_trajectory_settings.h"
+
+namespace polynomial_trajectories {
+
+namespace {
+
+class MinimumSnapTrajectorySessionTest : public ::testing::Test {
+ protected:
+  MinimumSnapTrajectorySessionTest() : generator_(42), uniform_(-1.0, 1.0) {
+    for (int i = 0; i < 5; i++) {
+      trajectory_settings_.way_points.push_back(randomVector(5.0));
+      segment_times_.push_back(1.5 + uniform_(generator_));
+    }
+    segment_times_.push_back(1.5 + uniform_(generator_));
+    Eigen::VectorXd minimization_weights(5);
+    minimization_weights << 0.0, 1.0, 1.0, 1.0, 1.0;
+    trajectory_settings_.minimization_weights = minimization_weights;
+    trajectory_settings_.polynomial_order = 11;
+    trajectory_settings_.continuity_order = 4;
+    trajectory_settings_.minimum_snap_solver =
+        MinimumSnapSolver::FREE_DERIVATIVES;
+
+    start_state_.position = randomVector(5.0);
+    start_state_.velocity = randomVector(1.0);
+    end_state_.position = randomVector(5.0);
+    end_state_.acceleration = randomVector(1.0);
+  }
+
+  Eigen::Vector3d randomVector(const double scale) {
+    return scale *
+           Eigen::Vector3d(uniform_(generator_), uniform_(generator_),
+                           uniform_(generator_));
+  }
+
+  Eigen::VectorXd segmentTimes() const {
+    return Eigen::Map<const Eigen::VectorXd>(segment_times_.data(),
+                                             segment_times_.size());
+  }
+
+  void expectMatchesColdSolve(MinimumSnapTrajectorySession* session) {
+    const double kCostTolerance = 1e-8;
+    const double kCoefficientTolerance = 1e-6;
+
+    const PolynomialTrajectory reference =
+        minimum_snap_trajectories::generateMinimumSnapTrajectory(
+            segmentTimes(), start_state_, end_state_, trajectory_settings_);
+    const PolynomialTrajectory trajectory = session->trajectory();
+
+    ASSERT_EQ(reference.trajectory_type, trajectory.trajectory_type);
+    ASSERT_EQ(reference.coeff.size(), trajectory.coeff.size());
+    EXPECT_NEAR(reference.T.toSec(), trajectory.T.toSec(), 1e-12);
+    EXPECT_NEAR(reference.optimization_cost, trajectory.optimization_cost,
+                kCostTolerance * std::max(1.0, reference.optimization_cost));
+    for (int i = 0; i < int(reference.coeff.size()); i++) {
+      EXPECT_LT((reference.coeff[i] - trajectory.coeff[i]).norm(),
+                kCoefficientTolerance *
+                    std::max(1.0, reference.coeff[i].norm()));
+    }
+  }
+
+  std::mt19937 generator_;
+  std::uniform_real_distribution<double> uniform_;
+
+  PolynomialTrajectorySettings trajectory_settings_;
+  std::vector<double> segment_times_;
+  quadrotor_common::TrajectoryPoint start_state_;
+  quadrotor_common::TrajectoryPoint end_state_;
+};
+
+}  // namespace
+
+TEST_F(MinimumSnapTrajectorySessionTest, MatchesColdSolveAfterUpdates) {
+  MinimumSnapTrajectorySession session(segmentTimes(), start_state_,
+                                       end_state_, trajectory_settings_);
+  expectMatchesColdSolve(&session);
+
+  for (int i = 0; i < 3; i++) {
+    const int index = 2 * i;
+    trajectory_settings_.way_points[index] = randomVector(5.0);
+    ASSERT_TRUE(session.moveWayPoint(
+        index, trajectory_settings_.way_points[index]));
+    expectMatchesColdSolve(&session);
+  }
+
+  segment_times_[3] = 0.7;
+  ASSERT_TRUE(session.setSegmentTime(3, segment_times_[3]));
+  expectMatchesColdSolve(&session);
+
+  segment_times_[0] = 2.1;
+  ASSERT_TRUE(session.setSegmentTime(0, segment_times_[0]));
+  expectMatchesColdSolve(&session);
+
+  // Insert before the third way point, splitting segment 2
+  const Eigen::Vector3d new_way_point = randomVector(5.0);
+  trajectory_settings_.way_points.insert(
+      trajectory_settings_.way_points.begin() + 2, new_way_point);
+  segment_times_[2] = 0.9;
+  segment_times_.insert(segment_times_.begin() + 3, 1.1);
+  ASSERT_TRUE(session.insertWayPoint(2, new_way_point, 0.9, 1.1));
+  EXPECT_EQ(6, session.numWayPoints());
+  expectMatchesColdSolve(&session);
+
+  // Append a way point right before the end position
+  trajectory_settings_.way_points.push_back(randomVector(5.0));
+  segment_times_.back() = 1.3;
+  segment_times_.push_back(0.8);
+  ASSERT_TRUE(session.insertWayPoint(
+      6, trajectory_settings_.way_points.back(), 1.3, 0.8));
+  expectMatchesColdSolve(&session);
+
+  // Remove the first way point, merging the first two segments
+  trajectory_settings_.way_points.erase(
+      trajectory_settings_.way_points.begin());
+  segment_times_[0] = 2.5;
+  segment_times_.erase(segment_times_.begin() + 1);
+  ASSERT_TRUE(session.removeWayPoint(0, 2.5));
+  EXPECT_EQ(6, session.numWayPoints());
+  EXPECT_EQ(7, session.numSegments());
+  expectMatchesColdSolve(&session);
+}
+
+TEST_F(MinimumSnapTrajectorySessionTest, RejectsInvalidUpdates) {
+  MinimumSnapTrajectorySession session(segmentTimes(), start_state_,
+                                       end_state_, trajectory_settings_);
+
+  EXPECT_FALSE(session.moveWayPoint(-1, Eigen::Vector3d::Zero()));
+  EXPECT_FALSE(session.moveWayPoint(5, Eigen::Vector3d::Zero()));
+  EXPECT_FALSE(session.insertWayPoint(6, Eigen::Vector3d::Zero(), 1.0, 1.0));
+  EXPECT_FALSE(session.insertWayPoint(0, Eigen::Vector3d::Zero(), 0.0, 1.0));
+  EXPECT_FALSE(session.removeWayPoint(5, 1.0));
+  EXPECT_FALSE(session.setSegmentTime(6, 1.0));
+  EXPECT_FALSE(session.setSegmentTime(0, -1.0));
+  expectMatchesColdSolve(&session);
+}
+
+}  // namespace polynomial_trajectories
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include <quadrotor_common/trajectory_point.h>
+#include <Eigen/Dense>
+
+#include "polynomial_trajectories/minimum_snap_trajectories.h"
+#include "polynomial_trajectories/polynomial_trajectory.h"
+#include "polynomial_trajectories/polynomial_trajectory_settings.h"
+
+// Counts the heap allocations of the whole process by wrapping the allocation
+// functions of glibc, which are also used by operator new and Eigen
+namespace {
+std::atomic<int> num_allocations(0);
+}  // namespace
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t num, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) {
+  num_allocations++;
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t num, size_t size) {
+  num_allocations++;
+  return __libc_calloc(num, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  num_allocations++;
+  return __libc_realloc(ptr, size);
+}
+}
+
+namespace polynomial_trajectories {
+
+namespace {
+
+class MinimumSnapWorkspaceTest : public ::testing::Test {
+ protected:
+  MinimumSnapWorkspaceTest() : generator_(42), uniform_(-5.0, 5.0) {
+    trajectory_settings_.way_points.resize(kNumWayPoints);
+    trajectory_settings_.heading_way_points.resize(kNumWayPoints);
+    trajectory_settings_.minimization_weights =
+        (Eigen::VectorXd(5) << 0.0, 0.0, 0.0, 0.0, 1.0).finished();
+    trajectory_settings_.polynomial_order = 9;
+    trajectory_settings_.continuity_order = 4;
+    segment_times_.resize(kNumWayPoints + 1);
+  }
+
+  // Draws a new problem of the same size without allocating memory
+  void randomizeProblem() {
+    for (int i = 0; i < kNumWayPoints; i++) {
+      trajectory_settings_.way_points[i] = Eigen::Vector3d(
+          uniform_(generator_), uniform_(generator_), uniform_(generator_));
+      trajectory_settings_.heading_way_points[i] = 0.2 * uniform_(generator_);
+    }
+    start_state_.position = Eigen::Vector3d(
+        uniform_(generator_), uniform_(generator_), uniform_(generator_));
+    end_state_.position = Eigen::Vector3d(
+        uniform_(generator_), uniform_(generator_), uniform_(generator_));
+    end_state_.heading = 0.2 * uniform_(generator_);
+    for (int i = 0; i < kNumWayPoints + 1; i++) {
+      segment_times_(i) = 2.0 + 0.2 * uniform_(generator_);
+    }
+  }
+
+  static constexpr int kNumWayPoints = 4;
+
+  std::mt19937 generator_;
+  std::uniform_real_distribution<double> uniform_;
+  PolynomialTrajectorySettings trajectory_settings_;
+  quadrotor_common::TrajectoryPoint start_state_;
+  quadrotor_common::TrajectoryPoint end_state_;
+  Eigen::VectorXd segment_times_;
+};
+
+constexpr int MinimumSnapWorkspaceTest::kNumWayPoints;
+
+}  // namespace
+
+TEST_F(MinimumSnapWorkspaceTest, NoAllocationsAfterWarmUp) {
+  const int kNumProblems = 20;
+
+  minimum_snap_trajectories::MinimumSnapWorkspace workspace;
+  PolynomialTrajectory trajectory;
+  randomizeProblem();
+  ASSERT_TRUE(minimum_snap_trajectories::generateMinimumSnapTrajectory(
+      segment_times_, start_state_, end_state_, trajectory_settings_,
+      &workspace, &trajectory));
+
+  const int num_allocations_before = num_allocations;
+  int num_successful = 0;
+  for (int i = 0; i < kNumProblems; i++) {
+    randomizeProblem();
+    if (minimum_snap_trajectories::generateMinimumSnapTrajectory(
+            segment_times_, start_state_, end_state_, trajectory_settings_,
+            &workspace, &trajectory)) {
+      num_successful++;
+    }
+  }
+  const int num_allocations_after = num_allocations;
+
+  EXPECT_EQ(kNumProblems, num_successful);
+  EXPECT_EQ(num_allocations_before, num_allocations_after);
+}
+
+TEST_F(MinimumSnapWorkspaceTest, MatchesFreeDerivativesSolver) {
+  const double kCostTolerance = 1e-6;
+  const double kCoefficientTolerance = 1e-4;
+
+  minimum_snap_trajectories::MinimumSnapWorkspace workspace;
+  for (int i = 0; i < 5; i++) {
+    randomizeProblem();
+    PolynomialTrajectory trajectory;
+    ASSERT_TRUE(minimum_snap_trajectories::generateMinimumSnapTrajectory(
+        segment_times_, start_state_, end_state_, trajectory_settings_,
+        &workspace, &trajectory));
+
+    PolynomialTrajectorySettings free_derivatives_settings =
+        trajectory_settings_;
+    free_derivatives_settings.minimum_snap_solver =
+        MinimumSnapSolver::FREE_DERIVATIVES;
+    const PolynomialTrajectory reference =
+        minimum_snap_trajectories::generateMinimumSnapTrajectory(
+            segment_times_, start_state_, end_state_,
+            free_derivatives_settings);
+
+    ASSERT_EQ(reference.trajectory_type, trajectory.trajectory_type);
+    ASSERT_EQ(reference.coeff.size(), trajectory.coeff.size());
+    EXPECT_NEAR(reference.optimization_cost, trajectory.optimization_cost,
+                kCostTolerance * std::max(1.0, reference.optimization_cost));
+    for (size_t k = 0; k < reference.coeff.size(); k++) {
+      ASSERT_EQ(4, trajectory.coeff[k].rows());
+      EXPECT_LT((reference.coeff[k] - trajectory.coeff[k]).norm(),
+                kCoefficientTolerance *
+                    std::max(1.0, reference.coeff[k].norm()));
+    }
+  }
+}
+
+}  // namespace polynomial_trajectories
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,188 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <quadrotor_common/trajectory_point.h>
+#include <Eigen/Dense>
+
+#include "polynomial_trajectories/constrained_polynomial_trajectories.h"
+#include "polynomial_trajectories/minimum_snap_trajectories.h"
+#include "polynomial_trajectories/polynomial_trajectories_common.h"
+#include "polynomial_trajectories/polynomial_trajectory.h"
+#include "polynomial_trajectories/polynomial_trajectory_settings.h"
+#include "polynomial_trajectories/thread_pool.h"
+
+namespace polynomial_trajectories {
+
+TEST(PolynomialDerivativesTest, MatchesTermWiseEvaluation) {
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+
+  for (int num_dimensions = 3; num_dimensions <= 4; num_dimensions++) {
+    for (int num_coefficients = 1; num_coefficients < 12; num_coefficients++) {
+      Eigen::MatrixXd coefficients(num_dimensions, num_coefficients);
+      for (int i = 0; i < coefficients.size(); i++) {
+        coefficients(i) = uniform(generator);
+      }
+      const double t = 1.5 * uniform(generator);
+
+      Eigen::Matrix<double, 4, 5> derivatives;
+      evaluatePolynomialDerivatives(coefficients, false, t, &derivatives);
+      Eigen::Matrix<double, 4, 5> reversed_derivatives;
+      evaluatePolynomialDerivatives(coefficients.rowwise().reverse(), true, t,
+                                    &reversed_derivatives);
+
+      for (int k = 0; k < 5; k++) {
+        Eigen::Vector4d expected = Eigen::Vector4d::Zero();
+        expected.head(num_dimensions) =
+            coefficients * (dVec(num_coefficients, k).asDiagonal() *
+                            tVec(num_coefficients, k, t));
+        EXPECT_LT((expected - derivatives.col(k)).norm(), 1e-10);
+        EXPECT_LT((expected - reversed_derivatives.col(k)).norm(), 1e-10);
+      }
+    }
+  }
+}
+
+TEST(PolynomialCoefficientsTest, StoresSegmentsContiguously) {
+  std::vector<Eigen::MatrixXd> segments;
+  for (int i = 0; i < 3; i++) {
+    segments.push_back(Eigen::MatrixXd::Random(4, 10));
+  }
+
+  const PolynomialCoefficients coefficients(segments);
+  ASSERT_EQ(segments.size(), coefficients.size());
+  EXPECT_EQ(4, coefficients.dimension());
+  EXPECT_EQ(10, coefficients.numCoefficients());
+  for (size_t i = 0; i < segments.size(); i++) {
+    EXPECT_EQ(segments[i], coefficients[i]);
+    EXPECT_EQ(coefficients.data() + i * coefficients.segmentSize(),
+              coefficients[i].data());
+  }
+}
+
+TEST(QuadRelevantMaximaTest, MatchesPointwiseEvaluation) {
+  const double kTolerance = 1e-6;
+
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+  const auto random_vector = [&](const double scale) {
+    return Eigen::Vector3d(scale * uniform(generator),
+                           scale * uniform(generator),
+                           scale * uniform(generator));
+  };
+
+  // Sequential evaluation and pools with one to three workers, every pool is
+  // reused for all trajectories
+  std::vector<std::unique_ptr<ThreadPool>> thread_pools;
+  thread_pools.push_back(nullptr);
+  for (int num_worker_threads = 1; num_worker_threads <= 3;
+       num_worker_threads++) {
+    thread_pools.push_back(
+        std::unique_ptr<ThreadPool>(new ThreadPool(num_worker_threads)));
+  }
+
+  for (int i = 0; i < 5; i++) {
+    quadrotor_common::TrajectoryPoint start_state;
+    start_state.velocity = random_vector(1.0);
+    quadrotor_common::TrajectoryPoint end_state;
+    end_state.position = random_vector(5.0);
+
+    std::vector<PolynomialTrajectory> trajectories;
+    trajectories.push_back(
+        constrained_polynomial_trajectories::computeFixedTimeTrajectory(
+            start_state, end_state, 4, 3.0 + uniform(generator)));
+    PolynomialTrajectorySettings trajectory_settings;
+    Eigen::VectorXd segment_times(6);
+    for (int j = 0; j < 5; j++) {
+      trajectory_settings.way_points.push_back(random_vector(5.0));
+      segment_times(j) = 1.5 + uniform(generator);
+    }
+    segment_times(5) = 1.5 + uniform(generator);
+    trajectory_settings.polynomial_order = 9;
+    trajectory_settings.continuity_order = 4;
+    trajectory_settings.minimization_weights = Eigen::Vector4d(0, 0, 0, 1);
+    trajectories.push_back(
+        minimum_snap_trajectories::generateMinimumSnapTrajectory(
+            segment_times, start_state, end_state, trajectory_settings));
+
+    for (const PolynomialTrajectory& trajectory : trajectories) {
+      Eigen::Vector3d expected_maxima = Eigen::Vector3d::Zero();
+      const int num_samples = trajectory.T.toSec() / 0.01 + 1;
+      for (int k = 0; k < num_samples; k++) {
+        const quadrotor_common::TrajectoryPoint state =
+            getPointFromTrajectory(trajectory, ros::Duration(0.01 * k));
+        expected_maxima = expected_maxima.cwiseMax(Eigen::Vector3d(
+            state.velocity.norm(),
+            (state.acceleration + Eigen::Vector3d(0.0, 0.0, 9.81)).norm(),
+            computeRollPitchRateNormFromTrajectoryPoint(state)));
+      }
+
+      for (const std::unique_ptr<ThreadPool>& thread_pool : thread_pools) {
+        Eigen::Vector3d maxima;
+        computeQuadRelevantMaxima(trajectory, thread_pool.get(), &maxima.x(),
+                                  &maxima.y(), &maxima.z());
+        EXPECT_TRUE(maxima.isApprox(expected_maxima, kTolerance))
+            << "Maxima: " << maxima.transpose()
+            << ", expected: " << expected_maxima.transpose();
+      }
+    }
+  }
+}
+
+TEST(GuaranteedFeasibilityTest, BoundsAreConservative) {
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+  const auto random_vector = [&](const double scale) {
+    return Eigen::Vector3d(scale * uniform(generator),
+                           scale * uniform(generator),
+                           scale * uniform(generator));
+  };
+
+  for (int i = 0; i < 20; i++) {
+    quadrotor_common::TrajectoryPoint start_state;
+    start_state.position = random_vector(5.0);
+    start_state.velocity = random_vector(1.0);
+    quadrotor_common::TrajectoryPoint end_state;
+    end_state.position = random_vector(5.0);
+
+    std::vector<PolynomialTrajectory> trajectories;
+    trajectories.push_back(
+        constrained_polynomial_trajectories::computeFixedTimeTrajectory(
+            start_state, end_state, 4, 3.0 + uniform(generator)));
+    PolynomialTrajectorySettings trajectory_settings;
+    trajectory_settings.way_points.push_back(random_vector(5.0));
+    trajectory_settings.polynomial_order = 7;
+    trajectory_settings.continuity_order = 4;
+    trajectory_settings.minimization_weights = Eigen::Vector4d(0, 0, 0, 1);
+    trajectories.push_back(
+        minimum_snap_trajectories::generateMinimumSnapTrajectory(
+            Eigen::Vector2d(2.0 + uniform(generator), 2.0 + uniform(generator)),
+            start_state, end_state, trajectory_settings));
+
+    for (const PolynomialTrajectory& trajectory : trajectories) {
+      Eigen::Vector3d maxima;
+      computeQuadRelevantMaxima(trajectory, &maxima.x(), &maxima.y(),
+                                &maxima.z());
+
+      // Generous limits are certified after subdividing
+      EXPECT_TRUE(isTrajectoryGuaranteedFeasibleUnderConstraints(
+          trajectory, 1.5 * maxima.x(), 1.5 * maxima.y(), 1.5 * maxima.z()));
+      // Violated limits are never certified
+      for (int j = 0; j < 3; j++) {
+        Eigen::Vector3d limits = 1.5 * maxima;
+        limits(j) = 0.98 * maxima(j);
+        EXPECT_FALSE(isTrajectoryGuaranteedFeasibleUnderConstraints(
+            trajectory, limits.x(), limits.y(), limits.z()));
+      }
+    }
+  }
+}
+
+}  // namespace polynomial_trajectories
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
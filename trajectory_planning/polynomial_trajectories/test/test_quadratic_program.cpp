@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "polynomial_trajectories/quadratic_program.h"
+
+namespace polynomial_trajectories {
+
+TEST(ActiveSetQuadraticProgramTest, ProjectionOntoHalfSpace) {
+  // min |x - (3, 2)|^2 subject to x_0 + x_1 <= 4
+  const Eigen::MatrixXd H = Eigen::Matrix2d::Identity();
+  const Eigen::VectorXd f = Eigen::Vector2d(-6.0, -4.0);
+  const Eigen::MatrixXd A_ineq = Eigen::RowVector2d(1.0, 1.0);
+  const Eigen::VectorXd b_ineq = Eigen::VectorXd::Constant(1, 4.0);
+
+  std::vector<int> active_set;
+  Eigen::VectorXd solution;
+  double objective_value;
+  ASSERT_TRUE(solveActiveSetQuadraticProgram(
+      H, f, Eigen::MatrixXd(0, 2), Eigen::VectorXd(0), A_ineq, b_ineq,
+      &active_set, &solution, &objective_value));
+  EXPECT_LT((solution - Eigen::Vector2d(2.5, 1.5)).norm(), 1e-10);
+  EXPECT_NEAR(0.5 - 13.0, objective_value, 1e-10);
+  ASSERT_EQ(1u, active_set.size());
+  EXPECT_EQ(0, active_set[0]);
+}
+
+TEST(ActiveSetQuadraticProgramTest, MatchesEnumerationOfActiveSets) {
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+
+  const int num_variables = 4;
+  const int num_inequalities = 6;
+  for (int trial = 0; trial < 50; trial++) {
+    Eigen::MatrixXd L(num_variables, num_variables);
+    Eigen::VectorXd f(num_variables);
+    Eigen::MatrixXd A_eq(1, num_variables);
+    Eigen::MatrixXd A_ineq(num_inequalities, num_variables);
+    for (int i = 0; i < L.size(); i++) {
+      L(i) = uniform(generator);
+    }
+    for (int i = 0; i < num_variables; i++) {
+      f(i) = 5.0 * uniform(generator);
+      A_eq(i) = uniform(generator);
+    }
+    for (int i = 0; i < A_ineq.size(); i++) {
+      A_ineq(i) = uniform(generator);
+    }
+    const Eigen::MatrixXd H =
+        L * L.transpose() +
+        0.1 * Eigen::MatrixXd::Identity(num_variables, num_variables);
+    const Eigen::VectorXd b_eq =
+        Eigen::VectorXd::Constant(1, uniform(generator));
+    // The origin shifted onto the equality constraint is strictly feasible
+    const Eigen::VectorXd x_feasible =
+        A_eq.transpose() * b_eq(0) / A_eq.squaredNorm();
+    const Eigen::VectorXd b_ineq =
+        A_ineq * x_feasible +
+        Eigen::VectorXd::Constant(num_inequalities, 0.2);
+
+    Eigen::VectorXd solution;
+    double objective_value;
+    ASSERT_TRUE(solveActiveSetQuadraticProgram(H, f, A_eq, b_eq, A_ineq,
+                                               b_ineq, nullptr, &solution,
+                                               &objective_value));
+    EXPECT_LT((A_eq * solution - b_eq).norm(), 1e-9);
+    EXPECT_LT((A_ineq * solution - b_ineq).maxCoeff(), 1e-9);
+
+    // Every feasible point satisfying the KKT conditions on a subset of the
+    // constraints is at least as expensive
+    for (int subset = 0; subset < (1 << num_inequalities); subset++) {
+      std::vector<int> rows;
+      for (int i = 0; i < num_inequalities; i++) {
+        if (subset & (1 << i)) {
+          rows.push_back(i);
+        }
+      }
+      const int num_constraints = 1 + rows.size();
+      if (num_constraints > num_variables) {
+        continue;
+      }
+      Eigen::MatrixXd A(num_constraints, num_variables);
+      Eigen::VectorXd b(num_constraints);
+      A.row(0) = A_eq;
+      b(0) = b_eq(0);
+      for (size_t j = 0; j < rows.size(); j++) {
+        A.row(j + 1) = A_ineq.row(rows[j]);
+        b(j + 1) = b_ineq(rows[j]);
+      }
+      Eigen::MatrixXd kkt = Eigen::MatrixXd::Zero(
+          num_variables + num_constraints, num_variables + num_constraints);
+      kkt.topLeftCorner(num_variables, num_variables) = 2.0 * H;
+      kkt.topRightCorner(num_variables, num_constraints) = A.transpose();
+      kkt.bottomLeftCorner(num_constraints, num_variables) = A;
+      Eigen::VectorXd rhs(num_variables + num_constraints);
+      rhs << -f, b;
+      const Eigen::VectorXd x =
+          kkt.colPivHouseholderQr().solve(rhs).head(num_variables);
+      if ((A_ineq * x - b_ineq).maxCoeff() > 1e-9) {
+        continue;
+      }
+      EXPECT_GE(x.transpose() * H * x + f.dot(x), objective_value - 1e-9);
+    }
+  }
+}
+
+TEST(ActiveSetQuadraticProgramTest, WarmStartReturnsSameSolution) {
+  // min |x - (3, 3, 3)|^2 subject to x <= (1, 1.5, 4) and x_0 + x_1 + x_2 = 5
+  const Eigen::MatrixXd H = Eigen::Matrix3d::Identity();
+  const Eigen::VectorXd f = Eigen::Vector3d::Constant(-6.0);
+  const Eigen::MatrixXd A_eq = Eigen::RowVector3d::Ones();
+  const Eigen::VectorXd b_eq = Eigen::VectorXd::Constant(1, 5.0);
+  const Eigen::MatrixXd A_ineq = Eigen::Matrix3d::Identity();
+  const Eigen::VectorXd b_ineq = Eigen::Vector3d(1.0, 1.5, 4.0);
+
+  std::vector<int> active_set;
+  Eigen::VectorXd cold_solution;
+  double cold_objective_value;
+  ASSERT_TRUE(solveActiveSetQuadraticProgram(H, f, A_eq, b_eq, A_ineq,
+                                             b_ineq, &active_set,
+                                             &cold_solution,
+                                             &cold_objective_value));
+  EXPECT_LT((cold_solution - Eigen::Vector3d(1.0, 1.5, 2.5)).norm(), 1e-10);
+  EXPECT_EQ(2u, active_set.size());
+
+  Eigen::VectorXd warm_solution;
+  double warm_objective_value;
+  ASSERT_TRUE(solveActiveSetQuadraticProgram(H, f, A_eq, b_eq, A_ineq,
+                                             b_ineq, &active_set,
+                                             &warm_solution,
+                                             &warm_objective_value));
+  EXPECT_LT((warm_solution - cold_solution).norm(), 1e-10);
+  EXPECT_EQ(2u, active_set.size());
+
+  // A warm start that is not dual feasible falls back to a cold start
+  active_set = {2};
+  ASSERT_TRUE(solveActiveSetQuadraticProgram(H, f, A_eq, b_eq, A_ineq,
+                                             b_ineq, &active_set,
+                                             &warm_solution,
+                                             &warm_objective_value));
+  EXPECT_LT((warm_solution - cold_solution).norm(), 1e-10);
+}
+
+TEST(ActiveSetQuadraticProgramTest, DetectsInfeasibility) {
+  // x_0 <= 1 and x_0 >= 2
+  const Eigen::MatrixXd H = Eigen::Matrix2d::Identity();
+  const Eigen::VectorXd f = Eigen::Vector2d::Zero();
+  Eigen::MatrixXd A_ineq(2, 2);
+  A_ineq << 1.0, 0.0, -1.0, 0.0;
+  const Eigen::VectorXd b_ineq = Eigen::Vector2d(1.0, -2.0);
+
+  Eigen::VectorXd solution;
+  double objective_value;
+  EXPECT_FALSE(solveActiveSetQuadraticProgram(
+      H, f, Eigen::MatrixXd(0, 2), Eigen::VectorXd(0), A_ineq, b_ineq,
+      nullptr, &solution, &objective_value));
+}
+
+}  // namespace polynomial_trajectories
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
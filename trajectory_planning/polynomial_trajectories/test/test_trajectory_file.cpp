@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <quadrotor_common/trajectory.h>
+#include <quadrotor_common/trajectory_point.h>
+#include <Eigen/Dense>
+
+#include "polynomial_trajectories/minimum_snap_trajectories.h"
+#include "polynomial_trajectories/polynomial_trajectories_common.h"
+#include "polynomial_trajectories/polynomial_trajectory.h"
+#include "polynomial_trajectories/polynomial_trajectory_settings.h"
+#include "polynomial_trajectories/trajectory_file.h"
+
+namespace polynomial_trajectories {
+
+namespace {
+
+PolynomialTrajectory minimumSnapTrajectory() {
+  PolynomialTrajectorySettings trajectory_settings;
+  trajectory_settings.way_points = {Eigen::Vector3d(2.0, 0.0, 1.0),
+                                    Eigen::Vector3d(2.0, 3.0, 2.0)};
+  trajectory_settings.minimization_weights =
+      Eigen::Vector4d(0.0, 1.0, 1.0, 1.0);
+  trajectory_settings.polynomial_order = 9;
+  trajectory_settings.continuity_order = 4;
+
+  quadrotor_common::TrajectoryPoint start_state;
+  start_state.heading = 0.5;
+  quadrotor_common::TrajectoryPoint end_state;
+  end_state.position = Eigen::Vector3d(0.0, 1.0, 1.0);
+
+  return minimum_snap_trajectories::generateMinimumSnapTrajectory(
+      Eigen::Vector3d(2.0, 2.5, 2.0), start_state, end_state,
+      trajectory_settings);
+}
+
+// Writes every test's file to its own temporary file, so tests running in
+// parallel never share a file
+class TrajectoryFileTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char file_name[] = "/tmp/test_trajectory_file_XXXXXX";
+    const int file_descriptor = mkstemp(file_name);
+    ASSERT_NE(-1, file_descriptor);
+    close(file_descriptor);
+    file_name_ = file_name;
+  }
+
+  void TearDown() override {
+    if (!file_name_.empty()) {
+      std::remove(file_name_.c_str());
+    }
+  }
+
+  std::string file_name_;
+};
+
+}  // namespace
+
+TEST_F(TrajectoryFileTest, PolynomialTrajectoryRoundTrip) {
+  const PolynomialTrajectory trajectory = minimumSnapTrajectory();
+  ASSERT_TRUE(saveTrajectoryFile(file_name_, trajectory));
+
+  TrajectoryFile file;
+  ASSERT_TRUE(file.open(file_name_));
+  EXPECT_EQ(TrajectoryFileContent::POLYNOMIAL, file.content());
+  ASSERT_EQ(trajectory.number_of_segments, file.numSegments());
+  EXPECT_EQ(trajectory.segment_times, Eigen::VectorXd(file.segmentTimes()));
+  for (int i = 0; i < file.numSegments(); i++) {
+    EXPECT_EQ(trajectory.coeff[i], Eigen::MatrixXd(file.coefficients(i)));
+  }
+
+  PolynomialTrajectory loaded_trajectory;
+  ASSERT_TRUE(file.load(&loaded_trajectory));
+  EXPECT_EQ(trajectory.trajectory_type, loaded_trajectory.trajectory_type);
+  EXPECT_EQ(trajectory.T.toSec(), loaded_trajectory.T.toSec());
+  EXPECT_EQ(trajectory.optimization_cost,
+            loaded_trajectory.optimization_cost);
+  EXPECT_EQ(trajectory.start_state.heading,
+            loaded_trajectory.start_state.heading);
+  EXPECT_EQ(trajectory.end_state.position,
+            loaded_trajectory.end_state.position);
+
+  const ros::Duration time(3.0);
+  EXPECT_EQ(getPointFromTrajectory(trajectory, time).position,
+            getPointFromTrajectory(loaded_trajectory, time).position);
+}
+
+TEST_F(TrajectoryFileTest, SampledTrajectoryRoundTrip) {
+  quadrotor_common::Trajectory trajectory;
+  trajectory.trajectory_type =
+      quadrotor_common::Trajectory::TrajectoryType::GENERAL;
+  for (int i = 0; i < 10; i++) {
+    quadrotor_common::TrajectoryPoint point;
+    point.time_from_start = ros::Duration(0.1 * i);
+    point.position = Eigen::Vector3d(i, 2.0 * i, 1.0);
+    point.orientation = Eigen::Quaterniond(
+        Eigen::AngleAxisd(0.1 * i, Eigen::Vector3d::UnitZ()));
+    point.velocity = Eigen::Vector3d(1.0, 2.0, 0.0);
+    point.heading = 0.1 * i;
+    trajectory.points.push_back(point);
+  }
+  ASSERT_TRUE(saveTrajectoryFile(file_name_, trajectory));
+
+  TrajectoryFile file;
+  ASSERT_TRUE(file.open(file_name_));
+  EXPECT_EQ(TrajectoryFileContent::SAMPLED, file.content());
+  ASSERT_EQ(int(trajectory.points.size()), file.numPoints());
+  EXPECT_EQ(0.9, file.point(9).heading);
+
+  quadrotor_common::Trajectory loaded_trajectory;
+  ASSERT_TRUE(file.load(&loaded_trajectory));
+  EXPECT_EQ(trajectory.trajectory_type, loaded_trajectory.trajectory_type);
+  ASSERT_EQ(trajectory.points.size(), loaded_trajectory.points.size());
+  auto loaded_point = loaded_trajectory.points.begin();
+  for (const quadrotor_common::TrajectoryPoint& point : trajectory.points) {
+    EXPECT_EQ(point.time_from_start.toSec(),
+              loaded_point->time_from_start.toSec());
+    EXPECT_EQ(point.position, loaded_point->position);
+    EXPECT_EQ(point.orientation.coeffs(), loaded_point->orientation.coeffs());
+    EXPECT_EQ(point.velocity, loaded_point->velocity);
+    EXPECT_EQ(point.heading, loaded_point->heading);
+    loaded_point++;
+  }
+}
+
+TEST_F(TrajectoryFileTest, RejectsInvalidFiles) {
+  ASSERT_TRUE(saveTrajectoryFile(file_name_, minimumSnapTrajectory()));
+
+  // Truncated file
+  {
+    std::ifstream input(file_name_, std::ios::binary);
+    const std::string content((std::istreambuf_iterator<char>(input)),
+                              std::istreambuf_iterator<char>());
+    input.close();
+    std::ofstream output(file_name_, std::ios::binary | std::ios::trunc);
+    output.write(content.data(), content.size() - 8);
+  }
+  TrajectoryFile file;
+  EXPECT_FALSE(file.open(file_name_));
+  EXPECT_FALSE(file.isOpen());
+
+  // Different version
+  ASSERT_TRUE(saveTrajectoryFile(file_name_, minimumSnapTrajectory()));
+  {
+    std::fstream output(file_name_,
+                        std::ios::binary | std::ios::in | std::ios::out);
+    const uint32_t version = kTrajectoryFileVersion + 1;
+    output.seekp(offsetof(TrajectoryFileHeader, version));
+    output.write(reinterpret_cast<const char*>(&version), sizeof(version));
+  }
+  EXPECT_FALSE(file.open(file_name_));
+}
+
+}  // namespace polynomial_trajectories
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,79 @@
+// Google Benchmark suite of the trajectory sampling. Run with
+// --benchmark_format=json or --benchmark_out=<file> to get machine readable
+// results that can be compared over time.
+#include <benchmark/benchmark.h>
+#include <random>
+
+#include <polynomial_trajectories/constrained_polynomial_trajectories.h>
+#include <polynomial_trajectories/minimum_snap_trajectories.h>
+#include <polynomial_trajectories/polynomial_trajectory.h>
+#include <polynomial_trajectories/polynomial_trajectory_settings.h>
+#include <quadrotor_common/trajectory_point.h>
+#include <Eigen/Dense>
+
+#include "trajectory_generation_helper/polynomial_trajectory_helper.h"
+
+namespace trajectory_generation_helper {
+
+namespace {
+
+static constexpr int kRandomSeed = 42;
+static constexpr double kSegmentTime = 2.0;
+
+// Arguments: sampling frequency, number of way points of an order 9 minimum
+// snap trajectory
+void BM_SampleMinimumSnapPolynomial(benchmark::State& state) {
+  std::mt19937 generator(kRandomSeed);
+  std::uniform_real_distribution<double> uniform(-5.0, 5.0);
+  polynomial_trajectories::PolynomialTrajectorySettings trajectory_settings;
+  for (int i = 0; i < state.range(1); i++) {
+    trajectory_settings.way_points.push_back(Eigen::Vector3d(
+        uniform(generator), uniform(generator), uniform(generator)));
+  }
+  trajectory_settings.minimization_weights = Eigen::VectorXd::Unit(5, 4);
+  trajectory_settings.polynomial_order = 9;
+  trajectory_settings.continuity_order = 4;
+  quadrotor_common::TrajectoryPoint start_state;
+  quadrotor_common::TrajectoryPoint end_state;
+  end_state.position = Eigen::Vector3d(6.0, 0.0, 1.0);
+  const polynomial_trajectories::PolynomialTrajectory polynomial =
+      polynomial_trajectories::minimum_snap_trajectories::
+          generateMinimumSnapTrajectory(
+              Eigen::VectorXd::Constant(state.range(1) + 1, kSegmentTime),
+              start_state, end_state, trajectory_settings);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        polynomials::samplePolynomial(polynomial, state.range(0)));
+  }
+}
+BENCHMARK(BM_SampleMinimumSnapPolynomial)
+    ->Args({50, 4})
+    ->Args({100, 4})
+    ->Args({100, 16})
+    ->Unit(benchmark::kMicrosecond);
+
+// Arguments: sampling frequency
+void BM_SampleFullyConstrainedPolynomial(benchmark::State& state) {
+  quadrotor_common::TrajectoryPoint start_state;
+  quadrotor_common::TrajectoryPoint end_state;
+  end_state.position = Eigen::Vector3d(6.0, 0.0, 1.0);
+  const polynomial_trajectories::PolynomialTrajectory polynomial =
+      polynomial_trajectories::constrained_polynomial_trajectories::
+          computeFixedTimeTrajectory(start_state, end_state, 5, kSegmentTime);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        polynomials::samplePolynomial(polynomial, state.range(0)));
+  }
+}
+BENCHMARK(BM_SampleFullyConstrainedPolynomial)
+    ->Arg(50)
+    ->Arg(100)
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+
+}  // namespace trajectory_generation_helper
+
+BENCHMARK_MAIN();
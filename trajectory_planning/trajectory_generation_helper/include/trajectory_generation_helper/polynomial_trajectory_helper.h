@@ -6,6 +6,8 @@
 #include <quadrotor_common/trajectory_point.h>
 #include <Eigen/Dense>
 
+#include "trajectory_generation_helper/trajectory_cache.h"
+
 namespace trajectory_generation_helper {
 
 namespace polynomials {
@@ -16,6 +18,15 @@ quadrotor_common::Trajectory computeTimeOptimalTrajectory(
     const quadrotor_common::TrajectoryPoint& s1, const int order_of_continuity,
     const double max_velocity, const double max_normalized_thrust,
     const double max_roll_pitch_rate, const double sampling_frequency);
+// Returns the trajectory from the cache if the same problem was solved
+// before. Since the trajectory does not depend on the absolute start position
+// it is also reused for translated start and end states.
+quadrotor_common::Trajectory computeTimeOptimalTrajectory(
+    const quadrotor_common::TrajectoryPoint& s0,
+    const quadrotor_common::TrajectoryPoint& s1, const int order_of_continuity,
+    const double max_velocity, const double max_normalized_thrust,
+    const double max_roll_pitch_rate, const double sampling_frequency,
+    TrajectoryCache* cache);
 
 quadrotor_common::Trajectory computeFixedTimeTrajectory(
     const quadrotor_common::TrajectoryPoint& s0,
@@ -55,6 +66,21 @@ quadrotor_common::Trajectory generateMinimumSnapTrajectoryWithSegmentRefinement(
     const double max_velocity, const double max_normalized_thrust,
     const double max_roll_pitch_rate, const double sampling_frequency);
 
+// Receding horizon replanning of a minimum snap trajectory that is being
+// executed, see polynomial_trajectories::minimum_snap_trajectories::
+// replanMinimumSnapTrajectory. The polynomial is replaced by the replanned
+// one such that it can be replanned again later on, it is kept if replanning
+// fails. The returned trajectory starts at time_from_start of the original
+// polynomial.
+quadrotor_common::Trajectory replanMinimumSnapTrajectory(
+    const ros::Duration& time_from_start,
+    const quadrotor_common::TrajectoryPoint& start_state,
+    const int horizon_segments,
+    const polynomial_trajectories::PolynomialTrajectorySettings&
+        trajectory_settings,
+    const double sampling_frequency,
+    polynomial_trajectories::PolynomialTrajectory* polynomial);
+
 quadrotor_common::Trajectory generateMinimumSnapRingTrajectory(
     const Eigen::VectorXd& segment_times,
     const polynomial_trajectories::PolynomialTrajectorySettings&
@@ -80,6 +106,21 @@ generateMinimumSnapRingTrajectoryWithSegmentRefinement(
         trajectory_settings,
     const double max_velocity, const double max_normalized_thrust,
     const double max_roll_pitch_rate, const double sampling_frequency);
+// Return the trajectory from the cache if the same problem was solved before
+quadrotor_common::Trajectory
+generateMinimumSnapRingTrajectoryWithSegmentRefinement(
+    const Eigen::VectorXd& initial_segment_times,
+    const polynomial_trajectories::PolynomialTrajectorySettings&
+        trajectory_settings,
+    const double sampling_frequency, TrajectoryCache* cache);
+quadrotor_common::Trajectory
+generateMinimumSnapRingTrajectoryWithSegmentRefinement(
+    const Eigen::VectorXd& initial_segment_times,
+    const polynomial_trajectories::PolynomialTrajectorySettings&
+        trajectory_settings,
+    const double max_velocity, const double max_normalized_thrust,
+    const double max_roll_pitch_rate, const double sampling_frequency,
+    TrajectoryCache* cache);
 
 // Sampling function
 quadrotor_common::Trajectory samplePolynomial(
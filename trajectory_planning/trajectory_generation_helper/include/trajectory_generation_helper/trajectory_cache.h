@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <quadrotor_common/trajectory.h>
+
+namespace trajectory_generation_helper {
+
+namespace polynomials {
+
+// Least recently used cache of sampled trajectories. The key is the list of
+// all problem parameters the trajectory depends on, their hash only selects
+// the bucket so different problems never share an entry.
+// All member functions are thread safe.
+class TrajectoryCache {
+ public:
+  typedef std::vector<double> Key;
+
+  explicit TrajectoryCache(const size_t capacity);
+
+  ~TrajectoryCache();
+
+  bool lookup(const Key& key, quadrotor_common::Trajectory* trajectory);
+  void insert(const Key& key, const quadrotor_common::Trajectory& trajectory);
+  void clear();
+
+  size_t size() const;
+  size_t capacity() const;
+  uint64_t hits() const;
+  uint64_t misses() const;
+
+ private:
+  struct KeyHash {
+    size_t operator()(const Key& key) const;
+  };
+
+  typedef std::list<std::pair<Key, quadrotor_common::Trajectory>> EntryList;
+
+  mutable std::mutex mutex_;
+  const size_t capacity_;
+  // Most recently used entry first
+  EntryList entries_;
+  std::unordered_map<Key, EntryList::iterator, KeyHash> entry_map_;
+  uint64_t hits_;
+  uint64_t misses_;
+};
+
+}  // namespace polynomials
+
+}  // namespace trajectory_generation_helper
@@ -8,6 +8,58 @@ namespace trajectory_generation_helper {
 
 namespace polynomials {
 
+namespace {
+
+// Distinguishes the keys of different problem types in a shared cache
+enum class CachedProblemType {
+  TIME_OPTIMAL,
+  RING_WITH_SEGMENT_REFINEMENT,
+  CONSTRAINED_RING_WITH_SEGMENT_REFINEMENT
+};
+
+void appendToKey(const Eigen::VectorXd& values, TrajectoryCache::Key* key) {
+  key->push_back(values.size());
+  key->insert(key->end(), values.data(), values.data() + values.size());
+}
+
+TrajectoryCache::Key ringTrajectoryCacheKey(
+    const CachedProblemType problem_type,
+    const Eigen::VectorXd& initial_segment_times,
+    const polynomial_trajectories::PolynomialTrajectorySettings&
+        trajectory_settings,
+    const double sampling_frequency) {
+  TrajectoryCache::Key key;
+  key.push_back(static_cast<double>(problem_type));
+  appendToKey(initial_segment_times, &key);
+  key.push_back(trajectory_settings.way_points.size());
+  for (const Eigen::Vector3d& way_point : trajectory_settings.way_points) {
+    appendToKey(way_point, &key);
+  }
+  key.push_back(trajectory_settings.heading_way_points.size());
+  key.insert(key.end(), trajectory_settings.heading_way_points.begin(),
+             trajectory_settings.heading_way_points.end());
+  key.push_back(trajectory_settings.optimize_heading);
+  key.push_back(trajectory_settings.corridor_lower_bounds.size());
+  for (const Eigen::Vector3d& bound :
+       trajectory_settings.corridor_lower_bounds) {
+    appendToKey(bound, &key);
+  }
+  key.push_back(trajectory_settings.corridor_upper_bounds.size());
+  for (const Eigen::Vector3d& bound :
+       trajectory_settings.corridor_upper_bounds) {
+    appendToKey(bound, &key);
+  }
+  appendToKey(trajectory_settings.minimization_weights, &key);
+  key.push_back(trajectory_settings.polynomial_order);
+  key.push_back(trajectory_settings.continuity_order);
+  key.push_back(static_cast<double>(trajectory_settings.minimum_snap_solver));
+  key.push_back(sampling_frequency);
+
+  return key;
+}
+
+}  // namespace
+
 // Constrained Polynomials
 quadrotor_common::Trajectory computeTimeOptimalTrajectory(
     const quadrotor_common::TrajectoryPoint& s0,
@@ -23,6 +75,65 @@ quadrotor_common::Trajectory computeTimeOptimalTrajectory(
   return samplePolynomial(polynomial, sampling_frequency);
 }
 
+quadrotor_common::Trajectory computeTimeOptimalTrajectory(
+    const quadrotor_common::TrajectoryPoint& s0,
+    const quadrotor_common::TrajectoryPoint& s1, const int order_of_continuity,
+    const double max_velocity, const double max_normalized_thrust,
+    const double max_roll_pitch_rate, const double sampling_frequency,
+    TrajectoryCache* cache) {
+  if (cache == nullptr) {
+    return computeTimeOptimalTrajectory(
+        s0, s1, order_of_continuity, max_velocity, max_normalized_thrust,
+        max_roll_pitch_rate, sampling_frequency);
+  }
+
+  // The trajectory is computed and cached relative to the start position
+  quadrotor_common::TrajectoryPoint normalized_s0 = s0;
+  normalized_s0.position = Eigen::Vector3d::Zero();
+  quadrotor_common::TrajectoryPoint normalized_s1 = s1;
+  normalized_s1.position = s1.position - s0.position;
+
+  TrajectoryCache::Key key;
+  key.push_back(static_cast<double>(CachedProblemType::TIME_OPTIMAL));
+  appendToKey(normalized_s1.position, &key);
+  for (const quadrotor_common::TrajectoryPoint* state : {&s0, &s1}) {
+    appendToKey(state->velocity, &key);
+    appendToKey(state->acceleration, &key);
+    appendToKey(state->jerk, &key);
+    appendToKey(state->snap, &key);
+  }
+  key.push_back(order_of_continuity);
+  key.push_back(max_velocity);
+  key.push_back(max_normalized_thrust);
+  key.push_back(max_roll_pitch_rate);
+  key.push_back(sampling_frequency);
+
+  quadrotor_common::Trajectory trajectory;
+  if (!cache->lookup(key, &trajectory)) {
+    trajectory = computeTimeOptimalTrajectory(
+        normalized_s0, normalized_s1, order_of_continuity, max_velocity,
+        max_normalized_thrust, max_roll_pitch_rate, sampling_frequency);
+    if (trajectory.trajectory_type ==
+        quadrotor_common::Trajectory::TrajectoryType::UNDEFINED) {
+      return trajectory;
+    }
+    cache->insert(key, trajectory);
+  }
+
+  for (quadrotor_common::TrajectoryPoint& point : trajectory.points) {
+    point.position += s0.position;
+  }
+  // Restore the exact start and end states, including the members that do
+  // not enter the key
+  const ros::Duration duration = trajectory.points.back().time_from_start;
+  trajectory.points.front() = s0;
+  trajectory.points.front().time_from_start = ros::Duration(0.0);
+  trajectory.points.back() = s1;
+  trajectory.points.back().time_from_start = duration;
+
+  return trajectory;
+}
+
 quadrotor_common::Trajectory computeFixedTimeTrajectory(
     const quadrotor_common::TrajectoryPoint& s0,
     const quadrotor_common::TrajectoryPoint& s1, const int order_of_continuity,
@@ -103,6 +214,29 @@ quadrotor_common::Trajectory generateMinimumSnapTrajectoryWithSegmentRefinement(
   return samplePolynomial(polynomial, sampling_frequency);
 }
 
+quadrotor_common::Trajectory replanMinimumSnapTrajectory(
+    const ros::Duration& time_from_start,
+    const quadrotor_common::TrajectoryPoint& start_state,
+    const int horizon_segments,
+    const polynomial_trajectories::PolynomialTrajectorySettings&
+        trajectory_settings,
+    const double sampling_frequency,
+    polynomial_trajectories::PolynomialTrajectory* polynomial) {
+  const polynomial_trajectories::PolynomialTrajectory replanned_polynomial =
+      polynomial_trajectories::minimum_snap_trajectories::
+          replanMinimumSnapTrajectory(*polynomial, time_from_start,
+                                      start_state, horizon_segments,
+                                      trajectory_settings);
+  if (replanned_polynomial.trajectory_type ==
+      polynomial_trajectories::TrajectoryType::UNDEFINED) {
+    return quadrotor_common::Trajectory();
+  }
+
+  *polynomial = replanned_polynomial;
+
+  return samplePolynomial(*polynomial, sampling_frequency);
+}
+
 quadrotor_common::Trajectory generateMinimumSnapRingTrajectory(
     const Eigen::VectorXd& segment_times,
     const polynomial_trajectories::PolynomialTrajectorySettings&
@@ -160,6 +294,69 @@ generateMinimumSnapRingTrajectoryWithSegmentRefinement(
   return samplePolynomial(polynomial, sampling_frequency);
 }
 
+quadrotor_common::Trajectory
+generateMinimumSnapRingTrajectoryWithSegmentRefinement(
+    const Eigen::VectorXd& initial_segment_times,
+    const polynomial_trajectories::PolynomialTrajectorySettings&
+        trajectory_settings,
+    const double sampling_frequency, TrajectoryCache* cache) {
+  if (cache == nullptr) {
+    return generateMinimumSnapRingTrajectoryWithSegmentRefinement(
+        initial_segment_times, trajectory_settings, sampling_frequency);
+  }
+
+  const TrajectoryCache::Key key = ringTrajectoryCacheKey(
+      CachedProblemType::RING_WITH_SEGMENT_REFINEMENT, initial_segment_times,
+      trajectory_settings, sampling_frequency);
+
+  quadrotor_common::Trajectory trajectory;
+  if (!cache->lookup(key, &trajectory)) {
+    trajectory = generateMinimumSnapRingTrajectoryWithSegmentRefinement(
+        initial_segment_times, trajectory_settings, sampling_frequency);
+    if (trajectory.trajectory_type !=
+        quadrotor_common::Trajectory::TrajectoryType::UNDEFINED) {
+      cache->insert(key, trajectory);
+    }
+  }
+
+  return trajectory;
+}
+
+quadrotor_common::Trajectory
+generateMinimumSnapRingTrajectoryWithSegmentRefinement(
+    const Eigen::VectorXd& initial_segment_times,
+    const polynomial_trajectories::PolynomialTrajectorySettings&
+        trajectory_settings,
+    const double max_velocity, const double max_normalized_thrust,
+    const double max_roll_pitch_rate, const double sampling_frequency,
+    TrajectoryCache* cache) {
+  if (cache == nullptr) {
+    return generateMinimumSnapRingTrajectoryWithSegmentRefinement(
+        initial_segment_times, trajectory_settings, max_velocity,
+        max_normalized_thrust, max_roll_pitch_rate, sampling_frequency);
+  }
+
+  TrajectoryCache::Key key = ringTrajectoryCacheKey(
+      CachedProblemType::CONSTRAINED_RING_WITH_SEGMENT_REFINEMENT,
+      initial_segment_times, trajectory_settings, sampling_frequency);
+  key.push_back(max_velocity);
+  key.push_back(max_normalized_thrust);
+  key.push_back(max_roll_pitch_rate);
+
+  quadrotor_common::Trajectory trajectory;
+  if (!cache->lookup(key, &trajectory)) {
+    trajectory = generateMinimumSnapRingTrajectoryWithSegmentRefinement(
+        initial_segment_times, trajectory_settings, max_velocity,
+        max_normalized_thrust, max_roll_pitch_rate, sampling_frequency);
+    if (trajectory.trajectory_type !=
+        quadrotor_common::Trajectory::TrajectoryType::UNDEFINED) {
+      cache->insert(key, trajectory);
+    }
+  }
+
+  return trajectory;
+}
+
 // Sampling function
 quadrotor_common::Trajectory samplePolynomial(
     const polynomial_trajectories::PolynomialTrajectory& polynomial,
@@ -0,0 +1,89 @@
+#include "trajectory_generation_helper/trajectory_cache.h"
+
+#include <functional>
+
+namespace trajectory_generation_helper {
+
+namespace polynomials {
+
+TrajectoryCache::TrajectoryCache(const size_t capacity)
+    : capacity_(capacity), hits_(0), misses_(0) {}
+
+TrajectoryCache::~TrajectoryCache() {}
+
+bool TrajectoryCache::lookup(const Key& key,
+                             quadrotor_common::Trajectory* trajectory) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  const auto entry = entry_map_.find(key);
+  if (entry == entry_map_.end()) {
+    misses_++;
+    return false;
+  }
+
+  entries_.splice(entries_.begin(), entries_, entry->second);
+  *trajectory = entry->second->second;
+  hits_++;
+
+  return true;
+}
+
+void TrajectoryCache::insert(const Key& key,
+                             const quadrotor_common::Trajectory& trajectory) {
+  if (capacity_ == 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  const auto entry = entry_map_.find(key);
+  if (entry != entry_map_.end()) {
+    entry->second->second = trajectory;
+    entries_.splice(entries_.begin(), entries_, entry->second);
+    return;
+  }
+
+  if (entries_.size() >= capacity_) {
+    entry_map_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+  entries_.emplace_front(key, trajectory);
+  entry_map_[key] = entries_.begin();
+}
+
+void TrajectoryCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  entries_.clear();
+  entry_map_.clear();
+}
+
+size_t TrajectoryCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+size_t TrajectoryCache::capacity() const { return capacity_; }
+
+uint64_t TrajectoryCache::hits() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return hits_;
+}
+
+uint64_t TrajectoryCache::misses() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return misses_;
+}
+
+size_t TrajectoryCache::KeyHash::operator()(const Key& key) const {
+  size_t hash = key.size();
+  for (const double value : key) {
+    hash ^= std::hash<double>()(value) + 0x9e3779b9 + (hash << 6) +
+            (hash >> 2);
+  }
+  return hash;
+}
+
+}  // namespace polynomials
+
+}  // namespace trajectory_generation_helper
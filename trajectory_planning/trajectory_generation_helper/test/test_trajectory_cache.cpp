@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+
+#include <quadrotor_common/trajectory.h>
+#include <quadrotor_common/trajectory_point.h>
+#include <Eigen/Dense>
+
+#include "trajectory_generation_helper/polynomial_trajectory_helper.h"
+#include "trajectory_generation_helper/trajectory_cache.h"
+
+namespace trajectory_generation_helper {
+
+namespace polynomials {
+
+TEST(TrajectoryCacheTest, EvictsLeastRecentlyUsedEntry) {
+  TrajectoryCache cache(2);
+  quadrotor_common::Trajectory trajectory;
+  trajectory.points.push_back(quadrotor_common::TrajectoryPoint());
+
+  cache.insert({1.0}, trajectory);
+  cache.insert({2.0}, trajectory);
+  // Looking up the first entry makes the second one the least recently used
+  quadrotor_common::Trajectory cached_trajectory;
+  EXPECT_TRUE(cache.lookup({1.0}, &cached_trajectory));
+  EXPECT_EQ(1u, cached_trajectory.points.size());
+  cache.insert({3.0}, trajectory);
+
+  EXPECT_EQ(2u, cache.size());
+  EXPECT_TRUE(cache.lookup({1.0}, &cached_trajectory));
+  EXPECT_FALSE(cache.lookup({2.0}, &cached_trajectory));
+  EXPECT_TRUE(cache.lookup({3.0}, &cached_trajectory));
+  EXPECT_EQ(3u, cache.hits());
+  EXPECT_EQ(1u, cache.misses());
+}
+
+TEST(TrajectoryCacheTest, ReusesTimeOptimalTrajectoryForTranslatedStates) {
+  const int kOrderOfContinuity = 5;
+  const double kMaxVelocity = 2.0;
+  const double kMaxNormalizedThrust = 12.0;
+  const double kMaxRollPitchRate = 0.5;
+  const double kSamplingFrequency = 50.0;
+
+  quadrotor_common::TrajectoryPoint start_state;
+  start_state.position = Eigen::Vector3d(0.0, 0.0, 1.0);
+  quadrotor_common::TrajectoryPoint end_state;
+  end_state.position = Eigen::Vector3d(2.0, 1.0, 1.5);
+  end_state.heading = 1.0;
+
+  TrajectoryCache cache(10);
+  const quadrotor_common::Trajectory first_trajectory =
+      computeTimeOptimalTrajectory(
+          start_state, end_state, kOrderOfContinuity, kMaxVelocity,
+          kMaxNormalizedThrust, kMaxRollPitchRate, kSamplingFrequency, &cache);
+  EXPECT_EQ(0u, cache.hits());
+  EXPECT_EQ(1u, cache.misses());
+
+  const Eigen::Vector3d offset(-3.0, 4.0, 0.5);
+  start_state.position += offset;
+  end_state.position += offset;
+  const quadrotor_common::Trajectory reference =
+      computeTimeOptimalTrajectory(start_state, end_state, kOrderOfContinuity,
+                                   kMaxVelocity, kMaxNormalizedThrust,
+                                   kMaxRollPitchRate, kSamplingFrequency);
+  const quadrotor_common::Trajectory cached_trajectory =
+      computeTimeOptimalTrajectory(
+          start_state, end_state, kOrderOfContinuity, kMaxVelocity,
+          kMaxNormalizedThrust, kMaxRollPitchRate, kSamplingFrequency, &cache);
+  EXPECT_EQ(1u, cache.hits());
+  EXPECT_EQ(1u, cache.misses());
+
+  ASSERT_EQ(first_trajectory.points.size(), cached_trajectory.points.size());
+  ASSERT_EQ(reference.points.size(), cached_trajectory.points.size());
+  auto reference_point = reference.points.begin();
+  for (const quadrotor_common::TrajectoryPoint& point :
+       cached_trajectory.points) {
+    EXPECT_LT((reference_point->position - point.position).norm(), 1e-9);
+    EXPECT_LT((reference_point->velocity - point.velocity).norm(), 1e-9);
+    EXPECT_NEAR(reference_point->time_from_start.toSec(),
+                point.time_from_start.toSec(), 1e-9);
+    reference_point++;
+  }
+  EXPECT_EQ(end_state.position, cached_trajectory.points.back().position);
+  EXPECT_EQ(end_state.heading, cached_trajectory.points.back().heading);
+}
+
+}  // namespace polynomials
+
+}  // namespace trajectory_generation_helper
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <string>
+
+#include <ros/ros.h>
+#include <XmlRpcValue.h>
+
+namespace parameter_dictionary {
+
+// Holds all parameters of a namespace that are fetched from the parameter
+// server with a single request. Parameters are then looked up locally with
+// the same relative names as used with quadrotor_common::getParam, which
+// saves one parameter server round trip per parameter.
+// A dictionary can also be constructed from an XmlRpcValue directly which
+// allows loading parameters without a running master, e.g. in tests.
+class ParameterDictionary {
+ public:
+  ParameterDictionary() : parameters_(), namespace_() {}
+
+  ParameterDictionary(const XmlRpc::XmlRpcValue& parameters,
+                      const std::string& ns)
+      : parameters_(parameters), namespace_(ns) {}
+
+  // Fetches all parameters in the namespace of the node handle at once
+  bool fetch(const ros::NodeHandle& nh) {
+    namespace_ = nh.getNamespace();
+    if (!ros::param::get(namespace_, parameters_) ||
+        parameters_.getType() != XmlRpc::XmlRpcValue::TypeStruct) {
+      ROS_ERROR("[%s] Could not fetch parameters in namespace %s",
+                ros::this_node::getName().c_str(), namespace_.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  bool hasParam(const std::string& name) const {
+    return find(name) != nullptr;
+  }
+
+  // Returns the dictionary of the sub namespace name or an empty dictionary
+  // if it does not exist
+  ParameterDictionary subDictionary(const std::string& name) const {
+    const XmlRpc::XmlRpcValue* value = find(name);
+    if (value == nullptr ||
+        value->getType() != XmlRpc::XmlRpcValue::TypeStruct) {
+      return ParameterDictionary(XmlRpc::XmlRpcValue(),
+                                 namespace_ + "/" + name);
+    }
+    return ParameterDictionary(*value, namespace_ + "/" + name);
+  }
+
+  template <typename T>
+  bool getParam(const std::string& name, T& parameter) const {
+    const XmlRpc::XmlRpcValue* value = find(name);
+    if (value == nullptr || !convert(*value, &parameter)) {
+      ROS_ERROR("[%s] Could not load parameter %s/%s",
+                ros::this_node::getName().c_str(), namespace_.c_str(),
+                name.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  template <typename T>
+  bool getParam(const std::string& name, T& parameter,
+                const T& default_value) const {
+    const XmlRpc::XmlRpcValue* value = find(name);
+    if (value == nullptr || !convert(*value, &parameter)) {
+      parameter = default_value;
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  // Resolves a relative name like "position_controller/kpxy" within the
+  // dictionary, returns nullptr if it does not exist
+  const XmlRpc::XmlRpcValue* find(const std::string& name) const {
+    // XmlRpcValue only provides a non-const member access
+    XmlRpc::XmlRpcValue* value = &parameters_;
+    std::string::size_type begin = 0;
+    while (begin <= name.size()) {
+      std::string::size_type end = name.find('/', begin);
+      if (end == std::string::npos) {
+        end = name.size();
+      }
+      const std::string key = name.substr(begin, end - begin);
+      if (!key.empty()) {
+        if (value->getType() != XmlRpc::XmlRpcValue::TypeStruct ||
+            !value->hasMember(key)) {
+          return nullptr;
+        }
+        value = &(*value)[key];
+      }
+      begin = end + 1;
+    }
+    return value;
+  }
+
+  static bool convert(const XmlRpc::XmlRpcValue& value, bool* parameter) {
+    if (value.getType() != XmlRpc::XmlRpcValue::TypeBoolean) {
+      return false;
+    }
+    *parameter = static_cast<bool>(const_cast<XmlRpc::XmlRpcValue&>(value));
+    return true;
+  }
+
+  static bool convert(const XmlRpc::XmlRpcValue& value, int* parameter) {
+    if (value.getType() != XmlRpc::XmlRpcValue::TypeInt) {
+      return false;
+    }
+    *parameter = static_cast<int>(const_cast<XmlRpc::XmlRpcValue&>(value));
+    return true;
+  }
+
+  static bool convert(const XmlRpc::XmlRpcValue& value, double* parameter) {
+    // Integers are accepted as well since YAML does not distinguish between
+    // 1 and 1.0 the way we would like it to
+    if (value.getType() == XmlRpc::XmlRpcValue::TypeDouble) {
+      *parameter =
+          static_cast<double>(const_cast<XmlRpc::XmlRpcValue&>(value));
+      return true;
+    }
+    if (value.getType() == XmlRpc::XmlRpcValue::TypeInt) {
+      *parameter = static_cast<int>(const_cast<XmlRpc::XmlRpcValue&>(value));
+      return true;
+    }
+    return false;
+  }
+
+  static bool convert(const XmlRpc::XmlRpcValue& value, float* parameter) {
+    double double_parameter;
+    if (!convert(value, &double_parameter)) {
+      return false;
+    }
+    *parameter = static_cast<float>(double_parameter);
+    return true;
+  }
+
+  static bool convert(const XmlRpc::XmlRpcValue& value,
+                      std::string* parameter) {
+    if (value.getType() != XmlRpc::XmlRpcValue::TypeString) {
+      return false;
+    }
+    *parameter =
+        static_cast<std::string>(const_cast<XmlRpc::XmlRpcValue&>(value));
+    return true;
+  }
+
+  mutable XmlRpc::XmlRpcValue parameters_;
+  std::string namespace_;
+};
+
+}  // namespace parameter_dictionary
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include <string>
+
+#include <XmlRpcValue.h>
+
+#include "parameter_dictionary/parameter_dictionary.h"
+
+namespace parameter_dictionary {
+
+namespace {
+
+ParameterDictionary testDictionary() {
+  XmlRpc::XmlRpcValue parameters;
+  parameters["state_estimate_timeout"] = 0.2;
+  parameters["enable_command_feedthrough"] = false;
+  parameters["n_lipo_cells"] = 4;
+  parameters["port_name"] = std::string("/dev/ttyUSB0");
+  parameters["position_controller"]["kpxy"] = 10;
+  parameters["position_controller"]["kdxy"] = 4.0;
+
+  return ParameterDictionary(parameters, "/test_node");
+}
+
+}  // namespace
+
+TEST(ParameterDictionaryTest, LoadsScalarTypes) {
+  const ParameterDictionary dictionary = testDictionary();
+
+  double state_estimate_timeout;
+  EXPECT_TRUE(
+      dictionary.getParam("state_estimate_timeout", state_estimate_timeout));
+  EXPECT_DOUBLE_EQ(0.2, state_estimate_timeout);
+
+  bool enable_command_feedthrough = true;
+  EXPECT_TRUE(dictionary.getParam("enable_command_feedthrough",
+                                  enable_command_feedthrough));
+  EXPECT_FALSE(enable_command_feedthrough);
+
+  int n_lipo_cells;
+  EXPECT_TRUE(dictionary.getParam("n_lipo_cells", n_lipo_cells));
+  EXPECT_EQ(4, n_lipo_cells);
+
+  std::string port_name;
+  EXPECT_TRUE(dictionary.getParam("port_name", port_name));
+  EXPECT_EQ("/dev/ttyUSB0", port_name);
+}
+
+TEST(ParameterDictionaryTest, ResolvesNestedNames) {
+  const ParameterDictionary dictionary = testDictionary();
+
+  // Integers in the YAML file are accepted for floating point parameters
+  double kpxy;
+  EXPECT_TRUE(dictionary.getParam("position_controller/kpxy", kpxy));
+  EXPECT_DOUBLE_EQ(10.0, kpxy);
+
+  float kdxy;
+  EXPECT_TRUE(dictionary.getParam("position_controller/kdxy", kdxy));
+  EXPECT_FLOAT_EQ(4.0f, kdxy);
+
+  EXPECT_TRUE(dictionary.hasParam("position_controller"));
+  const ParameterDictionary sub_dictionary =
+      dictionary.subDictionary("position_controller");
+  EXPECT_TRUE(sub_dictionary.getParam("kdxy", kdxy));
+  EXPECT_FALSE(sub_dictionary.hasParam("state_estimate_timeout"));
+}
+
+TEST(ParameterDictionaryTest, RejectsMissingAndMistypedParameters) {
+  const ParameterDictionary dictionary = testDictionary();
+
+  double value;
+  EXPECT_FALSE(dictionary.getParam("position_controller/kpz", value));
+  EXPECT_FALSE(dictionary.getParam("port_name", value));
+  EXPECT_FALSE(dictionary.getParam("state_estimate_timeout/kpz", value));
+
+  int n_lipo_cells;
+  EXPECT_FALSE(dictionary.getParam("state_estimate_timeout", n_lipo_cells));
+
+  EXPECT_FALSE(dictionary.getParam("kpz", value, 15.0));
+  EXPECT_DOUBLE_EQ(15.0, value);
+}
+
+}  // namespace parameter_dictionary
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}